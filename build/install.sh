@@ -123,6 +123,8 @@ function install_meta() {
     for PROBE_PATH in ${PROBES_PATH_LIST}; do
         cp ${PROBE_PATH}/*.meta ${GOPHER_META_DIR}
     done
+    # gopher self-metrics
+    cp ${PROJECT_FOLDER}/src/lib/probe/*.meta ${GOPHER_META_DIR}
     echo "install meta file of native probes success."
 }
 
@@ -38,7 +38,7 @@ URL:           https://gitee.com/openeuler/gala-gopher
 Source:        %{name}-%{version}.tar.gz
 BuildRoot:     %{_builddir}/%{name}-%{version}
 BuildRequires: systemd cmake gcc-c++ elfutils-devel clang llvm bpftool >= 6.8
-BuildRequires: libconfig-devel libevent-devel openssl-devel libbpf-devel >= 2:0.8 uthash-devel
+BuildRequires: libconfig-devel libevent-devel openssl-devel libbpf-devel >= 2:0.8 uthash-devel zlib-devel
 BuildRequires: jsoncpp-devel git libstdc++-devel
 # for DT
 #BuildRequires: CUnit-devel
@@ -57,7 +57,7 @@ BuildRequires: jsoncpp-devel java-1.8.0-openjdk-devel
 %endif
 
 Requires:      bash gawk procps-ng glibc elfutils libbpf >= 2:0.8
-Requires:      libconfig libevent iproute jsoncpp libstdc++
+Requires:      libconfig libevent iproute jsoncpp libstdc++ zlib
 
 %if !0%{?disable_kafka_channel}
 Requires:      librdkafka
@@ -58,6 +58,16 @@
 #define PROFILING_CHAN_LOCAL            0
 #define PROFILING_CHAN_KAFKA            1               // used in tprofiling
 
+// Policy of probe when its fifo to ingress is full
+#define FIFO_OVERFLOW_DROP_NEWEST_STR   "drop_newest"
+#define FIFO_OVERFLOW_DROP_OLDEST_STR   "drop_oldest"
+#define FIFO_OVERFLOW_BLOCK_STR         "block"
+#define FIFO_OVERFLOW_SPILL_STR         "spill"
+#define FIFO_OVERFLOW_DROP_NEWEST       0
+#define FIFO_OVERFLOW_DROP_OLDEST       1
+#define FIFO_OVERFLOW_BLOCK             2
+#define FIFO_OVERFLOW_SPILL             3
+
 /*
     copy struct probe_params code to python.probe/ipc.py.
     if modify struct probe_params, please sync change to the class ProbeParams in ipc.py
@@ -105,6 +115,9 @@ struct probe_params {
     unsigned int profiling_chan;        // the output channel for profiling probes, include stackprobe and tprofiling.
     unsigned int min_exec_dur;  // unit: microsecond(us)
     unsigned int min_aggr_dur;  // unit: millisecond(ms)
+    unsigned int fifo_overflow;         // Policy when fifo to ingress is full, refer to FIFO_OVERFLOW_XXX
+    unsigned int fifo_block_tmout;      // Max blocking time of FIFO_OVERFLOW_BLOCK policy, 0: no limit, unit: millisecond(ms)
+    char kernel_aggr;                   // Enable tcpprobe to aggregate metrics per tracker in kernel, default is 0
 };
 
 
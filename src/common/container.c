@@ -25,6 +25,7 @@
 #include <regex.h>
 #include "syscall.h"
 #include "container.h"
+#include "container_runtime.h"
 
 #define ERR_MSG2 "not installed"
 #define RUNNING "active (running)"
@@ -321,6 +322,12 @@ static int __get_containers_status(container_tbl* cstbl, const char *command_s)
 static int __get_container_name(const char *abbr_container_id, char name[], unsigned int len)
 {
     char command[COMMAND_LEN];
+    int ret;
+
+    ret = container_runtime_get_name(abbr_container_id, name, len);
+    if (ret != CONTAINER_NOTOK) {
+        return ret;
+    }
 
     if (!get_current_command()) {
         return -1;
@@ -342,6 +349,12 @@ static int __get_container_pid(const char *abbr_container_id, unsigned int *pid)
 {
     char line[LINE_BUF_LEN];
     char command[COMMAND_LEN];
+    int ret;
+
+    ret = container_runtime_get_pid(abbr_container_id, pid);
+    if (ret != CONTAINER_NOTOK) {
+        return ret;
+    }
 
     if (!get_current_command()) {
         return -1;
@@ -369,6 +382,12 @@ static int __get_container_pid(const char *abbr_container_id, unsigned int *pid)
 static int __get_container_pod(const char *abbr_container_id, char pod[], unsigned int len)
 {
     char command[COMMAND_LEN];
+    int ret;
+
+    ret = container_runtime_get_pod(abbr_container_id, pod, len);
+    if (ret != CONTAINER_NOTOK) {
+        return ret;
+    }
 
     if (!get_current_command()) {
         return -1;
@@ -398,6 +417,12 @@ static int __get_container_pod(const char *abbr_container_id, char pod[], unsign
 static int __get_container_pod_labels(const char *abbr_container_id, char pod_labels[], unsigned int len)
 {
     char command[COMMAND_LEN];
+    int ret;
+
+    ret = container_runtime_get_pod_labels(abbr_container_id, pod_labels, len);
+    if (ret != CONTAINER_NOTOK) {
+        return ret;
+    }
 
     if (!get_current_command()) {
         return -1;
@@ -1214,12 +1239,21 @@ int get_container_pod(const char *abbr_container_id, char pod[], unsigned int le
 int get_container_pod_id(const char *abbr_container_id, char pod_id[], unsigned int len)
 {
     char command[COMMAND_LEN];
+    int ret;
 
-    if (!get_current_command()) {
+    if (abbr_container_id == NULL || abbr_container_id[0] == 0) {
         return -1;
     }
 
-    if (abbr_container_id == NULL || abbr_container_id[0] == 0) {
+    ret = container_runtime_get_pod_id(abbr_container_id, pod_id, len);
+    if (ret != CONTAINER_NOTOK) {
+        if (ret) {
+            pod_id[0] = 0;
+        }
+        return ret;
+    }
+
+    if (!get_current_command()) {
         return -1;
     }
 
@@ -1232,7 +1266,7 @@ int get_container_pod_id(const char *abbr_container_id, char pod_id[], unsigned
             get_current_command(), abbr_container_id, DOCKER_PODID_COMMAND);
     }
 
-    int ret = exec_cmd_chroot((const char *)command, pod_id, len);
+    ret = exec_cmd_chroot((const char *)command, pod_id, len);
     if (ret) {
         pod_id[0] = 0;
     }
@@ -1463,30 +1497,38 @@ int get_container_image(const char *abbr_container_id, char image[], unsigned in
     char orig_image[CONTAINER_IMAGE_LEN];
     char *ptr;
     unsigned int len;
-
-    if (!get_current_command()) {
-        return -1;
-    }
+    int ret;
 
     if (abbr_container_id == NULL || abbr_container_id[0] == 0) {
         return -1;
     }
 
-    command[0] = 0;
-    if (__is_containerd()) {
-        (void)snprintf(command, COMMAND_LEN, "%s inspect %s %s",
-            get_current_command(), CONTAINERD_IMAGE_COMMAND, abbr_container_id);
-    } else {
-        (void)snprintf(command, COMMAND_LEN, "%s inspect %s %s",
-            get_current_command(), abbr_container_id, DOCKER_IMAGE_COMMAD);
-    }
-
     image[0] = 0;
     orig_image[0] = 0;
-    if (exec_cmd_chroot((const char *)command, orig_image, image_len)) {
+    ret = container_runtime_get_image(abbr_container_id, orig_image, sizeof(orig_image));
+    if (ret == CONTAINER_ERR) {
         return -1;
     }
 
+    if (ret == CONTAINER_NOTOK) {
+        if (!get_current_command()) {
+            return -1;
+        }
+
+        command[0] = 0;
+        if (__is_containerd()) {
+            (void)snprintf(command, COMMAND_LEN, "%s inspect %s %s",
+                get_current_command(), CONTAINERD_IMAGE_COMMAND, abbr_container_id);
+        } else {
+            (void)snprintf(command, COMMAND_LEN, "%s inspect %s %s",
+                get_current_command(), abbr_container_id, DOCKER_IMAGE_COMMAD);
+        }
+
+        if (exec_cmd_chroot((const char *)command, orig_image, min(image_len, sizeof(orig_image)))) {
+            return -1;
+        }
+    }
+
     // format: sha256:<IMAGE_ID>, we only take the beginning part of IMAGE_ID
     if (strncmp(orig_image, __CONTAINER_IMAGE_SHA_PREFIX, strlen(__CONTAINER_IMAGE_SHA_PREFIX)) == 0) {
         ptr = orig_image + strlen(__CONTAINER_IMAGE_SHA_PREFIX);
@@ -0,0 +1,641 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-18
+ * Description: native container metadata provider
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+#include "container.h"
+#include "container_runtime.h"
+
+#define __STATE_FILE_DOCKER         "config.v2.json"
+#define __STATE_FILE_OCI            "config.json"
+#define __STATE_FILE_INIT_PID       "init.pid"
+
+#define __KW_POD_NAME               "io.kubernetes.pod.name"
+#define __KW_POD_UID                "io.kubernetes.pod.uid"
+#define __KW_CRI_CONTAINER_NAME     "io.kubernetes.cri.container-name"
+#define __KW_CRI_IMAGE_NAME         "io.kubernetes.cri.image-name"
+#define __KW_CRI_SANDBOX_NAME       "io.kubernetes.cri.sandbox-name"
+#define __KW_CRI_SANDBOX_UID        "io.kubernetes.cri.sandbox-uid"
+
+struct container_meta_s {
+    char id[CONTAINER_ID_LEN + 1];      // key, abbreviated or full container id
+    time_t ts;
+    char found;
+    char runtime;                       // Refer to enum container_runtime_t
+    unsigned int pid;
+    char name[CONTAINER_NAME_LEN];
+    char image[CONTAINER_IMAGE_LEN];
+    char pod[POD_NAME_LEN];
+    char pod_id[POD_ID_LEN + 1];
+    char *pod_labels;                   // JSON object text
+    H_HANDLE;
+};
+
+enum meta_field_t {
+    META_FIELD_NAME = 0,
+    META_FIELD_IMAGE,
+    META_FIELD_POD,
+    META_FIELD_POD_ID,
+    META_FIELD_POD_LABELS
+};
+
+static struct container_meta_s *g_container_metas = NULL;
+static pthread_mutex_t g_container_meta_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_runtime_root[PATH_LEN];
+static char g_runtime_root_inited = 0;
+
+/*
+ * Minimal JSON scanner, only walks the objects of runtime state files in place.
+ * Each helper takes a pointer to the start of a value and never allocates.
+ */
+static const char *json_skip_ws(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+        p++;
+    }
+    return p;
+}
+
+static const char *json_skip_str(const char *p)
+{
+    p++;
+    while (*p != 0 && *p != '"') {
+        if (*p == '\\' && p[1] != 0) {
+            p++;
+        }
+        p++;
+    }
+    return (*p == '"') ? p + 1 : NULL;
+}
+
+static const char *json_skip_value(const char *p)
+{
+    int depth = 0;
+
+    p = json_skip_ws(p);
+    if (*p == '"') {
+        return json_skip_str(p);
+    }
+
+    if (*p != '{' && *p != '[') {
+        while (*p != 0 && *p != ',' && *p != '}' && *p != ']' &&
+               *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            p++;
+        }
+        return p;
+    }
+
+    do {
+        if (*p == 0) {
+            return NULL;
+        }
+        if (*p == '"') {
+            p = json_skip_str(p);
+            if (p == NULL) {
+                return NULL;
+            }
+            continue;
+        }
+        if (*p == '{' || *p == '[') {
+            depth++;
+        } else if (*p == '}' || *p == ']') {
+            depth--;
+        }
+        p++;
+    } while (depth > 0);
+    return p;
+}
+
+static const char *json_obj_get(const char *obj, const char *key)
+{
+    const char *p, *k, *end;
+    size_t key_len = strlen(key);
+
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    p = json_skip_ws(obj);
+    if (*p != '{') {
+        return NULL;
+    }
+    p = json_skip_ws(p + 1);
+
+    while (*p == '"') {
+        k = p + 1;
+        end = json_skip_str(p);
+        if (end == NULL) {
+            return NULL;
+        }
+        p = json_skip_ws(end);
+        if (*p != ':') {
+            return NULL;
+        }
+        p = json_skip_ws(p + 1);
+        if ((size_t)(end - 1 - k) == key_len && strncmp(k, key, key_len) == 0) {
+            return p;
+        }
+
+        p = json_skip_value(p);
+        if (p == NULL) {
+            return NULL;
+        }
+        p = json_skip_ws(p);
+        if (*p != ',') {
+            return NULL;
+        }
+        p = json_skip_ws(p + 1);
+    }
+    return NULL;
+}
+
+static const char *json_obj_get_path(const char *obj, const char *const keys[])
+{
+    const char *p = obj;
+    int i;
+
+    for (i = 0; keys[i] != NULL && p != NULL; i++) {
+        p = json_obj_get(p, keys[i]);
+    }
+    return p;
+}
+
+static int json_get_str(const char *val, char buf[], unsigned int len)
+{
+    const char *p;
+    unsigned int i = 0;
+
+    if (val == NULL || *val != '"' || len == 0) {
+        return -1;
+    }
+
+    for (p = val + 1; *p != 0 && *p != '"' && i + 1 < len; p++) {
+        if (*p != '\\') {
+            buf[i++] = *p;
+            continue;
+        }
+
+        p++;
+        switch (*p) {
+            case 'n':
+            case 't':
+            case 'r':
+                buf[i++] = ' ';
+                break;
+            case 'u':
+                // Non-ascii characters are not expected in names, keep them as placeholders.
+                buf[i++] = '?';
+                p += (strnlen(p + 1, 4) == 4) ? 4 : 0;
+                break;
+            case 0:
+                p--;
+                break;
+            default:
+                buf[i++] = *p;
+                break;
+        }
+    }
+    buf[i] = 0;
+    return 0;
+}
+
+static int json_get_uint(const char *val, unsigned int *num)
+{
+    char *end;
+    unsigned long v;
+
+    if (val == NULL || *val < '0' || *val > '9') {
+        return -1;
+    }
+    v = strtoul(val, &end, 10);
+    if (end == val) {
+        return -1;
+    }
+    *num = (unsigned int)v;
+    return 0;
+}
+
+static char *json_dup_obj(const char *val)
+{
+    const char *end;
+    char *obj;
+
+    if (val == NULL || *val != '{') {
+        return NULL;
+    }
+    end = json_skip_value(val);
+    if (end == NULL) {
+        return NULL;
+    }
+
+    obj = (char *)malloc(end - val + 1);
+    if (obj == NULL) {
+        return NULL;
+    }
+    (void)memcpy(obj, val, end - val);
+    obj[end - val] = 0;
+    return obj;
+}
+
+static char *read_state_file(const char *path)
+{
+    struct stat st;
+    FILE *f;
+    char *buf;
+    size_t n;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+    if (fstat(fileno(f), &st) != 0 || st.st_size <= 0 || st.st_size > CONTAINER_META_FILE_MAX) {
+        (void)fclose(f);
+        return NULL;
+    }
+
+    buf = (char *)malloc(st.st_size + 1);
+    if (buf == NULL) {
+        (void)fclose(f);
+        return NULL;
+    }
+    n = fread(buf, 1, st.st_size, f);
+    buf[n] = 0;
+    (void)fclose(f);
+    return buf;
+}
+
+// State dirs are named by full container id, abbreviated id matches the prefix.
+static int find_container_dir(const char *state_dir, const char *id, char dir[], unsigned int len)
+{
+    struct dirent *entry;
+    struct stat st;
+    size_t id_len = strlen(id);
+    DIR *d;
+
+    (void)snprintf(dir, len, "%s/%s", state_dir, id);
+    if (stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) {
+        return 0;
+    }
+
+    d = opendir(state_dir);
+    if (d == NULL) {
+        return -1;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        if (strncmp(entry->d_name, id, id_len) == 0) {
+            (void)snprintf(dir, len, "%s/%s", state_dir, entry->d_name);
+            (void)closedir(d);
+            return 0;
+        }
+    }
+    (void)closedir(d);
+    return -1;
+}
+
+/* docker and isulad keep "docker inspect" alike fields in config.v2.json */
+static int load_docker_meta(struct container_meta_s *meta, const char *state_dir)
+{
+    static const char *const name_keys[] = {"Name", NULL};
+    static const char *const pid_keys[] = {"State", "Pid", NULL};
+    static const char *const image_keys[] = {"Config", "Image", NULL};
+    static const char *const labels_keys[] = {"Config", "Labels", NULL};
+    char dir[PATH_LEN], path[PATH_LEN];
+    const char *base, *labels, *pid;
+    char *json;
+
+    if (find_container_dir(state_dir, meta->id, dir, sizeof(dir))) {
+        return -1;
+    }
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, __STATE_FILE_DOCKER);
+    json = read_state_file(path);
+    if (json == NULL) {
+        return -1;
+    }
+
+    // isulad nests the common fields in "CommonConfig"
+    base = json_obj_get(json, "CommonConfig");
+    if (base == NULL) {
+        base = json;
+    }
+
+    (void)json_get_str(json_obj_get_path(base, name_keys), meta->name, sizeof(meta->name));
+    (void)json_get_str(json_obj_get_path(base, image_keys), meta->image, sizeof(meta->image));
+    pid = json_obj_get_path(base, pid_keys);
+    if (pid == NULL) {
+        pid = json_obj_get_path(json, pid_keys);
+    }
+    (void)json_get_uint(pid, &meta->pid);
+
+    labels = json_obj_get_path(base, labels_keys);
+    (void)json_get_str(json_obj_get(labels, __KW_POD_NAME), meta->pod, sizeof(meta->pod));
+    (void)json_get_str(json_obj_get(labels, __KW_POD_UID), meta->pod_id, sizeof(meta->pod_id));
+    meta->pod_labels = json_dup_obj(labels);
+
+    free(json);
+    return 0;
+}
+
+static int load_containerd_ns_meta(struct container_meta_s *meta, const char *ns_dir)
+{
+    char dir[PATH_LEN], path[PATH_LEN];
+    const char *annotations;
+    char *json, *pid;
+
+    if (find_container_dir(ns_dir, meta->id, dir, sizeof(dir))) {
+        return -1;
+    }
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, __STATE_FILE_OCI);
+    json = read_state_file(path);
+    if (json == NULL) {
+        return -1;
+    }
+
+    // CRI writes the metadata of container and sandbox into annotations of OCI spec
+    annotations = json_obj_get(json, "annotations");
+    (void)json_get_str(json_obj_get(annotations, __KW_CRI_CONTAINER_NAME), meta->name, sizeof(meta->name));
+    (void)json_get_str(json_obj_get(annotations, __KW_CRI_IMAGE_NAME), meta->image, sizeof(meta->image));
+    (void)json_get_str(json_obj_get(annotations, __KW_CRI_SANDBOX_NAME), meta->pod, sizeof(meta->pod));
+    (void)json_get_str(json_obj_get(annotations, __KW_CRI_SANDBOX_UID), meta->pod_id, sizeof(meta->pod_id));
+    free(json);
+
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, __STATE_FILE_INIT_PID);
+    pid = read_state_file(path);
+    if (pid != NULL) {
+        (void)json_get_uint(pid, &meta->pid);
+        free(pid);
+    }
+    return 0;
+}
+
+static int load_containerd_meta(struct container_meta_s *meta, const char *state_dir)
+{
+    char ns_dir[PATH_LEN];
+    struct dirent *entry;
+    DIR *d;
+    int ret = -1;
+
+    d = opendir(state_dir);
+    if (d == NULL) {
+        return -1;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        (void)snprintf(ns_dir, sizeof(ns_dir), "%s/%s", state_dir, entry->d_name);
+        if (load_containerd_ns_meta(meta, ns_dir) == 0) {
+            ret = 0;
+            break;
+        }
+    }
+    (void)closedir(d);
+    return ret;
+}
+
+static const char *get_runtime_root(void)
+{
+    const char *prefix;
+
+    if (!g_runtime_root_inited) {
+        prefix = getenv(HOST_PATH_PREFIX_ENV);
+        (void)snprintf(g_runtime_root, sizeof(g_runtime_root), "%s", prefix ? prefix : "");
+        g_runtime_root_inited = 1;
+    }
+    return (const char *)g_runtime_root;
+}
+
+static void load_container_meta(struct container_meta_s *meta)
+{
+    char state_dir[PATH_LEN];
+    const char *root = get_runtime_root();
+
+    (void)snprintf(state_dir, sizeof(state_dir), "%s%s", root, DOCKER_STATE_DIR);
+    if (load_docker_meta(meta, state_dir) == 0) {
+        meta->runtime = CONTAINER_RUNTIME_DOCKER;
+        meta->found = 1;
+        return;
+    }
+
+    (void)snprintf(state_dir, sizeof(state_dir), "%s%s", root, ISULAD_STATE_DIR);
+    if (load_docker_meta(meta, state_dir) == 0) {
+        meta->runtime = CONTAINER_RUNTIME_ISULAD;
+        meta->found = 1;
+        return;
+    }
+
+    (void)snprintf(state_dir, sizeof(state_dir), "%s%s", root, CONTAINERD_STATE_DIR);
+    if (load_containerd_meta(meta, state_dir) == 0) {
+        meta->runtime = CONTAINER_RUNTIME_CONTAINERD;
+        meta->found = 1;
+        return;
+    }
+}
+
+static void reset_container_meta(struct container_meta_s *meta)
+{
+    meta->found = 0;
+    meta->runtime = CONTAINER_RUNTIME_UNKNOWN;
+    meta->pid = 0;
+    meta->name[0] = 0;
+    meta->image[0] = 0;
+    meta->pod[0] = 0;
+    meta->pod_id[0] = 0;
+    if (meta->pod_labels != NULL) {
+        free(meta->pod_labels);
+        meta->pod_labels = NULL;
+    }
+}
+
+static void free_container_meta(struct container_meta_s *meta)
+{
+    reset_container_meta(meta);
+    free(meta);
+}
+
+static void delete_if_container_metas_full(void)
+{
+    struct container_meta_s *meta, *tmp;
+
+    if (H_COUNT(g_container_metas) < CONTAINER_META_MAX_NUM) {
+        return;
+    }
+    H_ITER(g_container_metas, meta, tmp) {
+        H_DEL(g_container_metas, meta);
+        free_container_meta(meta);
+        return;
+    }
+}
+
+/* Unknown containers are cached too, so that a miss does not rescan the state dirs until timeout. */
+static struct container_meta_s *lkup_container_meta_locked(const char *id, char force_reload)
+{
+    struct container_meta_s *meta = NULL;
+    time_t now = time(NULL);
+
+    if (id == NULL || id[0] == 0 || strlen(id) > CONTAINER_ID_LEN) {
+        return NULL;
+    }
+
+    H_FIND_S(g_container_metas, id, meta);
+    if (meta != NULL && !force_reload && now < meta->ts + CONTAINER_META_TMOUT) {
+        return meta;
+    }
+
+    if (meta == NULL) {
+        meta = (struct container_meta_s *)calloc(1, sizeof(struct container_meta_s));
+        if (meta == NULL) {
+            return NULL;
+        }
+        (void)snprintf(meta->id, sizeof(meta->id), "%s", id);
+        delete_if_container_metas_full();
+        H_ADD_S(g_container_metas, id, meta);
+    } else {
+        reset_container_meta(meta);
+    }
+
+    load_container_meta(meta);
+    meta->ts = now;
+    return meta;
+}
+
+static int get_container_meta_str(const char *id, enum meta_field_t field, char buf[], unsigned int len)
+{
+    struct container_meta_s *meta;
+    const char *val = NULL;
+    int ret;
+
+    (void)pthread_mutex_lock(&g_container_meta_lock);
+    meta = lkup_container_meta_locked(id, 0);
+    if (meta == NULL || !meta->found) {
+        ret = CONTAINER_NOTOK;
+        goto out;
+    }
+
+    switch (field) {
+        case META_FIELD_NAME:
+            val = meta->name;
+            break;
+        case META_FIELD_IMAGE:
+            val = meta->image;
+            break;
+        case META_FIELD_POD:
+            val = meta->pod;
+            break;
+        case META_FIELD_POD_ID:
+            val = meta->pod_id;
+            break;
+        case META_FIELD_POD_LABELS:
+            // CRI labels are not written into OCI bundle, only CLI knows them.
+            if (meta->runtime == CONTAINER_RUNTIME_CONTAINERD) {
+                ret = CONTAINER_NOTOK;
+                goto out;
+            }
+            val = meta->pod_labels;
+            break;
+        default:
+            break;
+    }
+
+    if (val == NULL || val[0] == 0) {
+        ret = CONTAINER_ERR;
+        goto out;
+    }
+    (void)snprintf(buf, len, "%s", val);
+    ret = CONTAINER_OK;
+
+out:
+    (void)pthread_mutex_unlock(&g_container_meta_lock);
+    return ret;
+}
+
+int container_runtime_get_name(const char *abbr_container_id, char name[], unsigned int len)
+{
+    return get_container_meta_str(abbr_container_id, META_FIELD_NAME, name, len);
+}
+
+int container_runtime_get_image(const char *abbr_container_id, char image[], unsigned int len)
+{
+    return get_container_meta_str(abbr_container_id, META_FIELD_IMAGE, image, len);
+}
+
+int container_runtime_get_pod(const char *abbr_container_id, char pod[], unsigned int len)
+{
+    return get_container_meta_str(abbr_container_id, META_FIELD_POD, pod, len);
+}
+
+int container_runtime_get_pod_id(const char *abbr_container_id, char pod_id[], unsigned int len)
+{
+    return get_container_meta_str(abbr_container_id, META_FIELD_POD_ID, pod_id, len);
+}
+
+int container_runtime_get_pod_labels(const char *abbr_container_id, char pod_labels[], unsigned int len)
+{
+    return get_container_meta_str(abbr_container_id, META_FIELD_POD_LABELS, pod_labels, len);
+}
+
+int container_runtime_get_pid(const char *abbr_container_id, unsigned int *pid)
+{
+    struct container_meta_s *meta;
+    int ret = CONTAINER_NOTOK;
+
+    (void)pthread_mutex_lock(&g_container_meta_lock);
+    meta = lkup_container_meta_locked(abbr_container_id, 0);
+    // Container has been restarted within timeout, the cached pid is gone.
+    if (meta != NULL && meta->found && meta->pid != 0 && kill((pid_t)meta->pid, 0) != 0 && errno == ESRCH) {
+        meta = lkup_container_meta_locked(abbr_container_id, 1);
+    }
+
+    if (meta != NULL && meta->found) {
+        ret = (meta->pid != 0) ? CONTAINER_OK : CONTAINER_ERR;
+        *pid = meta->pid;
+    }
+    (void)pthread_mutex_unlock(&g_container_meta_lock);
+    return ret;
+}
+
+void container_runtime_cache_clear(void)
+{
+    struct container_meta_s *meta, *tmp;
+
+    (void)pthread_mutex_lock(&g_container_meta_lock);
+    H_ITER(g_container_metas, meta, tmp) {
+        H_DEL(g_container_metas, meta);
+        free_container_meta(meta);
+    }
+    g_container_metas = NULL;
+    (void)pthread_mutex_unlock(&g_container_meta_lock);
+}
+
+void container_runtime_set_root(const char *root)
+{
+    (void)pthread_mutex_lock(&g_container_meta_lock);
+    (void)snprintf(g_runtime_root, sizeof(g_runtime_root), "%s", root ? root : "");
+    g_runtime_root_inited = 1;
+    (void)pthread_mutex_unlock(&g_container_meta_lock);
+
+    container_runtime_cache_clear();
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-18
+ * Description: native container metadata provider
+ ******************************************************************************/
+#ifndef __CONTAINER_RUNTIME_H__
+#define __CONTAINER_RUNTIME_H__
+
+#pragma once
+
+#include "common.h"
+
+#define CONTAINER_META_TMOUT        60      // unit: second
+#define CONTAINER_META_MAX_NUM      1000
+#define CONTAINER_META_FILE_MAX     (1024 * 1024)
+
+#define DOCKER_STATE_DIR            "/var/lib/docker/containers"
+#define ISULAD_STATE_DIR            "/var/lib/isulad/engines/lcr"
+#define CONTAINERD_STATE_DIR        "/run/containerd/io.containerd.runtime.v2.task"
+
+enum container_runtime_t {
+    CONTAINER_RUNTIME_UNKNOWN = 0,
+    CONTAINER_RUNTIME_DOCKER,
+    CONTAINER_RUNTIME_ISULAD,
+    CONTAINER_RUNTIME_CONTAINERD
+};
+
+/*
+ * Container metadata is read from the on-disk state of container runtimes(e.g. config.v2.json
+ * of docker, OCI bundle of containerd) instead of forking "docker/isula/crictl inspect", and kept
+ * in a cache for CONTAINER_META_TMOUT seconds.
+ *
+ * All lookups return CONTAINER_OK if the field is found, CONTAINER_ERR if the container is found but
+ * has no such field, CONTAINER_NOTOK if the container is unknown here, caller may fall back to CLI then.
+ */
+int container_runtime_get_name(const char *abbr_container_id, char name[], unsigned int len);
+int container_runtime_get_pid(const char *abbr_container_id, unsigned int *pid);
+int container_runtime_get_image(const char *abbr_container_id, char image[], unsigned int len);
+int container_runtime_get_pod(const char *abbr_container_id, char pod[], unsigned int len);
+int container_runtime_get_pod_id(const char *abbr_container_id, char pod_id[], unsigned int len);
+int container_runtime_get_pod_labels(const char *abbr_container_id, char pod_labels[], unsigned int len);
+
+/* Root of runtime state dirs, default is the host path prefix. Also drops all cached metadata. */
+void container_runtime_set_root(const char *root);
+void container_runtime_cache_clear(void);
+
+#endif
@@ -24,6 +24,7 @@
 #define H_FIND(head_ptr, k_ptr, k_len, result_ptr)   HASH_FIND(hh, head_ptr, k_ptr, k_len, result_ptr)
 #define H_DEL(head_ptr, del_ptr)   HASH_DELETE(hh, head_ptr, del_ptr)
 #define H_COUNT(head_ptr)   HASH_CNT(hh, head_ptr)
+#define H_CLEAR(head_ptr)   HASH_CLEAR(hh, head_ptr)
 #define H_ADD(head_ptr, k_field_name, k_len, item_ptr)   HASH_ADD(hh, head_ptr, k_field_name, k_len, item_ptr)
 #define H_ADD_KEYPTR(head_ptr, k_ptr, k_len, item_ptr)   HASH_ADD_KEYPTR(hh, head_ptr, k_ptr, k_len, item_ptr)
 
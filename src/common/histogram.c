@@ -153,6 +153,77 @@ void histo_bucket_reset(struct histo_bucket_array_s *bucket_arr, size_t bucket_s
     bucket_arr->histo_buckets = NULL;
 }
 
+int histo_bucket_merge(struct histo_bucket_array_s *dst, const struct histo_bucket_array_s *src, size_t bucket_size)
+{
+    struct histo_bucket_s **buckets;
+
+    if (!src->histo_buckets) {
+        return 0;
+    }
+    if (!dst->histo_buckets) {
+        if (init_bucket(dst, bucket_size)) {
+            return -1;
+        }
+    }
+
+    buckets = dst->histo_buckets;
+    for (int i = 0; i < bucket_size; i++) {
+        if (!src->histo_buckets[i]) {
+            continue;
+        }
+        if (!buckets[i]) {
+            buckets[i] = (struct histo_bucket_s *)calloc(1, sizeof(struct histo_bucket_s));
+            if (!buckets[i]) {
+                WARN("[Histogram] malloc bucket failed !");
+                return -1;
+            }
+        }
+        buckets[i]->count += src->histo_buckets[i]->count;
+        buckets[i]->sum += src->histo_buckets[i]->sum;
+        buckets[i]->max = buckets[i]->max > src->histo_buckets[i]->max ? buckets[i]->max : src->histo_buckets[i]->max;
+    }
+    return 0;
+}
+
+/*
+ * Add counts bucketed elsewhere, e.g. in kernel. Only the sum and max of all the values are known,
+ * they are kept in the highest non-empty bucket as serialize_histo() outputs the totals only.
+ */
+int histo_bucket_add_counts(struct histo_bucket_array_s *bucket_array, size_t bucket_size,
+                            const u32 counts[], u64 sum, u64 max)
+{
+    struct histo_bucket_s **buckets;
+    int last = -1;
+
+    if (!bucket_array->histo_buckets) {
+        if (init_bucket(bucket_array, bucket_size)) {
+            return -1;
+        }
+    }
+
+    buckets = bucket_array->histo_buckets;
+    for (int i = 0; i < bucket_size; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        if (!buckets[i]) {
+            buckets[i] = (struct histo_bucket_s *)calloc(1, sizeof(struct histo_bucket_s));
+            if (!buckets[i]) {
+                WARN("[Histogram] malloc bucket failed !");
+                return -1;
+            }
+        }
+        buckets[i]->count += counts[i];
+        last = i;
+    }
+
+    if (last >= 0) {
+        buckets[last]->sum += sum;
+        buckets[last]->max = buckets[last]->max > max ? buckets[last]->max : max;
+    }
+    return 0;
+}
+
 int histo_bucket_value(struct bucket_range_s latency_buckets[], struct histo_bucket_array_s *bucket_arr, size_t bucket_size, enum histo_type_t type, float *value)
 {
     size_t offset = 0;
@@ -53,6 +53,11 @@ int init_bucket_with_content(struct histo_bucket_array_s *bucket_array, size_t b
 int histo_bucket_add_value(struct bucket_range_s bucket_range[], struct histo_bucket_array_s *bucket_array, size_t bucket_size, u64 value);
 int histo_bucket_value(struct bucket_range_s latency_buckets[], struct histo_bucket_array_s *bucket_arr, size_t bucket_size, enum histo_type_t type, float *value);
 void histo_bucket_reset(struct histo_bucket_array_s *bucket_arr, size_t bucket_size);
+/* Add counts of all buckets in src into dst, buckets of both are in the same range. */
+int histo_bucket_merge(struct histo_bucket_array_s *dst, const struct histo_bucket_array_s *src, size_t bucket_size);
+/* Add counts of each bucket, sum and max are of the values of all buckets. */
+int histo_bucket_add_counts(struct histo_bucket_array_s *bucket_array, size_t bucket_size,
+                            const u32 counts[], u64 sum, u64 max);
 int init_bucket_range(struct bucket_range_s *bucket, u64 min, u64 max);
 void free_histo_buckets(struct histo_bucket_array_s *his_bk_arr, int size);
 int resolve_bucket_size(char *buf, char **new_buf);
@@ -6,7 +6,10 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <libgen.h>
+#include <time.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/prctl.h>
 #include "logs.h"
 
 #define INVALID_FILE_ID         (-1)
@@ -20,6 +23,11 @@
 
 static struct log_mgr_s *local = NULL;
 static pthread_mutex_t metric_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t log_writer_tid;
+static char log_writer_running = 0;
+static pthread_mutex_t log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_writer_cond = PTHREAD_COND_INITIALIZER;
 static char logger_level_str[LOGGER_MAX][LOG_LEVEL_STR_LEN] = {DEBUG_STR, INFO_STR, WARN_STR, ERROR_STR};
 
 static int mkdirp(const char *path, mode_t mode)
@@ -328,10 +336,24 @@ static void init_logger(struct logger *logger, char *name, const int max_backup_
     logger->max_file_size = max_file_size / (logger->max_backup_index + 1);
     logger->pattern = NULL;
     (void)pthread_rwlock_init(&(logger->rwlock), NULL);
+    (void)pthread_mutex_init(&(logger->flush_lock), NULL);
+    (void)pthread_mutex_init(&(logger->buf_lock), NULL);
+    logger->wbuf = NULL;
+    logger->fbuf = NULL;
+    logger->wbuf_len = 0;
+    logger->wbuf_lines = 0;
+    (void)memset(&(logger->stats), 0, sizeof(logger->stats));
 }
 
+static void flush_logger(struct logger *logger);
+static void start_log_writer(void);
+static void stop_log_writer(void);
+
 static void prep_init_logger(struct logger *logger, const size_t max_file_size)
 {
+    // Pending messages belong to the file being closed.
+    flush_logger(logger);
+
     (void)pthread_rwlock_wrlock(&logger->rwlock);
     if (logger->file_fd > 0) {
         (void)close(logger->file_fd);
@@ -459,7 +481,7 @@ static int append_event_logger(struct log_mgr_s * mgr)
     }
 
     rm_log_file(full_path);
-    prep_init_logger(&g_meta_logger, META_LOGS_FILESIZE);
+    prep_init_logger(&g_event_logger, EVENT_LOGS_FILESIZE);
     int path_state = init_logger_path(&g_event_logger, full_path);
     if (path_state < 0) {
         return -1;
@@ -553,6 +575,7 @@ int init_log_mgr(struct log_mgr_s* mgr, int is_meta_out_log, char *logLevel)
 
     set_debug_log_level(logLevel);
     local = mgr;
+    start_log_writer();
     return 0;
 }
 
@@ -565,14 +588,25 @@ static void destroy_logger_instance(struct logger *logger)
         (void)close(logger->file_fd);
     }
     (void)pthread_rwlock_destroy(&(logger->rwlock));
+
+    (void)pthread_mutex_lock(&(logger->buf_lock));
+    free(logger->wbuf);
+    free(logger->fbuf);
+    logger->wbuf = NULL;
+    logger->fbuf = NULL;
+    logger->wbuf_len = 0;
+    logger->wbuf_lines = 0;
+    (void)pthread_mutex_unlock(&(logger->buf_lock));
 }
 
+
 void destroy_log_mgr(struct log_mgr_s* mgr)
 {
     if (mgr == NULL) {
         return;
     }
 
+    stop_log_writer();
     destroy_queue(mgr->metrics_files);
     destroy_queue(mgr->event_files);
     clear_log_dir(mgr->metrics_path);
@@ -659,7 +693,7 @@ static void check_file_state(struct logger *logger)
     }
 }
 
-static void write_log(const char *msg, size_t msg_len, struct logger *logger)
+static void write_logv(const struct iovec *iov, int iovcnt, size_t len, struct logger *logger)
 {
     if (logger == NULL) {
         return;
@@ -682,12 +716,229 @@ static void write_log(const char *msg, size_t msg_len, struct logger *logger)
         }
     }
     (void)lseek(logger->file_fd, 0, SEEK_END);
-    write_ret = write(logger->file_fd, msg, msg_len);
+    write_ret = writev(logger->file_fd, iov, iovcnt);
     if (write_ret == -1) {
         (void)printf("[ERROR]: write to log file failed, errno[%d].\n", errno);
     }
-    logger->buf_len += msg_len;
+    logger->buf_len += len;
+    (void)pthread_rwlock_unlock(&logger->rwlock);
+}
+
+static uint64_t log_elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (uint64_t)(end->tv_sec - start->tv_sec) * 1000000000ULL + (uint64_t)end->tv_nsec - (uint64_t)start->tv_nsec;
+}
+
+/* Write pending messages of logger(and msg if any) to file in one writev, called with flush_lock held. */
+static void flush_logger_locked(struct logger *logger, const char *msg, size_t msg_len)
+{
+    struct timespec start, end;
+    struct iovec iov[2];
+    int iovcnt = 0;
+    uint64_t lines, ns;
+    size_t len;
+    char *buf;
+
+    (void)pthread_mutex_lock(&logger->buf_lock);
+    buf = logger->wbuf;
+    len = logger->wbuf_len;
+    lines = logger->wbuf_lines;
+    logger->wbuf = logger->fbuf;
+    logger->fbuf = buf;
+    logger->wbuf_len = 0;
+    logger->wbuf_lines = 0;
+    (void)pthread_mutex_unlock(&logger->buf_lock);
+
+    if (len > 0) {
+        iov[iovcnt].iov_base = buf;
+        iov[iovcnt].iov_len = len;
+        iovcnt++;
+    }
+    if (msg_len > 0) {
+        iov[iovcnt].iov_base = (void *)msg;
+        iov[iovcnt].iov_len = msg_len;
+        iovcnt++;
+        lines++;
+    }
+    if (iovcnt == 0) {
+        return;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    write_logv(iov, iovcnt, len + msg_len, logger);
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = log_elapsed_ns(&start, &end);
+    logger->stats.bytes += len + msg_len;
+    logger->stats.lines += lines;
+    logger->stats.flushes++;
+    logger->stats.flush_ns += ns;
+    if (ns > logger->stats.max_flush_ns) {
+        logger->stats.max_flush_ns = ns;
+    }
+}
+
+static void flush_logger(struct logger *logger)
+{
+    char has_path;
+
+    // Keep pending messages until the first file of logger is opened.
+    (void)pthread_rwlock_rdlock(&logger->rwlock);
+    has_path = (logger->full_path_name[0] != 0);
     (void)pthread_rwlock_unlock(&logger->rwlock);
+    if (!has_path) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&logger->flush_lock);
+    flush_logger_locked(logger, NULL, 0);
+    (void)pthread_mutex_unlock(&logger->flush_lock);
+}
+
+/*
+ * Hot path of all loggers, only copies msg into the buffer of logger. Caller writes by itself
+ * if log writer is not running, msg is large or the buffer is full(log writer lags behind).
+ * Debug logger is always written at once, the last ERROR/WARN lines must survive a crash.
+ */
+static void write_log(const char *msg, size_t msg_len, struct logger *logger)
+{
+    char wakeup;
+
+    if (logger == NULL || msg_len == 0) {
+        return;
+    }
+
+    if (logger == &g_debug_logger || !__atomic_load_n(&log_writer_running, __ATOMIC_ACQUIRE) ||
+        msg_len > LOG_BUF_SIZE / 2) {
+        goto sync;
+    }
+
+    (void)pthread_mutex_lock(&logger->buf_lock);
+    if (logger->wbuf == NULL) {
+        logger->wbuf = (char *)malloc(LOG_BUF_SIZE);
+        logger->fbuf = (char *)malloc(LOG_BUF_SIZE);
+        if (logger->wbuf == NULL || logger->fbuf == NULL) {
+            free(logger->wbuf);
+            free(logger->fbuf);
+            logger->wbuf = NULL;
+            logger->fbuf = NULL;
+            (void)pthread_mutex_unlock(&logger->buf_lock);
+            goto sync;
+        }
+    }
+
+    if (logger->wbuf_len + msg_len <= LOG_BUF_SIZE) {
+        (void)memcpy(logger->wbuf + logger->wbuf_len, msg, msg_len);
+        logger->wbuf_len += msg_len;
+        logger->wbuf_lines++;
+        wakeup = (logger->wbuf_len >= LOG_FLUSH_THRESHOLD);
+        (void)pthread_mutex_unlock(&logger->buf_lock);
+        if (wakeup) {
+            (void)pthread_cond_signal(&log_writer_cond);
+        }
+        return;
+    }
+    (void)pthread_mutex_unlock(&logger->buf_lock);
+
+sync:
+    (void)pthread_mutex_lock(&logger->flush_lock);
+    flush_logger_locked(logger, msg, msg_len);
+    (void)pthread_mutex_unlock(&logger->flush_lock);
+}
+
+static void flush_all_loggers(void)
+{
+    flush_logger(&g_metrics_logger);
+    flush_logger(&g_event_logger);
+    flush_logger(&g_meta_logger);
+    flush_logger(&g_debug_logger);
+}
+
+void flush_logs(void)
+{
+    if (local == NULL) {
+        return;
+    }
+    flush_all_loggers();
+}
+
+static void report_logger_stats(struct logger *logger)
+{
+    struct logger_stats_s *stats = &logger->stats;
+
+    if (stats->flushes == 0) {
+        return;
+    }
+    INFO("[LOGS] %s logger: %llu lines, %llu bytes, %llu flushes, flush latency avg %llu us, max %llu us.\n",
+         logger->name, (unsigned long long)stats->lines, (unsigned long long)stats->bytes,
+         (unsigned long long)stats->flushes, (unsigned long long)(stats->flush_ns / stats->flushes / 1000),
+         (unsigned long long)(stats->max_flush_ns / 1000));
+}
+
+static void *log_writer_thread(void *arg)
+{
+    struct timespec ts;
+    time_t stats_ts = time(NULL);
+    time_t now;
+
+    prctl(PR_SET_NAME, "[LOGWRITER]");
+
+    (void)pthread_mutex_lock(&log_writer_mutex);
+    while (log_writer_running) {
+        (void)clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        (void)pthread_cond_timedwait(&log_writer_cond, &log_writer_mutex, &ts);
+        (void)pthread_mutex_unlock(&log_writer_mutex);
+
+        flush_all_loggers();
+
+        now = time(NULL);
+        if (now >= stats_ts + LOG_STATS_INTERVAL) {
+            stats_ts = now;
+            report_logger_stats(&g_metrics_logger);
+            report_logger_stats(&g_event_logger);
+            report_logger_stats(&g_meta_logger);
+        }
+
+        (void)pthread_mutex_lock(&log_writer_mutex);
+    }
+    (void)pthread_mutex_unlock(&log_writer_mutex);
+    return NULL;
+}
+
+static void start_log_writer(void)
+{
+    (void)pthread_mutex_lock(&log_writer_mutex);
+    if (log_writer_running) {
+        (void)pthread_mutex_unlock(&log_writer_mutex);
+        return;
+    }
+    __atomic_store_n(&log_writer_running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&log_writer_tid, NULL, log_writer_thread, NULL) != 0) {
+        // Loggers still work, every caller writes by itself.
+        __atomic_store_n(&log_writer_running, 0, __ATOMIC_RELEASE);
+        (void)fprintf(stderr, "Create log writer thread failed.\n");
+    }
+    (void)pthread_mutex_unlock(&log_writer_mutex);
+}
+
+static void stop_log_writer(void)
+{
+    (void)pthread_mutex_lock(&log_writer_mutex);
+    if (!log_writer_running) {
+        (void)pthread_mutex_unlock(&log_writer_mutex);
+        return;
+    }
+    __atomic_store_n(&log_writer_running, 0, __ATOMIC_RELEASE);
+    (void)pthread_cond_signal(&log_writer_cond);
+    (void)pthread_mutex_unlock(&log_writer_mutex);
+
+    (void)pthread_join(log_writer_tid, NULL);
+    flush_all_loggers();
 }
 
 static void log_without_date(struct logger *logger, const char *detail)
@@ -746,6 +997,7 @@ int read_metrics_logs(char logs_file_name[], size_t size)
     }
 
     pthread_mutex_lock(&metric_mutex);
+    flush_logger(&g_metrics_logger);
     file_id = que_pop_file(mgr->metrics_files);
     if (!IS_VALID_FILE_ID(file_id)) {
         DEBUG("File id invalid(%d)!\n", file_id);
@@ -765,17 +1017,36 @@ int read_metrics_logs(char logs_file_name[], size_t size)
     return 0;
 }
 
+/*
+ * Files removed by consumers are recreated by write_logv() anyway, so the per-line hot path
+ * only looks for them once per LOG_FILE_CHECK_INTERVAL.
+ */
+static char log_file_check_due(const time_t *last_check)
+{
+    time_t now = time(NULL);
+    time_t last = __atomic_load_n(last_check, __ATOMIC_RELAXED);
+
+    return (now >= last + LOG_FILE_CHECK_INTERVAL || now < last);
+}
+
+static void log_file_check_done(time_t *last_check)
+{
+    __atomic_store_n(last_check, time(NULL), __ATOMIC_RELAXED);
+}
+
 int wr_event_logs(const char* logs, size_t logs_len)
 {
+    static time_t last_check = 0;
     struct log_mgr_s *mgr = local;
     if (!mgr) {
         return -1;
     }
 
-    if (que_current_is_invalid(mgr, 0)) {
-        if (append_event_logger(mgr)) {
+    if (log_file_check_due(&last_check)) {
+        if (que_current_is_invalid(mgr, 0) && append_event_logger(mgr)) {
             return -1;
         }
+        log_file_check_done(&last_check);
     }
 
     log_without_date(&g_event_logger, logs);
@@ -785,8 +1056,12 @@ int wr_event_logs(const char* logs, size_t logs_len)
 
 void wr_meta_logs(const char* logs)
 {
-    if (access(g_meta_abs_path, F_OK) == -1) {
-        (void)append_meta_logger(local);
+    static time_t last_check = 0;
+
+    if (log_file_check_due(&last_check)) {
+        if (access(g_meta_abs_path, F_OK) == 0 || append_meta_logger(local) == 0) {
+            log_file_check_done(&last_check);
+        }
     }
 
     log_without_date(&g_meta_logger, logs);
@@ -794,8 +1069,12 @@ void wr_meta_logs(const char* logs)
 
 static void reappend_debug_logger(struct log_mgr_s *mgr)
 {
-    if (access(g_debug_abs_path, F_OK) == -1) {
-        (void)append_debug_logger(mgr);
+    static time_t last_check = 0;
+
+    if (log_file_check_due(&last_check)) {
+        if (access(g_debug_abs_path, F_OK) == 0 || append_debug_logger(mgr) == 0) {
+            log_file_check_done(&last_check);
+        }
     }
 }
 
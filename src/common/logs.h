@@ -18,6 +18,7 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdint.h>
 #include "common.h"
 
 #if !defined(UTEST)
@@ -43,6 +44,12 @@
 #define EVENT_LOGS_MAXNUM           (5)
 #endif
 
+#define LOG_BUF_SIZE            (256 * 1024)    // Pending bytes buffered per logger
+#define LOG_FLUSH_THRESHOLD     (64 * 1024)     // Wake up log writer once pending bytes exceed it
+#define LOG_FLUSH_INTERVAL_MS   100
+#define LOG_STATS_INTERVAL      600             // unit: second
+#define LOG_FILE_CHECK_INTERVAL 1               // unit: second
+
 #define LOGS_SWITCH_ON  1
 #define PATTERN_META_LOGGER_STR "%s\n" // "%m%n"
 #define PATTERN_DEBUG_LOGGER_STR "%02d/%02d/%02d %02d:%02d:%02d - %s %s" // "%D{%m/%d/%y %H:%M:%S}  - %m"
@@ -89,8 +96,16 @@ enum logger_level_t {
     LOGGER_MAX
 };
 
+struct logger_stats_s {
+    uint64_t bytes;             // Bytes written to file
+    uint64_t lines;             // Messages written to file
+    uint64_t flushes;
+    uint64_t flush_ns;          // Total latency of flushes
+    uint64_t max_flush_ns;
+};
+
 struct logger {
-    pthread_rwlock_t rwlock;
+    pthread_rwlock_t rwlock;    // Protects file state: fd, paths and buf_len
     char *pattern;
     enum logger_level_t level;
     char full_path_name[PATH_LEN];
@@ -101,6 +116,18 @@ struct logger {
     size_t max_file_size;
     int max_backup_index; // for save max back up  fname.log.1, fname.log.2, fname.log.3
     int curr_backup_index; // record current back up index.
+
+    /*
+     * Messages are appended to wbuf by callers and written to file by the log writer thread,
+     * flush_lock keeps them in order when a caller has to flush by itself.
+     */
+    pthread_mutex_t flush_lock;
+    pthread_mutex_t buf_lock;   // Protects wbuf
+    char *wbuf;
+    char *fbuf;                 // Swapped with wbuf while flushing
+    size_t wbuf_len;
+    uint64_t wbuf_lines;
+    struct logger_stats_s stats;
 };
 
 int read_metrics_logs(char logs_file_name[], size_t size);
@@ -113,6 +140,8 @@ int wr_event_logs(const char* logs, size_t logs_len);
 
 void rm_log_file(const char full_path[]);
 
+void flush_logs(void);
+
 void destroy_log_mgr(struct log_mgr_s* mgr);
 void clear_log_dir(const char full_path[]);
 int init_log_mgr(struct log_mgr_s* mgr, int is_meta_out_log, char *logLevel);
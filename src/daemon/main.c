@@ -265,6 +265,8 @@ static void *run_sig_handler(void *arg)
     // probe_mng创建的ipc消息队列是跟随内核的，进程结束消息队列还会存在，需要显示调用函数销毁
     destroy_ipc_msg_queue(g_probe_mng_ipc_msgid);
     clean_pin_map();
+    // Events and meta pending in log buffers are written before exit.
+    flush_logs();
     if (g_resourceMgr && g_resourceMgr->logsMgr) {
         clear_log_dir(g_resourceMgr->logsMgr->metrics_path);
     }
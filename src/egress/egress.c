@@ -18,12 +18,17 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/epoll.h>
 
 #include "base.h"
 #include "common.h"
 #include "egress.h"
 
+#define EGRESS_BATCH_SIZE       256     // Max elements drained from fifo and produced at once
+#define EGRESS_POLL_INTERVAL    100     // unit: ms, cadence of kafka delivery reports
+#define EGRESS_STATS_INTERVAL   600     // unit: second
+
 EgressMgr *EgressMgrCreate(void)
 {
     EgressMgr *mgr;
@@ -104,15 +109,35 @@ static int EgressInit(EgressMgr *mgr)
     return 0;
 }
 
+static void EgressDataProduce(Fifo *fifo, const EgressMgr *mgr, char *dataStrs[], uint32_t num)
+{
+    uint32_t i;
+#ifdef KAFKA_CHANNEL
+    KafkaMgr *kafkaMgr = NULL;
+
+    if (fifo == mgr->metric_fifo) {
+        kafkaMgr = mgr->metric_kafkaMgr;
+    } else if (fifo == mgr->event_fifo) {
+        kafkaMgr = mgr->event_kafkaMgr;
+    }
+
+    if (kafkaMgr != NULL) {
+        (void)KafkaMsgProduceBatch(kafkaMgr, dataStrs, num);  // dataStrs are freed by kafka
+        return;
+    }
+#endif
+    for (i = 0; i < num; i++) {
+        (void)free(dataStrs[i]);
+    }
+}
+
 static int EgressDataProcesssInput(Fifo *fifo, const EgressMgr *mgr)
 {
     // read data from fifo
-    char *dataStr = NULL;
+    char *dataStrs[EGRESS_BATCH_SIZE];
+    uint32_t num, i, cnt;
     int ret = 0;
-#ifdef KAFKA_CHANNEL
-    KafkaMgr *mkafkaMgr = mgr->metric_kafkaMgr;
-    KafkaMgr *ekafkaMgr = mgr->event_kafkaMgr;
-#endif
+
     uint64_t val = 0;
     ret = read(fifo->triggerFd, &val, sizeof(val));
     if (ret < 0) {
@@ -120,19 +145,20 @@ static int EgressDataProcesssInput(Fifo *fifo, const EgressMgr *mgr)
         return -1;
     }
 
-    while (FifoGet(fifo, (void **)&dataStr) == 0) {
-        // Add Egress data handlement.
-#ifdef KAFKA_CHANNEL
-        if ((mkafkaMgr != NULL) && (fifo->triggerFd == mgr->metric_fifo->triggerFd)) {
-            if (KafkaMsgProduce(mkafkaMgr, dataStr, strlen(dataStr)) != 0) {
-                continue;
+    do {
+        while ((num = FifoGetN(fifo, (void **)dataStrs, EGRESS_BATCH_SIZE)) > 0) {
+            // Add Egress data handlement.
+            cnt = 0;
+            for (i = 0; i < num; i++) {
+                if (dataStrs[i] != NULL) {
+                    dataStrs[cnt++] = dataStrs[i];
+                }
+            }
+            if (cnt > 0) {
+                EgressDataProduce(fifo, mgr, dataStrs, cnt);
             }
         }
-        if ((ekafkaMgr != NULL) && (fifo->triggerFd == mgr->event_fifo->triggerFd)) {
-            KafkaMsgProduce(ekafkaMgr, dataStr, strlen(dataStr));
-        }
-#endif
-    }
+    } while (FifoArm(fifo));
 
     return 0;
 }
@@ -144,7 +170,7 @@ static int EgressDataProcess(const EgressMgr *mgr)
     Fifo *fifo = NULL;
     int ret = 0;
 
-    events_num = epoll_wait(mgr->epoll_fd, events, MAX_EPOLL_EVENTS_NUM, -1);
+    events_num = epoll_wait(mgr->epoll_fd, events, MAX_EPOLL_EVENTS_NUM, EGRESS_POLL_INTERVAL);
     if ((events_num < 0) && (errno != EINTR)) {
         ERROR("Egress Msg wait failed: %s.\n", strerror(errno));
         return events_num;
@@ -168,6 +194,47 @@ static int EgressDataProcess(const EgressMgr *mgr)
     return 0;
 }
 
+#ifdef KAFKA_CHANNEL
+static void EgressReportKafkaStats(const char *name, const KafkaMgr *kafkaMgr)
+{
+    KafkaStats stats;
+
+    if (kafkaMgr == NULL) {
+        return;
+    }
+    KafkaMgrGetStats(kafkaMgr, &stats);
+    INFO("[EGRESS] %s kafka: %llu records, %llu produced, %llu delivered, %llu failed, %llu retried, %u pending.\n",
+         name, (unsigned long long)stats.records, (unsigned long long)stats.produced,
+         (unsigned long long)stats.delivered, (unsigned long long)stats.failed,
+         (unsigned long long)stats.retried, kafkaMgr->pendingNum);
+}
+#endif
+
+/* Delivery reports are served on their own cadence instead of after every produce. */
+static void EgressPoll(const EgressMgr *mgr)
+{
+#ifdef KAFKA_CHANNEL
+    static struct timespec poll_ts;
+    static time_t stats_ts;
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - poll_ts.tv_sec) * 1000 + (now.tv_nsec - poll_ts.tv_nsec) / 1000000 < EGRESS_POLL_INTERVAL) {
+        return;
+    }
+    poll_ts = now;
+
+    KafkaPoll(mgr->metric_kafkaMgr);
+    KafkaPoll(mgr->event_kafkaMgr);
+
+    if (now.tv_sec >= stats_ts + EGRESS_STATS_INTERVAL) {
+        stats_ts = now.tv_sec;
+        EgressReportKafkaStats("metric", mgr->metric_kafkaMgr);
+        EgressReportKafkaStats("event", mgr->event_kafkaMgr);
+    }
+#endif
+}
+
 void EgressMain(EgressMgr *mgr)
 {
     int ret = 0;
@@ -184,5 +251,6 @@ void EgressMain(EgressMgr *mgr)
             ERROR("[EGRESS] egress data process failed.\n");
             return;
         }
+        EgressPoll(mgr);
     }
 }
@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include "logs.h"
 #include "event2json.h"
+#include "nprobe_record.h"
 #include "ingress.h"
 
 IngressMgr *IngressMgrCreate(void)
@@ -62,7 +63,6 @@ static int LogData2Egress(IngressMgr *mgr, const char *logData)
 {
     int ret = 0;
     char *jsonFmt = NULL;
-    uint64_t msg = 1;
 
     jsonFmt = malloc(MAX_DATA_STR_LEN);
     if (jsonFmt == NULL) {
@@ -80,8 +80,8 @@ static int LogData2Egress(IngressMgr *mgr, const char *logData)
         ERROR("[INGRESS] egress event fifo full.\n");
         goto err;
     }
-    ret = write(mgr->egressMgr->event_fifo->triggerFd, &msg, sizeof(uint64_t));
-    if (ret != sizeof(uint64_t)) {
+    ret = FifoNotify(mgr->egressMgr->event_fifo);
+    if (ret != 0) {
         ERROR("[INGRESS] send trigger msg to egress event_fifo fd failed.\n");
         goto err;
     }
@@ -110,14 +110,13 @@ static int EventData2Egress(IngressMgr *mgr, const char *content)
         goto err;
     }
 
-    uint64_t msg = 1;
     ret = FifoPut(mgr->egressMgr->event_fifo, (void *)jsonStr);
     if (ret != 0) {
         ERROR("[INGRESS] egress event fifo full.\n");
         goto err;
     }
-    ret = write(mgr->egressMgr->event_fifo->triggerFd, &msg, sizeof(uint64_t));
-    if (ret != sizeof(uint64_t)) {
+    ret = FifoNotify(mgr->egressMgr->event_fifo);
+    if (ret != 0) {
         ERROR("[INGRESS] send trigger msg to egress event_fifo fd failed.\n");
         return -1;
     }
@@ -144,14 +143,13 @@ static int MetricData2Egress(IngressMgr *mgr, IMDB_Table *table, IMDB_Record* re
         goto err;
     }
 
-    uint64_t msg = 1;
     ret = FifoPut(mgr->egressMgr->metric_fifo, (void *)jsonStr);
     if (ret != 0) {
         ERROR("[INGRESS] egress metric fifo full.\n");
         goto err;
     }
-    ret = write(mgr->egressMgr->metric_fifo->triggerFd, &msg, sizeof(uint64_t));
-    if (ret != sizeof(uint64_t)) {
+    ret = FifoNotify(mgr->egressMgr->metric_fifo);
+    if (ret != 0) {
         ERROR("[INGRESS] send trigger msg to egress metric_fifo fd failed.\n");
         return -1;
     }
@@ -264,32 +262,28 @@ static int ProcessEventData(IngressMgr *mgr, const char *content)
     return 0;
 }
 
-static int ProcessMetricData(IngressMgr *mgr, const char *content, const char *tblName, struct probe_s *probe)
+static IMDB_Table *IngressLkupMetricTable(IngressMgr *mgr, const char *tblName, struct probe_s *probe)
 {
     IMDB_Table* table;
-    IMDB_Record* rec = NULL;
-    int ret = 0;
 
     table = IMDB_DataBaseMgrFindTable(mgr->imdbMgr, tblName);
     if (table == NULL) {
         ERROR("[INGRESS] failed to find tablename \"%s\" of metrics reported by probe %s\n",
               tblName, probe ? probe->name : "unknown");
-        return -1;
+        return NULL;
     }
 
     if (probe) {
         IMDB_TableUpdateExtLabelConf(table, &probe->ext_label_conf);
     }
+    return table;
+}
 
-    if (mgr->imdbMgr->writeLogsType == METRIC_LOG_PROM || mgr->imdbMgr->writeLogsType == METRIC_LOG_JSON) {
-        // save metric to imdb
-        rec = IMDB_DataBaseMgrCreateRec(mgr->imdbMgr, table, content);
-        if (rec == NULL) {
-            return -1;
-        }
-    }
-
+static int IngressMetricRec2Egress(IngressMgr *mgr, IMDB_Table *table, IMDB_Record *rec)
+{
 #ifdef KAFKA_CHANNEL
+    int ret;
+
     if (mgr->egressMgr && mgr->egressMgr->metric_kafkaMgr) {
         // send metric to egress
         ret = MetricData2Egress(mgr, table, rec);
@@ -297,19 +291,88 @@ static int ProcessMetricData(IngressMgr *mgr, const char *content, const char *t
             ERROR("[INGRESS] send metric data to egress failed.\n");
             return -1;
         } else {
-            DEBUG("[INGRESS] send metric data to egress succeed.(tbl=%s,content=%s)\n", table->name, content);
+            DEBUG("[INGRESS] send metric data to egress succeed.(tbl=%s)\n", table->name);
         }
     }
 #endif
     return 0;
 }
 
+static int ProcessMetricData(IngressMgr *mgr, const char *content, const char *tblName, struct probe_s *probe)
+{
+    IMDB_Table* table;
+    IMDB_Record* rec = NULL;
+
+    table = IngressLkupMetricTable(mgr, tblName, probe);
+    if (table == NULL) {
+        return -1;
+    }
+
+    if (mgr->imdbMgr->writeLogsType == METRIC_LOG_PROM || mgr->imdbMgr->writeLogsType == METRIC_LOG_JSON) {
+        // save metric to imdb
+        rec = IMDB_DataBaseMgrCreateRec(mgr->imdbMgr, table, content);
+        if (rec == NULL) {
+            return -1;
+        }
+    }
+
+    return IngressMetricRec2Egress(mgr, table, rec);
+}
+
+// process binary record emitted by native probes, see nprobe_emit_record()
+static int ProcessMetricRecord(IngressMgr *mgr, const struct nprobe_record_s *record, struct probe_s *probe)
+{
+    IMDB_Table* table;
+    IMDB_Record* rec = NULL;
+
+    table = IngressLkupMetricTable(mgr, record->tbl_name, probe);
+    if (table == NULL) {
+        return -1;
+    }
+
+    if (mgr->imdbMgr->writeLogsType == METRIC_LOG_PROM || mgr->imdbMgr->writeLogsType == METRIC_LOG_JSON) {
+        // save metric to imdb
+        rec = IMDB_DataBaseMgrCreateRecByFields(mgr->imdbMgr, table, record->fields, record->field_num);
+        if (rec == NULL) {
+            return -1;
+        }
+    }
+
+    return IngressMetricRec2Egress(mgr, table, rec);
+}
+
+static void IngressDataProcessOne(Fifo *fifo, IngressMgr *mgr, char *dataStr)
+{
+    int ret;
+    char *content;
+    char tblName[MAX_IMDB_TABLE_NAME_LEN];
+
+    if (is_nprobe_record(dataStr)) {
+        (void)ProcessMetricRecord(mgr, (const struct nprobe_record_s *)dataStr, (struct probe_s *)fifo->probe);
+        return;
+    }
+
+    ret = GetTableNameAndContent((const char*)dataStr, tblName, MAX_IMDB_TABLE_NAME_LEN, &content);
+    if (ret < 0 || (content == NULL)) {
+        ERROR("[INGRESS] Get dirty data str: %s\n", dataStr);
+        return;
+    }
+
+    if (strcmp(tblName, "log") == 0) {
+        (void)ProcessOtelLogData(mgr, content);
+    } else if (strcmp(tblName, "event") == 0) {
+        (void)ProcessEventData(mgr, content);
+    } else {
+        (void)ProcessMetricData(mgr, content, tblName, (struct probe_s *)fifo->probe);
+    }
+}
+
 static int IngressDataProcesssInput(Fifo *fifo, IngressMgr *mgr)
 {
     // read data from fifo
-    char *dataStr, *content;
+    char *dataStrs[FIFO_BATCH_SIZE];
+    uint32_t num, i;
     int ret = 0;
-    char tblName[MAX_IMDB_TABLE_NAME_LEN];
 
     uint64_t val = 0;
     ret = read(fifo->triggerFd, &val, sizeof(val));
@@ -318,27 +381,16 @@ static int IngressDataProcesssInput(Fifo *fifo, IngressMgr *mgr)
         return -1;
     }
 
-    while (FifoGet(fifo, (void **)&dataStr) == 0) {
-        if (dataStr == NULL)
-            continue;
-
-        ret = GetTableNameAndContent((const char*)dataStr, tblName, MAX_IMDB_TABLE_NAME_LEN, &content);
-        if (ret < 0 || (content == NULL)) {
-            ERROR("[INGRESS] Get dirty data str: %s\n", dataStr);
-            free(dataStr);
-            continue;
+    do {
+        while ((num = FifoGetN(fifo, (void **)dataStrs, FIFO_BATCH_SIZE)) > 0) {
+            for (i = 0; i < num; i++) {
+                if (dataStrs[i] == NULL)
+                    continue;
+                IngressDataProcessOne(fifo, mgr, dataStrs[i]);
+                free(dataStrs[i]);
+            }
         }
-
-        if (strcmp(tblName, "log") == 0) {
-            (void)ProcessOtelLogData(mgr, content);
-        } else if (strcmp(tblName, "event") == 0) {
-            (void)ProcessEventData(mgr, content);
-        } else {
-            (void)ProcessMetricData(mgr, content, tblName, (struct probe_s *)fifo->probe);
-        }
-
-        free(dataStr);
-    }
+    } while (FifoArm(fifo));
 
     return 0;
 }
@@ -241,6 +241,29 @@ static int ConfigMgrLoadKafkaConfig(void *config, config_setting_t *settings)
     }
     kafkaConfig->queueBufferingMaxMs = intVal;
 
+    kafkaConfig->msgPack = KAFKA_MSG_PACK_NONE;
+    ret = config_setting_lookup_string(settings, "msg_pack", &strVal);
+    if (ret != 0) {
+        if (!strcmp(strVal, "newline")) {
+            kafkaConfig->msgPack = KAFKA_MSG_PACK_NEWLINE;
+        } else if (!strcmp(strVal, "length")) {
+            kafkaConfig->msgPack = KAFKA_MSG_PACK_LENGTH;
+        } else if (strcmp(strVal, "none")) {
+            ERROR("[CONFIG] kafka msg_pack must be none, newline or length.\n");
+            return -1;
+        }
+    }
+
+    kafkaConfig->msgPackMaxKbytes = KAFKA_MSG_PACK_MAX_KBYTES;
+    ret = config_setting_lookup_int(settings, "msg_pack_max_kbytes", &intVal);
+    if (ret != 0) {
+        if (intVal <= 0) {
+            ERROR("[CONFIG] kafka msg_pack_max_kbytes must be positive.\n");
+            return -1;
+        }
+        kafkaConfig->msgPackMaxKbytes = (uint32_t)intVal;
+    }
+
     return 0;
 }
 
@@ -353,7 +376,38 @@ static int ConfigMgrLoadServerConfig(void *config, config_setting_t *settings, c
 
 static int ConfigMgrLoadWebServerConfig(void *config, config_setting_t *settings)
 {
-    return ConfigMgrLoadServerConfig(config, settings, "webServerConfig");
+    HttpServerConfig *serverConfig = (HttpServerConfig *)config;
+    const char *strVal = NULL;
+    int intVal = 0;
+    int ret;
+
+    ret = ConfigMgrLoadServerConfig(config, settings, "webServerConfig");
+    if (ret) {
+        return ret;
+    }
+
+    serverConfig->metricsFile = 0;
+    ret = config_setting_lookup_string(settings, "metrics_mode", &strVal);
+    if (ret != 0) {
+        if (!strcmp(strVal, "file")) {
+            serverConfig->metricsFile = 1;
+        } else if (strcmp(strVal, "memory")) {
+            ERROR("[CONFIG] webServerConfig metrics_mode must be memory or file.\n");
+            return -1;
+        }
+    }
+
+    serverConfig->snapshotTtl = WEB_SERVER_SNAPSHOT_TTL;
+    ret = config_setting_lookup_int(settings, "snapshot_ttl", &intVal);
+    if (ret != 0) {
+        if (intVal < 0) {
+            ERROR("[CONFIG] webServerConfig snapshot_ttl must not be negative.\n");
+            return -1;
+        }
+        serverConfig->snapshotTtl = (uint32_t)intVal;
+    }
+
+    return 0;
 }
 
 static int ConfigMgrLoadRestServerConfig(void *config, config_setting_t *settings)
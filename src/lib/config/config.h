@@ -21,6 +21,9 @@
 #include "base.h"
 #include "common.h"
 
+#define WEB_SERVER_SNAPSHOT_TTL     5       // unit: second
+#define KAFKA_MSG_PACK_MAX_KBYTES   64
+
 typedef enum {
     LOG_DEBUG = 0,
     LOG_INFO,
@@ -44,6 +47,12 @@ typedef struct {
     uint32_t timeRange;
 } EgressConfig;
 
+typedef enum {
+    KAFKA_MSG_PACK_NONE = 0,    // One record per kafka message
+    KAFKA_MSG_PACK_NEWLINE,     // Records packed into one kafka message, each one ends with '\n'
+    KAFKA_MSG_PACK_LENGTH       // Records packed into one kafka message, each one follows its 4-byte big-endian length
+} KafkaMsgPack;
+
 typedef struct {
     char broker[MAX_KAFKA_BROKER_LEN];
     uint32_t batchNumMessages;
@@ -51,6 +60,8 @@ typedef struct {
     uint32_t queueBufferingMaxMessages;
     uint32_t queueBufferingMaxKbytes;
     uint32_t queueBufferingMaxMs;
+    KafkaMsgPack msgPack;
+    uint32_t msgPackMaxKbytes;  // Max size of one packed kafka message
 } KafkaConfig;
 
 typedef struct  {
@@ -67,6 +78,8 @@ typedef struct {
     char privateKey[PATH_LEN];
     char certFile[PATH_LEN];
     char caFile[PATH_LEN];
+    char metricsFile;          // web_server only, serve metrics from log files instead of in-memory snapshot
+    uint32_t snapshotTtl;      // web_server only, seconds that one rendered snapshot is served to scrapers
 } HttpServerConfig;
 
 typedef struct {
@@ -23,6 +23,14 @@
 
 #define IS_POWER_OF_TWO(n) ((n) != 0 && (((n) & ((n) - 1)) == 0))
 
+#if defined(__x86_64__) || defined(__i386__)
+#define FIFO_CPU_RELAX()    __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define FIFO_CPU_RELAX()    __asm__ __volatile__("yield" ::: "memory")
+#else
+#define FIFO_CPU_RELAX()    do { } while (0)
+#endif
+
 static uint32_t FifoMin(uint32_t x1, uint32_t x2)
 {
     return x1 < x2 ? x1 : x2;
@@ -50,6 +58,7 @@ Fifo *FifoCreate(uint32_t size)
     }
     memset(fifo->buffer, 0, sizeof(void *) * size);
 
+    fifo->waiting = 1;
     fifo->triggerFd = eventfd(0, 0);
     if (fifo->triggerFd == -1) {
         free(fifo->buffer);
@@ -81,47 +90,146 @@ void FifoDestroy(Fifo *fifo)
     return;
 }
 
+/* Full means FifoPutN() cannot reserve a slot, i.e. all 'size' slots are taken. */
 int FifoFull(const Fifo *fifo)
 {
-    return ((fifo->size - fifo->in + fifo->out) <= 1) ? 1 : 0;
+    uint32_t in = __atomic_load_n(&fifo->in_head, __ATOMIC_RELAXED);
+    uint32_t out = __atomic_load_n(&fifo->out, __ATOMIC_RELAXED);
+
+    return ((in - out) >= fifo->size) ? 1 : 0;
 }
 
-int FifoPut(Fifo *fifo, void *element)
+static void FifoCopyIn(Fifo *fifo, uint32_t pos, void **elements, uint32_t num)
+{
+    uint32_t idx = pos & (fifo->size - 1);
+    uint32_t len = FifoMin(num, fifo->size - idx);
+
+    memcpy(fifo->buffer + idx, elements, sizeof(void *) * len);
+    memcpy(fifo->buffer, elements + len, sizeof(void *) * (num - len));
+}
+
+static void FifoCopyOut(Fifo *fifo, uint32_t pos, void **elements, uint32_t num)
 {
-    uint32_t len = 1;
-    uint32_t len2 = 0;
+    uint32_t idx = pos & (fifo->size - 1);
+    uint32_t len = FifoMin(num, fifo->size - idx);
+
+    memcpy(elements, fifo->buffer + idx, sizeof(void *) * len);
+    memcpy(elements + len, fifo->buffer, sizeof(void *) * (num - len));
+}
 
-    len = FifoMin(len, fifo->size - fifo->in + fifo->out);
+static void FifoUpdateWatermark(Fifo *fifo, uint32_t depth)
+{
+    uint32_t hwm = __atomic_load_n(&fifo->high_watermark, __ATOMIC_RELAXED);
 
-    __sync_synchronize();
+    while (depth > hwm) {
+        if (__atomic_compare_exchange_n(&fifo->high_watermark, &hwm, depth, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
 
-    len2 = FifoMin(len, fifo->size - (fifo->in & (fifo->size - 1)));
-    memcpy(fifo->buffer + (fifo->in & (fifo->size - 1)), &element, sizeof(void *) * len2);
-    memcpy(fifo->buffer, &element, sizeof(void *) * (len - len2));
+/*
+ * Multi-producer enqueue: producers reserve slots by CAS on 'in_head', fill them,
+ * then publish in reservation order by moving 'in' with release semantic.
+ * Returns the number of elements put, which is less than num if fifo is full.
+ */
+uint32_t FifoPutN(Fifo *fifo, void **elements, uint32_t num)
+{
+    uint32_t head, next, out, len;
+
+    head = __atomic_load_n(&fifo->in_head, __ATOMIC_RELAXED);
+    do {
+        out = __atomic_load_n(&fifo->out, __ATOMIC_ACQUIRE);
+        len = FifoMin(num, fifo->size - head + out);
+        if (len == 0) {
+            return 0;
+        }
+        next = head + len;
+    } while (!__atomic_compare_exchange_n(&fifo->in_head, &head, next, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    FifoCopyIn(fifo, head, elements, len);
+
+    // wait for earlier producers to publish their slots
+    while (__atomic_load_n(&fifo->in, __ATOMIC_RELAXED) != head) {
+        FIFO_CPU_RELAX();
+    }
+    __atomic_store_n(&fifo->in, next, __ATOMIC_RELEASE);
 
-    __sync_synchronize();
+    __atomic_add_fetch(&fifo->enqueued, len, __ATOMIC_RELAXED);
+    FifoUpdateWatermark(fifo, next - out);
+    return len;
+}
 
-    fifo->in += len;
-    return len == 0 ? -1 : 0;
+/*
+ * Dequeue, returns the number of elements got. The consumer is normally single,
+ * but a producer may also take the oldest elements away(drop-oldest overflow
+ * policy), so 'out' is moved by CAS. Slots in [out, in) are never rewritten
+ * before 'out' passes them, hence copying before the CAS is safe.
+ */
+uint32_t FifoGetN(Fifo *fifo, void **elements, uint32_t num)
+{
+    uint32_t in, out, len;
+
+    out = __atomic_load_n(&fifo->out, __ATOMIC_RELAXED);
+    do {
+        in = __atomic_load_n(&fifo->in, __ATOMIC_ACQUIRE);
+        len = FifoMin(num, in - out);
+        if (len == 0) {
+            return 0;
+        }
+        FifoCopyOut(fifo, out, elements, len);
+    } while (!__atomic_compare_exchange_n(&fifo->out, &out, out + len, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return len;
+}
+
+int FifoPut(Fifo *fifo, void *element)
+{
+    return (FifoPutN(fifo, &element, 1) == 1) ? 0 : -1;
 }
 
 int FifoGet(Fifo *fifo, void **elements)
 {
-    uint32_t len = 1;
-    uint32_t len2 = 0;
+    return (FifoGetN(fifo, elements, 1) == 1) ? 0 : -1;
+}
 
-    len = FifoMin(len, fifo->in - fifo->out);
+/*
+ * Wake up the consumer after elements are put. The eventfd is written only when
+ * the consumer has armed the fifo(i.e. empty -> non-empty transition), so one
+ * syscall covers a whole batch no matter how many producers put into it.
+ */
+int FifoNotify(Fifo *fifo)
+{
+    uint64_t msg = 1;
 
-    __sync_synchronize();
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&fifo->waiting, 0, __ATOMIC_SEQ_CST) == 0) {
+        return 0;
+    }
 
-    len2 = FifoMin(len, fifo->size - (fifo->out & (fifo->size - 1)));
-    memcpy(elements, fifo->buffer + (fifo->out & (fifo->size - 1)), sizeof(void *) * len2);
-    memcpy(elements, fifo->buffer, sizeof(void *) * (len - len2));
+    __atomic_add_fetch(&fifo->notify_cnt, 1, __ATOMIC_RELAXED);
+    if (write(fifo->triggerFd, &msg, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        return -1;
+    }
+    return 0;
+}
 
-    __sync_synchronize();
+/*
+ * Called by the consumer after it drained the fifo, before it goes back to wait
+ * on triggerFd. Returns 1 if elements arrived meanwhile and must be drained now.
+ */
+int FifoArm(Fifo *fifo)
+{
+    __atomic_store_n(&fifo->waiting, 1, __ATOMIC_SEQ_CST);
+    return (__atomic_load_n(&fifo->in, __ATOMIC_SEQ_CST) != __atomic_load_n(&fifo->out, __ATOMIC_RELAXED)) ? 1 : 0;
+}
+
+uint32_t FifoDepth(const Fifo *fifo)
+{
+    uint32_t in = __atomic_load_n(&fifo->in, __ATOMIC_RELAXED);
+    uint32_t out = __atomic_load_n(&fifo->out, __ATOMIC_RELAXED);
 
-    fifo->out += len;
-    return len == 0 ? -1 : 0;
+    return in - out;
 }
 
 FifoMgr *FifoMgrCreate(uint32_t size)
@@ -17,13 +17,22 @@
 
 #include <stdint.h>
 
+#define FIFO_BATCH_SIZE     64
+
 typedef struct {
     void **buffer;
     uint32_t size;
-    uint32_t in;
-    uint32_t out;
+    uint32_t in;            // published by producers, read by consumer
+    uint32_t out;           // published by consumer, read by producers
+    uint32_t in_head;       // reserved by producers, may run ahead of 'in'
+    uint32_t waiting;       // 1: consumer found fifo empty and waits for triggerFd
 
     int triggerFd;
+    uint64_t notify_cnt;    // number of triggerFd writes
+
+    uint64_t enqueued;      // number of elements put into fifo
+    uint64_t dropped;       // number of elements dropped by the overflow policy of producer
+    uint32_t high_watermark;    // max depth ever seen by producers
     void *probe;    // pointed to the probe who creates it
 } Fifo;
 
@@ -39,6 +48,11 @@ void FifoDestroy(Fifo *fifo);
 int FifoFull(const Fifo *fifo);
 int FifoPut(Fifo *fifo, void *element);
 int FifoGet(Fifo *fifo, void **elements);
+uint32_t FifoPutN(Fifo *fifo, void **elements, uint32_t num);
+uint32_t FifoGetN(Fifo *fifo, void **elements, uint32_t num);
+int FifoNotify(Fifo *fifo);
+int FifoArm(Fifo *fifo);
+uint32_t FifoDepth(const Fifo *fifo);
 
 FifoMgr *FifoMgrCreate(uint32_t size);
 void FifoMgrDestroy(FifoMgr *mgr);
@@ -294,7 +294,7 @@ int init_http_server_mgr(http_server_mgr_s *server_mgr, HttpServerConfig *config
         evhttp_set_bevcb(server_mgr->evhttp, http_server_bevcb_nossl, NULL);
     }
 
-    evhttp_set_gencb(server_mgr->evhttp, server_mgr->req_handler, NULL);
+    evhttp_set_gencb(server_mgr->evhttp, server_mgr->req_handler, server_mgr->req_arg);
     evhttp_set_allowed_methods(server_mgr->evhttp, server_mgr->allow_methods);
 
     handle = evhttp_bind_socket_with_handle(server_mgr->evhttp, server_mgr->bind_addr, server_mgr->port);
@@ -47,6 +47,7 @@ typedef struct {
     uint16_t port;
     uint16_t allow_methods;
     request_handler_cb req_handler;
+    void *req_arg;                // Passed to req_handler as arg
     char bind_addr[IP_STR_LEN];
     SSL_CTX *ssl_ctx;             // Indicate that if we enable https and client auth
     struct event_base *evbase;
@@ -13,6 +13,7 @@
  * Description: cache container info
  ******************************************************************************/
 #include <stdio.h>
+#include <time.h>
 
 #include "container.h"
 #include "json_tool.h"
@@ -48,18 +49,11 @@ static void delete_if_pod_caches_full(struct pod_cache **caches_ptr)
     }
 }
 
-struct container_cache *lkup_container_cache(struct container_cache *caches, const char *container_id)
-{
-    struct container_cache *con_cache = NULL;
-
-    H_FIND_S(caches, container_id, con_cache);
-    return con_cache;
-}
-
 static void fill_container_info(struct container_cache *con_cache)
 {
     int ret;
 
+    con_cache->ts = time(NULL);
     con_cache->container_name[0] = 0;
     ret = get_container_name(con_cache->container_id, con_cache->container_name, sizeof(con_cache->container_name));
     if (ret) {
@@ -82,6 +76,17 @@ static void fill_container_info(struct container_cache *con_cache)
     }
 }
 
+struct container_cache *lkup_container_cache(struct container_cache *caches, const char *container_id)
+{
+    struct container_cache *con_cache = NULL;
+
+    H_FIND_S(caches, container_id, con_cache);
+    if (con_cache != NULL && time(NULL) >= con_cache->ts + CONTAINER_CACHE_TMOUT) {
+        fill_container_info(con_cache);
+    }
+    return con_cache;
+}
+
 struct container_cache *create_container_cache(struct container_cache **caches_ptr, const char *container_id)
 {
     struct container_cache *con_cache;
@@ -119,12 +124,15 @@ void free_container_caches(struct container_cache **caches_ptr)
     *caches_ptr = NULL;
 }
 
-struct pod_cache *lkup_pod_cache(struct pod_cache *caches, const char *pod_id)
+static void free_pod_label_caches(struct pod_label_cache **caches_ptr)
 {
-    struct pod_cache *pod_cache = NULL;
+    struct pod_label_cache *cache, *tmp;
 
-    H_FIND_S(caches, pod_id, pod_cache);
-    return pod_cache;
+    H_ITER(*caches_ptr, cache, tmp) {
+        H_DEL(*caches_ptr, cache);
+        free(cache);
+    }
+    *caches_ptr = NULL;
 }
 
 #define __KW_POD_NAME       "io.kubernetes.pod.name"
@@ -138,6 +146,7 @@ static void fill_pod_info(struct pod_cache *pod_cache, const char *container_id)
     struct pod_label_cache *pod_label_cache;
     int ret;
 
+    pod_cache->ts = time(NULL);
     pod_labels_buf[0] = 0;
     ret = get_container_pod_labels(container_id, pod_labels_buf, sizeof(pod_labels_buf));
     if (ret) {
@@ -155,8 +164,12 @@ static void fill_pod_info(struct pod_cache *pod_cache, const char *container_id)
     }
     struct key_value_pairs *kv_pairs = Json_GetKeyValuePairs(pod_labels_json);
     if (!kv_pairs) {
+        Json_Delete(pod_labels_json);
         return;
     }
+
+    // Labels of pod may change, refill them as a whole.
+    free_pod_label_caches(&pod_cache->pod_labels);
     struct key_value *kv;
     Json_ArrayForEach(kv, kv_pairs) {
         label_val = (char *)Json_GetValueString(kv->valuePtr);
@@ -189,6 +202,17 @@ static void fill_pod_info(struct pod_cache *pod_cache, const char *container_id)
     Json_Delete(pod_labels_json);
 }
 
+struct pod_cache *lkup_pod_cache(struct pod_cache *caches, const char *pod_id)
+{
+    struct pod_cache *pod_cache = NULL;
+
+    H_FIND_S(caches, pod_id, pod_cache);
+    if (pod_cache != NULL && time(NULL) >= pod_cache->ts + CONTAINER_CACHE_TMOUT) {
+        fill_pod_info(pod_cache, pod_cache->container_id);
+    }
+    return pod_cache;
+}
+
 struct pod_cache *create_pod_cache(struct pod_cache **caches_ptr, const char *pod_id, const char *container_id)
 {
     struct pod_cache *pod_cache;
@@ -204,23 +228,14 @@ struct pod_cache *create_pod_cache(struct pod_cache **caches_ptr, const char *po
         return NULL;
     }
 
+    (void)snprintf(pod_cache->container_id, sizeof(pod_cache->container_id), "%s", container_id);
+
     fill_pod_info(pod_cache, container_id);
     delete_if_pod_caches_full(caches_ptr);
     H_ADD_S(*caches_ptr, pod_id, pod_cache);
     return pod_cache;
 }
 
-static void free_pod_label_caches(struct pod_label_cache **caches_ptr)
-{
-    struct pod_label_cache *cache, *tmp;
-
-    H_ITER(*caches_ptr, cache, tmp) {
-        H_DEL(*caches_ptr, cache);
-        free(cache);
-    }
-    *caches_ptr = NULL;
-}
-
 void free_pod_cache(struct pod_cache *cache)
 {
     if (!cache) {
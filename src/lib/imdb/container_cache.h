@@ -20,11 +20,14 @@
 #include "common.h"
 #include "hash.h"
 
+#define CONTAINER_CACHE_TMOUT   300     // unit: second, cached info is refreshed in place after timeout
+
 struct container_cache {
     char container_id[CONTAINER_ABBR_ID_LEN + 1];   // key
     char container_name[CONTAINER_NAME_LEN];
     char container_image[CONTAINER_IMAGE_LEN];
     char pod_id[POD_ID_LEN + 1];
+    time_t ts;
     H_HANDLE;
 };
 
@@ -39,6 +42,8 @@ struct pod_cache {
     char pod_name[POD_NAME_LEN];
     char pod_namespace[POD_NAMESPACE_LEN];
     struct pod_label_cache *pod_labels;
+    char container_id[CONTAINER_ABBR_ID_LEN + 1];   // Any container in pod, used to refresh pod info
+    time_t ts;
     H_HANDLE;
 };
 
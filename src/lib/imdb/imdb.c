@@ -25,12 +25,16 @@
 #include "strbuf.h"
 #include "container.h"
 #include "meta.h"
+#include "nprobe_record.h"
 #include "imdb.h"
 
 static uint32_t g_recordTimeout = 60;       // default timeout: 60 seconds
 #define IMDB_BUILD_ERR           (-1)
 #define IMDB_BUFFER_FULL         (-2)
 
+#define IMDB_VALUE_SIZE(len)     (((len) + IMDB_ARENA_ALIGN) & ~((size_t)IMDB_ARENA_ALIGN - 1))
+#define IMDB_VALUE_MALLOCED      0x80000000U    // Flag in valueSize, value of an arena record moved to malloc
+
 IMDB_Metric *IMDB_MetricCreate(char *name, char *description, char *type)
 {
     int ret = 0;
@@ -129,6 +133,13 @@ IMDB_Record *IMDB_RecordCreate(uint32_t capacity)
         return NULL;
     }
     memset(record->value, 0, sizeof(char *) * capacity);
+
+    record->valueSize = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    if (record->valueSize == NULL) {
+        free(record->value);
+        free(record);
+        return NULL;
+    }
     return record;
 }
 
@@ -155,12 +166,26 @@ void IMDB_RecordDestroy(IMDB_Record *record)
     if (record == NULL)
         return;
 
+    // Released with the arena of table, except values grown out of it
+    if (record->inArena) {
+        for (int i = 0; i < record->table->meta->metricsCapacity; i++) {
+            if (record->valueSize[i] & IMDB_VALUE_MALLOCED) {
+                free(record->value[i]);
+            }
+        }
+        return;
+    }
+
     if (record->value != NULL) {
         for (int i = 0; i < record->table->meta->metricsCapacity; i++) {
             free(record->value[i]);
         }
         free(record->value);
     }
+    free(record->valueSize);
+    if (record->key != NULL) {
+        free(record->key);
+    }
     free(record);
     return;
 }
@@ -179,8 +204,16 @@ IMDB_Table *IMDB_TableCreate(char *name, uint32_t capacity)
         return NULL;
     }
 
+    if (pthread_mutex_init(&table->lock, NULL)) {
+        (void)pthread_rwlock_destroy(&table->ext_label_conf.rwlock);
+        free(table);
+        return NULL;
+    }
+
     table->recordsCapability = capacity;
     (void)snprintf(table->name, sizeof(table->name), "%s", name);
+    IMDB_ArenaInit(&table->arena, IMDB_ARENA_MAX_SIZE);
+    IMDB_ArenaInit(&table->sealed.arena, IMDB_ARENA_MAX_SIZE);
     return table;
 }
 
@@ -193,6 +226,21 @@ void IMDB_TableSetEntityName(IMDB_Table *table, char *entity_name)
 void IMDB_TableSetMeta(IMDB_Table *table, IMDB_Meta *meta)
 {
     table->meta = meta;
+    table->keyNum = 0;
+
+    // A series is identified by all its labels, key columns alone may be shared, e.g. name of nic_failure.
+    for (uint32_t i = 0; i < meta->metricsCapacity; i++) {
+        if (meta->metrics[i] == NULL || (strcmp(meta->metrics[i]->type, METRIC_TYPE_KEY) != 0 &&
+                                         strcmp(meta->metrics[i]->type, METRIC_TYPE_LABEL) != 0)) {
+            continue;
+        }
+        if (table->keyNum >= MAX_IMDB_TABLE_KEY_NUM) {
+            WARN("[IMDB] Too many key and label columns in table %s, records will not be indexed.\n", table->name);
+            table->keyNum = 0;
+            return;
+        }
+        table->keyIdx[table->keyNum++] = (uint16_t)i;
+    }
 }
 
 int IMDB_TableAddRecord(IMDB_Table *table, IMDB_Record *record)
@@ -228,6 +276,10 @@ void IMDB_TableDestroy(IMDB_Table *table)
     }
 
     DeleteAndFreeRecords(table);
+    IMDB_ArenaDestroy(&table->arena);
+    IMDB_ArenaDestroy(&table->sealed.arena);
+    IMDB_LabelCacheClear(table);
+    (void)pthread_mutex_destroy(&table->lock);
     if (table->meta != NULL) {
         IMDB_MetaDestroy(table->meta);
     }
@@ -293,7 +345,7 @@ err:
 
 #define __IMDB_TGID_CACHE_SIZE  1024
 
-void IMDB_TgidAddRecord(const IMDB_DataBaseMgr *mgr, TGID_Record *record)
+void IMDB_TgidAddRecord(IMDB_DataBaseMgr *mgr, TGID_Record *record)
 {
     if (H_COUNT(*(mgr->tgids)) > __IMDB_TGID_CACHE_SIZE) {
         TGID_Record *r, *tmp;
@@ -302,6 +354,7 @@ void IMDB_TgidAddRecord(const IMDB_DataBaseMgr *mgr, TGID_Record *record)
             free(r);
             break;
         }
+        mgr->labelsGen++;   // labels rendered from evicted record may be stale
     }
 
     H_ADD_KEYPTR(*(mgr->tgids), &record->key, sizeof(TGID_RecordKey), record);
@@ -342,6 +395,29 @@ static void tgid_record_set_cmdline(TGID_Record *record, int pid)
     }
 }
 
+/* Container and pod caches evict old entries once full, labels rendered from them may be stale then. */
+static struct container_cache *IMDB_CreateContainerCache(IMDB_DataBaseMgr *mgr, const char *container_id)
+{
+    unsigned int num = H_COUNT(mgr->container_caches);
+    struct container_cache *con_cache = create_container_cache(&mgr->container_caches, container_id);
+
+    if (con_cache != NULL && H_COUNT(mgr->container_caches) <= num) {
+        mgr->labelsGen++;
+    }
+    return con_cache;
+}
+
+static struct pod_cache *IMDB_CreatePodCache(IMDB_DataBaseMgr *mgr, const char *pod_id, const char *container_id)
+{
+    unsigned int num = H_COUNT(mgr->pod_caches);
+    struct pod_cache *pod_cache = create_pod_cache(&mgr->pod_caches, pod_id, container_id);
+
+    if (pod_cache != NULL && H_COUNT(mgr->pod_caches) <= num) {
+        mgr->labelsGen++;
+    }
+    return pod_cache;
+}
+
 static void tgid_record_set_container_info(TGID_Record *record, IMDB_DataBaseMgr *mgr)
 {
     char container_id[CONTAINER_ABBR_ID_LEN + 1];
@@ -357,12 +433,12 @@ static void tgid_record_set_container_info(TGID_Record *record, IMDB_DataBaseMgr
     if (container_id[0]) {
         con_cache = lkup_container_cache(mgr->container_caches, container_id);
         if (!con_cache) {
-            con_cache = create_container_cache(&mgr->container_caches, container_id);
+            con_cache = IMDB_CreateContainerCache(mgr, container_id);
         }
     }
     if (con_cache && con_cache->pod_id[0]) {
         if (!lkup_pod_cache(mgr->pod_caches, con_cache->pod_id)) {
-            (void)create_pod_cache(&mgr->pod_caches, con_cache->pod_id, con_cache->container_id);
+            (void)IMDB_CreatePodCache(mgr, con_cache->pod_id, con_cache->container_id);
         }
     }
 }
@@ -434,6 +510,7 @@ void IMDB_DataBaseMgrDestroy(IMDB_DataBaseMgr *mgr)
 
     if (mgr->tables != NULL) {
         for (int i = 0; i < mgr->tablesNum; i++) {
+            H_DEL(mgr->tblsHash, mgr->tables[i]);
             IMDB_TableDestroy(mgr->tables[i]);
         }
         free(mgr->tables);
@@ -463,42 +540,202 @@ int IMDB_DataBaseMgrAddTable(IMDB_DataBaseMgr *mgr, IMDB_Table* table)
         return -1;
     }
 
-    for (int i = 0; i < mgr->tablesNum; i++) {
-        if (strcmp(mgr->tables[i]->name, table->name) == 0)
-            return -1;
+    if (IMDB_DataBaseMgrFindTable(mgr, table->name) != NULL) {
+        return -1;
     }
 
     mgr->tables[mgr->tablesNum] = table;
     mgr->tablesNum++;
+    H_ADD_S(mgr->tblsHash, name, table);
     return 0;
 }
 
+/*
+ * Tables are only added when meta files are loaded, the hash is read-only afterwards,
+ * so lookup is safe while the metrics thread reorders mgr->tables by RequeueTable().
+ */
 IMDB_Table *IMDB_DataBaseMgrFindTable(IMDB_DataBaseMgr *mgr, const char *tableName)
 {
-    for (int i = 0; i < mgr->tablesNum; i++) {
-        if (strcmp(mgr->tables[i]->name, tableName) == 0) {
-            return mgr->tables[i];
+    IMDB_Table *table = NULL;
+
+    H_FIND_S(mgr->tblsHash, tableName, table);
+    return table;
+}
+
+/*
+ * Set value of one column, the old storage is reused as long as the new value fits in its
+ * allocated size, so a value shrinking and growing back(e.g. counters) is not reallocated.
+ * Only the first value of an arena record comes from arena, a value growing later is moved
+ * to malloc, so updating records which are kept across scrapes never grows the arena.
+ */
+static int IMDB_RecordSetValue(IMDB_Table *table, IMDB_Record *record, uint32_t index, const char *str)
+{
+    size_t len = strlen(str);
+    uint32_t valueSize = record->valueSize[index];
+    size_t size;
+    char *value = record->value[index];
+    char *old;
+
+    if (value != NULL && (valueSize & ~IMDB_VALUE_MALLOCED) > len) {
+        (void)memcpy(value, str, len + 1);
+        return 0;
+    }
+
+    size = IMDB_VALUE_SIZE(len);
+    if (record->inArena && value == NULL) {
+        value = (char *)IMDB_ArenaAlloc(&table->arena, size);
+        if (value != NULL) {
+            (void)memcpy(value, str, len + 1);
+            record->value[index] = value;
+            record->valueSize[index] = (uint32_t)size;
+            return 0;
+        }
+    }
+
+    // Storage in arena is left there
+    old = (!record->inArena || (valueSize & IMDB_VALUE_MALLOCED)) ? record->value[index] : NULL;
+    value = (char *)realloc(old, size);
+    if (value == NULL) {
+        return -1;
+    }
+    (void)memcpy(value, str, len + 1);
+
+    record->value[index] = value;
+    record->valueSize[index] = (uint32_t)size | (record->inArena ? IMDB_VALUE_MALLOCED : 0);
+    return 0;
+}
+
+static void IMDB_TableTryResetArena(IMDB_Table *table)
+{
+    if (table->recordNum == 0) {
+        IMDB_ArenaReset(&table->arena);
+    }
+}
+
+/*
+ * Records of a table are released all together after serialized, so they are bump-allocated
+ * from the arena of table: one allocation for record, value array and key, one per column value.
+ * Falls back to malloc if arena of table is over its limit, or if records of the table are kept
+ * across scrapes, where the arena would never be reset.
+ */
+static IMDB_Record *IMDB_TableAllocRecord(IMDB_Table *table, const char *key, int keyLen)
+{
+    uint32_t capacity = table->meta->metricsCapacity;
+    size_t size = sizeof(IMDB_Record) + (sizeof(char *) + sizeof(uint32_t)) * capacity;
+    IMDB_Record *record = NULL;
+
+    IMDB_TableTryResetArena(table);
+    if (!table->kept && !IMDB_ArenaFull(&table->arena)) {
+        record = (IMDB_Record *)IMDB_ArenaAlloc(&table->arena, size + (size_t)keyLen + 1);
+    }
+
+    if (record == NULL) {
+        record = IMDB_RecordCreateWithTable(table);
+        if (record != NULL && keyLen > 0) {
+            record->key = strdup(key);
+            if (record->key == NULL) {
+                IMDB_RecordDestroy(record);
+                return NULL;
+            }
+        }
+        return record;
+    }
+
+    (void)memset(record, 0, size);
+    record->value = (char **)(record + 1);
+    record->valueSize = (uint32_t *)(record->value + capacity);
+    record->table = table;
+    record->inArena = 1;
+    if (keyLen > 0) {
+        record->key = (char *)record + size;
+        (void)memcpy(record->key, key, (size_t)keyLen + 1);
+    }
+    return record;
+}
+
+// eg: values of key and label columns "1234", "eth0" -> "1234|eth0", returns length of key, 0 if not indexed
+static int IMDB_BuildRecordKey(const IMDB_Table *table, const char **values, char *key, size_t size)
+{
+    size_t len = 0, valLen;
+    uint32_t i;
+
+    if (table->keyNum == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < table->keyNum; i++) {
+        valLen = strlen(values[table->keyIdx[i]]);
+        if (len + valLen + 1 >= size) {
+            return 0;
+        }
+        if (i > 0) {
+            key[len++] = '|';
+        }
+        (void)memcpy(key + len, values[table->keyIdx[i]], valLen);
+        len += valLen;
+    }
+    key[len] = 0;
+    return (int)len;
+}
+
+/*
+ * Repeated reports of the same series(same values of key and label columns) before the records
+ * are consumed overwrite the existing record in place, so the number of records in a
+ * table is bounded by the number of live entities instead of the report rate.
+ */
+static IMDB_Record *IMDB_TableUpsertRecord(IMDB_Table *table, const char **values)
+{
+    char key[MAX_IMDB_RECORD_KEY_LEN];
+    uint32_t i, metricsCapacity = table->meta->metricsCapacity;
+    IMDB_Record *record = NULL;
+    int keyLen;
+
+    keyLen = IMDB_BuildRecordKey(table, values, key, sizeof(key));
+    if (keyLen > 0) {
+        H_FIND(table->recordsHash, key, keyLen, record);
+    }
+
+    if (record != NULL) {
+        for (i = 0; i < metricsCapacity; i++) {
+            if (IMDB_RecordSetValue(table, record, i, values[i]) != 0) {
+                ERROR("[IMDB] Set metrics value failed.(%s, %s).\n", table->name, table->meta->metrics[i]->name);
+                DeleteRecord(table, record);
+                IMDB_RecordDestroy(record);
+                return NULL;
+            }
+        }
+        IMDB_RecordUpdateTime(record, (time_t)time(NULL));
+        return record;
+    }
+
+    record = IMDB_TableAllocRecord(table, key, keyLen);
+    if (record == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < metricsCapacity; i++) {
+        if (IMDB_RecordSetValue(table, record, i, values[i]) != 0) {
+            ERROR("[IMDB] Set metrics value failed.(%s, %s).\n", table->name, table->meta->metrics[i]->name);
+            goto err;
         }
     }
 
+    if (IMDB_TableAddRecord(table, record) != 0) {
+        goto err;
+    }
+    return record;
+
+err:
+    IMDB_RecordDestroy(record);
     return NULL;
 }
 
-static int IMDB_DataBaseMgrParseContent(IMDB_DataBaseMgr *mgr, IMDB_Table *table,
-                                        IMDB_Record *record, const char *content)
+static int IMDB_DataBaseMgrParseContent(IMDB_Table *table, char *buffer, const char **values)
 {
-    char *value;
-    char *token, *buffer;
+    char *token;
     char delim[] = "|";
-    char *buffer_head = NULL;
     uint32_t index = 0, metricsCapacity = table->meta->metricsCapacity;
 
-    buffer = strdup(content);
-    if (buffer == NULL) {
-        goto ERR;
-    }
-    buffer_head = buffer;
-
     // start analyse record string
     strsep(&buffer, delim);
     for (token = strsep(&buffer, delim); token != NULL; token = strsep(&buffer, delim)) {
@@ -509,7 +746,7 @@ static int IMDB_DataBaseMgrParseContent(IMDB_DataBaseMgr *mgr, IMDB_Table *table
         if (strcmp(token, "") == 0) {
             if (index == 0) {
                 ERROR("[IMDB] Key can't be null(%s).\n", buffer);
-                goto ERR;
+                return -1;
             } else {
                 token = INVALID_METRIC_VALUE;
             }
@@ -519,66 +756,140 @@ static int IMDB_DataBaseMgrParseContent(IMDB_DataBaseMgr *mgr, IMDB_Table *table
         if (index >= metricsCapacity) {
             if (strcmp(token, INVALID_METRIC_VALUE) != 0) {
                 ERROR("[IMDB] Raw ingress data exceeds metrics num of table(%s)\n", table->name);
-                goto ERR;
+                return -1;
             }
             break;
         }
 
-        value = strdup(token);
-        if (value == NULL) {
-            ERROR("[IMDB] Set metrics value failed.(%s, %s).\n", table->name, table->meta->metrics[index]->name);
-            goto ERR;
-        }
-
-        record->value[index] = value;
+        values[index] = token;
         index += 1;
     }
 
     if (index != metricsCapacity) {
         ERROR("[IMDB] Raw ingress data does not reach metrics num of table(%s), index = %lu, metricsCapacity = %lu.\n", table->name, index, metricsCapacity);
-        goto ERR;
+        return -1;
     }
 
-    if (buffer_head != NULL) {
-        free(buffer_head);
-    }
     return 0;
+}
 
-ERR:
-    if (buffer_head != NULL) {
-        free(buffer_head);
+IMDB_Record* IMDB_DataBaseMgrCreateRec(IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *content)
+{
+    const char *values[MAX_FIELDS_NUM];
+    IMDB_Record *record = NULL;
+    char *buffer;
+
+    if (table->meta->metricsCapacity > MAX_FIELDS_NUM) {
+        return NULL;
     }
-    return -1;
+
+    buffer = strdup(content);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    if (IMDB_DataBaseMgrParseContent(table, buffer, values) == 0) {
+        (void)pthread_mutex_lock(&table->lock);
+        record = IMDB_TableUpsertRecord(table, values);
+        (void)pthread_mutex_unlock(&table->lock);
+    }
+
+    free(buffer);
+    return record;
 }
 
-IMDB_Record* IMDB_DataBaseMgrCreateRec(IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *content)
+static char *IMDB_U64ToStr(uint64_t val, char *buf_end)
 {
-    pthread_rwlock_wrlock(&mgr->rwlock);
+    char *p = buf_end;
 
-    int ret = 0;
-    IMDB_Record *record;
+    *p = 0;
+    do {
+        *(--p) = (char)('0' + val % 10);
+        val /= 10;
+    } while (val != 0);
+    return p;
+}
 
-    record = IMDB_RecordCreateWithTable(table);
-    if (record == NULL) {
-        goto ERR;
+static const char *IMDB_FieldToStr(const struct nprobe_field_s *field, char *num, size_t size)
+{
+    const char *str;
+    uint64_t uval;
+    int ret;
+
+    switch (field->type) {
+        case NPROBE_FIELD_U64:
+            str = IMDB_U64ToStr(field->u64_val, num + size - 1);
+            break;
+        case NPROBE_FIELD_S64:
+            uval = (field->s64_val < 0) ? (0 - (uint64_t)field->s64_val) : (uint64_t)field->s64_val;
+            str = IMDB_U64ToStr(uval, num + size - 1);
+            if (field->s64_val < 0) {
+                *(char *)(--str) = '-';
+            }
+            break;
+        case NPROBE_FIELD_DOUBLE:
+            ret = snprintf(num, size, "%.*f", (int)field->precision, field->f64_val);
+            if (ret < 0) {
+                return NULL;
+            }
+            // Too many digits for the buffer, %.17g round-trips any double in at most 24 chars.
+            if (ret >= (int)size && snprintf(num, size, "%.17g", field->f64_val) >= (int)size) {
+                return NULL;
+            }
+            str = num;
+            break;
+        case NPROBE_FIELD_STR:
+            str = (field->len == 0) ? INVALID_METRIC_VALUE : field->str;
+            break;
+        default:
+            return NULL;
     }
 
-    ret = IMDB_DataBaseMgrParseContent(mgr, table, record, content);
-    if (ret != 0) {
-        goto ERR;
+    return str;
+}
+
+static int IMDB_DataBaseMgrLoadFields(IMDB_Table *table, const struct nprobe_field_s *fields, uint32_t field_num,
+                                      const char **values, char (*nums)[INT_LEN])
+{
+    uint32_t metricsCapacity = table->meta->metricsCapacity;
+
+    if (field_num != metricsCapacity || field_num > MAX_FIELDS_NUM) {
+        ERROR("[IMDB] Binary record does not match metrics num of table(%s), field_num = %u, metricsCapacity = %u.\n",
+              table->name, field_num, metricsCapacity);
+        return -1;
     }
-    ret = IMDB_TableAddRecord(table, record);
-    if (ret != 0) {
-        goto ERR;
+
+    if (fields[0].type == NPROBE_FIELD_STR && fields[0].len == 0) {
+        ERROR("[IMDB] Key can't be null(%s).\n", table->name);
+        return -1;
     }
 
-    pthread_rwlock_unlock(&mgr->rwlock);
-    return record;
+    for (uint32_t i = 0; i < field_num; i++) {
+        values[i] = IMDB_FieldToStr(&fields[i], nums[i], INT_LEN);
+        if (values[i] == NULL) {
+            ERROR("[IMDB] Set metrics value failed.(%s, %s).\n", table->name, table->meta->metrics[i]->name);
+            return -1;
+        }
+    }
 
-ERR:
-    pthread_rwlock_unlock(&mgr->rwlock);
-    IMDB_RecordDestroy(record);
-    return NULL;
+    return 0;
+}
+
+IMDB_Record* IMDB_DataBaseMgrCreateRecByFields(IMDB_DataBaseMgr *mgr, IMDB_Table *table,
+                                               const struct nprobe_field_s *fields, uint32_t field_num)
+{
+    const char *values[MAX_FIELDS_NUM];
+    char nums[MAX_FIELDS_NUM][INT_LEN];
+    IMDB_Record *record = NULL;
+
+    if (IMDB_DataBaseMgrLoadFields(table, fields, field_num, values, nums) != 0) {
+        return NULL;
+    }
+
+    (void)pthread_mutex_lock(&table->lock);
+    record = IMDB_TableUpsertRecord(table, values);
+    (void)pthread_mutex_unlock(&table->lock);
+    return record;
 }
 
 // return 0 if satisfy, return -1 if not
@@ -701,7 +1012,7 @@ static int append_pod_level_labels(struct container_cache *con_cache, char **buf
     }
     pod_cache = lkup_pod_cache(mgr->pod_caches, con_cache->pod_id);
     if (!pod_cache) {
-        pod_cache = create_pod_cache(&mgr->pod_caches, con_cache->pod_id, con_cache->container_id);
+        pod_cache = IMDB_CreatePodCache(mgr, con_cache->pod_id, con_cache->container_id);
         if (!pod_cache) {
             DEBUG("[IMDB] Failed to create pod cache(pod_id=%s)\n", con_cache->pod_id);
             return 0;
@@ -760,7 +1071,7 @@ static int append_container_level_labels(const char *container_id, char **buffer
     }
     con_cache = lkup_container_cache(mgr->container_caches, container_id);
     if (!con_cache) {
-        con_cache = create_container_cache(&mgr->container_caches, container_id);
+        con_cache = IMDB_CreateContainerCache(mgr, container_id);
         if (!con_cache) {
             DEBUG("[IMDB] Failed to create container cache(container_id=%s)\n", container_id);
             return 0;
@@ -881,6 +1192,124 @@ static int append_machine_id_label(IMDB_DataBaseMgr *mgr, char **buffer_ptr, int
     return 0;
 }
 
+#define IMDB_LABEL_LEVEL_PROC       'P'
+#define IMDB_LABEL_LEVEL_CONTAINER  'C'
+#define IMDB_LABEL_LEVEL_TAIL       'T'     // custom labels and machine id
+
+void IMDB_LabelCacheClear(IMDB_Table *table)
+{
+    IMDB_LabelCache *cache, *tmp;
+
+    H_ITER(table->labelCaches, cache, tmp) {
+        H_DEL(table->labelCaches, cache);
+        free(cache->labels);
+        free(cache);
+    }
+    table->labelCacheNum = 0;
+}
+
+/* Rendered labels depend on ext_label_conf of table, drop them all once it is updated. */
+static void IMDB_LabelCacheCheckConf(IMDB_Table *table)
+{
+    time_t last_update_time;
+
+    (void)pthread_rwlock_rdlock(&table->ext_label_conf.rwlock);
+    last_update_time = table->ext_label_conf.last_update_time;
+    (void)pthread_rwlock_unlock(&table->ext_label_conf.rwlock);
+
+    if (last_update_time != table->labelConfTs) {
+        IMDB_LabelCacheClear(table);
+        table->labelConfTs = last_update_time;
+    }
+}
+
+static const char *IMDB_LabelCacheLkup(const IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *key, time_t now)
+{
+    IMDB_LabelCache *cache = NULL;
+
+    H_FIND_S(table->labelCaches, key, cache);
+    if (cache == NULL || cache->gen != mgr->labelsGen || now >= cache->ts + IMDB_LABEL_CACHE_TMOUT) {
+        return NULL;
+    }
+    return cache->labels;
+}
+
+static void IMDB_LabelCacheAdd(const IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *key,
+                               const char *labels, time_t now)
+{
+    IMDB_LabelCache *cache = NULL;
+    char *str;
+
+    str = strdup(labels);
+    if (str == NULL) {
+        return;
+    }
+
+    H_FIND_S(table->labelCaches, key, cache);
+    if (cache == NULL) {
+        if (table->labelCacheNum >= IMDB_LABEL_CACHE_SIZE) {
+            IMDB_LabelCacheClear(table);
+        }
+        cache = (IMDB_LabelCache *)calloc(1, sizeof(IMDB_LabelCache));
+        if (cache == NULL) {
+            free(str);
+            return;
+        }
+        (void)snprintf(cache->key, sizeof(cache->key), "%s", key);
+        H_ADD_S(table->labelCaches, key, cache);
+        table->labelCacheNum++;
+    }
+
+    free(cache->labels);
+    cache->labels = str;
+    cache->gen = mgr->labelsGen;
+    cache->ts = now;
+}
+
+/* Append the labels of one level, rendered from tgid/container/pod caches at most once per entity. */
+static int append_cached_labels(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char level, const char *id,
+                                char **buffer_ptr, int *size_ptr, char type_json)
+{
+    char key[IMDB_LABEL_CACHE_KEY_LEN];
+    char labels[MAX_LABELS_BUFFER_SIZE];
+    const char *cached;
+    char *p = labels;
+    int size = sizeof(labels);
+    time_t now = time(NULL);
+    int ret;
+
+    (void)snprintf(key, sizeof(key), "%c%c%s", type_json ? 'j' : 'p', level, id);
+    cached = IMDB_LabelCacheLkup(mgr, table, key, now);
+    if (cached == NULL) {
+        labels[0] = 0;
+        switch (level) {
+            case IMDB_LABEL_LEVEL_PROC:
+                ret = append_proc_level_labels(id, &p, &size, mgr, table, type_json);
+                break;
+            case IMDB_LABEL_LEVEL_CONTAINER:
+                ret = append_container_level_labels(id, &p, &size, mgr, table, 1, type_json);
+                break;
+            default:
+                ret = append_custom_labels(table, &p, &size, type_json);
+                if (ret == 0) {
+                    ret = append_machine_id_label(mgr, &p, &size, type_json);
+                }
+                break;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        IMDB_LabelCacheAdd(mgr, table, key, labels, now);
+        cached = labels;
+    }
+
+    ret = __snprintf(buffer_ptr, *size_ptr, size_ptr, "%s", cached);
+    if (ret < 0) {
+        return IMDB_BUFFER_FULL;
+    }
+    return 0;
+}
+
 static int IMDB_BuildLabels(IMDB_DataBaseMgr *mgr,
                             IMDB_Record *record,
                             IMDB_Table *table,
@@ -938,7 +1367,7 @@ static int IMDB_BuildLabels(IMDB_DataBaseMgr *mgr,
     // Append 'COMM, Container and POD' label for ALL process-level metrics.
     if (tgid_idx >= 0) {
         tgid_str = (char *)(record->value[tgid_idx]);
-        ret = append_proc_level_labels(tgid_str, &p, &size, mgr, table, type_json);
+        ret = append_cached_labels(mgr, table, IMDB_LABEL_LEVEL_PROC, tgid_str, &p, &size, type_json);
         if (ret < 0) {
             DEBUG("[IMDB] Failed to append process-level labels(tgid=%s, ret=%d)\n", tgid_str, ret);
             return ret;
@@ -947,22 +1376,16 @@ static int IMDB_BuildLabels(IMDB_DataBaseMgr *mgr,
 
     if (con_id_idx >= 0) {
         con_id = (char *)(record->value[con_id_idx]);
-        ret = append_container_level_labels(con_id, &p, &size, mgr, table, 1, type_json);
+        ret = append_cached_labels(mgr, table, IMDB_LABEL_LEVEL_CONTAINER, con_id, &p, &size, type_json);
         if (ret < 0) {
             DEBUG("[IMDB] Failed to append container-level labels(container_id=%s, ret=%d)\n", con_id, ret);
             return ret;
         }
     }
 
-    ret = append_custom_labels(table, &p, &size, type_json);
-    if (ret < 0) {
-        ERROR("[IMDB] Failed to append custom labels(ret=%d)\n", ret);
-        return ret;
-    }
-
-    ret = append_machine_id_label(mgr, &p, &size, type_json);
+    ret = append_cached_labels(mgr, table, IMDB_LABEL_LEVEL_TAIL, "", &p, &size, type_json);
     if (ret < 0) {
-        ERROR("[IMDB] Failed to append machine_id label(ret=%d)\n", ret);
+        ERROR("[IMDB] Failed to append custom and machine_id labels(ret=%d)\n", ret);
         return ret;
     }
 
@@ -1463,6 +1886,46 @@ static int IMDB_Rec2Json(IMDB_DataBaseMgr *mgr, IMDB_Record *record, IMDB_Table
     return (int)(maxLen - curMaxLen);
 }
 
+/*
+ * Move all records of the active generation to the sealed one, ingress goes on with an
+ * empty active generation at once. Records left in the sealed generation by last round
+ * (buffer full) are older, so the table is only sealed again after they are drained.
+ */
+static void IMDB_TableSeal(IMDB_Table *table)
+{
+    IMDB_Arena arena;
+
+    if (table->sealed.records != NULL) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&table->lock);
+    table->kept = 0;
+    if (table->recordNum == 0) {
+        (void)pthread_mutex_unlock(&table->lock);
+        return;
+    }
+
+    table->sealed.records = table->records;
+    table->sealed.recordNum = table->recordNum;
+    table->records = NULL;
+    table->recordNum = 0;
+    H_CLEAR(table->recordsHash);
+
+    // Drained arena of sealed generation only holds spare chunks, reused by ingress.
+    arena = table->sealed.arena;
+    table->sealed.arena = table->arena;
+    table->arena = arena;
+    (void)pthread_mutex_unlock(&table->lock);
+}
+
+static void IMDB_SealedDelRecord(IMDB_Table *table, IMDB_Record *record)
+{
+    DL_DELETE(table->sealed.records, record);
+    table->sealed.recordNum--;
+    IMDB_RecordDestroy(record);
+}
+
 static int IMDB_Tbl2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buffer, uint32_t maxLen)
 {
     int ret = 0;
@@ -1478,15 +1941,15 @@ static int IMDB_Tbl2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buff
     }
     curMaxLen -= __RESERVED_BUF_SIZE;
 
-    if (table->recordNum == 0) {
+    if (table->sealed.recordNum == 0) {
         return 0;
     }
-    DL_FOREACH_SAFE(table->records, record, tmp) {
+    IMDB_LabelCacheCheckConf(table);
+    DL_FOREACH_SAFE(table->sealed.records, record, tmp) {
         // check timeout
         if (record->updateTime + g_recordTimeout < time(NULL)) {
             // remove invalid record
-            DeleteRecord(table, record);
-            IMDB_RecordDestroy(record);
+            IMDB_SealedDelRecord(table, record);
             continue;
         }
 
@@ -1498,8 +1961,7 @@ static int IMDB_Tbl2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buff
 
         if (ret < 0) {
             // if build label fail, we just delete record
-            DeleteRecord(table, record);
-            IMDB_RecordDestroy(record);
+            IMDB_SealedDelRecord(table, record);
             continue;
         }
         if (ret == 0) {
@@ -1512,8 +1974,7 @@ static int IMDB_Tbl2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buff
         total += ret;
 
         // delete record after to string
-        DeleteRecord(table, record);
-        IMDB_RecordDestroy(record);
+        IMDB_SealedDelRecord(table, record);
 
         index++;
     }
@@ -1539,35 +2000,324 @@ static int IMDB_Tbl2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buff
     return total;
 }
 
-int IMDB_DataBase2Metrics(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen, uint32_t *buf_len)
+/*
+ * Serialize snapshots of records from *pos on, *pos is set to the first one left when buffer
+ * is full. Snapshots failing to build are moved to dropped, their records are deleted later.
+ */
+static int IMDB_TblKeep2Metrics(IMDB_DataBaseMgr *mgr, IMDB_Table *table, IMDB_Record **snapshots,
+                                IMDB_Record **dropped, IMDB_Record **pos, char *buffer, uint32_t maxLen)
 {
-    pthread_rwlock_wrlock(&mgr->rwlock);
+    int ret = 0;
+    int total = 0;
+    IMDB_Record *record, *next;
+    char *curBuffer = buffer;
+    uint32_t curMaxLen = maxLen;
+
+    if (curMaxLen < __RESERVED_BUF_SIZE) {
+        return 0;
+    }
+    curMaxLen -= __RESERVED_BUF_SIZE;
+
+    for (record = *pos; record != NULL; record = next) {
+        next = record->next;
+        if (mgr->writeLogsType == METRIC_LOG_JSON) {
+            ret = IMDB_Rec2Json(mgr, record, table, curBuffer, curMaxLen);
+        } else {
+            ret = IMDB_Rec2Prometheus(mgr, record, table, curBuffer, curMaxLen);
+        }
+
+        if (ret < 0) {
+            DL_DELETE(*snapshots, record);
+            DL_APPEND(*dropped, record);
+            continue;
+        }
+        if (ret == 0) {
+            curBuffer[0] = 0;
+            break;  /* buffer is full, break loop */
+        }
+
+        curBuffer += ret;
+        curMaxLen -= ret;
+        total += ret;
+    }
+    *pos = record;
+
+    if (total == 0 || mgr->writeLogsType == METRIC_LOG_JSON) {
+        return total;
+    }
+
+    curMaxLen += __RESERVED_BUF_SIZE;
+    ret = snprintf(curBuffer, curMaxLen, "\n");
+    if (ret < 0 || ret >= curMaxLen) {
+        ERROR("[IMDB] table(%s) add endsym fail, ret=%d.\n", table->name, ret);
+        return -1;
+    }
+    return total + 1;
+}
+
+/* Copy of a record for serializing out of table lock, record, value array, values and key in one block. */
+static IMDB_Record *IMDB_RecordSnapshot(const IMDB_Table *table, const IMDB_Record *record)
+{
+    uint32_t i, capacity = table->meta->metricsCapacity;
+    size_t size = sizeof(IMDB_Record) + sizeof(char *) * capacity + strlen(record->key) + 1;
+    size_t len;
+    IMDB_Record *snapshot;
+    char *str;
+
+    for (i = 0; i < capacity; i++) {
+        size += strlen(record->value[i]) + 1;
+    }
+
+    snapshot = (IMDB_Record *)malloc(size);
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    (void)memset(snapshot, 0, sizeof(IMDB_Record));
+    snapshot->updateTime = record->updateTime;
+    snapshot->table = table;
+    snapshot->value = (char **)(snapshot + 1);
+
+    str = (char *)(snapshot->value + capacity);
+    for (i = 0; i < capacity; i++) {
+        len = strlen(record->value[i]) + 1;
+        (void)memcpy(str, record->value[i], len);
+        snapshot->value[i] = str;
+        str += len;
+    }
+    (void)memcpy(str, record->key, strlen(record->key) + 1);
+    snapshot->key = str;
+    return snapshot;
+}
+
+static void IMDB_SnapshotsFree(IMDB_Record *snapshots)
+{
+    IMDB_Record *snapshot, *tmp;
 
+    DL_FOREACH_SAFE(snapshots, snapshot, tmp) {
+        free(snapshot);
+    }
+}
+
+/* Take snapshots of live records of an indexed table, timed out records are deleted meanwhile. */
+static int IMDB_TblSnapshot(IMDB_Table *table, IMDB_Record **snapshots)
+{
+    IMDB_Record *record, *next, *snapshot;
+    time_t now = time(NULL);
+
+    (void)pthread_mutex_lock(&table->lock);
+    table->kept = 1;
+    for (record = table->records; record != NULL; record = next) {
+        next = record->next;
+        if (record->updateTime + g_recordTimeout < now) {
+            DeleteRecord(table, record);
+            IMDB_RecordDestroy(record);
+            continue;
+        }
+
+        snapshot = IMDB_RecordSnapshot(table, record);
+        if (snapshot == NULL) {
+            (void)pthread_mutex_unlock(&table->lock);
+            IMDB_SnapshotsFree(*snapshots);
+            *snapshots = NULL;
+            return -1;
+        }
+        DL_APPEND(*snapshots, snapshot);
+    }
+    (void)pthread_mutex_unlock(&table->lock);
+    return 0;
+}
+
+/* Records whose snapshots failed to build are deleted, unless they are updated meanwhile. */
+static void IMDB_TblDelDropped(IMDB_Table *table, IMDB_Record *dropped)
+{
+    IMDB_Record *snapshot, *record;
+
+    if (dropped == NULL) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&table->lock);
+    DL_FOREACH(dropped, snapshot) {
+        record = NULL;
+        H_FIND(table->recordsHash, snapshot->key, strlen(snapshot->key), record);
+        if (record != NULL && record->updateTime == snapshot->updateTime) {
+            DeleteRecord(table, record);
+            IMDB_RecordDestroy(record);
+        }
+    }
+    (void)pthread_mutex_unlock(&table->lock);
+    IMDB_SnapshotsFree(dropped);
+}
+
+/*
+ * Serialize the records of an indexed table without consuming them, so every scraper gets all
+ * live records. Records are updated in place by ingress, so they are copied under table lock and
+ * serialized afterwards, ingress only waits for the copy, not for the scraper or log writer.
+ */
+static int IMDB_TblKeep2Chunks(IMDB_DataBaseMgr *mgr, IMDB_Table *table, char *buffer, uint32_t maxLen,
+                               char **cursor, uint32_t *curMaxLen, IMDB_MetricsSink sink, void *ctx)
+{
+    IMDB_Record *snapshots = NULL, *dropped = NULL, *pos, *next;
+    int ret = 0;
+
+    if (IMDB_TblSnapshot(table, &snapshots) != 0) {
+        ERROR("[IMDB] Failed to take snapshot of table %s.\n", table->name);
+        return -1;
+    }
+
+    IMDB_LabelCacheCheckConf(table);
+    pos = snapshots;
+    while (pos != NULL) {
+        ret = IMDB_TblKeep2Metrics(mgr, table, &snapshots, &dropped, &pos, *cursor, *curMaxLen);
+        if (ret < 0 || ret >= *curMaxLen) {
+            ERROR("[IMDB] Failed to transfer tables to prometheus, ret=%d.\n", ret);
+            ret = -1;
+            break;
+        }
+
+        if (ret > 0) {
+            table->weighting++;
+        }
+        *cursor += ret;
+        *curMaxLen -= ret;
+        ret = 0;
+        if (pos == NULL) {
+            break;
+        }
+
+        // buffer is full
+        if (*cursor == buffer) {
+            ERROR("[IMDB] Record of table %s exceeds %u bytes, dropped.\n", table->name, maxLen);
+            next = pos->next;
+            DL_DELETE(snapshots, pos);
+            DL_APPEND(dropped, pos);
+            pos = next;
+            continue;
+        }
+
+        if (sink(ctx, buffer, (uint32_t)(*cursor - buffer)) != 0) {
+            ret = -1;
+            break;
+        }
+        *cursor = buffer;
+        *curMaxLen = maxLen;
+        buffer[0] = 0;
+    }
+
+    IMDB_SnapshotsFree(snapshots);
+    IMDB_TblDelDropped(table, dropped);
+    return ret;
+}
+
+/*
+ * Serialize the sealed records of all tables into buffer. Once buffer is full, it is handed
+ * over to sink and reused, so all records go out in one round whatever their total size is.
+ * Without sink, serializing stops at buffer full and the records left are deferred.
+ */
+static int IMDB_DataBase2Chunks(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                                IMDB_MetricsSink sink, void *ctx, char keep, uint32_t *buf_len)
+{
     int ret = 0;
     char *cursor = buffer;
     uint32_t curMaxLen = maxLen;
+    IMDB_Table *table;
 
     for (int i = 0; i < mgr->tablesNum; i++) {
-        ret = IMDB_Tbl2Metrics(mgr, mgr->tables[i], cursor, curMaxLen);
-        if (ret < 0 || ret >= curMaxLen) {
-            ERROR("[IMDB] Failed to transfer tables to prometheus, ret=%d.\n", ret);
-            goto ERR;
+        table = mgr->tables[i];
+        // Records of a table without key can not be told apart, they are consumed anyway.
+        if (keep && sink != NULL && table->keyNum > 0 && table->sealed.records == NULL) {
+            if (IMDB_TblKeep2Chunks(mgr, table, buffer, maxLen, &cursor, &curMaxLen, sink, ctx) != 0) {
+                return -1;
+            }
+            continue;
         }
 
-        if (ret > 0) {
-            mgr->tables[i]->weighting++;
+        IMDB_TableSeal(table);
+        for (;;) {
+            ret = IMDB_Tbl2Metrics(mgr, table, cursor, curMaxLen);
+            if (ret < 0 || ret >= curMaxLen) {
+                ERROR("[IMDB] Failed to transfer tables to prometheus, ret=%d.\n", ret);
+                return -1;
+            }
+
+            if (ret > 0) {
+                table->weighting++;
+            }
+            cursor += ret;
+            curMaxLen -= ret;
+
+            if (table->sealed.records == NULL) {
+                IMDB_ArenaReset(&table->sealed.arena);
+                break;
+            }
+
+            // buffer is full
+            if (cursor == buffer) {
+                ERROR("[IMDB] Record of table %s exceeds %u bytes, dropped.\n", table->name, maxLen);
+                IMDB_SealedDelRecord(table, table->sealed.records);
+                continue;
+            }
+
+            if (sink == NULL) {
+                mgr->deferredRecords += table->sealed.recordNum;
+                break;
+            }
+
+            if (sink(ctx, buffer, (uint32_t)(cursor - buffer)) != 0) {
+                mgr->deferredRecords += table->sealed.recordNum;
+                return -1;
+            }
+            cursor = buffer;
+            curMaxLen = maxLen;
+            buffer[0] = 0;
         }
-        cursor += ret;
-        curMaxLen -= ret;
     }
-    IMDB_AdjustTblPrio(mgr);
+
     *buf_len = maxLen - curMaxLen;
-    pthread_rwlock_unlock(&mgr->rwlock);
     return 0;
-ERR:
+}
+
+int IMDB_DataBase2Metrics(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen, uint32_t *buf_len)
+{
+    int ret;
 
+    pthread_rwlock_wrlock(&mgr->rwlock);
+    ret = IMDB_DataBase2Chunks(mgr, buffer, maxLen, NULL, NULL, 0, buf_len);
+    if (ret == 0) {
+        IMDB_AdjustTblPrio(mgr);
+    }
     pthread_rwlock_unlock(&mgr->rwlock);
-    return -1;
+    return ret;
+}
+
+static int IMDB_DataBase2Sink(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                              IMDB_MetricsSink sink, void *ctx, char keep)
+{
+    uint32_t buf_len = 0;
+    int ret;
+
+    pthread_rwlock_wrlock(&mgr->rwlock);
+    ret = IMDB_DataBase2Chunks(mgr, buffer, maxLen, sink, ctx, keep, &buf_len);
+    if (ret == 0 && buf_len > 0) {
+        ret = sink(ctx, buffer, buf_len);
+    }
+    if (ret == 0) {
+        IMDB_AdjustTblPrio(mgr);
+    }
+    pthread_rwlock_unlock(&mgr->rwlock);
+    return ret;
+}
+
+int IMDB_DataBase2MetricsStream(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                                IMDB_MetricsSink sink, void *ctx)
+{
+    return IMDB_DataBase2Sink(mgr, buffer, maxLen, sink, ctx, 0);
+}
+
+int IMDB_DataBase2MetricsSnapshot(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                                  IMDB_MetricsSink sink, void *ctx)
+{
+    return IMDB_DataBase2Sink(mgr, buffer, maxLen, sink, ctx, 1);
 }
 
 #endif
@@ -1637,6 +2387,9 @@ int IMDB_Record2Json(const IMDB_DataBaseMgr *mgr, const IMDB_Table *table, const
 void AddRecord(IMDB_Table *table, IMDB_Record *record)
 {
     DL_APPEND(table->records, record);
+    if (record->key != NULL) {
+        H_ADD_KEYPTR(table->recordsHash, record->key, strlen(record->key), record);
+    }
     table->recordNum++;
 }
 
@@ -1647,6 +2400,9 @@ void DeleteRecord(IMDB_Table *table, IMDB_Record *record)
     }
 
     DL_DELETE(table->records, record);
+    if (record->key != NULL) {
+        H_DEL(table->recordsHash, record);
+    }
     table->recordNum--;
 }
 
@@ -1654,13 +2410,22 @@ void DeleteAndFreeRecords(IMDB_Table *table)
 {
     IMDB_Record *r, *tmp;
 
+    DL_FOREACH_SAFE(table->sealed.records, r, tmp) {
+        IMDB_SealedDelRecord(table, r);
+    }
+    IMDB_ArenaReset(&table->sealed.arena);
+
     if (table->records == NULL) {
         return;
     }
 
     DL_FOREACH_SAFE(table->records, r, tmp) {
         DL_DELETE(table->records, r);
+        if (r->key != NULL) {
+            H_DEL(table->recordsHash, r);
+        }
         IMDB_RecordDestroy(r);
     }
     table->recordNum = 0;
+    IMDB_ArenaReset(&table->arena);
 }
\ No newline at end of file
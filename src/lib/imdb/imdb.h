@@ -24,6 +24,7 @@
 #include "hash.h"
 #include "ext_label.h"
 #include "container_cache.h"
+#include "imdb_arena.h"
 
 #define MAX_IMDB_DATABASEMGR_CAPACITY   256
 // metric specification
@@ -34,6 +35,8 @@
 
 // table specification
 #define MAX_IMDB_TABLE_NAME_LEN         32
+#define MAX_IMDB_TABLE_KEY_NUM          32      // Max key and label columns used to index records
+#define MAX_IMDB_RECORD_KEY_LEN         1024
 
 // database specification
 #define MAX_IMDB_DATABASE_NAME_LEN      32
@@ -41,6 +44,10 @@
 // MAX LENGTH FOR PROMETHEUS LABELS
 #define MAX_LABELS_BUFFER_SIZE          1024
 
+#define IMDB_LABEL_CACHE_SIZE           4096    // Max rendered label fragments per table
+#define IMDB_LABEL_CACHE_TMOUT          30      // unit: second
+#define IMDB_LABEL_CACHE_KEY_LEN        (INT_LEN + CONTAINER_ABBR_ID_LEN + 4)
+
 #define MAX_IMDB_SYSTEM_UUID_LEN        40
 #define MAX_IMDB_HOSTNAME_LEN           64
 #define MAX_IMDB_HOSTIP_LEN             64
@@ -75,12 +82,17 @@ typedef struct {
 
 struct IMDB_Table_s;
 typedef struct IMDB_Table_s IMDB_Table;
+struct nprobe_field_s;
 typedef struct IMDB_Record_s {
     time_t updateTime;     // Unit: second
     char **value;
+    uint32_t *valueSize;   // Allocated bytes of each value, reused while the new value fits
     const IMDB_Table *table;     // table that this record belongs to
     struct IMDB_Record_s *next;
     struct IMDB_Record_s *prev;
+    char *key;             // Values of key and label columns joined by '|', NULL if record is not indexed
+    char inArena;          // Record, values and key are allocated from arena of table
+    H_HANDLE;              // Indexed by key in table
 } IMDB_Record;
 
 typedef struct {
@@ -88,6 +100,29 @@ typedef struct {
     IMDB_Metric **metrics;
 } IMDB_Meta;
 
+/*
+ * Label text appended to records for one entity(process or container) is the same for
+ * all records of a table, it is rendered once and reused until the caches it comes from
+ * change(labelsGen of IMDB_DataBaseMgr) or it times out(pid may be reused).
+ */
+typedef struct {
+    char key[IMDB_LABEL_CACHE_KEY_LEN];     // Output format, label level and tgid or container id
+    uint32_t gen;
+    time_t ts;
+    char *labels;
+    H_HANDLE;
+} IMDB_LabelCache;
+
+/*
+ * Records moved out of the active generation of a table at once, so the serializer
+ * formats them without blocking ingress. Records in it are not indexed any more.
+ */
+typedef struct {
+    uint32_t recordNum;
+    IMDB_Record *records;
+    IMDB_Arena arena;               // Arena of the records, swapped with the one of active generation
+} IMDB_Generation;
+
 typedef struct IMDB_Table_s {
     char name[MAX_IMDB_TABLE_NAME_LEN];
     char entity_name[MAX_IMDB_TABLE_NAME_LEN];
@@ -95,9 +130,25 @@ typedef struct IMDB_Table_s {
     char weighting;                 // 0: Highest Level(Entitlement to priority); >0: Low priority
     char pad[3];                    // rsvd
     uint32_t recordsCapability;     // Capability for records count in one table
+    uint32_t keyNum;                // Number of key and label columns, 0: table is not indexed, records are always appended
+    uint16_t keyIdx[MAX_IMDB_TABLE_KEY_NUM];
+
+    /* Active generation, written by ingress under lock */
+    pthread_mutex_t lock;
     uint32_t recordNum;
     IMDB_Record *records;
+    IMDB_Record *recordsHash;       // Records indexed by key and label columns, used to upsert
+    IMDB_Arena arena;               // Released at once when the table has no record
+    char kept;                      // Records are kept across scrapes, new ones are malloced not to pin arena
+
+    IMDB_Generation sealed;         // Sealed generation, drained by serializer without lock
+
+    /* Only accessed by serializer */
+    IMDB_LabelCache *labelCaches;
+    uint32_t labelCacheNum;
+    time_t labelConfTs;             // last_update_time of ext_label_conf when caches are rendered
     struct ext_label_conf ext_label_conf;
+    H_HANDLE;                       // Indexed by name in IMDB_DataBaseMgr
 } IMDB_Table;
 
 typedef struct {
@@ -117,9 +168,10 @@ typedef struct {
     uint32_t tblsCapability;        // Capability for tables count in one database
     uint32_t tablesNum;
 
-    IMDB_Table **tables;
+    IMDB_Table **tables;            // Ordered by output priority, refer to RequeueTable()
+    IMDB_Table *tblsHash;           // Hash of tables indexed by name, order independent
     IMDB_NodeInfo nodeInfo;
-    pthread_rwlock_t rwlock;
+    pthread_rwlock_t rwlock;        // Held by serializer, ingress only takes the lock of table
     MetricLogType writeLogsType;
 
     TGID_Record **tgids;
@@ -127,8 +179,14 @@ typedef struct {
     struct pod_cache *pod_caches;
 
     pthread_t metrics_tid;
+    char renderOnScrape;            // Metrics are rendered by web_server on scrape, not written to files
+    uint32_t labelsGen;             // Bumped when tgid, container or pod caches change
+    uint64_t deferredRecords;       // Records left to next round because serializing buffer is full
 } IMDB_DataBaseMgr;
 
+/* Consumes one chunk of serialized metrics, returns 0 on success. */
+typedef int (*IMDB_MetricsSink)(void *ctx, const char *buf, uint32_t len);
+
 IMDB_Metric *IMDB_MetricCreate(char *name, char *description, char *type);
 void IMDB_MetricDestroy(IMDB_Metric *metric);
 
@@ -150,6 +208,7 @@ void IMDB_TableSetMeta(IMDB_Table *table, IMDB_Meta *meta);
 int IMDB_TableAddRecord(IMDB_Table *table, IMDB_Record *record);
 void IMDB_TableUpdateExtLabelConf(IMDB_Table *table, struct ext_label_conf *conf);
 void IMDB_TableDestroy(IMDB_Table *table);
+void IMDB_LabelCacheClear(IMDB_Table *table);
 
 IMDB_DataBaseMgr *IMDB_DataBaseMgrCreate(uint32_t capacity);
 void IMDB_DataBaseMgrSetRecordTimeout(uint32_t timeout);
@@ -159,7 +218,14 @@ int IMDB_DataBaseMgrAddTable(IMDB_DataBaseMgr *mgr, IMDB_Table* table);
 IMDB_Table *IMDB_DataBaseMgrFindTable(IMDB_DataBaseMgr *mgr, const char *tableName);
 
 IMDB_Record* IMDB_DataBaseMgrCreateRec(IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *content);
+IMDB_Record* IMDB_DataBaseMgrCreateRecByFields(IMDB_DataBaseMgr *mgr, IMDB_Table *table,
+                                               const struct nprobe_field_s *fields, uint32_t field_num);
 int IMDB_DataBase2Metrics(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen, uint32_t *buf_len);
+int IMDB_DataBase2MetricsStream(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                                IMDB_MetricsSink sink, void *ctx);
+/* Same as IMDB_DataBase2MetricsStream(), but records of indexed tables are kept until they time out. */
+int IMDB_DataBase2MetricsSnapshot(IMDB_DataBaseMgr *mgr, char *buffer, uint32_t maxLen,
+                                  IMDB_MetricsSink sink, void *ctx);
 int IMDB_DataStr2Json(IMDB_DataBaseMgr *mgr, const char *recordStr, char *jsonStr, uint32_t jsonStrLen);
 int IMDB_Record2Json(const IMDB_DataBaseMgr *mgr, const IMDB_Table *table, const IMDB_Record *record,
                      char *jsonStr, uint32_t jsonStrLen);
@@ -0,0 +1,147 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-11
+ * Description: bump allocator for IMDB records
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "imdb_arena.h"
+
+struct IMDB_ArenaChunk_s {
+    struct IMDB_ArenaChunk_s *next;
+    size_t size;
+    size_t used;
+    char data[] __attribute__((aligned(IMDB_ARENA_ALIGN)));
+};
+
+#define IMDB_ARENA_ROUNDUP(size)    (((size) + IMDB_ARENA_ALIGN - 1) & ~((size_t)IMDB_ARENA_ALIGN - 1))
+
+void IMDB_ArenaInit(IMDB_Arena *arena, size_t limit)
+{
+    (void)memset(arena, 0, sizeof(IMDB_Arena));
+    arena->limit = limit;
+}
+
+static struct IMDB_ArenaChunk_s *IMDB_ArenaNewChunk(IMDB_Arena *arena, size_t size)
+{
+    struct IMDB_ArenaChunk_s *chunk;
+
+    if (size < IMDB_ARENA_CHUNK_SIZE) {
+        size = IMDB_ARENA_CHUNK_SIZE;
+    }
+    // Tables which never drain do not reset the arena, so it must not grow without bound.
+    if (arena->limit == 0 || arena->total + size > arena->limit) {
+        return NULL;
+    }
+
+    if (size == IMDB_ARENA_CHUNK_SIZE && arena->spares != NULL) {
+        chunk = arena->spares;
+        arena->spares = chunk->next;
+        chunk->used = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->total += chunk->size;
+        return chunk;
+    }
+
+    chunk = (struct IMDB_ArenaChunk_s *)malloc(sizeof(struct IMDB_ArenaChunk_s) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->total += size;
+    arena->chunkAllocs++;
+    return chunk;
+}
+
+void *IMDB_ArenaAlloc(IMDB_Arena *arena, size_t size)
+{
+    struct IMDB_ArenaChunk_s *chunk = arena->chunks;
+    void *p;
+
+    size = IMDB_ARENA_ROUNDUP(size);
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        chunk = IMDB_ArenaNewChunk(arena, size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+    }
+
+    p = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->allocs++;
+    return p;
+}
+
+char *IMDB_ArenaStrdup(IMDB_Arena *arena, const char *str)
+{
+    size_t len = strlen(str);
+    char *p = (char *)IMDB_ArenaAlloc(arena, len + 1);
+
+    if (p != NULL) {
+        (void)memcpy(p, str, len + 1);
+    }
+    return p;
+}
+
+int IMDB_ArenaFull(const IMDB_Arena *arena)
+{
+    return (arena->limit == 0 || arena->total >= arena->limit) ? 1 : 0;
+}
+
+/* Keep some chunks for the next round, so a steady workload does not malloc at all. */
+void IMDB_ArenaReset(IMDB_Arena *arena)
+{
+    struct IMDB_ArenaChunk_s *chunk, *next;
+    size_t kept = 0;
+
+    for (chunk = arena->spares; chunk != NULL; chunk = chunk->next) {
+        kept += chunk->size;
+    }
+
+    for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        if (chunk->size == IMDB_ARENA_CHUNK_SIZE && kept < IMDB_ARENA_KEEP_SIZE) {
+            chunk->next = arena->spares;
+            arena->spares = chunk;
+            kept += chunk->size;
+            continue;
+        }
+        free(chunk);
+    }
+
+    arena->chunks = NULL;
+    arena->total = 0;
+}
+
+static void IMDB_ArenaFreeChunks(struct IMDB_ArenaChunk_s *chunks)
+{
+    struct IMDB_ArenaChunk_s *chunk, *next;
+
+    for (chunk = chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+}
+
+void IMDB_ArenaDestroy(IMDB_Arena *arena)
+{
+    IMDB_ArenaFreeChunks(arena->chunks);
+    IMDB_ArenaFreeChunks(arena->spares);
+    arena->chunks = NULL;
+    arena->spares = NULL;
+    arena->total = 0;
+}
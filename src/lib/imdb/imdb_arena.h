@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-11
+ * Description: bump allocator for IMDB records
+ ******************************************************************************/
+#ifndef __IMDB_ARENA_H__
+#define __IMDB_ARENA_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IMDB_ARENA_CHUNK_SIZE   (32 * 1024)
+#define IMDB_ARENA_MAX_SIZE     (16 * 1024 * 1024)  // Default limit of memory in arena per table
+#define IMDB_ARENA_KEEP_SIZE    (1024 * 1024)       // Chunks kept by reset for reuse
+#define IMDB_ARENA_ALIGN        8
+
+struct IMDB_ArenaChunk_s;
+
+/*
+ * Memory is bump-allocated from chunks and never freed one by one, all of it is
+ * released at once by IMDB_ArenaReset() when no allocation is referenced any more.
+ */
+typedef struct {
+    struct IMDB_ArenaChunk_s *chunks;   // Chunk in use is the first one
+    struct IMDB_ArenaChunk_s *spares;   // Empty chunks kept by reset
+    size_t total;                       // Bytes of chunks in use
+    size_t limit;                       // No chunk is added beyond it, callers fall back to malloc, 0: disabled
+    uint64_t chunkAllocs;               // Number of chunks malloced
+    uint64_t allocs;                    // Number of allocations served
+} IMDB_Arena;
+
+void IMDB_ArenaInit(IMDB_Arena *arena, size_t limit);
+void *IMDB_ArenaAlloc(IMDB_Arena *arena, size_t size);
+char *IMDB_ArenaStrdup(IMDB_Arena *arena, const char *str);
+int IMDB_ArenaFull(const IMDB_Arena *arena);
+void IMDB_ArenaReset(IMDB_Arena *arena);
+void IMDB_ArenaDestroy(IMDB_Arena *arena);
+
+#endif
@@ -34,30 +34,35 @@ void RemoveMetricsLogs(char logs_file_name[])
     rm_log_file(logs_file_name);
 }
 
-static int WriteMetricsLogs(IMDB_DataBaseMgr *imdbMgr)
+static int WriteMetricsChunk(void *ctx, const char *buf, uint32_t len)
 {
-    int ret;
-    int buffer_len = 0;
-    g_buffer[0] = 0;
-
-    ret = IMDB_DataBase2Metrics(imdbMgr, g_buffer, LEN_1M, &buffer_len);
-    if (ret < 0) {
-        ERROR("[METRICLOG] IMDB database to prometheus fail, ret: %d\n", ret);
+    if (wr_metrics_logs(buf, len) < 0) {
+        ERROR("[METRICLOG] write metrics logs fail.\n");
         return -1;
     }
+    return 0;
+}
 
-    if (buffer_len == 0) {
-        // return when no data in tables
-        return 0;
-    }
+/*
+ * Metrics are serialized in chunks of g_buffer and each chunk is written as soon as it
+ * is full, so all records in IMDB are written every round however many they are.
+ */
+static int WriteMetricsLogs(IMDB_DataBaseMgr *imdbMgr)
+{
+    static uint64_t deferredRecords = 0;
+    int ret;
+
+    g_buffer[0] = 0;
+    ret = IMDB_DataBase2MetricsStream(imdbMgr, g_buffer, LEN_1M, WriteMetricsChunk, NULL);
 
-    if (g_buffer[buffer_len] != 0) {
-        ERROR("[METRICLOG] g_buffer[buffer_len] is not 0.\n");
+    if (imdbMgr->deferredRecords != deferredRecords) {
+        WARN("[METRICLOG] %llu records deferred to next round so far.\n",
+             (unsigned long long)imdbMgr->deferredRecords);
+        deferredRecords = imdbMgr->deferredRecords;
     }
 
-    ret = wr_metrics_logs(g_buffer, buffer_len);
     if (ret < 0) {
-        ERROR("[METRICLOG] write metrics logs fail.\n");
+        ERROR("[METRICLOG] IMDB database to prometheus fail, ret: %d\n", ret);
         return -1;
     }
 
@@ -74,6 +79,11 @@ void WriteMetricsLogsMain(IMDB_DataBaseMgr *mgr)
         return;
     }
 
+    if (mgr->renderOnScrape) {
+        INFO("[METRICLOG] metrics are rendered by web_server on scrape, skip writing metrics logs.\n");
+        return;
+    }
+
     for (;;) {
         sleep(METRIC_LOG_WRITE_INTERVAL);
         ret = WriteMetricsLogs(mgr);
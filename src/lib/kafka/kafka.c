@@ -16,13 +16,21 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <arpa/inet.h>
 #include "kafka.h"
 
 #ifdef KAFKA_CHANNEL
 static void dr_msg_cb(rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque)
 {
+    KafkaMgr *mgr = (KafkaMgr *)opaque;
+
     if (rkmessage->err) {
         ERROR("Message delivery failed: %s\n", rd_kafka_err2str(rkmessage->err));
+        if (mgr != NULL) {
+            (void)__atomic_add_fetch(&mgr->stats.failed, 1, __ATOMIC_RELAXED);
+        }
+    } else if (mgr != NULL) {
+        (void)__atomic_add_fetch(&mgr->stats.delivered, 1, __ATOMIC_RELAXED);
     }/* rkmessage被librdkafka自动销毁 */
 }
 
@@ -64,6 +72,17 @@ KafkaMgr *KafkaMgrCreate(const ConfigMgr *configMgr, const char *topic_type)
     mgr->queueBufferingMaxKbytes = configMgr->kafkaConfig->queueBufferingMaxKbytes;
     mgr->queueBufferingMaxMessages = configMgr->kafkaConfig->queueBufferingMaxMessages;
     mgr->queueBufferingMaxMs = configMgr->kafkaConfig->queueBufferingMaxMs;
+    mgr->msgPack = configMgr->kafkaConfig->msgPack;
+    mgr->msgPackMaxBytes = configMgr->kafkaConfig->msgPackMaxKbytes * 1024;
+    if (mgr->msgPackMaxBytes == 0) {
+        mgr->msgPackMaxBytes = KAFKA_MSG_PACK_MAX_KBYTES * 1024;
+    }
+
+    mgr->pending = (rd_kafka_message_t *)calloc(KAFKA_PENDING_MAX, sizeof(rd_kafka_message_t));
+    if (mgr->pending == NULL) {
+        ERROR("malloc memory for kafka pending messages failed.\n");
+        goto err;
+    }
 
     mgr->conf = rd_kafka_conf_new();
     ret = rd_kafka_conf_set(mgr->conf, "bootstrap.servers", mgr->kafkaBroker, errstr, sizeof(errstr));
@@ -115,6 +134,7 @@ KafkaMgr *KafkaMgrCreate(const ConfigMgr *configMgr, const char *topic_type)
         goto err;
     }
     rd_kafka_conf_set_dr_msg_cb(mgr->conf, dr_msg_cb);
+    rd_kafka_conf_set_opaque(mgr->conf, mgr);
 
     mgr->rk = rd_kafka_new(RD_KAFKA_PRODUCER, mgr->conf, errstr, sizeof(errstr));
     if (mgr->rk == NULL) {
@@ -132,6 +152,7 @@ KafkaMgr *KafkaMgrCreate(const ConfigMgr *configMgr, const char *topic_type)
     return mgr;
 
 err:
+    free(mgr->pending);
     free(mgr);
     return NULL;
 }
@@ -147,12 +168,16 @@ void KafkaMgrDestroy(KafkaMgr *mgr)
     if (mgr->rk != NULL)
         rd_kafka_destroy(mgr->rk);
 
+    for (uint32_t i = 0; i < mgr->pendingNum; i++) {
+        free(mgr->pending[i].payload);
+    }
+    free(mgr->pending);
     free(mgr);
     return;
 }
 
 #define __RETRY_MAX 3
-int KafkaMsgProduce(const KafkaMgr *mgr, char *msg, const uint32_t msgLen)
+int KafkaMsgProduce(KafkaMgr *mgr, char *msg, const uint32_t msgLen)
 {
     int ret = 0;
     int retry_index = 0, retry_max = __RETRY_MAX;
@@ -167,15 +192,229 @@ retry:
         retry_index++;
         if ((retry_index < retry_max) && (rd_kafka_last_error() == RD_KAFKA_RESP_ERR__QUEUE_FULL)) {
             (void)rd_kafka_poll(mgr->rk, 10);
+            mgr->stats.retried++;
             goto retry;
         }
         ERROR("Failed to produce msg to topic %s: %s.\n", rd_kafka_topic_name(mgr->rkt),
                                                            rd_kafka_err2str(rd_kafka_last_error()));
         (void)free(msg);
+        mgr->stats.records++;
+        (void)__atomic_add_fetch(&mgr->stats.failed, 1, __ATOMIC_RELAXED);
         return -1;
     }
+    mgr->stats.records++;
+    mgr->stats.produced++;
     (void)rd_kafka_poll(mgr->rk, 0);
     return 0;
 }
 
+static void KafkaDropMsg(KafkaMgr *mgr, rd_kafka_message_t *rkmessage)
+{
+    (void)__atomic_add_fetch(&mgr->stats.failed, 1, __ATOMIC_RELAXED);
+    free(rkmessage->payload);
+    rkmessage->payload = NULL;
+}
+
+/* Messages not taken by kafka wait in pending for retry, the newest are dropped if pending is full. */
+static uint32_t KafkaQueuePending(KafkaMgr *mgr, rd_kafka_message_t *rkmessages, uint32_t num)
+{
+    uint32_t i, dropped = 0;
+
+    for (i = 0; i < num; i++) {
+        if (mgr->pendingNum < KAFKA_PENDING_MAX) {
+            mgr->pending[mgr->pendingNum++] = rkmessages[i];
+        } else {
+            KafkaDropMsg(mgr, &rkmessages[i]);
+            dropped++;
+        }
+    }
+    if (dropped > 0) {
+        ERROR("Kafka pending queue is full, %u msgs to topic %s dropped.\n", dropped, rd_kafka_topic_name(mgr->rkt));
+    }
+    return dropped;
+}
+
+/*
+ * Messages rejected on queue full are moved to the head of rkmessages in order and their
+ * number is returned by rejected, others failed are dropped. Returns the number of dropped.
+ */
+static uint32_t KafkaProduceMsgs(KafkaMgr *mgr, rd_kafka_message_t *rkmessages, uint32_t num, uint32_t *rejected)
+{
+    uint32_t i, kept = 0, dropped = 0;
+    int ok;
+
+    *rejected = 0;
+    for (i = 0; i < num; i++) {
+        rkmessages[i].err = RD_KAFKA_RESP_ERR_NO_ERROR;
+    }
+    ok = rd_kafka_produce_batch(mgr->rkt, RD_KAFKA_PARTITION_UA, RD_KAFKA_MSG_F_FREE, rkmessages, (int)num);
+    if (ok == (int)num) {
+        mgr->stats.produced += num;
+        return 0;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (rkmessages[i].err == RD_KAFKA_RESP_ERR_NO_ERROR) {
+            mgr->stats.produced++;
+        } else if (rkmessages[i].err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+            rkmessages[kept++] = rkmessages[i];
+        } else {
+            KafkaDropMsg(mgr, &rkmessages[i]);
+            dropped++;
+        }
+    }
+    if (dropped > 0) {
+        ERROR("Failed to produce %u msgs to topic %s.\n", dropped, rd_kafka_topic_name(mgr->rkt));
+    }
+    *rejected = kept;
+    return dropped;
+}
+
+/* Retry pending messages oldest first, stops once kafka rejects them again(queue still full). */
+static void KafkaRetryPending(KafkaMgr *mgr)
+{
+    uint32_t num, rejected;
+
+    while (mgr->pendingNum > 0) {
+        num = mgr->pendingNum;
+        if (num > KAFKA_PRODUCE_BATCH_MAX) {
+            num = KAFKA_PRODUCE_BATCH_MAX;
+        }
+
+        mgr->stats.retried += num;
+        (void)KafkaProduceMsgs(mgr, mgr->pending, num, &rejected);
+
+        // Messages still rejected stay at the head of pending, ahead of the ones not retried yet.
+        (void)memmove(mgr->pending + rejected, mgr->pending + num,
+                      (mgr->pendingNum - num) * sizeof(rd_kafka_message_t));
+        mgr->pendingNum -= num - rejected;
+        if (rejected > 0) {
+            break;
+        }
+    }
+}
+
+uint32_t KafkaPackSize(KafkaMsgPack msgPack, uint32_t len)
+{
+    return (msgPack == KAFKA_MSG_PACK_LENGTH) ? (len + sizeof(uint32_t)) : (len + 1);
+}
+
+char *KafkaPackMsgs(KafkaMsgPack msgPack, char *msgs[], const uint32_t lens[], uint32_t num, uint32_t size)
+{
+    char *buf = (char *)malloc(size);
+    uint32_t i, off = 0, be_len;
+
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (msgPack == KAFKA_MSG_PACK_LENGTH) {
+            be_len = htonl(lens[i]);
+            (void)memcpy(buf + off, &be_len, sizeof(be_len));
+            off += sizeof(be_len);
+            (void)memcpy(buf + off, msgs[i], lens[i]);
+            off += lens[i];
+        } else {
+            (void)memcpy(buf + off, msgs[i], lens[i]);
+            off += lens[i];
+            buf[off++] = '\n';
+        }
+    }
+    return buf;
+}
+
+static int KafkaMsgProduceChunk(KafkaMgr *mgr, char *msgs[], uint32_t num)
+{
+    rd_kafka_message_t rkmessages[KAFKA_PRODUCE_BATCH_MAX];
+    uint32_t lens[KAFKA_PRODUCE_BATCH_MAX];
+    uint32_t i, j, k, size, cnt = 0;
+    uint32_t rejected, dropped;
+    int ret = 0;
+
+    (void)memset(rkmessages, 0, sizeof(rkmessages));
+    for (i = 0; i < num; i++) {
+        lens[i] = (uint32_t)strlen(msgs[i]);
+    }
+
+    for (i = 0; i < num; i = j) {
+        if (mgr->msgPack == KAFKA_MSG_PACK_NONE) {
+            rkmessages[cnt].payload = msgs[i];
+            rkmessages[cnt].len = lens[i];
+            cnt++;
+            j = i + 1;
+            continue;
+        }
+
+        size = KafkaPackSize(mgr->msgPack, lens[i]);
+        for (j = i + 1; j < num && size + KafkaPackSize(mgr->msgPack, lens[j]) <= mgr->msgPackMaxBytes; j++) {
+            size += KafkaPackSize(mgr->msgPack, lens[j]);
+        }
+        rkmessages[cnt].payload = KafkaPackMsgs(mgr->msgPack, msgs + i, lens + i, j - i, size);
+        for (k = i; k < j; k++) {
+            free(msgs[k]);
+        }
+        if (rkmessages[cnt].payload == NULL) {
+            (void)__atomic_add_fetch(&mgr->stats.failed, 1, __ATOMIC_RELAXED);
+            ret = -1;
+            continue;
+        }
+        rkmessages[cnt].len = size;
+        cnt++;
+    }
+
+    if (cnt == 0) {
+        return ret;
+    }
+
+    // Keep the order: new messages queue up behind the pending ones until those are taken.
+    if (mgr->pendingNum > 0) {
+        dropped = KafkaQueuePending(mgr, rkmessages, cnt);
+    } else {
+        dropped = KafkaProduceMsgs(mgr, rkmessages, cnt, &rejected);
+        dropped += KafkaQueuePending(mgr, rkmessages, rejected);
+    }
+    return (dropped > 0) ? -1 : ret;
+}
+
+int KafkaMsgProduceBatch(KafkaMgr *mgr, char *msgs[], uint32_t num)
+{
+    uint32_t off, cnt;
+    int ret = 0;
+
+    mgr->stats.records += num;
+
+    // Keep the order: pending messages go before the new ones.
+    KafkaRetryPending(mgr);
+
+    for (off = 0; off < num; off += cnt) {
+        cnt = num - off;
+        if (cnt > KAFKA_PRODUCE_BATCH_MAX) {
+            cnt = KAFKA_PRODUCE_BATCH_MAX;
+        }
+        if (KafkaMsgProduceChunk(mgr, msgs + off, cnt) != 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+void KafkaPoll(KafkaMgr *mgr)
+{
+    if (mgr == NULL) {
+        return;
+    }
+    (void)rd_kafka_poll(mgr->rk, 0);
+    KafkaRetryPending(mgr);
+}
+
+void KafkaMgrGetStats(const KafkaMgr *mgr, KafkaStats *stats)
+{
+    stats->records = mgr->stats.records;
+    stats->produced = mgr->stats.produced;
+    stats->delivered = __atomic_load_n(&mgr->stats.delivered, __ATOMIC_RELAXED);
+    stats->failed = __atomic_load_n(&mgr->stats.failed, __ATOMIC_RELAXED);
+    stats->retried = mgr->stats.retried;
+}
+
 #endif
\ No newline at end of file
@@ -21,6 +21,17 @@
 #include "base.h"
 #include "config.h"
 
+#define KAFKA_PRODUCE_BATCH_MAX     256     // Max kafka messages per rd_kafka_produce_batch()
+#define KAFKA_PENDING_MAX           4096    // Max kafka messages waiting for retry on queue full
+
+typedef struct {
+    uint64_t records;           // Records handed to kafka mgr
+    uint64_t produced;          // Kafka messages enqueued to librdkafka
+    uint64_t delivered;         // Kafka messages acked by broker
+    uint64_t failed;            // Kafka messages dropped, failed to enqueue or deliver
+    uint64_t retried;           // Kafka messages enqueued again after queue full
+} KafkaStats;
+
 typedef struct {
     char kafkaBroker[MAX_KAFKA_BROKER_LEN];
     char kafkaTopic[MAX_KAFKA_TOPIC_LEN];
@@ -29,16 +40,40 @@ typedef struct {
     uint32_t queueBufferingMaxMessages;
     uint32_t queueBufferingMaxKbytes;
     uint32_t queueBufferingMaxMs;
+    KafkaMsgPack msgPack;
+    uint32_t msgPackMaxBytes;
 
     rd_kafka_t *rk;
     rd_kafka_topic_t *rkt;
     rd_kafka_conf_t *conf;
+
+    // Only touched by the thread that produces with KafkaMsgProduceBatch()
+    rd_kafka_message_t *pending;
+    uint32_t pendingNum;
+    KafkaStats stats;
 } KafkaMgr;
 
 KafkaMgr *KafkaMgrCreate(const ConfigMgr *configMgr, const char *topic_type);
 void KafkaMgrDestroy(KafkaMgr *mgr);
 
-int KafkaMsgProduce(const KafkaMgr *mgr, char *msg, const uint32_t msgLen);
+int KafkaMsgProduce(KafkaMgr *mgr, char *msg, const uint32_t msgLen);
+
+/*
+ * Produce num NUL-terminated records(freed by kafka mgr in any case) with rd_kafka_produce_batch(),
+ * records are packed into fewer kafka messages if msg_pack is configured. Never blocks: messages
+ * rejected on queue full wait for KafkaPoll() to retry them, and new ones queue up behind them to
+ * keep the order. Returns -1 if any of them is dropped.
+ */
+int KafkaMsgProduceBatch(KafkaMgr *mgr, char *msgs[], uint32_t num);
+
+/* Bytes of a record of len in a packed kafka message. */
+uint32_t KafkaPackSize(KafkaMsgPack msgPack, uint32_t len);
+/* Pack num records into one kafka message payload of size bytes, as laid out by msgPack. */
+char *KafkaPackMsgs(KafkaMsgPack msgPack, char *msgs[], const uint32_t lens[], uint32_t num, uint32_t size);
+
+/* Serve delivery reports and retry pending messages, called periodically by the producing thread. */
+void KafkaPoll(KafkaMgr *mgr);
+void KafkaMgrGetStats(const KafkaMgr *mgr, KafkaStats *stats);
 
 #endif /* KAFKA_CHANNEL */
 
@@ -20,6 +20,7 @@
 #include <time.h>
 
 #include "probe_mng.h"
+#include "probe_fifo.h"
 
 #define PROBE_START_DELAY           5
 #define PROBE_LKUP_PID_RETRY_MAX    4
@@ -45,7 +46,6 @@ repeat:
 
 static void sendOutputToIngresss(struct probe_s *probe, char *buffer, uint32_t bufferSize)
 {
-    int ret = 0;
     char *dataStr;
 
     buffer[bufferSize - 1] = '\0';
@@ -54,40 +54,17 @@ static void sendOutputToIngresss(struct probe_s *probe, char *buffer, uint32_t b
         return;
     }
 
-    ret = FifoPut(probe->fifo, (void *)dataStr);
-    if (ret) {
-        ERROR("[E-PROBE %s] fifo put failed.\n", probe->name);
-        (void)free(dataStr);
-    }
-
-    return;
-}
-
-static void writeIngressEvt(struct probe_s *probe)
-{
-    uint64_t msg = 1;
-    int ret = write(probe->fifo->triggerFd, &msg, sizeof(uint64_t));
-    if (ret != sizeof(uint64_t)) {
-        ERROR("[E-PROBE %s] send trigger msg to eventfd failed.\n", probe->name);
-    }
+    // Overflow of fifo is handled by the policy of probe, refer to probe_fifo_put().
+    (void)probe_fifo_put(probe, (void *)dataStr);
     return;
 }
 
 static void parseExtendProbeOutput(struct probe_s *probe, FILE *f)
 {
-#define __WRITE_EVT_PERIOD  5
     char buffer[MAX_DATA_STR_LEN];
     size_t bufferSize = 0;
-    time_t last_wr_event = (time_t)0, current = (time_t)0;
-    time_t secs;
 
     while (feof(f) == 0 && ferror(f) == 0) {
-        if (FifoFull(probe->fifo)) {
-            writeIngressEvt(probe);
-            sleep(1);   // Rate limiting for probes
-            continue;
-        }
-
         if (fgets(buffer, sizeof(buffer), f) == NULL) {
             continue;
         }
@@ -104,19 +81,6 @@ static void parseExtendProbeOutput(struct probe_s *probe, FILE *f)
         }
 
         sendOutputToIngresss(probe, buffer, bufferSize);
-        if (last_wr_event == (time_t)0) {
-            writeIngressEvt(probe);
-            last_wr_event = (time_t)time(NULL);
-        } else {
-            current = (time_t)time(NULL);
-            if (current > last_wr_event) {
-                secs = current - last_wr_event;
-                if (secs >= __WRITE_EVT_PERIOD) {
-                    writeIngressEvt(probe);
-                    last_wr_event = current;
-                }
-            }
-        }
     }
     return;
 }
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-04
+ * Description: binary record protocol between native probes and ingress
+ ******************************************************************************/
+#ifndef __NPROBE_RECORD_H__
+#define __NPROBE_RECORD_H__
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Native probes can emit metrics as typed binary records instead of '|' separated
+ * text lines. A record is one contiguous allocation: header, field array and the
+ * bytes of all string fields, so ingress loads it into IMDB without re-parsing.
+ *
+ * Text lines always start with '|', binary records start with NPROBE_RECORD_MAGIC,
+ * both kinds of element can be mixed in the same probe fifo.
+ */
+#define NPROBE_RECORD_MAGIC         0x7f
+#define NPROBE_RECORD_TBL_NAME_LEN  32      // Same as MAX_IMDB_TABLE_NAME_LEN
+#define NPROBE_RECORD_MAX_FIELDS    128     // Same as MAX_FIELDS_NUM
+
+enum nprobe_field_type_e {
+    NPROBE_FIELD_U64 = 0,
+    NPROBE_FIELD_S64,
+    NPROBE_FIELD_DOUBLE,
+    NPROBE_FIELD_STR,
+
+    NPROBE_FIELD_MAX
+};
+
+struct nprobe_field_s {
+    uint8_t type;                   // Refer to enum nprobe_field_type_e
+    uint8_t precision;              // Digits after the decimal point, only used by NPROBE_FIELD_DOUBLE
+    uint16_t rsvd;
+    uint32_t len;                   // Length of string(exclude '\0'), only used by NPROBE_FIELD_STR
+    union {
+        uint64_t u64_val;
+        int64_t s64_val;
+        double f64_val;
+        const char *str;            // String view, empty string means invalid value
+    };
+};
+
+struct nprobe_record_s {
+    char magic;                     // Always NPROBE_RECORD_MAGIC
+    uint8_t rsvd;
+    uint16_t field_num;
+    uint32_t size;                  // Total size of this record, include header
+    char tbl_name[NPROBE_RECORD_TBL_NAME_LEN];
+    struct nprobe_field_s fields[];
+};
+
+#define NPROBE_U64(v)       { .type = NPROBE_FIELD_U64, .u64_val = (uint64_t)(v) }
+#define NPROBE_S64(v)       { .type = NPROBE_FIELD_S64, .s64_val = (int64_t)(v) }
+#define NPROBE_DBL(v, prec) { .type = NPROBE_FIELD_DOUBLE, .precision = (prec), .f64_val = (double)(v) }
+#define NPROBE_STR(s)       { .type = NPROBE_FIELD_STR, .str = (s) }
+
+#define NPROBE_FIELDS_NUM(fields)   (sizeof(fields) / sizeof((fields)[0]))
+
+static inline int is_nprobe_record(const void *data)
+{
+    return (data != NULL) && (*(const char *)data == NPROBE_RECORD_MAGIC);
+}
+
+/*
+ * Repoint the string views of a record to its own tail, used when the record bytes
+ * are moved to another place(e.g. read back from the spill file of probe fifo).
+ */
+static inline void nprobe_record_fixup(struct nprobe_record_s *record)
+{
+    char *str_pos = (char *)&record->fields[record->field_num];
+    uint16_t i;
+
+    for (i = 0; i < record->field_num; i++) {
+        if (record->fields[i].type != NPROBE_FIELD_STR) {
+            continue;
+        }
+        record->fields[i].str = str_pos;
+        str_pos += record->fields[i].len + 1;
+    }
+}
+
+struct nprobe_record_s *nprobe_record_create(const char *tbl_name, const struct nprobe_field_s *fields,
+                                             uint16_t field_num);
+int nprobe_emit_record(const char *tbl_name, const struct nprobe_field_s *fields, uint16_t field_num);
+
+#endif
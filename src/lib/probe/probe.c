@@ -24,7 +24,9 @@
 
 #include "syscall.h"
 #include "nprobe_fprintf.h"
+#include "nprobe_record.h"
 #include "probe_mng.h"
+#include "probe_fifo.h"
 
 #define ZEROPAD 1       /* pad with zero */
 #define SIGN    2       /* unsigned/signed long */
@@ -68,20 +70,72 @@ int nprobe_fprintf(FILE *stream, const char *curFormat, ...)
     (void)vsnprintf(dataStr, MAX_DATA_STR_LEN, curFormat, args);
     va_end(args);
 
-    int ret = FifoPut(g_probe->fifo, (void *)dataStr);
-    if (ret != 0) {
-        ERROR("[PROBE %s] fifo full.\n", g_probe->name);
-        (void)free(dataStr);
-        return -1;
+    return probe_fifo_put(g_probe, (void *)dataStr);
+}
+
+/*
+ * Pack the fields into one contiguous record(header + fields + string bytes),
+ * string views in the record point to its own tail, so it can be freed at once.
+ */
+struct nprobe_record_s *nprobe_record_create(const char *tbl_name, const struct nprobe_field_s *fields,
+                                             uint16_t field_num)
+{
+    struct nprobe_record_s *record;
+    size_t size, str_size = 0;
+    char *str_pos;
+    uint16_t i;
+
+    if (tbl_name == NULL || fields == NULL || field_num == 0 || field_num > NPROBE_RECORD_MAX_FIELDS) {
+        return NULL;
     }
 
-    uint64_t msg = 1;
-    ret = write(g_probe->fifo->triggerFd, &msg, sizeof(uint64_t));
-    if (ret != sizeof(uint64_t)) {
-        ERROR("[PROBE %s] send trigger msg to eventfd failed.\n", g_probe->name);
-        return -1;
+    for (i = 0; i < field_num; i++) {
+        if (fields[i].type >= NPROBE_FIELD_MAX) {
+            ERROR("[PROBE] invalid field type %u of table %s.\n", fields[i].type, tbl_name);
+            return NULL;
+        }
+        if (fields[i].type == NPROBE_FIELD_STR) {
+            str_size += (fields[i].str ? strlen(fields[i].str) : 0) + 1;
+        }
+    }
+
+    size = sizeof(struct nprobe_record_s) + sizeof(struct nprobe_field_s) * field_num + str_size;
+    record = (struct nprobe_record_s *)malloc(size);
+    if (record == NULL) {
+        return NULL;
     }
 
-    return 0;
+    record->magic = NPROBE_RECORD_MAGIC;
+    record->rsvd = 0;
+    record->field_num = field_num;
+    record->size = (uint32_t)size;
+    (void)snprintf(record->tbl_name, sizeof(record->tbl_name), "%s", tbl_name);
+    (void)memcpy(record->fields, fields, sizeof(struct nprobe_field_s) * field_num);
+
+    str_pos = (char *)&record->fields[field_num];
+    for (i = 0; i < field_num; i++) {
+        if (record->fields[i].type != NPROBE_FIELD_STR) {
+            continue;
+        }
+        record->fields[i].len = fields[i].str ? (uint32_t)strlen(fields[i].str) : 0;
+        if (record->fields[i].len > 0) {
+            (void)memcpy(str_pos, fields[i].str, record->fields[i].len);
+        }
+        str_pos[record->fields[i].len] = 0;
+        record->fields[i].str = str_pos;
+        str_pos += record->fields[i].len + 1;
+    }
+
+    return record;
 }
 
+int nprobe_emit_record(const char *tbl_name, const struct nprobe_field_s *fields, uint16_t field_num)
+{
+    struct nprobe_record_s *record = nprobe_record_create(tbl_name, fields, field_num);
+
+    if (record == NULL) {
+        return -1;
+    }
+
+    return probe_fifo_put(g_probe, (void *)record);
+}
@@ -0,0 +1,445 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-08
+ * Description: overflow policy and statistics of probe fifo
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "nprobe_record.h"
+#include "probe_fifo.h"
+#include "probe_params_parser.h"
+
+#define PROBE_FIFO_BLOCK_INTERVAL   1000    // unit: us
+#define PROBE_FIFO_LOG_INTERVAL     60      // unit: second
+
+static pthread_mutex_t g_spill_create_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void probe_fifo_drop(struct probe_s *probe, void *data)
+{
+    time_t now = time(NULL);
+    time_t last = __atomic_load_n(&probe->fifo_full_log_ts, __ATOMIC_RELAXED);
+
+    (void)__atomic_add_fetch(&probe->fifo->dropped, 1, __ATOMIC_RELAXED);
+    free(data);
+
+    // Drops are counted in self-metrics, only log once a while, by the producer which wins the CAS.
+    if (now >= last + PROBE_FIFO_LOG_INTERVAL &&
+        __atomic_compare_exchange_n(&probe->fifo_full_log_ts, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        ERROR("[PROBE %s] fifo full, %llu elements dropped so far.\n", probe->name,
+              (unsigned long long)__atomic_load_n(&probe->fifo->dropped, __ATOMIC_RELAXED));
+    }
+}
+
+static int probe_fifo_notify(struct probe_s *probe)
+{
+    if (FifoNotify(probe->fifo) != 0) {
+        ERROR("[PROBE %s] send trigger msg to eventfd failed.\n", probe->name);
+        return -1;
+    }
+    return 0;
+}
+
+static u32 probe_fifo_data_len(const void *data)
+{
+    if (is_nprobe_record(data)) {
+        return ((const struct nprobe_record_s *)data)->size;
+    }
+    return (u32)strlen((const char *)data) + 1;
+}
+
+static struct probe_fifo_spill_s *probe_fifo_spill_get(struct probe_s *probe)
+{
+    char path[PATH_LEN];
+    struct probe_fifo_spill_s *spill;
+    int fd;
+
+    spill = __atomic_load_n(&probe->fifo_spill, __ATOMIC_ACQUIRE);
+    if (spill != NULL) {
+        return spill;
+    }
+
+    (void)pthread_mutex_lock(&g_spill_create_lock);
+    spill = probe->fifo_spill;
+    if (spill != NULL) {
+        goto out;
+    }
+
+    path[0] = 0;
+    (void)snprintf(path, sizeof(path), "%sfifo_spill_%s.XXXXXX", GALA_GOPHER_RUN_DIR, probe->name);
+    fd = mkstemp(path);
+    if (fd < 0) {
+        ERROR("[PROBE %s] failed to create fifo spill file %s.\n", probe->name, path);
+        goto out;
+    }
+    // Unlinked at once, so nothing is left behind after gopher exits.
+    (void)unlink(path);
+
+    spill = (struct probe_fifo_spill_s *)calloc(1, sizeof(struct probe_fifo_spill_s));
+    if (spill == NULL) {
+        (void)close(fd);
+        goto out;
+    }
+    (void)pthread_mutex_init(&spill->lock, NULL);
+    spill->fd = fd;
+    __atomic_store_n(&probe->fifo_spill, spill, __ATOMIC_RELEASE);
+out:
+    (void)pthread_mutex_unlock(&g_spill_create_lock);
+    return spill;
+}
+
+/* Called with spill->lock held. */
+static int probe_fifo_spill_write(struct probe_s *probe, struct probe_fifo_spill_s *spill, void *data)
+{
+    u32 len = probe_fifo_data_len(data);
+
+    if (spill->wr_off + sizeof(len) + len > PROBE_FIFO_SPILL_MAX_SIZE) {
+        goto err;
+    }
+
+    if (pwrite(spill->fd, &len, sizeof(len), (off_t)spill->wr_off) != sizeof(len)) {
+        goto err;
+    }
+    if (pwrite(spill->fd, data, len, (off_t)(spill->wr_off + sizeof(len))) != len) {
+        goto err;
+    }
+
+    spill->wr_off += sizeof(len) + len;
+    (void)__atomic_add_fetch(&spill->spilled, 1, __ATOMIC_RELAXED);
+    free(data);
+    return 0;
+
+err:
+    probe_fifo_drop(probe, data);
+    return -1;
+}
+
+/*
+ * Move spilled elements back to fifo in order, returns 1 if some are still left in spill file.
+ * Called with spill->lock held.
+ */
+static int probe_fifo_spill_replay(struct probe_s *probe, struct probe_fifo_spill_s *spill)
+{
+    char *data;
+    u32 len;
+
+    while (spill->rd_off < spill->wr_off) {
+        // Fifo full is expected, the rest is replayed by the next put or by probe_fifo_spill_flush().
+        if (FifoFull(probe->fifo)) {
+            return 1;
+        }
+        if (pread(spill->fd, &len, sizeof(len), (off_t)spill->rd_off) != sizeof(len)) {
+            goto broken;
+        }
+
+        data = (char *)malloc(len);
+        if (data == NULL) {
+            return 1;
+        }
+        if (pread(spill->fd, data, len, (off_t)(spill->rd_off + sizeof(len))) != len) {
+            free(data);
+            goto broken;
+        }
+        if (is_nprobe_record(data)) {
+            nprobe_record_fixup((struct nprobe_record_s *)data);
+        }
+
+        if (FifoPut(probe->fifo, (void *)data) != 0) {
+            free(data);
+            return 1;
+        }
+        spill->rd_off += sizeof(len) + len;
+    }
+    goto reset;
+
+broken:
+    ERROR("[PROBE %s] failed to read fifo spill file, discard it.\n", probe->name);
+reset:
+    spill->rd_off = 0;
+    spill->wr_off = 0;
+    (void)ftruncate(spill->fd, 0);
+    return 0;
+}
+
+static int probe_fifo_put_spill(struct probe_s *probe, void *data)
+{
+    struct probe_fifo_spill_s *spill = probe_fifo_spill_get(probe);
+    int ret;
+
+    if (spill == NULL) {
+        probe_fifo_drop(probe, data);
+        return -1;
+    }
+
+    (void)pthread_mutex_lock(&spill->lock);
+    ret = probe_fifo_spill_write(probe, spill, data);
+    (void)pthread_mutex_unlock(&spill->lock);
+    return ret;
+}
+
+static int probe_fifo_put_block(struct probe_s *probe, void *data)
+{
+    u32 tmout = probe->probe_param.fifo_block_tmout;
+    u32 waited = 0;
+
+    // tmout 0 waits until there is room.
+    while (FifoPut(probe->fifo, data) != 0) {
+        if (tmout != 0 && waited >= tmout * 1000) {
+            probe_fifo_drop(probe, data);
+            return -1;
+        }
+        (void)probe_fifo_notify(probe);
+        (void)usleep(PROBE_FIFO_BLOCK_INTERVAL);
+        waited += PROBE_FIFO_BLOCK_INTERVAL;
+    }
+    return 0;
+}
+
+static int probe_fifo_put_drop_oldest(struct probe_s *probe, void *data)
+{
+    void *oldest;
+
+    while (FifoPut(probe->fifo, data) != 0) {
+        if (FifoGet(probe->fifo, &oldest) == 0) {
+            (void)__atomic_add_fetch(&probe->fifo->dropped, 1, __ATOMIC_RELAXED);
+            free(oldest);
+        }
+    }
+    return 0;
+}
+
+int probe_fifo_put(struct probe_s *probe, void *data)
+{
+    struct probe_fifo_spill_s *spill;
+    int ret = 0;
+
+    if (probe == NULL || probe->fifo == NULL) {
+        free(data);
+        return -1;
+    }
+
+    // Keep the order: nothing overtakes the elements waiting in spill file.
+    spill = __atomic_load_n(&probe->fifo_spill, __ATOMIC_ACQUIRE);
+    if (spill != NULL) {
+        (void)pthread_mutex_lock(&spill->lock);
+        if (probe_fifo_spill_replay(probe, spill)) {
+            ret = probe_fifo_spill_write(probe, spill, data);
+            (void)pthread_mutex_unlock(&spill->lock);
+            (void)probe_fifo_notify(probe);
+            return ret;
+        }
+        (void)pthread_mutex_unlock(&spill->lock);
+    }
+
+    if (FifoPut(probe->fifo, data) != 0) {
+        switch (probe->probe_param.fifo_overflow) {
+            case FIFO_OVERFLOW_DROP_OLDEST:
+                ret = probe_fifo_put_drop_oldest(probe, data);
+                break;
+            case FIFO_OVERFLOW_BLOCK:
+                ret = probe_fifo_put_block(probe, data);
+                break;
+            case FIFO_OVERFLOW_SPILL:
+                ret = probe_fifo_put_spill(probe, data);
+                break;
+            default:
+                probe_fifo_drop(probe, data);
+                ret = -1;
+                break;
+        }
+    }
+
+    if (probe_fifo_notify(probe) != 0) {
+        return -1;
+    }
+    return ret;
+}
+
+/*
+ * Replay what is left in the spill file once ingress has made room, a probe going quiet after
+ * a burst puts nothing more to replay it. Producers replaying meanwhile hold the lock, skip then.
+ */
+static void probe_fifo_spill_flush(struct probe_s *probe)
+{
+    struct probe_fifo_spill_s *spill;
+    char pending;
+
+    if (probe->fifo == NULL) {
+        return;
+    }
+    spill = __atomic_load_n(&probe->fifo_spill, __ATOMIC_ACQUIRE);
+    if (spill == NULL || pthread_mutex_trylock(&spill->lock) != 0) {
+        return;
+    }
+    pending = (spill->rd_off < spill->wr_off);
+    if (pending) {
+        (void)probe_fifo_spill_replay(probe, spill);
+    }
+    (void)pthread_mutex_unlock(&spill->lock);
+
+    if (pending) {
+        (void)probe_fifo_notify(probe);
+    }
+}
+
+void probe_fifo_spill_flush_all(struct probe_mng_s *probe_mng)
+{
+    int i;
+
+    for (i = 0; i < PROBE_TYPE_MAX; i++) {
+        if (probe_mng->probes[i] != NULL) {
+            probe_fifo_spill_flush(probe_mng->probes[i]);
+        }
+    }
+
+    for (i = 1; i <= probe_mng->custom_index; i++) {
+        if (probe_mng->custom[i] != NULL) {
+            probe_fifo_spill_flush(probe_mng->custom[i]);
+        }
+    }
+}
+
+void probe_fifo_spill_destroy(struct probe_s *probe)
+{
+    if (probe->fifo_spill == NULL) {
+        return;
+    }
+
+    (void)close(probe->fifo_spill->fd);
+    (void)pthread_mutex_destroy(&probe->fifo_spill->lock);
+    free(probe->fifo_spill);
+    probe->fifo_spill = NULL;
+}
+
+/*
+ * gopher self-metrics: statistics of every probe fifo are reported as nprobe records
+ * through a dedicated fifo, so they go through ingress/IMDB like any other metrics.
+ */
+int probe_fifo_stats_init(struct probe_mng_s *probe_mng)
+{
+    probe_mng->stats_fifo = FifoCreate(MAX_FIFO_SIZE);
+    if (probe_mng->stats_fifo == NULL) {
+        return -1;
+    }
+    probe_mng->stats_fifo_attached = 0;
+    probe_mng->stats_ts = (time_t)time(NULL);
+    return 0;
+}
+
+void probe_fifo_stats_deinit(struct probe_mng_s *probe_mng)
+{
+    struct epoll_event event;
+    void *data;
+
+    if (probe_mng->stats_fifo == NULL) {
+        return;
+    }
+
+    if (probe_mng->stats_fifo_attached && probe_mng->ingress_epoll_fd >= 0) {
+        event.events = EPOLLIN;
+        event.data.ptr = probe_mng->stats_fifo;
+        (void)epoll_ctl(probe_mng->ingress_epoll_fd, EPOLL_CTL_DEL, probe_mng->stats_fifo->triggerFd, &event);
+    }
+
+    while (FifoGet(probe_mng->stats_fifo, &data) == 0) {
+        free(data);
+    }
+    FifoDestroy(probe_mng->stats_fifo);
+    probe_mng->stats_fifo = NULL;
+}
+
+static int attach_stats_fifo(struct probe_mng_s *probe_mng)
+{
+    struct epoll_event event;
+
+    if (probe_mng->stats_fifo_attached) {
+        return 0;
+    }
+
+    if (probe_mng->ingress_epoll_fd < 0) {
+        return -1;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = probe_mng->stats_fifo;
+    if (epoll_ctl(probe_mng->ingress_epoll_fd, EPOLL_CTL_ADD, probe_mng->stats_fifo->triggerFd, &event)) {
+        ERROR("[PROBMNG] add EPOLLIN event of fifo stats failed.\n");
+        return -1;
+    }
+    probe_mng->stats_fifo_attached = 1;
+    return 0;
+}
+
+static void report_one_probe_fifo_stats(struct probe_mng_s *probe_mng, struct probe_s *probe)
+{
+    struct nprobe_record_s *record;
+    Fifo *fifo = probe->fifo;
+    u64 spilled = 0;
+
+    if (fifo == NULL) {
+        return;
+    }
+
+    if (probe->fifo_spill != NULL) {
+        spilled = __atomic_load_n(&probe->fifo_spill->spilled, __ATOMIC_RELAXED);
+    }
+
+    struct nprobe_field_s fields[] = {
+        NPROBE_STR(probe->name),
+        NPROBE_STR(fifo_overflow_to_str(probe->probe_param.fifo_overflow)),
+        NPROBE_U64(FifoDepth(fifo)),
+        NPROBE_U64(__atomic_load_n(&fifo->high_watermark, __ATOMIC_RELAXED)),
+        NPROBE_U64(__atomic_load_n(&fifo->enqueued, __ATOMIC_RELAXED)),
+        NPROBE_U64(__atomic_load_n(&fifo->dropped, __ATOMIC_RELAXED)),
+        NPROBE_U64(spilled)
+    };
+
+    record = nprobe_record_create(PROBE_FIFO_STATS_TBL, fields, NPROBE_FIELDS_NUM(fields));
+    if (record == NULL) {
+        return;
+    }
+
+    if (FifoPut(probe_mng->stats_fifo, (void *)record) != 0) {
+        free(record);
+    }
+}
+
+void report_probe_fifo_stats(struct probe_mng_s *probe_mng)
+{
+    int i;
+
+    if (probe_mng->stats_fifo == NULL || attach_stats_fifo(probe_mng)) {
+        return;
+    }
+
+    for (i = 0; i < PROBE_TYPE_MAX; i++) {
+        if (probe_mng->probes[i] != NULL) {
+            report_one_probe_fifo_stats(probe_mng, probe_mng->probes[i]);
+        }
+    }
+
+    for (i = 1; i <= probe_mng->custom_index; i++) {
+        if (probe_mng->custom[i] != NULL) {
+            report_one_probe_fifo_stats(probe_mng, probe_mng->custom[i]);
+        }
+    }
+
+    if (FifoNotify(probe_mng->stats_fifo) != 0) {
+        ERROR("[PROBMNG] send trigger msg of fifo stats failed.\n");
+    }
+}
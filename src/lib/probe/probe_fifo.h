@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-08
+ * Description: overflow policy and statistics of probe fifo
+ ******************************************************************************/
+#ifndef __PROBE_FIFO_H__
+#define __PROBE_FIFO_H__
+
+#pragma once
+
+#include <pthread.h>
+#include "probe_mng.h"
+
+#define PROBE_FIFO_STATS_TBL        "gopher_probe_fifo"
+#define PROBE_FIFO_STATS_PERIOD     5                       // unit: second
+#define PROBE_FIFO_SPILL_MAX_SIZE   (64 * 1024 * 1024)      // Max bytes of spill file per probe
+
+struct probe_fifo_spill_s {
+    pthread_mutex_t lock;       // Producers of one probe may put from several threads
+    int fd;                     // Unlinked file under GALA_GOPHER_RUN_DIR
+    u64 rd_off;
+    u64 wr_off;
+    u64 spilled;                // Number of elements written to spill file
+};
+
+/*
+ * Put data(text line or nprobe record) into the fifo of probe and wake up ingress.
+ * If fifo is full, probe->probe_param.fifo_overflow decides what happens, data is
+ * always consumed(put, spilled or freed). Returns 0 if data is accepted.
+ */
+int probe_fifo_put(struct probe_s *probe, void *data);
+/* Replay spill files of all probes into their fifos, called periodically by probe-mng thread. */
+void probe_fifo_spill_flush_all(struct probe_mng_s *probe_mng);
+void probe_fifo_spill_destroy(struct probe_s *probe);
+
+int probe_fifo_stats_init(struct probe_mng_s *probe_mng);
+void probe_fifo_stats_deinit(struct probe_mng_s *probe_mng);
+void report_probe_fifo_stats(struct probe_mng_s *probe_mng);
+
+#endif
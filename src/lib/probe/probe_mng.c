@@ -36,6 +36,7 @@
 #include "probe_params_parser.h"
 #include "json_tool.h"
 #include "probe_mng.h"
+#include "probe_fifo.h"
 
 static int init_probe_bin(struct probe_s *probe, enum probe_type_e probe_type);
 
@@ -371,6 +372,7 @@ static void destroy_probe(struct probe_s *probe)
         FifoDestroy(probe->fifo);
         probe->fifo = NULL;
     }
+    probe_fifo_spill_destroy(probe);
 
     for (i = 0 ; i < probe->snooper_conf_num ; i++) {
         free_snooper_conf(probe->snooper_confs[i]);
@@ -1478,6 +1480,7 @@ void destroy_probe_mng(void)
         g_probe_mng->probes[i] = NULL;
     }
 
+    probe_fifo_stats_deinit(g_probe_mng);
     unload_snooper_bpf(g_probe_mng);
     free(g_probe_mng);
     g_probe_mng = NULL;
@@ -1768,6 +1771,11 @@ struct probe_mng_s *create_probe_mng(void)
 
     g_probe_mng->keeplive_ts = (time_t)time(NULL);
 
+    ret = probe_fifo_stats_init(g_probe_mng);
+    if (ret) {
+        goto err;
+    }
+
     if (is_file_exist(GALA_GOPHER_CUSTOM_PATH)) {
         return g_probe_mng;
     }
@@ -1866,6 +1874,17 @@ static char is_keeplive_tmout(struct probe_mng_s *probe_mng)
     return 0;
 }
 
+static char is_fifo_stats_tmout(struct probe_mng_s *probe_mng)
+{
+    time_t current = (time_t)time(NULL);
+
+    if (current >= probe_mng->stats_ts + PROBE_FIFO_STATS_PERIOD) {
+        probe_mng->stats_ts = current;
+        return 1;
+    }
+    return 0;
+}
+
 #define SNOOPER_POLL_TMOUT  100  // 100ms
 void run_probe_mng_daemon(struct probe_mng_s *probe_mng)
 {
@@ -1891,6 +1910,16 @@ void run_probe_mng_daemon(struct probe_mng_s *probe_mng)
             keeplive_probes(probe_mng);
             put_probemng_lock();
         }
+
+        get_probemng_lock();
+        probe_fifo_spill_flush_all(probe_mng);
+        put_probemng_lock();
+
+        if (is_fifo_stats_tmout(probe_mng)) {
+            get_probemng_lock();
+            report_probe_fifo_stats(probe_mng);
+            put_probemng_lock();
+        }
     }
 }
 
@@ -74,6 +74,8 @@ struct custom_ini {
 struct probe_s;
 typedef int (*ProbeMain)(struct probe_s *);
 typedef void *(*ProbeCB)(void *);
+struct probe_fifo_spill_s;
+
 struct probe_s {
     char *name;                                         // Name for probe
     char *bin;                                          // Execute bin file for probe
@@ -87,7 +89,9 @@ struct probe_s {
     u32 probe_range_flags;                              // Refer to flags defined [PROBE_RANGE_XX_XX]
     ProbeMain probe_entry;                              // Main function for native probe
     ProbeCB cb;                                         // Thread cb for probe
-    Fifo *fifo;                                         // Data channel for probe, !!!NOTICE: context in probe-thread
+    Fifo *fifo;                                         // Data channel for probe, put by producer threads, got by ingress
+    struct probe_fifo_spill_s *fifo_spill;              // Spill file when fifo is full, replayed by producers and probe-mng thread
+    time_t fifo_full_log_ts;                            // Rate limiting of fifo full logs, atomic as producers share it
     pthread_t tid;                                      // Thread for admin probe
 
     int pid;                                            // PID of extend probe process(Invalid value -1), wr&rd by rest/probe/probe-mng thread
@@ -115,6 +119,9 @@ struct probe_mng_s {
     int ingress_epoll_fd;                               // !!!NOTICE: NO NEED FREE.
     pthread_t tid;                                      // probe mng thread, used to poll perf event
     time_t keeplive_ts;                                 // Used to keeplive probe
+    Fifo *stats_fifo;                                   // Channel of gopher self-metrics(probe fifo stats) to ingress
+    char stats_fifo_attached;
+    time_t stats_ts;                                    // Used to report probe fifo stats periodically
 
     pthread_rwlock_t rwlock;                            // Exclusive operations between rest-api event and perf event.
 
@@ -194,6 +194,19 @@ static int parser_report_cport(struct probe_s *probe, const struct param_key_s *
     return 0;
 }
 
+static int parser_kernel_aggr(struct probe_s *probe, const struct param_key_s *param_key, const void *key_item)
+{
+    int value = Json_GetValueInt(key_item);
+    if (value < param_key->v.min || value > param_key->v.max || value == INVALID_INT_NUM) {
+        PARSE_ERR("params.%s invalid value %d, must be in [%d, %d]",
+                  param_key->key, value, param_key->v.min, param_key->v.max);
+        return -1;
+    }
+
+    probe->probe_param.kernel_aggr = (char)value;
+    return 0;
+}
+
 static int parser_l7pro(struct probe_s *probe, const struct param_key_s *param_key, const void *key_item)
 {
     void *object;
@@ -435,6 +448,46 @@ static int parser_min_aggr_dur(struct probe_s *probe, const struct param_key_s *
     return 0;
 }
 
+static int parser_fifo_overflow(struct probe_s *probe, const struct param_key_s *param_key, const void *key_item)
+{
+    const char *value = (const char *)Json_GetValueString(key_item);
+
+    if (!Json_IsString(key_item)) {
+        return -1;
+    }
+
+    if (strcmp(value, FIFO_OVERFLOW_DROP_NEWEST_STR) == 0) {
+        probe->probe_param.fifo_overflow = FIFO_OVERFLOW_DROP_NEWEST;
+    } else if (strcmp(value, FIFO_OVERFLOW_DROP_OLDEST_STR) == 0) {
+        probe->probe_param.fifo_overflow = FIFO_OVERFLOW_DROP_OLDEST;
+    } else if (strcmp(value, FIFO_OVERFLOW_BLOCK_STR) == 0) {
+        probe->probe_param.fifo_overflow = FIFO_OVERFLOW_BLOCK;
+    } else if (strcmp(value, FIFO_OVERFLOW_SPILL_STR) == 0) {
+        probe->probe_param.fifo_overflow = FIFO_OVERFLOW_SPILL;
+    } else {
+        PARSE_ERR("params.%s invalid value %s, must be one of %s|%s|%s|%s", param_key->key, value,
+                  FIFO_OVERFLOW_DROP_NEWEST_STR, FIFO_OVERFLOW_DROP_OLDEST_STR,
+                  FIFO_OVERFLOW_BLOCK_STR, FIFO_OVERFLOW_SPILL_STR);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int parser_fifo_block_tmout(struct probe_s *probe, const struct param_key_s *param_key, const void *key_item)
+{
+    int value = Json_GetValueInt(key_item);
+
+    if (value < param_key->v.min || value > param_key->v.max || value == INVALID_INT_NUM) {
+        PARSE_ERR("params.%s invalid value %d, must be in [%d, %d]",
+                  param_key->key, value, param_key->v.min, param_key->v.max);
+        return -1;
+    }
+
+    probe->probe_param.fifo_block_tmout = (u32)value;
+    return 0;
+}
+
 static int parser_kafka_port(struct probe_s *probe, const struct param_key_s *param_key, const void *key_item)
 {
     int value = Json_GetValueInt(key_item);
@@ -582,9 +635,12 @@ SET_DEFAULT_PARAMS_INTER(cadvisor_port);
 SET_DEFAULT_PARAMS_INTER(profiling_chan);
 SET_DEFAULT_PARAMS_INTER(min_exec_dur);
 SET_DEFAULT_PARAMS_INTER(min_aggr_dur);
+SET_DEFAULT_PARAMS_INTER(fifo_overflow);
+SET_DEFAULT_PARAMS_INTER(fifo_block_tmout);
 
 SET_DEFAULT_PARAMS_CAHR(logs);
 SET_DEFAULT_PARAMS_CAHR(report_cport);
+SET_DEFAULT_PARAMS_CAHR(kernel_aggr);
 SET_DEFAULT_PARAMS_CAHR(support_ssl);
 SET_DEFAULT_PARAMS_CAHR(res_percent_upper);
 SET_DEFAULT_PARAMS_CAHR(res_percent_lower);
@@ -606,6 +662,7 @@ SET_DEFAULT_PARAMS_STR(flame_dir);
 #define RES_UPPER_THR       "res_upper_thr"
 #define REPORT_EVENT        "report_event"
 #define REPORT_CPORT        "report_cport"
+#define KERNEL_AGGR         "kernel_aggr"
 #define L7_PROTOCOL         "l7_protocol"
 #define SUPPORT_SSL         "support_ssl"
 #define PYROSCOPE_SERVER    "pyroscope_server"
@@ -624,6 +681,8 @@ SET_DEFAULT_PARAMS_STR(flame_dir);
 #define PROFLING_CHANNEL    "profiling_channel"
 #define MIN_EXEC_DUR        "min_exec_dur"
 #define MIN_AGGR_DUR        "min_aggr_dur"
+#define FIFO_OVERFLOW       "fifo_overflow"
+#define FIFO_BLOCK_TMOUT    "fifo_block_timeout"
 #define CUSTOM_PARAMS       "custom_param"
 
 struct param_key_s param_keys[] = {
@@ -639,6 +698,7 @@ struct param_key_s param_keys[] = {
     {REPORT_EVENT,        {0, 0, 1, ""},                             parser_report_event,            set_default_params_char_logs, JSON_NUMBER},
 #endif
     {REPORT_CPORT,        {0, 0, 1, ""},                             parser_report_cport,            set_default_params_char_report_cport, JSON_NUMBER},
+    {KERNEL_AGGR,         {0, 0, 1, ""},                             parser_kernel_aggr,             set_default_params_char_kernel_aggr, JSON_NUMBER},
     {L7_PROTOCOL,         {0, 0, 0, ""},                             parser_l7pro,                   set_default_params_inter_l7_probe_proto_flags, JSON_ARRAY},
     {SUPPORT_SSL,         {0, 0, 1, ""},                             parser_support_ssl,             set_default_params_char_support_ssl, JSON_NUMBER},
 
@@ -658,6 +718,8 @@ struct param_key_s param_keys[] = {
     {PROFLING_CHANNEL,    {PROFILING_CHAN_LOCAL, 0, 0, ""},          parser_profiling_channel,       set_default_params_inter_profiling_chan, JSON_STRING},
     {MIN_EXEC_DUR,        {1, 0, 1000000, ""},                       parser_min_exec_dur,            set_default_params_inter_min_exec_dur, JSON_NUMBER},
     {MIN_AGGR_DUR,        {100, 10, 10000, ""},                      parser_min_aggr_dur,            set_default_params_inter_min_aggr_dur, JSON_NUMBER},
+    {FIFO_OVERFLOW,       {FIFO_OVERFLOW_DROP_NEWEST, 0, 0, ""},     parser_fifo_overflow,           set_default_params_inter_fifo_overflow, JSON_STRING},
+    {FIFO_BLOCK_TMOUT,    {100, 0, 10000, ""},                       parser_fifo_block_tmout,        set_default_params_inter_fifo_block_tmout, JSON_NUMBER},
 };
 
 void set_default_params(struct probe_s *probe)
@@ -674,6 +736,12 @@ void set_default_params(struct probe_s *probe)
             param_key->defaulter(params, &(param_key->v));
         }
     }
+
+    // Extend probes are paced by their fifo, the reader waits until there is room instead of dropping lines.
+    if (IS_EXTEND_PROBE(probe) || probe->probe_type == PROBE_CUSTOM) {
+        params->fifo_overflow = FIFO_OVERFLOW_BLOCK;
+        params->fifo_block_tmout = 0;
+    }
 }
 
 int parse_params(struct probe_s *probe, const void *params_json)
@@ -742,6 +810,20 @@ void print_custom_params(void *params, struct probe_params *probe_param)
     Json_AddStringToObject(params, DEV_NAME_KEY, probe_param->target_dev);
     Json_AddUIntItemToObject(params, CADVISOR_PORT, probe_param->cadvisor_port);
 }
+const char *fifo_overflow_to_str(unsigned int fifo_overflow)
+{
+    switch (fifo_overflow) {
+        case FIFO_OVERFLOW_DROP_OLDEST:
+            return FIFO_OVERFLOW_DROP_OLDEST_STR;
+        case FIFO_OVERFLOW_BLOCK:
+            return FIFO_OVERFLOW_BLOCK_STR;
+        case FIFO_OVERFLOW_SPILL:
+            return FIFO_OVERFLOW_SPILL_STR;
+        default:
+            return FIFO_OVERFLOW_DROP_NEWEST_STR;
+    }
+}
+
 void probe_params_to_json(struct probe_s *probe, void *params)
 {
     struct probe_params *probe_param = &probe->probe_param;
@@ -750,6 +832,10 @@ void probe_params_to_json(struct probe_s *probe, void *params)
     size_t size;
 
     Json_AddUIntItemToObject(params, REPORT_PERIOD, probe_param->period);
+    Json_AddStringToObject(params, FIFO_OVERFLOW, fifo_overflow_to_str(probe_param->fifo_overflow));
+    if (probe_param->fifo_overflow == FIFO_OVERFLOW_BLOCK) {
+        Json_AddUIntItemToObject(params, FIFO_BLOCK_TMOUT, probe_param->fifo_block_tmout);
+    }
     if (probe_type == PROBE_IO || probe_type == PROBE_TCP) {
         Json_AddUIntItemToObject(params, SAMPLE_PERIOD, probe_param->sample_period);
     }
@@ -783,6 +869,7 @@ void probe_params_to_json(struct probe_s *probe, void *params)
     }
     if (probe_type == PROBE_TCP) {
         Json_AddCharItemToObject(params, REPORT_CPORT, probe_param->report_cport);
+        Json_AddCharItemToObject(params, KERNEL_AGGR, probe_param->kernel_aggr);
     }
     if (probe_type == PROBE_BASEINFO) {
         Json_AddStringToObject(params, ELF_PATH, probe_param->elf_path);
@@ -20,6 +20,7 @@ int parse_params(struct probe_s *probe, const void *params_json);
 void set_default_params(struct probe_s *probe);
 
 void probe_params_to_json(struct probe_s *probe, void *json);
+const char *fifo_overflow_to_str(unsigned int fifo_overflow);
 
 #endif
 
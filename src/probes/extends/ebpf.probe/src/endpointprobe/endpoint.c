@@ -34,6 +34,7 @@
 
 #include <bpf/bpf.h>
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "tcp.skel.h"
 #include "udp.skel.h"
 #include "tcp.h"
@@ -48,7 +49,7 @@
 #include "endpoint.h"
 
 #define EP_ENTITY_ID_LEN 64
-#define CAPACITY         4096
+#define CAPACITY         (1024 * 1024)  // Bytes
 #define DELAY_MS         500
 #define RM_ENDPOINT_MAP_PATH "/usr/bin/rm -rf /sys/fs/bpf/gala-gopher/__endpoint*"
 
@@ -750,16 +751,6 @@ static void sig_int(int signo)
     g_stop = 1;
 }
 
-static int get_netns_fd(pid_t pid)
-{
-    const char *fmt = "/proc/%d/ns/net";
-    char path[PATH_LEN];
-
-    path[0] = 0;
-    (void)snprintf(path, PATH_LEN, fmt, pid);
-    return open(path, O_RDONLY);
-}
-
 static int add_tcp_listen(struct endpoint_probe_s *probe, struct tcp_listen_port *tlp, int ino)
 {
     struct tcp_listen_key_s key;
@@ -790,13 +781,13 @@ static int add_tcp_listen(struct endpoint_probe_s *probe, struct tcp_listen_port
     return 0;
 }
 
-static void load_tcp_listens(struct endpoint_probe_s *probe)
+static void load_tcp_listens(struct endpoint_probe_s *probe, u32 pid)
 {
     int ret;
     struct tcp_listen_ports* tlps;
     struct tcp_listen_port *tlp;
 
-    tlps = get_listen_ports();
+    tlps = get_netns_listen_ports(pid);
     if (tlps == NULL) {
         goto err;
     }
@@ -832,52 +823,40 @@ err:
 
 static void reload_listen_port(struct endpoint_probe_s *probe)
 {
-    int ret, netns_fd;
+    int ret;
+    u32 pid;
     struct snooper_con_info_s *container;
     struct ipc_body_s *ipc_body = &probe->ipc_body;
 
     destroy_tcp_listens(probe);
 
-    netns_fd = get_netns_fd(getpid());
-    if (netns_fd <= 0) {
-        ERROR("[EPPROBE]: Get netns fd failed.\n");
-        return;
-    }
-
-    load_tcp_listens(probe);
+    load_tcp_listens(probe, 0);
 
     for (int i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
         if (ipc_body->snooper_objs[i].type != SNOOPER_OBJ_CON) {
             continue;
         }
 
+        // Listen ports of a container are looked up in the net namespace of its process.
         container = &(ipc_body->snooper_objs[i].obj.con_info);
-        ret = enter_container_netns((const char *)container->con_id);
+        ret = get_container_pid((const char *)container->con_id, &pid);
         if (ret) {
-            ERROR("[EPPROBE]: Enter container netns failed.(container_id = %s)\n", container->con_id);
+            ERROR("[EPPROBE]: Get container pid failed.(container_id = %s)\n", container->con_id);
             continue;
         }
 
-        load_tcp_listens(probe);
-
-        (void)exit_container_netns(netns_fd);
+        load_tcp_listens(probe, pid);
     }
 
-    (void)close(netns_fd);
     return;
 }
 
 static void reload_listen_map(struct endpoint_probe_s *probe)
 {
-    struct tcp_listen_val_s value;
-    struct tcp_listen_key_s k = {0};
-    struct tcp_listen_key_s nk = {0};
     struct tcp_listen_s *listen, *tmp;
 
-    while (bpf_map_get_next_key(probe->listen_port_fd, &k, &nk) == 0) {
-        (void)bpf_map_lookup_elem(probe->listen_port_fd, &nk, &value);
-        (void)bpf_map_delete_elem(probe->listen_port_fd, &nk);
-    }
+    (void)bpf_map_drain(probe->listen_port_fd, sizeof(struct tcp_listen_key_s), sizeof(struct tcp_listen_val_s),
+                        NULL, NULL);
 
     H_ITER(probe->listens, listen, tmp) {
         (void)bpf_map_update_elem(probe->listen_port_fd, &(listen->key), &(listen->val), BPF_ANY);
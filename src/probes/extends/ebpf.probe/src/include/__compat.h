@@ -77,13 +77,22 @@ static inline long bpfbuf_output(void *ctx, void *map, void *buf, __u64 size)
 typedef int (*bpf_buffer_sample_fn)(void *ctx, void *data, u32 size);
 typedef void (*bpf_buffer_lost_fn)(void *ctx, int cpu, u64 cnt);
 
+struct bpf_buffer_stats
+{
+    u64 events;     // samples handed to the sample callback
+    u64 bytes;
+    u64 lost;       // samples dropped by kernel, only perf buffer reports them
+};
+
 struct bpf_buffer
 {
     struct bpf_map *map;
     void *inner;
     bpf_buffer_sample_fn fn;
+    bpf_buffer_lost_fn lost_fn;
     void *ctx;
     int type;
+    struct bpf_buffer_stats stats;
 };
 
 static void __perfbuf_sample_fn(void *ctx, int cpu, void *data, __u32 size)
@@ -91,6 +100,8 @@ static void __perfbuf_sample_fn(void *ctx, int cpu, void *data, __u32 size)
     struct bpf_buffer *buffer = (struct bpf_buffer *)ctx;
     bpf_buffer_sample_fn fn;
 
+    buffer->stats.events++;
+    buffer->stats.bytes += size;
     fn = buffer->fn;
     if (!fn) {
         return;
@@ -99,6 +110,29 @@ static void __perfbuf_sample_fn(void *ctx, int cpu, void *data, __u32 size)
     (void)fn(buffer->ctx, data, size);
 }
 
+static void __perfbuf_lost_fn(void *ctx, int cpu, __u64 cnt)
+{
+    struct bpf_buffer *buffer = (struct bpf_buffer *)ctx;
+
+    buffer->stats.lost += cnt;
+    if (buffer->lost_fn) {
+        buffer->lost_fn(buffer->ctx, cpu, cnt);
+    }
+}
+
+static int __ringbuf_sample_fn(void *ctx, void *data, size_t size)
+{
+    struct bpf_buffer *buffer = (struct bpf_buffer *)ctx;
+
+    buffer->stats.events++;
+    buffer->stats.bytes += size;
+    if (!buffer->fn) {
+        return 0;
+    }
+
+    return buffer->fn(buffer->ctx, data, (u32)size);
+}
+
 static inline int bpf_buffer__reset(struct bpf_map *map, struct bpf_map *heap)
 {
     bool use_ringbuf;
@@ -163,14 +197,15 @@ static inline int bpf_buffer__open(struct bpf_buffer *buffer, bpf_buffer_sample_
     fd = bpf_map__fd(buffer->map);
     type = buffer->type;
 
+    buffer->fn = sample_cb;
+    buffer->lost_fn = lost_cb;
+    buffer->ctx = ctx;
     switch (type) {
     case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
-        buffer->fn = sample_cb;
-        buffer->ctx = ctx;
-        inner = perf_buffer__new(fd, PERF_BUFFER_PAGES, __perfbuf_sample_fn, lost_cb, buffer, NULL);
+        inner = perf_buffer__new(fd, PERF_BUFFER_PAGES, __perfbuf_sample_fn, __perfbuf_lost_fn, buffer, NULL);
         break;
     case BPF_MAP_TYPE_RINGBUF:
-        inner = ring_buffer__new(fd, (ring_buffer_sample_fn) sample_cb, ctx, NULL);
+        inner = ring_buffer__new(fd, __ringbuf_sample_fn, buffer, NULL);
         break;
     default:
         return 0;
@@ -198,6 +233,51 @@ static inline int bpf_buffer__poll(struct bpf_buffer *buffer, int timeout_ms)
     }
 }
 
+/*
+ * The fd becomes readable when there are samples in the buffer, so buffers of several probes can
+ * be waited on in one epoll set and the ready ones drained by bpf_buffer__consume().
+ */
+static inline int bpf_buffer__epoll_fd(struct bpf_buffer *buffer)
+{
+    switch (buffer->type)
+    {
+    case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
+        return perf_buffer__epoll_fd((struct perf_buffer *)buffer->inner);
+    case BPF_MAP_TYPE_RINGBUF:
+#if (CURRENT_LIBBPF_VERSION  >= LIBBPF_VERSION(0, 8))
+        return ring_buffer__epoll_fd((struct ring_buffer *)buffer->inner);
+#else
+        // Ring buffer map is pollable itself.
+        return bpf_map__fd(buffer->map);
+#endif
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Drain all available samples without waiting. */
+static inline int bpf_buffer__consume(struct bpf_buffer *buffer)
+{
+    switch (buffer->type)
+    {
+    case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
+        return perf_buffer__consume((struct perf_buffer *)buffer->inner);
+    case BPF_MAP_TYPE_RINGBUF:
+        return ring_buffer__consume((struct ring_buffer *)buffer->inner);
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Fetch the counters since last call. */
+static inline void bpf_buffer__take_stats(struct bpf_buffer *buffer, struct bpf_buffer_stats *stats)
+{
+    *stats = buffer->stats;
+    buffer->stats.events = 0;
+    buffer->stats.bytes = 0;
+    buffer->stats.lost = 0;
+}
+
 static inline void bpf_buffer__free(struct bpf_buffer *buffer)
 {
     if (!buffer) {
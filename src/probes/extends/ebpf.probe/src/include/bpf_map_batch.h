@@ -0,0 +1,45 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-30
+ * Description: batched bpf map iteration header
+ ******************************************************************************/
+#ifndef __BPF_MAP_BATCH_H__
+#define __BPF_MAP_BATCH_H__
+
+#pragma once
+
+#include "common.h"
+
+#define MAP_BATCH_CNT       256     // Entries read per syscall
+
+/* Return values of map_iter_cb */
+#define MAP_ITER_CONTINUE   0
+#define MAP_ITER_DELETE     1       // Delete the entry, it is done after the callback returns
+#define MAP_ITER_STOP       2
+
+typedef int (*map_iter_cb)(const void *key, const void *value, void *ctx);
+
+/*
+ * Walk all entries of a map, MAP_BATCH_CNT entries per syscall with bpf_map_lookup_batch() when
+ * both libbpf and kernel support it, otherwise one bpf_map_get_next_key() and lookup per entry.
+ * value_size 0 walks the keys only. Returns the number of entries visited, or -1 on error.
+ */
+int bpf_map_iter(int map_fd, u32 key_size, u32 value_size, map_iter_cb cb, void *ctx);
+
+/*
+ * Delete all entries of a map with bpf_map_lookup_and_delete_batch(), cb is called for each
+ * entry if not NULL. The return value of cb is ignored, MAP_ITER_STOP does not keep the rest
+ * of the map. Returns the number of entries deleted, or -1 on error.
+ */
+int bpf_map_drain(int map_fd, u32 key_size, u32 value_size, map_iter_cb cb, void *ctx);
+
+#endif
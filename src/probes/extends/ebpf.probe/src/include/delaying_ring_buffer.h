@@ -17,17 +17,26 @@
 
 #include <sys/time.h>
 
+#define DRB_ALIGN   8
+
+/*
+ * Records are written in place into one contiguous byte ring: this header, then the data,
+ * padded to DRB_ALIGN. A record never wraps, the tail of the ring is skipped instead.
+ */
 struct drb_item {
-    void *data;
-    int size;
     struct timespec creation_time;
+    int size;           // Size of data
+    int len;            // Size of the whole record in the ring
+    char data[] __attribute__((aligned(DRB_ALIGN)));
 };
 
 struct delaying_ring_buffer {
-    struct drb_item *storage;
-    int writer_idx;
+    char *storage;
+    int writer_idx;     // Byte offsets into storage
     int reader_idx;
-    int capacity;
+    int data_end;       // Records end here before the writer wraps to the start
+    int used;           // Bytes of records, plus the skipped tail if the writer has wrapped
+    int capacity;       // Bytes
     int delay_ms;
 };
 
@@ -37,4 +46,4 @@ int drb_put(struct delaying_ring_buffer *drb, const char *data, const int size);
 const struct drb_item *drb_look(struct delaying_ring_buffer *drb);
 int drb_pop(struct delaying_ring_buffer *drb);
 
-#endif
\ No newline at end of file
+#endif
@@ -24,6 +24,8 @@ struct tcp_listen_port {
     unsigned int pid;
     unsigned int port;
     unsigned int fd;
+    unsigned int uid;           // Owner of socket, only known from sock_diag
+    unsigned long ino;          // Inode of socket, 0 if unknown
     char comm[TASK_COMM_LEN];
 };
 
@@ -50,6 +52,8 @@ struct tcp_estab_comm {
 struct tcp_estab {
     int is_client;
     int te_comm_num;
+    unsigned int uid;
+    unsigned long ino;
     struct ip_addr local;
     struct ip_addr remote;
     struct tcp_estab_comm *te_comm[TCP_ESTAB_COMM_MAX];
@@ -91,10 +95,17 @@ struct tcp_endpoints {
     struct tcp_endpoint *tep[TCP_ENDPOINT_MAX];
 };
 
+/*
+ * Sockets are dumped by NETLINK_SOCK_DIAG in the net namespace of caller and their owners are
+ * found by one scan of /proc/<pid>/fd, "ss" is only used if sock_diag is unavailable.
+ * get_netns_xxx() look into the net namespace of process pid instead(0: net namespace of caller).
+ */
 char is_listen_port(unsigned int port, struct tcp_listen_ports* tlps);
 struct tcp_listen_ports* get_listen_ports(void);
+struct tcp_listen_ports* get_netns_listen_ports(unsigned int pid);
 void free_listen_ports(struct tcp_listen_ports** ptlps);
 struct tcp_estabs* get_estab_tcps(struct tcp_listen_ports* tlps);
+struct tcp_estabs* get_netns_estab_tcps(struct tcp_listen_ports* tlps, unsigned int pid);
 void free_estab_tcps(struct tcp_estabs** ptes);
 struct tcp_endpoints *get_tcp_endpoints(struct tcp_listen_ports* tlps, struct tcp_estabs* tes);
 void free_tcp_endpoints(struct tcp_endpoints **pteps);
@@ -38,6 +38,7 @@
 #include "flowtracer_reader.h"
 #include "connect.h"
 #include "protocol/expose/protocol_parser.h"
+#include "protocol/utils/l7_mem.h"
 #include "data_stream.h"
 #include "l7_common.h"
 #include "conn_tracker.h"
@@ -47,6 +48,11 @@
 #define L7_TBL_RPC      "l7_rpc"
 #define L7_TBL_RPC_API  "l7_rpc_api"
 
+#define __L7_LINK_MAX   (4 * 1024)
+
+// Cluster IP lookups(conntrack, FlowTracer) keep global state, serialize them among workers.
+static pthread_mutex_t g_transform_lock = PTHREAD_MUTEX_INITIALIZER;
+
 
 const char *proto_name[PROTO_MAX] = {
     "unknown",
@@ -81,13 +87,13 @@ static void destroy_tracker_record(struct conn_tracker_s* tracker)
         tracker->records.api_stats = NULL;
     }
 
-    for (int i = 0; i < tracker->records.record_buf_size && i < RECORD_BUF_SIZE; i++) {
+    for (size_t i = 0; i < tracker->records.record_buf_size; i++) {
         if (tracker->records.records[i] != NULL) {
             free_record_data(tracker->protocol, tracker->records.records[i]);
             tracker->records.records[i] = NULL;
         }
     }
-    tracker->records.record_buf_size = 0;
+    record_buf_reset_records(&tracker->records);
     tracker->records.err_count = 0;
     tracker->records.req_count = 0;
     tracker->records.resp_count = 0;
@@ -99,6 +105,7 @@ static void destroy_tracker_record(struct conn_tracker_s* tracker)
 static void destroy_conn_tracker(struct conn_tracker_s* tracker)
 {
     destroy_tracker_record(tracker);
+    record_buf_release(&tracker->records);
     deinit_data_stream(&(tracker->send_stream));
     deinit_data_stream(&(tracker->recv_stream));
     free(tracker);
@@ -122,17 +129,17 @@ static struct conn_tracker_s* create_conn_tracker(const struct tracker_id_s *id)
     return tracker;
 }
 
-static struct conn_tracker_s* lkup_conn_tracker(struct l7_mng_s *l7_mng, const struct tracker_id_s *id)
+static struct conn_tracker_s* lkup_conn_tracker(struct l7_worker_s *worker, const struct tracker_id_s *id)
 {
     struct conn_tracker_s* tracker = NULL;
 
-    H_FIND(l7_mng->trackers, id, sizeof(struct tracker_id_s), tracker);
+    H_FIND(worker->trackers, id, sizeof(struct tracker_id_s), tracker);
     return tracker;
 }
 
-static struct conn_tracker_s* add_conn_tracker(struct l7_mng_s *l7_mng, const struct tracker_id_s *id)
+static struct conn_tracker_s* add_conn_tracker(struct l7_worker_s *worker, const struct tracker_id_s *id)
 {
-    struct conn_tracker_s* tracker = lkup_conn_tracker(l7_mng, id);
+    struct conn_tracker_s* tracker = lkup_conn_tracker(worker, id);
     if (tracker) {
         return tracker;
     }
@@ -142,7 +149,7 @@ static struct conn_tracker_s* add_conn_tracker(struct l7_mng_s *l7_mng, const st
         return NULL;
     }
 
-    H_ADD_KEYPTR(l7_mng->trackers, &new_tracker->id, sizeof(struct tracker_id_s), new_tracker);
+    H_ADD_KEYPTR(worker->trackers, &new_tracker->id, sizeof(struct tracker_id_s), new_tracker);
     return new_tracker;
 }
 
@@ -238,11 +245,11 @@ static struct l7_link_s* create_l7_link(const struct l7_link_id_s *id)
     return link;
 }
 
-static struct l7_link_s* lkup_l7_link(struct l7_mng_s *l7_mng, const struct l7_link_id_s *id)
+static struct l7_link_s* lkup_l7_link(struct l7_link_s *l7_links, const struct l7_link_id_s *id)
 {
     struct l7_link_s* link = NULL;
 
-    H_FIND(l7_mng->l7_links, id, sizeof(struct l7_link_id_s), link);
+    H_FIND(l7_links, id, sizeof(struct l7_link_id_s), link);
     return link;
 }
 
@@ -253,7 +260,7 @@ static void __init_l7_link_info(struct l7_link_s* link, const struct conn_tracke
     return;
 }
 
-static struct l7_link_s* add_l7_link(struct l7_mng_s *l7_mng, const struct conn_tracker_s* tracker)
+static struct l7_link_s* add_l7_link(struct l7_worker_s *worker, const struct conn_tracker_s* tracker)
 {
     struct l7_link_id_s l7_link_id = {0};
 
@@ -264,14 +271,13 @@ static struct l7_link_s* add_l7_link(struct l7_mng_s *l7_mng, const struct conn_
     (void)memcpy(&(l7_link_id.client_addr), &(tracker->open_info.client_addr), sizeof(struct conn_addr_s));
     (void)memcpy(&(l7_link_id.server_addr), &(tracker->open_info.server_addr), sizeof(struct conn_addr_s));
 
-    struct l7_link_s* link = lkup_l7_link(l7_mng, (const struct l7_link_id_s *)&l7_link_id);
+    struct l7_link_s* link = lkup_l7_link(worker->l7_links, (const struct l7_link_id_s *)&l7_link_id);
     if (link) {
         link->stats[OPEN_EVT]++;
         return link;
     }
 
-#define __L7_LINK_MAX (4 * 1024)
-    if (l7_mng->l7_links_capability >= __L7_LINK_MAX) {
+    if (worker->l7_links_capability >= __L7_LINK_MAX) {
         ERROR("[L7PROBE]: Create 'l7_link' failed(upper to limited).\n");
         return NULL;
     }
@@ -285,12 +291,12 @@ static struct l7_link_s* add_l7_link(struct l7_mng_s *l7_mng, const struct conn_
     __init_l7_link_info(new_link, tracker);
     new_link->last_rcv_data = time(NULL);
 
-    H_ADD_KEYPTR(l7_mng->l7_links, &new_link->id, sizeof(struct l7_link_id_s), new_link);
-    l7_mng->l7_links_capability++;
+    H_ADD_KEYPTR(worker->l7_links, &new_link->id, sizeof(struct l7_link_id_s), new_link);
+    worker->l7_links_capability++;
     return new_link;
 }
 
-static struct l7_link_s* find_l7_link(struct l7_mng_s *l7_mng, const struct conn_tracker_s* tracker)
+static struct l7_link_s* find_l7_link(struct l7_worker_s *worker, const struct conn_tracker_s* tracker)
 {
     struct l7_link_id_s l7_link_id = {0};
 
@@ -301,7 +307,7 @@ static struct l7_link_s* find_l7_link(struct l7_mng_s *l7_mng, const struct conn
     l7_link_id.l7_role = tracker->l7_role;
     l7_link_id.protocol = tracker->protocol;
 
-    return lkup_l7_link(l7_mng, (const struct l7_link_id_s *)&l7_link_id);
+    return lkup_l7_link(worker->l7_links, (const struct l7_link_id_s *)&l7_link_id);
 }
 
 static struct l7_api_statistic_s* create_l7_api_statistic(const struct api_stats_id id)
@@ -317,7 +323,7 @@ static struct l7_api_statistic_s* create_l7_api_statistic(const struct api_stats
     return l7_api_statistic;
 }
 
-static void transform_cluster_ip(struct l7_mng_s *l7_mng, struct conn_tracker_s* tracker)
+static void __transform_cluster_ip(struct l7_mng_s *l7_mng, struct conn_tracker_s* tracker)
 {
     int transform = ADDR_TRANSFORM_NONE;
 
@@ -387,7 +393,18 @@ static void transform_cluster_ip(struct l7_mng_s *l7_mng, struct conn_tracker_s*
     return;
 }
 
-static int proc_conn_ctl_msg(struct l7_mng_s *l7_mng, struct conn_ctl_s *conn_ctl_msg)
+static void transform_cluster_ip(struct l7_mng_s *l7_mng, struct conn_tracker_s* tracker)
+{
+    if (l7_mng->ipc_body.probe_param.cluster_ip_backend == 0) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&g_transform_lock);
+    __transform_cluster_ip(l7_mng, tracker);
+    (void)pthread_mutex_unlock(&g_transform_lock);
+}
+
+static int proc_conn_ctl_msg(struct l7_worker_s *worker, struct conn_ctl_s *conn_ctl_msg)
 {
     struct conn_tracker_s* tracker;
     struct tracker_id_s tracker_id = {0};
@@ -398,7 +415,7 @@ static int proc_conn_ctl_msg(struct l7_mng_s *l7_mng, struct conn_ctl_s *conn_ct
     switch(conn_ctl_msg->type) {
         case CONN_EVT_OPEN:
         {
-            tracker = add_conn_tracker(l7_mng, (const struct tracker_id_s *)&tracker_id);
+            tracker = add_conn_tracker(worker, (const struct tracker_id_s *)&tracker_id);
             if (tracker) {
                 /* Reinit conn_tracker when it is reused */
                 if (tracker->inactive) {
@@ -420,7 +437,7 @@ static int proc_conn_ctl_msg(struct l7_mng_s *l7_mng, struct conn_ctl_s *conn_ct
                             &(conn_ctl_msg->open.client_addr), sizeof(struct conn_addr_s));
 
                     // Transform K8S cluster IP to backend IP.
-                    transform_cluster_ip(l7_mng, tracker);
+                    transform_cluster_ip(worker->l7_mng, tracker);
 
                     // Client port just used for cluster IP address translation. Here, client port MUST set 0.
                     tracker->open_info.client_addr.port = 0;
@@ -439,7 +456,7 @@ static int proc_conn_ctl_msg(struct l7_mng_s *l7_mng, struct conn_ctl_s *conn_ct
         }
         case CONN_EVT_CLOSE:
         {
-            tracker = lkup_conn_tracker(l7_mng, (const struct tracker_id_s *)&tracker_id);
+            tracker = lkup_conn_tracker(worker, (const struct tracker_id_s *)&tracker_id);
             if (tracker) {
                 tracker->inactive = 1;
             }
@@ -454,7 +471,7 @@ static int proc_conn_ctl_msg(struct l7_mng_s *l7_mng, struct conn_ctl_s *conn_ct
     return 0;
 }
 
-static int proc_conn_stats_msg(struct l7_mng_s *l7_mng, struct conn_stats_s *conn_stats_msg)
+static int proc_conn_stats_msg(struct l7_worker_s *worker, struct conn_stats_s *conn_stats_msg)
 {
     struct conn_tracker_s* tracker;
     struct l7_link_s* link;
@@ -463,16 +480,16 @@ static int proc_conn_stats_msg(struct l7_mng_s *l7_mng, struct conn_stats_s *con
     tracker_id.fd = conn_stats_msg->conn_id.fd;
     tracker_id.tgid = conn_stats_msg->conn_id.tgid;
 
-    tracker = lkup_conn_tracker(l7_mng, (const struct tracker_id_s *)&tracker_id);
-    if (tracker->protocol == PROTO_UNKNOW || tracker->l7_role == L7_UNKNOW) {
-        return 0;
-    }
+    tracker = lkup_conn_tracker(worker, (const struct tracker_id_s *)&tracker_id);
     if (tracker == NULL) {
         ERROR("[L7Probe]: Conn tracker[%d:%d] is not found when proc stats msg.\n", tracker_id.tgid, tracker_id.fd);
         return -1;
     }
+    if (tracker->protocol == PROTO_UNKNOW || tracker->l7_role == L7_UNKNOW) {
+        return 0;
+    }
 
-    link = find_l7_link(l7_mng, (const struct conn_tracker_s *)tracker);
+    link = find_l7_link(worker, (const struct conn_tracker_s *)tracker);
     if (link == NULL) {
         ERROR("[L7Probe]: Conn link[%d:%d] is not found when proc stats msg.\n", tracker_id.tgid, tracker_id.fd);
         return -1;
@@ -488,7 +505,7 @@ static int proc_conn_stats_msg(struct l7_mng_s *l7_mng, struct conn_stats_s *con
     return 0;
 }
 
-static int proc_conn_data_msg(struct l7_mng_s *l7_mng, struct conn_data_msg_s *conn_data_msg, char *conn_data_buf)
+static int proc_conn_data_msg(struct l7_worker_s *worker, struct conn_data_msg_s *conn_data_msg, char *conn_data_buf)
 {
     int ret = 0;
     struct conn_tracker_s* tracker;
@@ -497,7 +514,7 @@ static int proc_conn_data_msg(struct l7_mng_s *l7_mng, struct conn_data_msg_s *c
 
     tracker_id.fd = conn_data_msg->conn_id.fd;
     tracker_id.tgid = conn_data_msg->conn_id.tgid;
-    tracker = lkup_conn_tracker(l7_mng, (const struct tracker_id_s *)&tracker_id);
+    tracker = lkup_conn_tracker(worker, (const struct tracker_id_s *)&tracker_id);
     if (tracker == NULL) {
         ERROR("[L7Probe]: Conn tracker[%d:%d] is not found when proc data msg.\n", tracker_id.tgid, tracker_id.fd);
         return -1;
@@ -514,7 +531,7 @@ static int proc_conn_data_msg(struct l7_mng_s *l7_mng, struct conn_data_msg_s *c
         tracker->l7_role = conn_data_msg->l7_role;
     }
 
-    link = add_l7_link(l7_mng, (const struct conn_tracker_s *)tracker);
+    link = add_l7_link(worker, (const struct conn_tracker_s *)tracker);
     if (link == NULL) {
         return -1;
     }
@@ -576,7 +593,7 @@ static void add_tracker_l7_stats(struct bucket_range_s bucket_range[], struct co
         statistic->stats[SERVER_ERR_COUNT] += item->server_err_count;
 
         // Put latency into buckets
-        for (int i = 0; i < item->record_buf_size && i < RECORD_BUF_SIZE; i++) {
+        for (size_t i = 0; i < item->record_buf_size; i++) {
             if (item->records[i]) {
                 statistic->latency_sum += item->records[i]->latency;
                 ret = histo_bucket_add_value(bucket_range, &statistic->latency_buckets, __MAX_LT_RANGE, item->records[i]->latency);
@@ -588,7 +605,7 @@ static void add_tracker_l7_stats(struct bucket_range_s bucket_range[], struct co
     }
 }
 
-static void add_tracker_stats(struct l7_mng_s *l7_mng, struct conn_tracker_s* tracker)
+static void add_tracker_stats(struct l7_worker_s *worker, struct conn_tracker_s* tracker)
 {
     int ret;
     struct l7_link_s* link;
@@ -596,7 +613,7 @@ static void add_tracker_stats(struct l7_mng_s *l7_mng, struct conn_tracker_s* tr
     if (tracker->records.record_buf_size == 0 && tracker->records.req_count == 0 && tracker->records.resp_count == 0) {
         return;
     }
-    link = find_l7_link(l7_mng, (const struct conn_tracker_s *)tracker);
+    link = find_l7_link(worker, (const struct conn_tracker_s *)tracker);
     if (link == NULL) {
         return;
     }
@@ -605,10 +622,10 @@ static void add_tracker_stats(struct l7_mng_s *l7_mng, struct conn_tracker_s* tr
     link->stats[RSP_COUNT] += tracker->records.resp_count;
     link->stats[ERR_COUNT] += tracker->records.err_count;
 
-    for (int i = 0; i < tracker->records.record_buf_size && i < RECORD_BUF_SIZE; i++) {
+    for (size_t i = 0; i < tracker->records.record_buf_size; i++) {
         if (tracker->records.records[i]) {
             link->latency_sum += tracker->records.records[i]->latency;
-            ret = histo_bucket_add_value(l7_mng->latency_buckets, &link->latency_buckets,
+            ret = histo_bucket_add_value(worker->l7_mng->latency_buckets, &link->latency_buckets,
                             __MAX_LT_RANGE, tracker->records.records[i]->latency);
             if (ret) {
                 ERROR("[L7PROBE] Failed to add latency to histo bucket, value: %lu\n", tracker->records.records[i]->latency);
@@ -617,11 +634,11 @@ static void add_tracker_stats(struct l7_mng_s *l7_mng, struct conn_tracker_s* tr
     }
 
     // add l7 api statistics
-    add_tracker_l7_stats(l7_mng->latency_buckets, tracker, link);
+    add_tracker_l7_stats(worker->l7_mng->latency_buckets, tracker, link);
     return;
 }
 
-static void l7_parser_tracker(struct l7_mng_s *l7_mng, struct conn_tracker_s* tracker)
+static void l7_parser_tracker(struct l7_worker_s *worker, struct conn_tracker_s* tracker)
 {
     enum message_type_t msg_type;
 
@@ -638,7 +655,7 @@ static void l7_parser_tracker(struct l7_mng_s *l7_mng, struct conn_tracker_s* tr
                        &tracker->records);
 
     // add stats
-    add_tracker_stats(l7_mng, tracker);
+    add_tracker_stats(worker, tracker);
     destroy_tracker_record(tracker);
 
     // pop frames
@@ -705,16 +722,8 @@ static char is_l7link_inactive(struct l7_link_s *link)
 
 static void aging_l7_stats(struct l7_mng_s *l7_mng)
 {
-    struct conn_tracker_s *tracker, *tmp_tracker;
     struct l7_link_s *link, *tmp;
 
-    H_ITER(l7_mng->trackers, tracker, tmp_tracker) {
-        if (tracker->inactive) {
-            H_DEL(l7_mng->trackers, tracker);
-            destroy_conn_tracker(tracker);
-        }
-    }
-
     H_ITER(l7_mng->l7_links, link, tmp) {
         if (is_l7link_inactive(link)) {
             H_DEL(l7_mng->l7_links, link);
@@ -724,6 +733,108 @@ static void aging_l7_stats(struct l7_mng_s *l7_mng)
     }
 }
 
+static void merge_l7_api_stats(struct l7_link_s *link, struct l7_api_statistic_s *src)
+{
+    struct l7_api_statistic_s *statistic;
+
+    H_FIND(link->l7_statistic, &(src->id), sizeof(struct api_stats_id), statistic);
+    if (statistic == NULL) {
+        statistic = create_l7_api_statistic(src->id);
+        if (statistic == NULL) {
+            return;
+        }
+        H_ADD_KEYPTR(link->l7_statistic, &(statistic->id), sizeof(struct api_stats_id), statistic);
+    }
+
+    for (int i = 0; i < __MAX_STATS; i++) {
+        statistic->stats[i] += src->stats[i];
+    }
+    statistic->latency_sum += src->latency_sum;
+    (void)histo_bucket_merge(&statistic->latency_buckets, &src->latency_buckets, __MAX_LT_RANGE);
+}
+
+static void merge_l7_link(struct l7_mng_s *l7_mng, struct l7_link_s *src)
+{
+    struct l7_link_s *link;
+    struct l7_api_statistic_s *item, *tmp;
+
+    link = lkup_l7_link(l7_mng->l7_links, (const struct l7_link_id_s *)&(src->id));
+    if (link == NULL) {
+        if (l7_mng->l7_links_capability >= __L7_LINK_MAX) {
+            ERROR("[L7PROBE]: Merge 'l7_link' failed(upper to limited).\n");
+            return;
+        }
+        link = create_l7_link((const struct l7_link_id_s *)&(src->id));
+        if (link == NULL) {
+            return;
+        }
+        link->l7_info = src->l7_info;
+        H_ADD_KEYPTR(l7_mng->l7_links, &link->id, sizeof(struct l7_link_id_s), link);
+        l7_mng->l7_links_capability++;
+    }
+
+    for (int i = 0; i < __MAX_STATS; i++) {
+        if (i == LAST_BYTES_SENT || i == LAST_BYTES_RECV) {
+            link->stats[i] = (src->stats[i] != 0) ? src->stats[i] : link->stats[i];
+        } else {
+            link->stats[i] += src->stats[i];
+        }
+    }
+    link->latency_sum += src->latency_sum;
+    (void)histo_bucket_merge(&link->latency_buckets, &src->latency_buckets, __MAX_LT_RANGE);
+    if (src->last_rcv_data > link->last_rcv_data) {
+        link->last_rcv_data = src->last_rcv_data;
+    }
+
+    H_ITER(src->l7_statistic, item, tmp) {
+        merge_l7_api_stats(link, item);
+    }
+}
+
+/*
+ * Links of the same id may be in several workers(e.g. connections of one process sharded
+ * apart), their stats of this period are added up into l7_mng->l7_links, then reset in the
+ * worker. Inactive trackers and links of the worker are aged here as well.
+ */
+static void merge_l7_worker(struct l7_mng_s *l7_mng, struct l7_worker_s *worker)
+{
+    struct conn_tracker_s *tracker, *tmp_tracker;
+    struct l7_link_s *link, *tmp;
+
+    (void)pthread_mutex_lock(&worker->lock);
+    H_ITER(worker->l7_links, link, tmp) {
+        merge_l7_link(l7_mng, link);
+        if (is_l7link_inactive(link)) {
+            H_DEL(worker->l7_links, link);
+            destroy_l7_link(link);
+            worker->l7_links_capability--;
+        } else {
+            reset_link_stats(link);
+        }
+    }
+
+    H_ITER(worker->trackers, tracker, tmp_tracker) {
+        if (tracker->inactive) {
+            H_DEL(worker->trackers, tracker);
+            destroy_conn_tracker(tracker);
+        }
+    }
+    (void)pthread_mutex_unlock(&worker->lock);
+
+    l7_worker_trim(worker);
+    if (worker->dropped > 0) {
+        WARN("[L7PROBE]: L7 worker %u falls behind, %llu events discarded.\n", worker->id, worker->dropped);
+        worker->dropped = 0;
+    }
+}
+
+static void merge_l7_workers(struct l7_mng_s *l7_mng)
+{
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        merge_l7_worker(l7_mng, &(l7_mng->workers[i]));
+    }
+}
+
 static void calc_link_stats(struct l7_link_s *link, struct probe_params *probe_param)
 {
     link->err_ratio = link->stats[REQ_COUNT] == 0 ? 0.00f : (float)((float)link->stats[ERR_COUNT] / (float)link->stats[REQ_COUNT]);
@@ -938,6 +1049,7 @@ void report_l7(void *ctx)
         return;
     }
 
+    merge_l7_workers(l7_mng);
     calc_l7_stats(l7_mng);
     report_l7_stats(l7_mng);
     aging_l7_stats(l7_mng);
@@ -945,14 +1057,25 @@ void report_l7(void *ctx)
     return;
 }
 
+/* Workers must be stopped. */
 void destroy_trackers(void *ctx)
 {
     struct l7_mng_s *l7_mng = ctx;
+    struct l7_worker_s *worker;
     struct conn_tracker_s *tracker, *tmp;
+    struct l7_link_s *link, *tmp_link;
 
-    H_ITER(l7_mng->trackers, tracker, tmp) {
-        H_DEL(l7_mng->trackers, tracker);
-        destroy_conn_tracker(tracker);
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        worker = &(l7_mng->workers[i]);
+        H_ITER(worker->trackers, tracker, tmp) {
+            H_DEL(worker->trackers, tracker);
+            destroy_conn_tracker(tracker);
+        }
+        H_ITER(worker->l7_links, link, tmp_link) {
+            H_DEL(worker->l7_links, link);
+            destroy_l7_link(link);
+        }
+        worker->l7_links_capability = 0;
     }
 }
 
@@ -967,10 +1090,36 @@ void destroy_links(void *ctx)
     }
 }
 
+static void destroy_unprobed_worker(struct l7_worker_s *worker, int proc_map_fd)
+{
+    struct conn_tracker_s *tracker, *tmp_tracker;
+    struct l7_link_s *link, *tmp_link;
+    struct obj_ref_s val = {0};
+    struct proc_s proc = {0};
+
+    (void)pthread_mutex_lock(&worker->lock);
+    H_ITER(worker->trackers, tracker, tmp_tracker) {
+        proc.proc_id = tracker->id.tgid;
+        if (bpf_map_lookup_elem(proc_map_fd, &proc, &val) < 0) {
+            H_DEL(worker->trackers, tracker);
+            destroy_conn_tracker(tracker);
+        }
+    }
+
+    H_ITER(worker->l7_links, link, tmp_link) {
+        proc.proc_id = link->id.tgid;
+        if (bpf_map_lookup_elem(proc_map_fd, &proc, &val) < 0) {
+            H_DEL(worker->l7_links, link);
+            destroy_l7_link(link);
+            worker->l7_links_capability--;
+        }
+    }
+    (void)pthread_mutex_unlock(&worker->lock);
+}
+
 void destroy_unprobed_trackers_links(void *ctx)
 {
     struct l7_mng_s *l7_mng = ctx;
-    struct conn_tracker_s *tracker, *tmp_tracker;
     struct l7_link_s *link, *tmp_link;
     struct obj_ref_s val = {0};
     struct proc_s proc = {0};
@@ -980,12 +1129,8 @@ void destroy_unprobed_trackers_links(void *ctx)
         return;
     }
 
-    H_ITER(l7_mng->trackers, tracker, tmp_tracker) {
-        proc.proc_id = tracker->id.tgid;
-        if (bpf_map_lookup_elem(proc_map_fd, &proc, &val) < 0) {
-            H_DEL(l7_mng->trackers, tracker);
-            destroy_conn_tracker(tracker);
-        }
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        destroy_unprobed_worker(&(l7_mng->workers[i]), proc_map_fd);
     }
 
     H_ITER(l7_mng->l7_links, link, tmp_link) {
@@ -998,88 +1143,147 @@ void destroy_unprobed_trackers_links(void *ctx)
     }
 }
 
-void l7_parser(void *ctx)
+/* Called by worker thread with worker->lock held. */
+void l7_worker_parse(struct l7_worker_s *worker)
 {
-    struct l7_mng_s *l7_mng = ctx;
     struct conn_tracker_s *tracker, *tmp;
 
-    H_ITER(l7_mng->trackers, tracker, tmp) {
-        l7_parser_tracker(l7_mng, tracker);
+    H_ITER(worker->trackers, tracker, tmp) {
+        l7_parser_tracker(worker, tracker);
     }
+
+    // Records of all trackers have been destroyed, release them in bulk.
+    l7_mem_cycle_reset();
+}
+
+/* Hand over the events dispatched so far, and let workers parse their trackers. */
+void l7_parser(void *ctx)
+{
+    struct l7_mng_s *l7_mng = ctx;
+
+    l7_workers_kick(l7_mng, 1);
 }
 
 int tracker_msg(void *ctx, void *data, u32 size)
 {
     struct l7_mng_s *l7_mng = ctx;
     if (drb_put(l7_mng->drb, data, size)) {
-        WARN("[L7PROBE] Not enough space to put event into the ring buffer. Event is discarded.\n");
+        // Reported periodically with the kernel buffer counters, see report_l7_pb().
+        l7_mng->drb_dropped++;
     }
     return 0;
 }
 
-int tracker_msg_continue(void *ctx, void *data, u32 size)
+/* Returns size of the tracker msg at p and its conn id, or 0 if the msg is invalid. */
+static size_t get_tracker_msg(char *p, int remain_size, struct conn_id_s **conn_id)
 {
-    char *p = data;
-    struct l7_mng_s *l7_mng  = ctx;
-    int remain_size = (int)size, step_size = 0, offset = 0;
-    size_t walk_size = 0;
-    enum tracker_evt_e *evt;
+    enum tracker_evt_e *evt = (enum tracker_evt_e *)p;
     struct conn_data_msg_s *conn_data_msg;
-    char *conn_data_buf;
+    size_t walk_size;
 
-    step_size = min(sizeof(struct conn_stats_s), sizeof(struct conn_ctl_s));
-    step_size = min(step_size, sizeof(struct conn_data_msg_s));
-
-    do {
-        if (remain_size < step_size) {
-            break;
+    switch (*evt) {
+        case TRACKER_EVT_STATS:
+        {
+            if (remain_size < sizeof(struct conn_stats_s)) {
+                ERROR("[L7Probe]: Invalid conn tracker stats msg.\n");
+                return 0;
+            }
+            *conn_id = &(((struct conn_stats_s *)p)->conn_id);
+            return sizeof(struct conn_stats_s);
         }
+        case TRACKER_EVT_CTRL:
+        {
+            if (remain_size < sizeof(struct conn_ctl_s)) {
+                ERROR("[L7Probe]: Invalid conn tracker ctrl msg.\n");
+                return 0;
+            }
+            *conn_id = &(((struct conn_ctl_s *)p)->conn_id);
+            return sizeof(struct conn_ctl_s);
+        }
+        case TRACKER_EVT_DATA:
+        {
+            if (remain_size < sizeof(struct conn_data_msg_s)) {
+                ERROR("[L7Probe]: Invalid conn tracker data msg.\n");
+                return 0;
+            }
+            conn_data_msg = (struct conn_data_msg_s *)p;
+            walk_size = sizeof(struct conn_data_msg_s) + conn_data_msg->payload_size;
+            if (walk_size > (size_t)remain_size) {
+                ERROR("[L7Probe]: Invalid conn tracker data msg.\n");
+                return 0;
+            }
+            *conn_id = &(conn_data_msg->conn_id);
+            return walk_size;
+        }
+        default:
+        {
+            ERROR("[L7Probe]: Unknown conn tracker msg.\n");
+            return 0;
+        }
+    }
+}
 
-        p = (char *)data + offset;
+#define TRACKER_MSG_MIN_SIZE \
+    min(min(sizeof(struct conn_stats_s), sizeof(struct conn_ctl_s)), sizeof(struct conn_data_msg_s))
+
+/* Called by worker thread with worker->lock held, msgs are checked by tracker_msg_continue(). */
+void l7_worker_proc_msgs(struct l7_worker_s *worker, char *data, u32 size)
+{
+    char *p;
+    int remain_size = (int)size, offset = 0;
+    size_t walk_size;
+    struct conn_id_s *conn_id;
+    struct conn_data_msg_s *conn_data_msg;
+
+    while (remain_size >= TRACKER_MSG_MIN_SIZE) {
+        p = data + offset;
+        walk_size = get_tracker_msg(p, remain_size, &conn_id);
+        if (walk_size == 0) {
+            return;
+        }
 
-        evt = (enum tracker_evt_e *)p;
-        switch (*evt) {
+        switch (*(enum tracker_evt_e *)p) {
             case TRACKER_EVT_STATS:
-            {
-                if (remain_size < sizeof(struct conn_stats_s)) {
-                    ERROR("[L7Probe]: Invalid conn tracker stats msg.\n");
-                    return 0;
-                }
-                (void)proc_conn_stats_msg(l7_mng, (struct conn_stats_s *)p);
-                walk_size = sizeof(struct conn_stats_s);
+                (void)proc_conn_stats_msg(worker, (struct conn_stats_s *)p);
                 break;
-            }
             case TRACKER_EVT_CTRL:
-            {
-                if (remain_size < sizeof(struct conn_ctl_s)) {
-                    ERROR("[L7Probe]: Invalid conn tracker ctrl msg.\n");
-                    return 0;
-                }
-                (void)proc_conn_ctl_msg(l7_mng, (struct conn_ctl_s *)p);
-                walk_size = sizeof(struct conn_ctl_s);
+                (void)proc_conn_ctl_msg(worker, (struct conn_ctl_s *)p);
                 break;
-            }
             case TRACKER_EVT_DATA:
-            {
-                if (remain_size < sizeof(struct conn_data_msg_s)) {
-                    ERROR("[L7Probe]: Invalid conn tracker data msg.\n");
-                    return 0;
-                }
                 conn_data_msg = (struct conn_data_msg_s *)p;
-                conn_data_buf = p + sizeof(struct conn_data_msg_s);
-                (void)proc_conn_data_msg(l7_mng, conn_data_msg, conn_data_buf);
-                walk_size = sizeof(struct conn_data_msg_s) + conn_data_msg->payload_size;
+                (void)proc_conn_data_msg(worker, conn_data_msg, p + sizeof(struct conn_data_msg_s));
                 break;
-            }
             default:
-            {
-                ERROR("[L7Probe]: Unknown conn tracker msg.\n");
-                return 0;
-            }
+                return;
+        }
+
+        offset += walk_size;
+        remain_size -= walk_size;
+    }
+}
+
+/* Dispatch the msgs to the workers owning their trackers. */
+int tracker_msg_continue(void *ctx, void *data, u32 size)
+{
+    char *p;
+    struct l7_mng_s *l7_mng  = ctx;
+    int remain_size = (int)size, offset = 0;
+    size_t walk_size;
+    struct conn_id_s *conn_id;
+    struct l7_worker_s *worker;
+
+    while (remain_size >= TRACKER_MSG_MIN_SIZE) {
+        p = (char *)data + offset;
+        walk_size = get_tracker_msg(p, remain_size, &conn_id);
+        if (walk_size == 0) {
+            return 0;
         }
 
+        worker = l7_worker_of(l7_mng, conn_id->tgid, conn_id->fd);
+        (void)l7_worker_put(worker, p, (u32)walk_size);
+
         offset += walk_size;
         remain_size -= walk_size;
-    } while (1);
+    }
     return 0;
 }
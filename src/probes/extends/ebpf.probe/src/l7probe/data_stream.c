@@ -18,6 +18,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "protocol/expose/protocol_parser.h"
+#include "protocol/utils/l7_mem.h"
 #include "data_stream.h"
 
 
@@ -26,11 +27,64 @@ static void destroy_frame_data(enum proto_type_t type, struct frame_data_s* fram
     free_frame_data_s(type, frame_data);
 }
 
+static size_t next_slots_size(size_t slots_size, size_t max_size)
+{
+    size_t new_size = (slots_size == 0) ? __BUF_SLOTS_INIT_SIZE : slots_size * 2;
+
+    return (new_size > max_size) ? max_size : new_size;
+}
+
+/*
+ * Make room for one more frame at the tail. Pending frames are moved back to the start of slots when
+ * at least half of the slots were popped, which costs no more than those pops, otherwise slots are doubled.
+ */
+static int reserve_frame_slot(struct frame_buf_s *frame_buf)
+{
+    size_t offset = (size_t)(frame_buf->frames - frame_buf->slots);
+    size_t new_size;
+    struct frame_data_s **slots;
+
+    if (offset + frame_buf->frame_buf_size < frame_buf->slots_size) {
+        return 0;
+    }
+    if (frame_buf->frame_buf_size >= __FRAME_BUF_SIZE) {
+        return -1;
+    }
+
+    if (offset > 0 && (offset >= frame_buf->slots_size / 2 || frame_buf->slots_size >= __FRAME_BUF_SIZE)) {
+        (void)memmove(frame_buf->slots, frame_buf->frames, frame_buf->frame_buf_size * sizeof(struct frame_data_s *));
+        frame_buf->frames = frame_buf->slots;
+        return 0;
+    }
+
+    new_size = next_slots_size(frame_buf->slots_size, __FRAME_BUF_SIZE);
+    slots = (struct frame_data_s **)realloc(frame_buf->slots, new_size * sizeof(struct frame_data_s *));
+    if (slots == NULL) {
+        return -1;
+    }
+    frame_buf->slots = slots;
+    frame_buf->slots_size = new_size;
+    frame_buf->frames = slots + offset;
+    return 0;
+}
+
+static void release_frame_slots(struct frame_buf_s *frame_buf, char force)
+{
+    if (force || frame_buf->slots_size > __BUF_SLOTS_INIT_SIZE) {
+        free(frame_buf->slots);
+        frame_buf->slots = NULL;
+        frame_buf->slots_size = 0;
+    }
+    frame_buf->frames = frame_buf->slots;
+    frame_buf->frame_buf_size = 0;
+    frame_buf->current_pos = 0;
+}
+
 static int push_frame_data(struct data_stream_s *data_stream, const struct frame_data_s* frame_data)
 {
     struct frame_buf_s *frame_buf = &(data_stream->frame_bufs);
 
-    if (frame_buf->frame_buf_size >= __FRAME_BUF_SIZE) {
+    if (reserve_frame_slot(frame_buf)) {
         return -1;
     }
 
@@ -41,12 +95,11 @@ static int push_frame_data(struct data_stream_s *data_stream, const struct frame
 
 struct api_stats* create_api_stats(char* api)
 {
-    struct api_stats* api_stats = (struct api_stats*) malloc(sizeof(struct api_stats));
+    struct api_stats* api_stats = (struct api_stats*) l7_mem_cycle_alloc(sizeof(struct api_stats));
     if (api_stats == NULL) {
         ERROR("Failed to malloc struct api_stats.\n");
         return NULL;
     }
-    memset(api_stats, 0, sizeof(struct api_stats));
     (void) snprintf(api_stats->id.api, MAX_API_LEN, "%s", api);
     return api_stats;
 }
@@ -56,10 +109,70 @@ void destroy_api_stats(struct api_stats *api_stats)
     struct api_stats *item, *tmp;
     H_ITER(api_stats, item, tmp) {
         H_DEL(api_stats, item);
-        free(item);
+        free(item->records);
+        free(item->err_records);
+        l7_mem_free(item);
     }
 }
 
+static int add_record_slot(struct record_data_s ***records, size_t *slots_size, size_t *used,
+                           struct record_data_s *record_data)
+{
+    size_t new_size;
+    struct record_data_s **slots;
+
+    if (*used >= *slots_size) {
+        if (*used >= RECORD_BUF_SIZE) {
+            return -1;
+        }
+        new_size = next_slots_size(*slots_size, RECORD_BUF_SIZE);
+        slots = (struct record_data_s **)realloc(*records, new_size * sizeof(struct record_data_s *));
+        if (slots == NULL) {
+            return -1;
+        }
+        *records = slots;
+        *slots_size = new_size;
+    }
+
+    (*records)[*used] = record_data;
+    (*used)++;
+    return 0;
+}
+
+int api_stats_add_record(struct api_stats *api_stats, struct record_data_s *record_data)
+{
+    return add_record_slot(&api_stats->records, &api_stats->records_slots_size, &api_stats->record_buf_size,
+                           record_data);
+}
+
+int api_stats_add_err_record(struct api_stats *api_stats, struct record_data_s *record_data)
+{
+    return add_record_slot(&api_stats->err_records, &api_stats->err_records_slots_size, &api_stats->err_count,
+                           record_data);
+}
+
+int record_buf_add_record(struct record_buf_s *record_buf, struct record_data_s *record_data)
+{
+    return add_record_slot(&record_buf->records, &record_buf->records_slots_size, &record_buf->record_buf_size,
+                           record_data);
+}
+
+void record_buf_reset_records(struct record_buf_s *record_buf)
+{
+    record_buf->record_buf_size = 0;
+    if (record_buf->records_slots_size > __BUF_SLOTS_INIT_SIZE) {
+        record_buf_release(record_buf);
+    }
+}
+
+void record_buf_release(struct record_buf_s *record_buf)
+{
+    free(record_buf->records);
+    record_buf->records = NULL;
+    record_buf->records_slots_size = 0;
+    record_buf->record_buf_size = 0;
+}
+
 static void destroy_raw_data(struct raw_data_s* raw_data)
 {
     (void)free(raw_data);
@@ -76,38 +189,64 @@ static struct raw_data_s* create_raw_data(size_t data_size)
     }
 
     raw_data->data_len = data_size;
+    raw_data->data_cap = data_size;
     return raw_data;
 }
 
-static int push_raw_data(struct data_stream_s *data_stream, const struct raw_data_s* raw_data)
+/* Same as reserve_frame_slot() */
+static int reserve_raw_slot(struct raw_buf_s *raw_buf)
 {
-    struct raw_buf_s *raw_buf = &(data_stream->raw_bufs);
+    size_t offset = (size_t)(raw_buf->raw_datas - raw_buf->slots);
+    size_t new_size;
+    struct raw_data_s **slots;
 
+    if (offset + raw_buf->raw_buf_size < raw_buf->slots_size) {
+        return 0;
+    }
     if (raw_buf->raw_buf_size >= __RAW_BUF_SIZE) {
-        ERROR("raw_buf->raw_buf_size = %u\n", raw_buf->raw_buf_size);
         return -1;
     }
 
-    raw_buf->raw_datas[raw_buf->raw_buf_size] = (struct raw_data_s *)raw_data;
-    raw_buf->raw_buf_size++;
+    if (offset > 0 && (offset >= raw_buf->slots_size / 2 || raw_buf->slots_size >= __RAW_BUF_SIZE)) {
+        (void)memmove(raw_buf->slots, raw_buf->raw_datas, raw_buf->raw_buf_size * sizeof(struct raw_data_s *));
+        raw_buf->raw_datas = raw_buf->slots;
+        return 0;
+    }
+
+    new_size = next_slots_size(raw_buf->slots_size, __RAW_BUF_SIZE);
+    slots = (struct raw_data_s **)realloc(raw_buf->slots, new_size * sizeof(struct raw_data_s *));
+    if (slots == NULL) {
+        return -1;
+    }
+    raw_buf->slots = slots;
+    raw_buf->slots_size = new_size;
+    raw_buf->raw_datas = slots + offset;
     return 0;
 }
 
-static struct raw_data_s* replace_top_raw_data(struct data_stream_s *data_stream, const struct raw_data_s* new_data)
+static void release_raw_slots(struct raw_buf_s *raw_buf, char force)
 {
-    struct raw_buf_s *raw_buf = &(data_stream->raw_bufs);
-
-    if (raw_buf->raw_buf_size == 0) {
-        return NULL;
+    if (force || raw_buf->slots_size > __BUF_SLOTS_INIT_SIZE) {
+        free(raw_buf->slots);
+        raw_buf->slots = NULL;
+        raw_buf->slots_size = 0;
     }
+    raw_buf->raw_datas = raw_buf->slots;
+    raw_buf->raw_buf_size = 0;
+}
 
-    struct raw_data_s* raw_data = raw_buf->raw_datas[0];
-    if (raw_data == NULL) {
-        return NULL;
+static int push_raw_data(struct data_stream_s *data_stream, const struct raw_data_s* raw_data)
+{
+    struct raw_buf_s *raw_buf = &(data_stream->raw_bufs);
+
+    if (reserve_raw_slot(raw_buf)) {
+        ERROR("raw_buf->raw_buf_size = %u\n", raw_buf->raw_buf_size);
+        return -1;
     }
 
-    raw_buf->raw_datas[0] = (struct raw_data_s *)new_data;
-    return raw_data;
+    raw_buf->raw_datas[raw_buf->raw_buf_size] = (struct raw_data_s *)raw_data;
+    raw_buf->raw_buf_size++;
+    return 0;
 }
 
 static struct raw_data_s* pop_raw_data(struct data_stream_s *data_stream)
@@ -123,11 +262,12 @@ static struct raw_data_s* pop_raw_data(struct data_stream_s *data_stream)
         return NULL;
     }
 
-    for (int i = 1; i < raw_buf->raw_buf_size && i < __RAW_BUF_SIZE; i++) {
-        raw_buf->raw_datas[i - 1] = raw_buf->raw_datas[i];
-    }
-    raw_buf->raw_datas[raw_buf->raw_buf_size - 1] = NULL;
+    raw_buf->raw_datas[0] = NULL;
+    raw_buf->raw_datas++;
     raw_buf->raw_buf_size--;
+    if (raw_buf->raw_buf_size == 0) {
+        release_raw_slots(raw_buf, 0);
+    }
     return raw_data;
 }
 
@@ -143,84 +283,80 @@ static struct raw_data_s* peek_raw_data(struct data_stream_s *data_stream)
     return raw_data;
 }
 
-static struct raw_data_s* __do_overlay_raw_data(const struct raw_data_s* dst_data, const struct raw_data_s* src_data)
+/*
+ * Append the fragment to the raw data in place. data[] grows geometrically, so a message which spans
+ * many bpf events is copied O(n) bytes in total, instead of copying all accumulated data per fragment.
+ */
+static struct raw_data_s* __do_overlay_raw_data(struct raw_data_s* dst_data, const struct raw_data_s* src_data)
 {
-    if (src_data->index < dst_data->index) {
-        return (struct raw_data_s*)dst_data;
-    }
-    char *p;
-    struct raw_data_s* new_raw_data;
-    size_t mem_size = dst_data->data_len + src_data->data_len + sizeof(struct raw_data_s);
+    struct raw_data_s* raw_data = dst_data;
+    size_t data_len = dst_data->data_len + src_data->data_len;
+    size_t data_cap = dst_data->data_cap;
 
-    new_raw_data = (struct raw_data_s *)malloc(mem_size);
-    if (new_raw_data == NULL) {
-        return NULL;
+    if (data_len > data_cap) {
+        data_cap = (data_cap * 2 > data_len) ? data_cap * 2 : data_len;
+        raw_data = (struct raw_data_s *)realloc(dst_data, sizeof(struct raw_data_s) + data_cap);
+        if (raw_data == NULL) {
+            return NULL;
+        }
+        raw_data->data_cap = data_cap;
     }
 
-    new_raw_data->data_len = mem_size - sizeof(struct raw_data_s);
-    new_raw_data->timestamp_ns = dst_data->timestamp_ns;
-    new_raw_data->current_pos = dst_data->current_pos;
-    new_raw_data->index = src_data->index;
-    new_raw_data->flags = 0;
-    new_raw_data->isBrokeData = 0;
-
-    p = new_raw_data->data;
-    (void)memcpy(p, dst_data->data, dst_data->data_len);
-
-    p += dst_data->data_len;
-    (void)memcpy(p, src_data->data, src_data->data_len);
-
-    return new_raw_data;
+    (void)memcpy(raw_data->data + raw_data->data_len, src_data->data, src_data->data_len);
+    raw_data->data_len = data_len;
+    raw_data->index = src_data->index;
+    raw_data->flags = 0;
+    raw_data->isBrokeData = 0;
+    return raw_data;
 }
 
 static int overlay_raw_data(struct data_stream_s *data_stream)
 {
-    struct raw_data_s *overlay_data, *poped_data, *replaced_data;
+    struct raw_data_s *dst_data, *src_data, *overlay_data;
     struct raw_buf_s *raw_buf = &(data_stream->raw_bufs);
 
     if (raw_buf->raw_buf_size < 2) {
         return -1;
     }
 
-    if ((raw_buf->raw_datas[0] == NULL) || (raw_buf->raw_datas[1] == NULL)) {
+    dst_data = raw_buf->raw_datas[0];
+    src_data = raw_buf->raw_datas[1];
+    if ((dst_data == NULL) || (src_data == NULL)) {
         return -1;
     }
 
-    overlay_data = __do_overlay_raw_data(raw_buf->raw_datas[0], raw_buf->raw_datas[1]);
-    if (overlay_data == NULL) {
-        return -1;
-    }
-
-    if ((overlay_data->index == raw_buf->raw_datas[0]->index) && (overlay_data->index > 0)) {
-        overlay_data->isBrokeData = 1;
+    // Fragment out of order, the message is left broken for the parser to skip.
+    if (src_data->index < dst_data->index) {
+        dst_data->isBrokeData = 1;
         return 0;
     }
 
-    // Pop and free 1st raw data
-    poped_data = pop_raw_data(data_stream);
-    if (poped_data) {
-        destroy_raw_data(poped_data);
-    }
-
-    // Replace and free 2nd raw data
-    replaced_data = replace_top_raw_data(data_stream, overlay_data);
-    if (replaced_data) {
-        destroy_raw_data(replaced_data);
-    } else {
-        destroy_raw_data(overlay_data);
+    overlay_data = __do_overlay_raw_data(dst_data, src_data);
+    if (overlay_data == NULL) {
+        return -1;
     }
 
+    // The 2nd raw data is consumed, the overlaid one takes its slot and the 1st slot is popped.
+    raw_buf->raw_datas[0] = NULL;
+    raw_buf->raw_datas[1] = overlay_data;
+    raw_buf->raw_datas++;
+    raw_buf->raw_buf_size--;
+    destroy_raw_data(src_data);
     return 0;
 }
 
 static void __do_pop_frames(enum proto_type_t type, struct frame_buf_s *frame_bufs)
 {
-    int start;
     struct frame_data_s *frame;
-    if (frame_bufs->current_pos == 0) {
+    size_t pop_num = frame_bufs->current_pos;
+
+    if (pop_num == 0) {
         return;
     }
-    for (int i = 0; i <= frame_bufs->current_pos - 1 && i < __FRAME_BUF_SIZE; i++) {
+    if (pop_num > frame_bufs->frame_buf_size) {
+        pop_num = frame_bufs->frame_buf_size;
+    }
+    for (size_t i = 0; i < pop_num; i++) {
         frame = frame_bufs->frames[i];
         if (frame) {
             destroy_frame_data(type, frame);
@@ -228,14 +364,12 @@ static void __do_pop_frames(enum proto_type_t type, struct frame_buf_s *frame_bu
         frame_bufs->frames[i] = NULL;
     }
 
-    start = 0;
-    for (int i = frame_bufs->current_pos; i < frame_bufs->frame_buf_size && i < __FRAME_BUF_SIZE && start < __FRAME_BUF_SIZE; i++) {
-        frame_bufs->frames[start++] = frame_bufs->frames[i];
-        frame_bufs->frames[i] = NULL;
-    }
-    frame_bufs->frame_buf_size -= frame_bufs->current_pos;
+    frame_bufs->frames += pop_num;
+    frame_bufs->frame_buf_size -= pop_num;
     frame_bufs->current_pos = 0;
-
+    if (frame_bufs->frame_buf_size == 0) {
+        release_frame_slots(frame_bufs, 0);
+    }
     return;
 }
 
@@ -255,25 +389,31 @@ void deinit_data_stream(struct data_stream_s *data_stream)
 {
     struct frame_data_s *frame_data;
 
-    for (int i = 0; i < data_stream->raw_bufs.raw_buf_size && i < __RAW_BUF_SIZE; i++) {
+    for (size_t i = 0; i < data_stream->raw_bufs.raw_buf_size; i++) {
         if (data_stream->raw_bufs.raw_datas[i] != NULL) {
             destroy_raw_data(data_stream->raw_bufs.raw_datas[i]);
             data_stream->raw_bufs.raw_datas[i] = NULL;
         }
     }
-    data_stream->raw_bufs.raw_buf_size = 0;
+    release_raw_slots(&(data_stream->raw_bufs), 1);
 
-    for (int i = 0; i < data_stream->frame_bufs.frame_buf_size && i < __FRAME_BUF_SIZE; i++) {
+    for (size_t i = 0; i < data_stream->frame_bufs.frame_buf_size; i++) {
         if (data_stream->frame_bufs.frames[i] != NULL) {
             frame_data = data_stream->frame_bufs.frames[i];
             destroy_frame_data(data_stream->type, frame_data);
             data_stream->frame_bufs.frames[i] = NULL;
         }
     }
-    data_stream->frame_bufs.frame_buf_size = 0;
+    release_frame_slots(&(data_stream->frame_bufs), 1);
     return;
 }
 
+size_t data_stream_mem_size(const struct data_stream_s *data_stream)
+{
+    return data_stream->raw_bufs.slots_size * sizeof(struct raw_data_s *) +
+           data_stream->frame_bufs.slots_size * sizeof(struct frame_data_s *);
+}
+
 enum parse_rslt_e {
     PARSE_NEXT = 0,
     PARSE_REBOUND,
@@ -198,5 +198,9 @@ void report_l7(void *ctx);
 int tracker_msg(void *ctx, void *data, u32 size);
 int tracker_msg_continue(void *ctx, void *data, u32 size);
 
+struct l7_worker_s;
+void l7_worker_proc_msgs(struct l7_worker_s *worker, char *data, u32 size);
+void l7_worker_parse(struct l7_worker_s *worker);
+
 #endif
 
@@ -56,13 +56,24 @@ struct frame_data_s {
 };
 
 /*
-  Used to cache L7 message frame from protocol parser
+  Slots of frame/raw/record buffers are allocated at first push and doubled on demand up to the max size,
+  and released again once the buffer is drained, so an idle connection holds no slots.
+*/
+#define __BUF_SLOTS_INIT_SIZE   16
+
+/*
+  Used to cache L7 message frame from protocol parser.
+  frames[0, frame_buf_size) are the pending frames, popping moves 'frames' forward inside 'slots' in O(1),
+  and pending frames are moved back to the start of 'slots' only when the tail is reached.
 */
 #define __FRAME_BUF_SIZE   (1024 * 10)
 struct frame_buf_s {
-    struct frame_data_s *frames[__FRAME_BUF_SIZE];
+    struct frame_data_s **frames;
     size_t frame_buf_size;
     size_t current_pos;
+
+    struct frame_data_s **slots;
+    size_t slots_size;
 };
 
 #define RAW_DATA_FLAGS_INVALID  (0x00000001)
@@ -74,6 +85,7 @@ struct raw_data_s {
     u32 flags;
     u64 timestamp_ns;
     size_t data_len;
+    size_t data_cap;    // Capacity of data[], only maintained for raw data cached in data stream
     u32 index;
     u32 isBrokeData;
 
@@ -107,25 +119,30 @@ struct api_stats {
     H_HANDLE;
     struct api_stats_id id;
 
-    struct record_data_s *records[RECORD_BUF_SIZE]; // maintain all records pointers for the api, in use of calculate latency by buckets
+    struct record_data_s **records; // maintain all records pointers for the api, in use of calculate latency by buckets
     size_t record_buf_size; // the amount of records for the api
+    size_t records_slots_size;
     size_t req_count;       // the amount of req for the api
     size_t resp_count;      // the amount of resp for the api
-    struct record_data_s *err_records[RECORD_BUF_SIZE]; // all error records pointers for the api
+    struct record_data_s **err_records; // all error records pointers for the api
     size_t err_count;           // error count，err_count = client_err_count + server_err_count
+    size_t err_records_slots_size;
     size_t client_err_count;    // client error count. For http：statusCode in [400,499]
     size_t server_err_count;    // server error count. For http: statusCode in [500,599]
 };
 
 struct api_stats* create_api_stats(char* api);
 void destroy_api_stats(struct api_stats *api_stats);
+int api_stats_add_record(struct api_stats *api_stats, struct record_data_s *record_data);
+int api_stats_add_err_record(struct api_stats *api_stats, struct record_data_s *record_data);
 
 /**
  * Records of matching request and response frames.
  */
 struct record_buf_s {
-    struct record_data_s *records[RECORD_BUF_SIZE];
+    struct record_data_s **records;
     size_t record_buf_size;
+    size_t records_slots_size;
 
     struct api_stats *api_stats;
 
@@ -136,13 +153,22 @@ struct record_buf_s {
     size_t msg_error_count; // protocol's msg error count for calculating error rate.
 };
 
+/* Returns -1 if the buffer already holds RECORD_BUF_SIZE records, the record is not taken then. */
+int record_buf_add_record(struct record_buf_s *record_buf, struct record_data_s *record_data);
+/* Forget all records(caller frees them before), slots are kept for the next period unless grown large. */
+void record_buf_reset_records(struct record_buf_s *record_buf);
+void record_buf_release(struct record_buf_s *record_buf);
+
 /*
-  Used to cache continuity data from bpf
+  Used to cache continuity data from bpf, managed the same way as frame_buf_s.
 */
 #define __RAW_BUF_SIZE   (50 * 10 * 5)
 struct raw_buf_s {
     size_t raw_buf_size;
-    struct raw_data_s *raw_datas[__RAW_BUF_SIZE];
+    struct raw_data_s **raw_datas;
+
+    struct raw_data_s **slots;
+    size_t slots_size;
 };
 
 /*
@@ -157,6 +183,8 @@ struct data_stream_s {
 
 int init_data_stream(struct data_stream_s *data_stream);
 void deinit_data_stream(struct data_stream_s *data_stream);
+/* Bytes of heap held by the data stream itself, raw data and frame contents excluded. */
+size_t data_stream_mem_size(const struct data_stream_s *data_stream);
 void data_stream_pop_frames(struct data_stream_s *data_stream);
 int data_stream_parse_frames(enum message_type_t msg_type, struct data_stream_s *data_stream);
 int data_stream_add_raw_data(struct data_stream_s *data_stream, const char *data, size_t data_len, u64 timestamp_ns, u32 index);
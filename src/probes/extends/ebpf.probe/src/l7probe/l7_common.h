@@ -20,6 +20,7 @@
 #include "filter.h"
 #include "connect.h"
 #include "conn_tracker.h"
+#include "l7_worker.h"
 
 
 #define LIBSSL_EBPF_PROG_MAX 256
@@ -57,12 +58,17 @@ struct l7_mng_s {
     struct filter_args_s filter_args;
     struct l7_ebpf_prog_s bpf_progs;
     struct l7_java_prog_s java_progs;
-    struct conn_tracker_s *trackers;
+    struct l7_worker_s *workers;    // Trackers are sharded to workers
+    u32 worker_num;
     struct bucket_range_s latency_buckets[__MAX_LT_RANGE];
-    struct l7_link_s *l7_links;
+    struct l7_link_s *l7_links;     // Merged from links of all workers at report time
     struct conn_data_s conn_data;
     struct java_proc_s *java_procs;
     struct delaying_ring_buffer *drb;
+    u64 drb_dropped;                // Events discarded since drb is full
+    int epoll_fd;                   // Kernel buffers of all bpf progs and the tick timer
+    int tick_fd;
+    time_t last_buffer_report;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-29
+ * Description: sharded L7 parsing workers
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "protocol/utils/l7_mem.h"
+#include "l7_common.h"
+#include "l7_worker.h"
+
+static void free_batches(struct l7_batch_s *batch)
+{
+    struct l7_batch_s *next;
+
+    while (batch != NULL) {
+        next = batch->next;
+        free(batch);
+        batch = next;
+    }
+}
+
+static void *l7_worker_thread(void *arg)
+{
+    struct l7_worker_s *worker = arg;
+    struct l7_batch_s *batches, *batch;
+    char parse, trim;
+
+    for (;;) {
+        (void)pthread_mutex_lock(&worker->q_lock);
+        while (worker->head == NULL && !worker->parse && !worker->trim && !worker->stop) {
+            (void)pthread_cond_wait(&worker->q_cond, &worker->q_lock);
+        }
+        if (worker->stop) {
+            (void)pthread_mutex_unlock(&worker->q_lock);
+            break;
+        }
+        batches = worker->head;
+        worker->head = worker->tail = NULL;
+        worker->pending = 0;
+        parse = worker->parse;
+        trim = worker->trim;
+        worker->parse = 0;
+        worker->trim = 0;
+        // Taken batches are always processed before anyone else gets the tables.
+        (void)pthread_mutex_lock(&worker->lock);
+        (void)pthread_mutex_unlock(&worker->q_lock);
+
+        for (batch = batches; batch != NULL; batch = batch->next) {
+            l7_worker_proc_msgs(worker, batch->data, batch->len);
+        }
+        if (parse) {
+            l7_worker_parse(worker);
+        }
+        (void)pthread_mutex_unlock(&worker->lock);
+
+        free_batches(batches);
+        // Memory pool is per thread, so it is trimmed by its owner.
+        if (trim) {
+            l7_mem_trim();
+        }
+    }
+    return NULL;
+}
+
+static u32 default_worker_num(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long num = cpus / 4;
+
+    if (num < 1) {
+        return 1;
+    }
+    return (num > L7_WORKER_MAX) ? L7_WORKER_MAX : (u32)num;
+}
+
+int l7_workers_create(struct l7_mng_s *l7_mng, u32 num)
+{
+    struct l7_worker_s *worker;
+
+    if (num == 0) {
+        num = default_worker_num();
+    }
+    if (num > L7_WORKER_MAX) {
+        num = L7_WORKER_MAX;
+    }
+
+    l7_mng->workers = (struct l7_worker_s *)calloc(num, sizeof(struct l7_worker_s));
+    if (l7_mng->workers == NULL) {
+        return -1;
+    }
+    l7_mng->worker_num = num;
+
+    for (u32 i = 0; i < num; i++) {
+        worker = &(l7_mng->workers[i]);
+        worker->id = i;
+        worker->l7_mng = l7_mng;
+        (void)pthread_mutex_init(&worker->q_lock, NULL);
+        (void)pthread_cond_init(&worker->q_cond, NULL);
+        (void)pthread_mutex_init(&worker->lock, NULL);
+        if (pthread_create(&worker->thd, NULL, l7_worker_thread, worker) != 0) {
+            ERROR("[L7PROBE]: Failed to create l7 worker thread %u.\n", i);
+            l7_workers_stop(l7_mng);
+            l7_workers_destroy(l7_mng);
+            return -1;
+        }
+        worker->running = 1;
+    }
+
+    INFO("[L7PROBE]: %u l7 workers started.\n", num);
+    return 0;
+}
+
+void l7_workers_stop(struct l7_mng_s *l7_mng)
+{
+    struct l7_worker_s *worker;
+
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        worker = &(l7_mng->workers[i]);
+        if (!worker->running) {
+            continue;
+        }
+        (void)pthread_mutex_lock(&worker->q_lock);
+        worker->stop = 1;
+        (void)pthread_cond_signal(&worker->q_cond);
+        (void)pthread_mutex_unlock(&worker->q_lock);
+        (void)pthread_join(worker->thd, NULL);
+        worker->running = 0;
+    }
+}
+
+/* Workers must be stopped, and their trackers and links destroyed already. */
+void l7_workers_destroy(struct l7_mng_s *l7_mng)
+{
+    struct l7_worker_s *worker;
+
+    if (l7_mng->workers == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        worker = &(l7_mng->workers[i]);
+        free_batches(worker->head);
+        free_batches(worker->batch);
+        (void)pthread_mutex_destroy(&worker->q_lock);
+        (void)pthread_cond_destroy(&worker->q_cond);
+        (void)pthread_mutex_destroy(&worker->lock);
+    }
+    free(l7_mng->workers);
+    l7_mng->workers = NULL;
+    l7_mng->worker_num = 0;
+}
+
+struct l7_worker_s *l7_worker_of(struct l7_mng_s *l7_mng, int tgid, int fd)
+{
+    u32 hash = (u32)tgid * 0x9E3779B1U ^ (u32)fd * 0x85EBCA6BU;
+
+    hash ^= hash >> 16;
+    return &(l7_mng->workers[hash % l7_mng->worker_num]);
+}
+
+static void __hand_over_batch(struct l7_worker_s *worker)
+{
+    struct l7_batch_s *batch = worker->batch;
+
+    if (batch == NULL) {
+        return;
+    }
+    worker->batch = NULL;
+
+    (void)pthread_mutex_lock(&worker->q_lock);
+    if (worker->pending + batch->len > L7_WORKER_PENDING_MAX) {
+        (void)pthread_mutex_unlock(&worker->q_lock);
+        worker->dropped += batch->events;
+        free(batch);
+        return;
+    }
+    if (worker->tail == NULL) {
+        worker->head = batch;
+    } else {
+        worker->tail->next = batch;
+    }
+    worker->tail = batch;
+    worker->pending += batch->len;
+    (void)pthread_cond_signal(&worker->q_cond);
+    (void)pthread_mutex_unlock(&worker->q_lock);
+}
+
+int l7_worker_put(struct l7_worker_s *worker, const char *msg, u32 size)
+{
+    struct l7_batch_s *batch = worker->batch;
+    u32 batch_size;
+
+    if (batch != NULL && batch->size - batch->len < size) {
+        __hand_over_batch(worker);
+        batch = NULL;
+    }
+
+    if (batch == NULL) {
+        batch_size = (size > L7_WORKER_BATCH_SIZE) ? size : L7_WORKER_BATCH_SIZE;
+        batch = (struct l7_batch_s *)malloc(sizeof(struct l7_batch_s) + batch_size);
+        if (batch == NULL) {
+            worker->dropped++;
+            return -1;
+        }
+        batch->next = NULL;
+        batch->events = 0;
+        batch->len = 0;
+        batch->size = batch_size;
+        worker->batch = batch;
+    }
+
+    (void)memcpy(batch->data + batch->len, msg, size);
+    batch->len += size;
+    batch->events++;
+    return 0;
+}
+
+void l7_worker_trim(struct l7_worker_s *worker)
+{
+    (void)pthread_mutex_lock(&worker->q_lock);
+    worker->trim = 1;
+    (void)pthread_cond_signal(&worker->q_cond);
+    (void)pthread_mutex_unlock(&worker->q_lock);
+}
+
+void l7_workers_kick(struct l7_mng_s *l7_mng, char parse)
+{
+    struct l7_worker_s *worker;
+
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        worker = &(l7_mng->workers[i]);
+        __hand_over_batch(worker);
+        if (parse) {
+            (void)pthread_mutex_lock(&worker->q_lock);
+            worker->parse = 1;
+            (void)pthread_cond_signal(&worker->q_cond);
+            (void)pthread_mutex_unlock(&worker->q_lock);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-29
+ * Description: sharded L7 parsing workers header
+ ******************************************************************************/
+#ifndef __L7_WORKER_H__
+#define __L7_WORKER_H__
+
+#pragma once
+
+#include <pthread.h>
+#include "common.h"
+
+#define L7_WORKER_MAX           8
+#define L7_WORKER_BATCH_SIZE    (64 * 1024)
+#define L7_WORKER_PENDING_MAX   (64 * 1024 * 1024)  // Bytes handed over but not processed by a worker yet
+
+struct l7_mng_s;
+struct conn_tracker_s;
+struct l7_link_s;
+
+/* Tracker messages copied back to back, in the same layout as they come from kernel. */
+struct l7_batch_s {
+    struct l7_batch_s *next;
+    u32 events;
+    u32 len;
+    u32 size;
+    char data[];
+};
+
+/*
+ * Events are sharded by tracker id(tgid, fd), so every tracker lives in exactly one worker and
+ * its frames are parsed and matched there without locking. Links are per worker too, and are
+ * merged by the main thread at report time.
+ */
+struct l7_worker_s {
+    u32 id;
+    char running;
+    char stop;                      // Following flags are protected by q_lock
+    char parse;                     // Parse the trackers after the handed over batches
+    char trim;                      // Trim the memory pool of the worker thread
+    pthread_t thd;
+    pthread_mutex_t q_lock;
+    pthread_cond_t q_cond;
+    struct l7_batch_s *head;        // Batches handed over to the worker, protected by q_lock
+    struct l7_batch_s *tail;
+    u64 pending;
+    u64 dropped;                    // Events dropped as the worker falls behind, touched by main thread only
+    struct l7_batch_s *batch;       // Batch being filled by main thread
+
+    pthread_mutex_t lock;           // Protects tables below, held by worker while processing
+    struct l7_mng_s *l7_mng;
+    struct conn_tracker_s *trackers;
+    struct l7_link_s *l7_links;
+    u32 l7_links_capability;
+};
+
+/* Start num workers, 0 for the default which depends on the number of cpus. */
+int l7_workers_create(struct l7_mng_s *l7_mng, u32 num);
+void l7_workers_stop(struct l7_mng_s *l7_mng);
+void l7_workers_destroy(struct l7_mng_s *l7_mng);
+
+/* Called by main thread only. */
+struct l7_worker_s *l7_worker_of(struct l7_mng_s *l7_mng, int tgid, int fd);
+int l7_worker_put(struct l7_worker_s *worker, const char *msg, u32 size);
+void l7_workers_kick(struct l7_mng_s *l7_mng, char parse);
+void l7_worker_trim(struct l7_worker_s *worker);
+
+#endif
@@ -22,6 +22,8 @@
 #include <sys/stat.h>
 #include <sched.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #ifdef BPF_PROG_KERN
 #undef BPF_PROG_KERN
@@ -32,6 +34,7 @@
 #endif
 
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "ipc.h"
 #include "syscall.h"
 #include "tcp.h"
@@ -43,8 +46,10 @@
 #include "histogram.h"
 
 #define RM_L7_MAP_PATH "/usr/bin/rm -rf /sys/fs/bpf/gala-gopher/__l7*"
-#define CAPACITY 4096 * 10 * 5
+#define CAPACITY (32 * 1024 * 1024)    // Bytes, data events are delayed in place
 #define DELAY_MS 500
+#define L7_TICK_MS 100
+#define L7_EPOLL_EVENTS_MAX 64
 
 volatile sig_atomic_t g_stop;
 static struct l7_mng_s g_l7_mng;
@@ -72,7 +77,7 @@ static void init_l7_historm_range(struct l7_mng_s *l7_mng)
     }
 }
 
-static void __do_l7_load_tcp_fd(int fd)
+static void __do_l7_load_tcp_fd(int fd, u32 pid)
 {
     int i, j;
     int role;
@@ -80,12 +85,13 @@ static void __do_l7_load_tcp_fd(int fd)
     struct tcp_estabs* tes = NULL;
     struct conn_id_s k;
 
-    tlps = get_listen_ports();
+    tlps = get_netns_listen_ports(pid);
     if (tlps == NULL) {
+        ERROR("[L7PROBE]: Get listen ports failed.(%u)\n", pid);
         goto err;
     }
 
-    tes = get_estab_tcps(tlps);
+    tes = get_netns_estab_tcps(tlps, pid);
     if (tes == NULL) {
         goto err;
     }
@@ -112,66 +118,37 @@ err:
     return;
 }
 
-static int do_l7_load_tcp_fd(int fd, int proc_id, int netns_fd)
+static int do_l7_load_tcp_fd(int fd, int proc_id)
 {
-    int ret;
-    bool is_container = false;
+    u32 pid = 0;
+
+    // Sockets of a container process are looked up in its net namespace.
     if (proc_id != 0 && is_container_proc(proc_id)) {
-        ret = enter_proc_netns(proc_id);
-        if (ret) {
-            ERROR("[L7PROBE]: Enter container netns failed.(%d, ret = %d)\n", proc_id, ret);
-            return ret;
-        }
-        is_container = true;
+        pid = (u32)proc_id;
     }
 
-    __do_l7_load_tcp_fd(fd);
-
-    if (is_container) {
-        (void)exit_container_netns(netns_fd);
-    }
+    __do_l7_load_tcp_fd(fd, pid);
     return 0;
 }
 
-static int get_netns_fd(pid_t pid)
-{
-    const char *fmt = "/proc/%d/ns/net";
-    char path[PATH_LEN];
-
-    path[0] = 0;
-    (void)snprintf(path, PATH_LEN, fmt, pid);
-    return open(path, O_RDONLY);
-}
-
 static void l7_unload_tcp_fd(struct l7_mng_s *l7_mng)
 {
-    struct conn_id_s connect_id = {0}, next_connect_id = {0};
-    while (bpf_map_get_next_key(l7_mng->bpf_progs.l7_tcp_fd, &connect_id, &next_connect_id) == 0) {
-        bpf_map_delete_elem(l7_mng->bpf_progs.l7_tcp_fd, &next_connect_id);
-        connect_id = next_connect_id;
-    }
+    (void)bpf_map_drain(l7_mng->bpf_progs.l7_tcp_fd, sizeof(struct conn_id_s), sizeof(int), NULL, NULL);
 }
 
 static int l7_load_tcp_fd(struct l7_mng_s *l7_mng)
 {
     int proc_id;
-    int netns_fd = 0;
     struct ipc_body_s *ipc_body = &(l7_mng->ipc_body);
-    netns_fd = get_netns_fd(getpid());
-    if (netns_fd <= 0) {
-        ERROR("[L7PROBE]: Get netns fd failed.\n");
-        return -1;
-    }
 
     for (int i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
         if (ipc_body->snooper_objs[i].type == SNOOPER_OBJ_PROC) {
             proc_id = ipc_body->snooper_objs[i].obj.proc.proc_id;
-            do_l7_load_tcp_fd(l7_mng->bpf_progs.l7_tcp_fd, proc_id, netns_fd);
+            do_l7_load_tcp_fd(l7_mng->bpf_progs.l7_tcp_fd, proc_id);
         }
     }
 
-    (void)do_l7_load_tcp_fd(l7_mng->bpf_progs.l7_tcp_fd, 0, netns_fd);
-    (void)close(netns_fd);
+    (void)do_l7_load_tcp_fd(l7_mng->bpf_progs.l7_tcp_fd, 0);
     return 0;
 }
 
@@ -335,44 +312,157 @@ static void unload_l7_snoopers(int fd, struct ipc_body_s *ipc_body)
     }
 }
 
-static int __poll_l7_pb(struct bpf_prog_s* prog)
+static int __add_l7_pb_epoll(int epoll_fd, struct bpf_prog_s* prog)
 {
-    int ret;
+    int fd;
+    struct epoll_event ev = {.events = EPOLLIN};
 
     for (int i = 0; i < prog->num && i < SKEL_MAX_NUM; i++) {
-        if (prog->buffers[i]) {
-            ret = bpf_buffer__poll(prog->buffers[i], THOUSAND);
-            if (ret < 0 && ret != -EINTR) {
-                return ret;
-            }
+        if (prog->buffers[i] == NULL) {
+            continue;
+        }
+        fd = bpf_buffer__epoll_fd(prog->buffers[i]);
+        ev.data.ptr = prog->buffers[i];
+        if (fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+            ERROR("[L7PROBE]: Add bpf buffer into epoll set failed(%d).\n", errno);
+            return -1;
         }
     }
 
     return 0;
 }
 
-static int poll_l7_pb(struct l7_ebpf_prog_s* ebpf_progs)
+/*
+ * Buffers of kern_sock and every libssl prog are waited on together, so whichever is ready is
+ * drained at once instead of waiting for the poll timeout of the idle ones. The tick timer is in the
+ * same set (with NULL data), it drives the ipc check, delayed events, parsing and reporting.
+ */
+static int rebuild_l7_epoll(struct l7_mng_s *l7_mng)
 {
-    int ret;
-    struct libssl_prog_s *libssl_prog;
+    struct l7_ebpf_prog_s *ebpf_progs = &(l7_mng->bpf_progs);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
 
-    if (ebpf_progs->kern_sock_prog) {
-        ret = __poll_l7_pb(ebpf_progs->kern_sock_prog);
-        if (ret) {
+    // Buffers of the unloaded progs are gone, start from an empty set.
+    if (l7_mng->epoll_fd >= 0) {
+        (void)close(l7_mng->epoll_fd);
+    }
+    l7_mng->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (l7_mng->epoll_fd < 0) {
+        ERROR("[L7PROBE]: Create epoll failed(%d).\n", errno);
+        return -1;
+    }
+
+    if (epoll_ctl(l7_mng->epoll_fd, EPOLL_CTL_ADD, l7_mng->tick_fd, &ev)) {
+        ERROR("[L7PROBE]: Add tick timer into epoll set failed(%d).\n", errno);
+        return -1;
+    }
+
+    if (ebpf_progs->kern_sock_prog && __add_l7_pb_epoll(l7_mng->epoll_fd, ebpf_progs->kern_sock_prog)) {
+        return -1;
+    }
+
+    for (int i = 0; i < LIBSSL_EBPF_PROG_MAX; i++) {
+        if (ebpf_progs->libssl_progs[i].prog &&
+            __add_l7_pb_epoll(l7_mng->epoll_fd, ebpf_progs->libssl_progs[i].prog)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int create_l7_tick(struct l7_mng_s *l7_mng)
+{
+    struct itimerspec its = {
+        .it_interval = {0, L7_TICK_MS * 1000000},
+        .it_value = {0, L7_TICK_MS * 1000000}
+    };
+
+    l7_mng->tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (l7_mng->tick_fd < 0) {
+        ERROR("[L7PROBE]: Create tick timer failed(%d).\n", errno);
+        return -1;
+    }
+    if (timerfd_settime(l7_mng->tick_fd, 0, &its, NULL)) {
+        ERROR("[L7PROBE]: Set tick timer failed(%d).\n", errno);
+        return -1;
+    }
+    return 0;
+}
+
+/* Drain the ready bpf buffers, returns 1 when the tick timer expires, 0 if not, or negative error. */
+static int poll_l7_pb(struct l7_mng_s *l7_mng)
+{
+    int nfds, ret, tick = 0;
+    u64 expirations;
+    struct epoll_event events[L7_EPOLL_EVENTS_MAX];
+
+    nfds = epoll_wait(l7_mng->epoll_fd, events, L7_EPOLL_EVENTS_MAX, -1);
+    if (nfds < 0) {
+        return (errno == EINTR) ? 0 : -errno;
+    }
+
+    for (int i = 0; i < nfds; i++) {
+        if (events[i].data.ptr == NULL) {
+            (void)read(l7_mng->tick_fd, &expirations, sizeof(expirations));
+            tick = 1;
+            continue;
+        }
+        ret = bpf_buffer__consume((struct bpf_buffer *)events[i].data.ptr);
+        if (ret < 0 && ret != -EINTR) {
             return ret;
         }
     }
+    return tick;
+}
+
+static void __report_l7_pb(struct bpf_prog_s* prog, const char *name, time_t secs)
+{
+    struct bpf_buffer_stats stats;
+
+    for (int i = 0; i < prog->num && i < SKEL_MAX_NUM; i++) {
+        if (prog->buffers[i] == NULL) {
+            continue;
+        }
+        bpf_buffer__take_stats(prog->buffers[i], &stats);
+        if (stats.lost > 0) {
+            WARN("[L7PROBE]: Buffer of %s lost %llu events in %lds, drained %llu events/s, %llu bytes/s.\n",
+                name, stats.lost, (long)secs, stats.events / secs, stats.bytes / secs);
+        } else {
+            DEBUG("[L7PROBE]: Buffer of %s drained %llu events/s, %llu bytes/s.\n",
+                name, stats.events / secs, stats.bytes / secs);
+        }
+    }
+}
 
+static void report_l7_pb(struct l7_mng_s *l7_mng)
+{
+    time_t secs, current = (time_t)time(NULL);
+    struct l7_ebpf_prog_s *ebpf_progs = &(l7_mng->bpf_progs);
+
+    if (l7_mng->last_buffer_report == 0) {
+        l7_mng->last_buffer_report = current;
+        return;
+    }
+    secs = current - l7_mng->last_buffer_report;
+    if (secs <= 0 || secs < l7_mng->ipc_body.probe_param.period) {
+        return;
+    }
+    l7_mng->last_buffer_report = current;
+
+    if (ebpf_progs->kern_sock_prog) {
+        __report_l7_pb(ebpf_progs->kern_sock_prog, "kern_sock", secs);
+    }
     for (int i = 0; i < LIBSSL_EBPF_PROG_MAX; i++) {
-        libssl_prog = &(ebpf_progs->libssl_progs[i]);
-        if (libssl_prog && libssl_prog->prog) {
-            ret = __poll_l7_pb(libssl_prog->prog);
-            if (ret) {
-                return ret;
-            }
+        if (ebpf_progs->libssl_progs[i].prog) {
+            __report_l7_pb(ebpf_progs->libssl_progs[i].prog, ebpf_progs->libssl_progs[i].libssl_path, secs);
         }
     }
-    return 0;
+
+    if (l7_mng->drb_dropped > 0) {
+        WARN("[L7PROBE]: Delaying ring buffer is full, %llu events discarded in %lds.\n",
+            l7_mng->drb_dropped, (long)secs);
+        l7_mng->drb_dropped = 0;
+    }
 }
 
 static void poll_drb(struct l7_mng_s *l7_mng)
@@ -400,7 +490,6 @@ int main(int argc, char **argv)
     struct l7_mng_s *l7_mng = &g_l7_mng;
     struct ipc_body_s ipc_body;
     FILE *fp = NULL;
-    struct timespec ts = {0, 1}; // 1 ns
     fp = popen(RM_L7_MAP_PATH, "r");
     if (fp != NULL) {
         (void)pclose(fp);
@@ -413,6 +502,8 @@ int main(int argc, char **argv)
     }
 
     (void)memset(l7_mng, 0, sizeof(struct l7_mng_s));
+    l7_mng->epoll_fd = -1;
+    l7_mng->tick_fd = -1;
 
     l7_mng->drb = drb_new(CAPACITY, DELAY_MS);
     if (!l7_mng->drb) {
@@ -420,17 +511,36 @@ int main(int argc, char **argv)
         goto err;
     }
 
+    if (l7_workers_create(l7_mng, 0)) {
+        ERROR("[L7PROBE] Failed to create l7 workers.\n");
+        goto err;
+    }
+
     int msq_id = create_ipc_msg_queue(IPC_EXCL);
     if (msq_id < 0) {
         ERROR("[L7PROBE]: Get ipc msg que failed.\n");
         goto err;
     }
     init_l7_historm_range(l7_mng);
+    if (create_l7_tick(l7_mng) || rebuild_l7_epoll(l7_mng)) {
+        goto err;
+    }
     INIT_BPF_APP(l7probe, EBPF_RLIM_LIMITED);
     INFO("[L7PROBE]: Successfully started!\n");
 
     while (!g_stop) {
-        nanosleep(&ts, NULL);
+        // SysV msg queue can not be polled, it is checked on each tick.
+        ret = poll_l7_pb(l7_mng);
+        if (ret < 0) {
+            if (!g_stop) {
+                ERROR("[L7Probe]: perf poll failed(%d).\n", ret);
+            }
+            break;
+        }
+        if (ret == 0) {
+            continue;
+        }
+
         ret = recv_ipc_msg(msq_id, (long)PROBE_L7, &ipc_body);
         if (ret == 0) {
             if (ipc_body.probe_flags & IPC_FLAGS_PARAMS_CHG || ipc_body.probe_flags == 0) {
@@ -472,31 +582,35 @@ int main(int argc, char **argv)
                 }
             }
 
+            if (rebuild_l7_epoll(l7_mng)) {
+                break;
+            }
             is_load_prog = 1;
         }
 
         if (is_load_prog) {
-            ret = poll_l7_pb(&(l7_mng->bpf_progs));
-            if (ret && !g_stop) {
-                ERROR("[L7Probe]: perf poll failed(%d).\n", ret);
-                break;
-            }
-
             poll_drb(l7_mng);
             l7_parser(l7_mng);
             report_l7(l7_mng);
-        } else {
-            sleep(1);
+            report_l7_pb(l7_mng);
         }
     }
 
 err:
+    l7_workers_stop(l7_mng);
     destroy_trackers(l7_mng);
     destroy_links(l7_mng);
+    l7_workers_destroy(l7_mng);
     l7_unload_probe_jsse(l7_mng);
     unload_l7_prog(l7_mng);
     destroy_ipc_body(&(l7_mng->ipc_body));
     drb_destroy(l7_mng->drb);
+    if (l7_mng->epoll_fd >= 0) {
+        (void)close(l7_mng->epoll_fd);
+    }
+    if (l7_mng->tick_fd >= 0) {
+        (void)close(l7_mng->tick_fd);
+    }
     INFO("[L7PROBE] Cleanup is completed");
     return 0;
 }
@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include "amqp_parser.h"
 #include "../utils/binary_decoder.h"
+#include "../utils/l7_mem.h"
 
 
 /* AMQP Protocol Constants */
@@ -376,7 +377,7 @@ parse_state_t amqp_parse_frame(enum message_type_t msg_type, struct raw_data_s *
     }
 
     /* Allocate frame data structure */
-    *frame_data = (struct frame_data_s *)calloc(1, sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *)l7_mem_zalloc(sizeof(struct frame_data_s));
     if (*frame_data == NULL) {
         WARN("[AMQP PARSER] Failed to allocate frame data.\n");
         return STATE_INVALID;
@@ -386,7 +387,7 @@ parse_state_t amqp_parse_frame(enum message_type_t msg_type, struct raw_data_s *
     amqp_message_t *msg = (amqp_message_t *)calloc(1, sizeof(amqp_message_t));
     if (msg == NULL) {
         WARN("[AMQP PARSER] Failed to allocate message.\n");
-        free(*frame_data);
+        l7_mem_free(*frame_data);
         *frame_data = NULL;
         return STATE_INVALID;
     }
@@ -399,7 +400,7 @@ parse_state_t amqp_parse_frame(enum message_type_t msg_type, struct raw_data_s *
     if (state != STATE_SUCCESS) {
         WARN("[AMQP PARSER] Failed to parse frame.\n");
         free_amqp_message(msg);
-        free(*frame_data);
+        l7_mem_free(*frame_data);
         *frame_data = NULL;
         return state;
     }
@@ -15,13 +15,14 @@
 #include <arpa/inet.h>
 #include "../../include/data_stream.h"
 #include "../utils/binary_decoder.h"
+#include "../utils/l7_mem.h"
 #include "crpc_internal.h"
 #include "crpc_parser.h"
 
 void free_crpc_msg(void *frame)
 {
     struct crpc_message_s *crpc_msg = (struct crpc_message_s *)frame;
-    free(crpc_msg);
+    l7_mem_free(crpc_msg);
 }
 
 static parse_state_t crpc_validate_tech_header(struct raw_data_s *raw_data, u16 head_len, u32 message_len)
@@ -127,7 +128,7 @@ size_t crpc_find_frame_boundary(struct raw_data_s *raw_data)
 parse_state_t crpc_parse_frame(enum message_type_t msg_type, struct raw_data_s *raw_data, struct frame_data_s **frame_data)
 {
     parse_state_t state;
-    struct crpc_message_s *crpc_msg = (struct crpc_message_s *)calloc(1, sizeof(struct crpc_message_s));
+    struct crpc_message_s *crpc_msg = (struct crpc_message_s *)l7_mem_zalloc(sizeof(struct crpc_message_s));
     if (crpc_msg == NULL) {
         CRPC_ERROR("Failed to malloc crpc message.\n");
         return STATE_INVALID;
@@ -135,14 +136,14 @@ parse_state_t crpc_parse_frame(enum message_type_t msg_type, struct raw_data_s *
 
     state = __do_crpc_parse_frame(msg_type, raw_data, crpc_msg);
     if (state != STATE_SUCCESS) {
-        free(crpc_msg);
+        l7_mem_free(crpc_msg);
         return state;
     }
 
-    *frame_data = (struct frame_data_s *)malloc(sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *)l7_mem_alloc(sizeof(struct frame_data_s));
     if ((*frame_data) == NULL) {
         CRPC_ERROR("Failed to malloc frame data.\n");
-        free(crpc_msg);
+        l7_mem_free(crpc_msg);
         return STATE_INVALID;
     }
 
@@ -156,7 +157,7 @@ parse_state_t crpc_parse_frame(enum message_type_t msg_type, struct raw_data_s *
 void free_crpc_record(void *record)
 {
     struct crpc_record_s *crpc_record = (struct crpc_record_s *)record;
-    free(crpc_record);
+    l7_mem_free(crpc_record);
 }
 
 
@@ -174,7 +175,7 @@ static void crpc_matcher_add_record(struct crpc_record_s *match_record, struct r
         return;
     }
 
-    record = (struct crpc_record_s *)malloc(sizeof(struct crpc_record_s));
+    record = (struct crpc_record_s *)l7_mem_cycle_alloc(sizeof(struct crpc_record_s));
     if (record == NULL) {
         CRPC_ERROR("Failed to malloc crpc record.\n");
         return;
@@ -182,7 +183,7 @@ static void crpc_matcher_add_record(struct crpc_record_s *match_record, struct r
     record->req_msg = match_record->req_msg;
     record->resp_msg = match_record->resp_msg;
 
-    struct record_data_s *record_data = (struct record_data_s *)malloc(sizeof(struct record_data_s));
+    struct record_data_s *record_data = (struct record_data_s *)l7_mem_cycle_alloc(sizeof(struct record_data_s));
     if (record_data == NULL) {
         CRPC_ERROR("Failed to malloc record data.\n");
         free_crpc_record(record);
@@ -192,8 +193,11 @@ static void crpc_matcher_add_record(struct crpc_record_s *match_record, struct r
     record_data->latency = record->resp_msg->timestamp_ns - record->req_msg->timestamp_ns;
 
     // TODO: calculate error count;
-    record_buf->records[record_buf->record_buf_size] = record_data;
-    record_buf->record_buf_size++;
+    if (record_buf_add_record(record_buf, record_data)) {
+        CRPC_ERROR("Failed to add crpc record into buffer.\n");
+        free_crpc_record(record);
+        l7_mem_free(record_data);
+    }
 }
 
 void crpc_match_frames(struct frame_buf_s *req_frames, struct frame_buf_s *resp_frames, struct record_buf_s *record_buf)
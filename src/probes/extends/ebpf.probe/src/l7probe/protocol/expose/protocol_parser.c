@@ -14,6 +14,7 @@
  * **************************************************************************** */
 
 #include "protocol_parser.h"
+#include "utils/l7_mem.h"
 #include "pgsql/pgsql_msg_format.h"
 #include "pgsql/pgsql_parser.h"
 #include "pgsql/pgsql_matcher.h"
@@ -43,7 +44,7 @@ void free_record_data(enum proto_type_t type, struct record_data_s *record_data)
         return;
     }
     if (record_data->record == NULL) {
-        free(record_data);
+        l7_mem_free(record_data);
         return;
     }
 
@@ -78,7 +79,7 @@ void free_record_data(enum proto_type_t type, struct record_data_s *record_data)
         default:
             break;
     }
-    free(record_data);
+    l7_mem_free(record_data);
 }
 
 void free_frame_data_s(enum proto_type_t type, struct frame_data_s *frame)
@@ -87,7 +88,7 @@ void free_frame_data_s(enum proto_type_t type, struct frame_data_s *frame)
         return;
     }
     if (frame->frame == NULL) {
-        free(frame);
+        l7_mem_free(frame);
         return;
     }
 
@@ -122,7 +123,7 @@ void free_frame_data_s(enum proto_type_t type, struct frame_data_s *frame)
         default:
             break;
     }
-    free(frame);
+    l7_mem_free(frame);
 }
 
 size_t proto_find_frame_boundary(enum proto_type_t type, enum message_type_t msg_type, struct raw_data_s *raw_data)
@@ -16,6 +16,7 @@
 #include "data_stream.h"
 #include "../model/http_msg_format.h"
 #include "http_matcher.h"
+#include "utils/l7_mem.h"
 
 static void calc_l7_api_statistic(struct record_buf_s *record_buf, struct record_data_s *record_data, struct http_record *rcd_cp)
 {
@@ -51,8 +52,7 @@ static void calc_l7_api_statistic(struct record_buf_s *record_buf, struct record
         }
         H_ADD_KEYPTR(record_buf->api_stats, &(api_stats->id), sizeof(struct api_stats_id), api_stats);
     }
-    api_stats->records[api_stats->record_buf_size] = record_data;
-    ++api_stats->record_buf_size;
+    (void)api_stats_add_record(api_stats, record_data);
     ++api_stats->req_count;
     ++api_stats->resp_count;
 
@@ -63,8 +63,7 @@ static void calc_l7_api_statistic(struct record_buf_s *record_buf, struct record
         } else {
             ++api_stats->server_err_count;
         }
-        api_stats->err_records[api_stats->err_count] = record_data;
-        ++api_stats->err_count;
+        (void)api_stats_add_err_record(api_stats, record_data);
     }
 }
 
@@ -78,7 +77,7 @@ static void add_http_record_into_buf(http_record *record, struct record_buf_s *r
         return;
     }
 
-    rcd_cp = (http_record *) malloc(sizeof(http_record));
+    rcd_cp = init_http_record();
     if (rcd_cp == NULL) {
         ERROR("[HTTP1.x MATCHER] Failed to malloc http_record.\n");
         return;
@@ -86,7 +85,7 @@ static void add_http_record_into_buf(http_record *record, struct record_buf_s *r
     rcd_cp->req = record->req;
     rcd_cp->resp = record->resp;
 
-    struct record_data_s *record_data = (struct record_data_s *) malloc(sizeof(struct record_data_s));
+    struct record_data_s *record_data = (struct record_data_s *) l7_mem_cycle_alloc(sizeof(struct record_data_s));
     if (record_data == NULL) {
         ERROR("[HTTP1.x MATCHER] Failed to malloc record_data.\n");
         free_http_record(rcd_cp);
@@ -100,8 +99,12 @@ static void add_http_record_into_buf(http_record *record, struct record_buf_s *r
         DEBUG("[HTTP1.x MATCHER] Response Status Code: %d, error count increase.\n", record->resp->resp_status);
         ++record_buf->err_count;
     }
-    record_buf->records[record_buf->record_buf_size] = record_data;
-    ++record_buf->record_buf_size;
+    if (record_buf_add_record(record_buf, record_data)) {
+        ERROR("[HTTP1.x MATCHER] Failed to add record into buffer.\n");
+        free_http_record(rcd_cp);
+        l7_mem_free(record_data);
+        return;
+    }
 
     calc_l7_api_statistic(record_buf, record_data, rcd_cp);
 }
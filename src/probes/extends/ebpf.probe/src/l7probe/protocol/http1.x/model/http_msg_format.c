@@ -15,6 +15,7 @@
 
 #include <stdlib.h>
 #include "http_msg_format.h"
+#include "utils/l7_mem.h"
 
 char KEY_CONTENT_ENCODING[17] = "Content-Encoding";
 char KEY_CONTENT_LENGTH[15] = "Content-Length";
@@ -24,11 +25,10 @@ char KEY_UPGRADE[8] = "Upgrade";
 
 http_message *init_http_msg(void)
 {
-    http_message *http_msg = (http_message *) malloc(sizeof(struct http_message));
+    http_message *http_msg = (http_message *) l7_mem_zalloc(sizeof(struct http_message));
     if (http_msg == NULL) {
         return NULL;
     }
-    memset(http_msg, 0, sizeof(http_message));
     http_msg->type = MESSAGE_UNKNOW;
     http_msg->minor_version = -1;
     http_msg->resp_status = -1;
@@ -44,23 +44,23 @@ void free_http_msg(http_message *http_msg)
         free_http_headers_map(&(http_msg->headers));
     }
     if (http_msg->req_method != NULL) {
-        free(http_msg->req_method);
+        l7_mem_free(http_msg->req_method);
     }
     if (http_msg->req_path != NULL) {
-        free(http_msg->req_path);
+        l7_mem_free(http_msg->req_path);
     }
     if (http_msg->resp_message != NULL) {
-        free(http_msg->resp_message);
+        l7_mem_free(http_msg->resp_message);
     }
     if (http_msg->body != NULL) {
-        free(http_msg->body);
+        l7_mem_free(http_msg->body);
     }
-    free(http_msg);
+    l7_mem_free(http_msg);
 }
 
 http_record *init_http_record(void)
 {
-    http_record *record = (http_record *) malloc(sizeof(http_record));
+    http_record *record = (http_record *) l7_mem_cycle_alloc(sizeof(http_record));
     if (record == NULL) {
         return NULL;
     }
@@ -74,5 +74,5 @@ void free_http_record(http_record *http_record)
     }
 
     // NOTE: the req/resp of record reused the pointer of req/resp in frame_buf, so we do not free the req/resp pointer here
-    free(http_record);
+    l7_mem_free(http_record);
 }
\ No newline at end of file
@@ -18,6 +18,7 @@
 #include <string.h>
 #include "http_parse_wrapper.h"
 #include "http_parser.h"
+#include "utils/l7_mem.h"
 
 #define CONTENT_VALUE_LEN       64
 /**
@@ -289,10 +290,10 @@ static parse_state_t parse_request_frame(struct raw_data_s *raw_data, http_messa
     frame_data->timestamp_ns = raw_data->timestamp_ns;
     frame_data->minor_version = req.minor_version;
     if (req.method != NULL && req.method_len != 0) {
-        frame_data->req_method = strndup(req.method, req.method_len);
+        frame_data->req_method = l7_mem_strndup(req.method, req.method_len);
     }
     if (req.path != NULL && req.path_len != 0) {
-        frame_data->req_path = strndup(req.path, req.path_len);
+        frame_data->req_path = l7_mem_strndup(req.path, req.path_len);
     }
 
     frame_data->headers_byte_size = offset;
@@ -339,7 +340,7 @@ static parse_state_t parse_response_frame(struct raw_data_s *raw_data, struct ht
     frame_data->timestamp_ns = raw_data->timestamp_ns;
     frame_data->minor_version = resp.minor_version;
     frame_data->resp_status = resp.status;
-    frame_data->resp_message = strndup(resp.msg, resp.msg_len);
+    frame_data->resp_message = l7_mem_strndup(resp.msg, resp.msg_len);
     frame_data->headers_byte_size = offset;
 
     // raw_data pointer offset
@@ -387,7 +388,7 @@ parse_state_t http_parse_frame(enum message_type_t msg_type, struct raw_data_s *
         return state;
     }
 
-    *frame_data = (struct frame_data_s *) malloc(sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *) l7_mem_alloc(sizeof(struct frame_data_s));
     if ((*frame_data) == NULL) {
         WARN("[HTTP1.x PARSER] Failed to malloc frame_data.\n");
         free_http_msg(http_msg);
@@ -17,6 +17,7 @@
 #include <string.h>
 #include "kafka_decoder.h"
 #include "utils/frame_decoder.h"
+#include "utils/l7_mem.h"
 #include "kafka_matcher.h"
 
 parse_state_t decode_fetch_resp(struct raw_data_s *resp_frame, int16_t api_version, size_t *error_count)
@@ -136,15 +137,19 @@ void kafka_match_frames(struct frame_buf_s *req_frames, struct frame_buf_s *resp
 
         // 将匹配到的record存入record_buf
         if (record != NULL) {
-            struct record_data_s *record_data = (struct record_data_s *) malloc(sizeof(struct record_data_s));
+            struct record_data_s *record_data = (struct record_data_s *) l7_mem_cycle_alloc(sizeof(struct record_data_s));
             if (record_data == NULL) {
                 ERROR("[Kafka Match Frames] malloc record_data failed.\n");
                 continue;
             }
             record_data->record = record;
             record_data->latency = record->resp->timestamp_ns - record->req->timestamp_ns;
-            buf->records[buf->record_buf_size] = record_data;
-            buf->record_buf_size++;
+            if (record_buf_add_record(buf, record_data)) {
+                WARN("[Kafka Match Frames] The record buffer is full.\n");
+                free_kafka_record(record);
+                l7_mem_free(record_data);
+                continue;
+            }
             req_frame->consumed = true;
             matched_resp_frame->frame->consumed = true;
         } else {
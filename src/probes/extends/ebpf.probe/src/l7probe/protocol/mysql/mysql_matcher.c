@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include "mysql_matcher_wrapper.h"
 #include "mysql_msg_format.h"
+#include "utils/l7_mem.h"
 
 // Process a simple request and response pair, and populate details into a
 // record entry. This is for MySQL commands that have only a single OK, ERR or
@@ -225,7 +226,7 @@ static void mysql_matcher_add_record(struct mysql_packet_msg_s *req, u64 rsp_tim
     req->consumed = true;
     rsp = init_mysql_msg_s();
     rsp->timestamp_ns = rsp_timestamp_ns;
-    mysql_record = (struct mysql_command_req_resp_s *)calloc(1, sizeof(struct mysql_command_req_resp_s));
+    mysql_record = (struct mysql_command_req_resp_s *)l7_mem_cycle_alloc(sizeof(struct mysql_command_req_resp_s));
     if (mysql_record == NULL) {
         ERROR("[MySQL MATCHER] Failed to malloc mysql_record_s for mysql_record.\n");
         free_mysql_packet_msg_s(rsp);
@@ -234,7 +235,7 @@ static void mysql_matcher_add_record(struct mysql_packet_msg_s *req, u64 rsp_tim
     // mysql_record = init_mysql_command_req_resp_s();
     mysql_record->req = req;
     mysql_record->rsp = rsp;
-    record_data = (struct record_data_s *)calloc(1, sizeof(struct record_data_s));
+    record_data = (struct record_data_s *)l7_mem_cycle_alloc(sizeof(struct record_data_s));
     if (record_data == NULL) {
         ERROR("[MySQL MATCHER] Failed to malloc mysql_record_s for mysql_record.\n");
         free_mysql_record(mysql_record);
@@ -242,8 +243,11 @@ static void mysql_matcher_add_record(struct mysql_packet_msg_s *req, u64 rsp_tim
     }
     record_data->record = mysql_record;
     record_data->latency = rsp_timestamp_ns - req->timestamp_ns;
-    record_buf->records[record_buf->record_buf_size] = record_data;
-    ++record_buf->record_buf_size;
+    if (record_buf_add_record(record_buf, record_data)) {
+        ERROR("[MYSQL MATCHER] Failed to add mysql record into buffer.\n");
+        free_mysql_record(mysql_record);
+        l7_mem_free(record_data);
+    }
 }
 
 static int ProcessPackets(size_t req_index, struct mysql_packet_msg_s *req, struct frame_buf_s *req_frames,
@@ -12,10 +12,11 @@
  * **************************************************************************** */
 #include "mysql_msg_format.h"
 #include <string.h>
+#include "utils/l7_mem.h"
 
 struct mysql_packet_msg_s* init_mysql_msg_s(void)
 {
-    struct mysql_packet_msg_s *msg = (struct mysql_packet_msg_s*)calloc(1, sizeof(struct mysql_packet_msg_s));
+    struct mysql_packet_msg_s *msg = (struct mysql_packet_msg_s*)l7_mem_zalloc(sizeof(struct mysql_packet_msg_s));
     if (msg == NULL) {
         return NULL;
     }
@@ -31,7 +32,7 @@ void free_mysql_packet_msg_s(struct mysql_packet_msg_s* msg)
         free(msg->msg);
         msg->msg = NULL;
     }
-    free(msg);
+    l7_mem_free(msg);
     msg = NULL;
 }
 
@@ -83,5 +84,5 @@ void free_mysql_record(struct mysql_command_req_resp_s* record)
         free_mysql_packet_msg_s(record->rsp);
         record->rsp = NULL;
     }
-    free(record);
+    l7_mem_free(record);
 }
\ No newline at end of file
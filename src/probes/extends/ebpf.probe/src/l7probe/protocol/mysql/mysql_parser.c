@@ -15,11 +15,13 @@
 #include <string.h>
 #include <stdint.h>
 #include "../utils/binary_decoder.h"
+#include "../utils/l7_mem.h"
 #include "mysql_parser.h"
 #include "data_stream.h"
 #include "mysql_msg_format.h"
 
-static bool is_first_packet = true;
+// Parsers run on several l7 workers.
+static __thread bool is_first_packet = true;
 
 static NumberRange cmd_length_ranges[32] = {
     [kSleep] = {1, 1},
@@ -143,14 +145,14 @@ parse_state_t mysql_parse_frame(enum message_type_t msg_type, struct raw_data_s
             return STATE_INVALID;
         }
     }
-    *frame_data = (struct frame_data_s *)calloc(1, sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *)l7_mem_zalloc(sizeof(struct frame_data_s));
     if ((*frame_data) == NULL) {
         return STATE_INVALID;
     }
     struct mysql_packet_msg_s *packet_msg;
     packet_msg = init_mysql_msg_s();
     if (packet_msg == NULL) {
-        free(*frame_data);
+        l7_mem_free(*frame_data);
         return STATE_INVALID;
     }
     packet_msg->timestamp_ns = raw_data->timestamp_ns;
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "pgsql_parser.h"
 #include "pgsql_matcher.h"
+#include "utils/l7_mem.h"
 
 static parse_state_t pgsql_handle_query(struct pgsql_regular_msg_s *msg, struct frame_buf_s *req_frames,
                                  struct frame_buf_s *rsp_frames, struct pgsql_query_req_resp_s *req_rsp)
@@ -505,35 +506,35 @@ static void pgsql_matcher_add_record(struct pgsql_regular_msg_s *req, uint64_t r
 
     // req、resp的payload字段均为作保存
     req->consumed = true;
-    resp = (struct pgsql_regular_msg_s *) malloc(sizeof(struct pgsql_regular_msg_s));
+    resp = init_pgsql_regular_msg();
     if (resp == NULL) {
         ERROR("[PGSQL MATCHER] Failed to malloc pgsql_regular_msg_s for resp_msg.\n");
         return;
     }
-    memset(resp, 0, sizeof(struct pgsql_regular_msg_s));
 
     resp->timestamp_ns = resp_timestamp_ns;
-    pgsql_record = (struct pgsql_record_s *) malloc(sizeof(struct pgsql_record_s));
+    pgsql_record = (struct pgsql_record_s *) l7_mem_cycle_alloc(sizeof(struct pgsql_record_s));
     if (pgsql_record == NULL) {
         ERROR("[PGSQL MATCHER] Failed to malloc pgsql_record_s for pgsql_record.\n");
         free_pgsql_regular_msg(resp);
         return;
     }
-    memset(pgsql_record, 0, sizeof(struct pgsql_record_s));
 
     pgsql_record->req_msg = req;
     pgsql_record->resp_msg = resp;
-    record_data = (struct record_data_s *) malloc(sizeof(struct record_data_s));
+    record_data = (struct record_data_s *) l7_mem_cycle_alloc(sizeof(struct record_data_s));
     if (record_data == NULL) {
         ERROR("[PGSQL MATCHER] Failed to malloc record_data_s for record_data.\n");
         free_pgsql_record(pgsql_record);
         return;
     }
-    memset(record_data, 0, sizeof(struct record_data_s));
     record_data->record = pgsql_record;
     record_data->latency = resp_timestamp_ns - req->timestamp_ns;
-    record_buf->records[record_buf->record_buf_size] = record_data;
-    ++record_buf->record_buf_size;
+    if (record_buf_add_record(record_buf, record_data)) {
+        ERROR("[PGSQL MATCHER] Failed to add pgsql record into buffer.\n");
+        free_pgsql_record(pgsql_record);
+        l7_mem_free(record_data);
+    }
 }
 
 static void handle_simple_query(struct pgsql_regular_msg_s *req, struct frame_buf_s *req_frames,
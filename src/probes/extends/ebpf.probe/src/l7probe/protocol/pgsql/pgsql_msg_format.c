@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "pgsql_msg_format.h"
+#include "utils/l7_mem.h"
 
 struct pgsql_tag_enum_value_s pgsql_tag_enum_values[] = {
     PGSQL_TAG_ENUM_VALUE(true, PGSQL_COPY_DATA),
@@ -66,11 +67,10 @@ bool contains_pgsql_tag(char tag)
 
 struct pgsql_regular_msg_s *init_pgsql_regular_msg(void)
 {
-    struct pgsql_regular_msg_s *msg = (struct pgsql_regular_msg_s *) malloc(sizeof(struct pgsql_regular_msg_s));
+    struct pgsql_regular_msg_s *msg = (struct pgsql_regular_msg_s *) l7_mem_zalloc(sizeof(struct pgsql_regular_msg_s));
     if (msg == NULL) {
         return NULL;
     }
-    memset(msg, 0, sizeof(struct pgsql_regular_msg_s));
     return msg;
 }
 
@@ -83,7 +83,7 @@ void free_pgsql_regular_msg(struct pgsql_regular_msg_s *msg)
         free(msg->payload_data);
         msg->payload_data = NULL;
     }
-    free(msg);
+    l7_mem_free(msg);
 }
 
 
@@ -663,5 +663,5 @@ void free_pgsql_record(struct pgsql_record_s *record)
         record->resp_msg = NULL;
     }
 
-    free(record);
+    l7_mem_free(record);
 }
@@ -16,6 +16,7 @@
 #include <string.h>
 
 #include "utils/binary_decoder.h"
+#include "utils/l7_mem.h"
 #include "common/protocol_common.h"
 #include "pgsql_parser.h"
 
@@ -506,15 +507,14 @@ parse_state_t pgsql_parse_frame(struct raw_data_s *raw_data, struct frame_data_s
         return STATE_NEEDS_MORE_DATA;
     }
 
-    *frame_data = (struct frame_data_s *) malloc(sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *) l7_mem_zalloc(sizeof(struct frame_data_s));
     if ((*frame_data) == NULL) {
         return STATE_INVALID;
     }
-    memset(*frame_data, 0, sizeof(struct frame_data_s));
 
     regular_msg = init_pgsql_regular_msg();
     if (regular_msg == NULL) {
-        free(*frame_data);
+        l7_mem_free(*frame_data);
         return STATE_INVALID;
     }
     regular_msg->timestamp_ns = raw_data->timestamp_ns;
@@ -522,7 +522,7 @@ parse_state_t pgsql_parse_frame(struct raw_data_s *raw_data, struct frame_data_s
     parse_msg_state = pgsql_parse_regular_msg(raw_data, regular_msg);
     if (parse_msg_state != STATE_SUCCESS) {
         free_pgsql_regular_msg(regular_msg);
-        free(*frame_data);
+        l7_mem_free(*frame_data);
         return parse_msg_state;
     }
     return STATE_SUCCESS;
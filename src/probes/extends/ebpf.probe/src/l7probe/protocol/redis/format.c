@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <json_tool.h>
 #include "utils/string_utils.h"
+#include "utils/l7_mem.h"
 #include "common.h"
 #include "format.h"
 
@@ -409,6 +410,6 @@ void format_array_msg(UT_array *payloads, struct redis_msg_s *msg)
         return;
     }
 
-    msg->command = strdup(command);
+    msg->command = l7_mem_strdup(command);
     msg->payload = format_as_str_separated_by_space(payloads);
 }
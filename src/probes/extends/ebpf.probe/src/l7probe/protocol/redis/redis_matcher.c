@@ -17,6 +17,7 @@
 #include <string.h>
 #include "redis_msg_format.h"
 #include "redis_matcher.h"
+#include "utils/l7_mem.h"
 
 static struct redis_record_s *handle_pub_resp_msg(struct redis_msg_s *resp)
 {
@@ -34,7 +35,7 @@ static struct redis_record_s *handle_pub_resp_msg(struct redis_msg_s *resp)
     }
 
     unmatched_record->req_msg->timestamp_ns = resp->timestamp_ns;
-    unmatched_record->req_msg->command = strdup(PUSH_PUB_CMD);
+    unmatched_record->req_msg->command = l7_mem_strdup(PUSH_PUB_CMD);
     unmatched_record->req_msg->is_fake_msg = true;
     unmatched_record->resp_msg = resp;
     return unmatched_record;
@@ -87,16 +88,19 @@ static void add_redis_record_to_buf(struct record_buf_s *record_buf, struct redi
         return;
     }
 
-    struct record_data_s *record_data = (struct record_data_s *)malloc(sizeof(struct record_data_s));
+    struct record_data_s *record_data = (struct record_data_s *)l7_mem_cycle_alloc(sizeof(struct record_data_s));
     if (record_data == NULL) {
         ERROR("[Redis Match] Malloc record_data failed.\n");
         return;
     }
-    memset(record_data, 0, sizeof(struct record_data_s));
     record_data->record = record;
     record_data->latency = record->resp_msg->timestamp_ns - record->req_msg->timestamp_ns;
-    record_buf->records[record_buf->record_buf_size] = record_data;
-    ++record_buf->record_buf_size;
+    if (record_buf_add_record(record_buf, record_data)) {
+        WARN("[Redis Match] The record buffer is full.\n");
+        free_redis_record(record);
+        l7_mem_free(record_data);
+        return;
+    }
     record_buf->err_count += record->resp_msg->single_reply_error_msg_count;
     record_buf->msg_total_count += record->resp_msg->single_reply_msg_count;
 }
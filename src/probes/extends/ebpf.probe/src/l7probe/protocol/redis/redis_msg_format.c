@@ -16,10 +16,11 @@
 #include <string.h>
 #include "common.h"
 #include "redis_msg_format.h"
+#include "utils/l7_mem.h"
 
 struct redis_msg_s *init_redis_msg(void)
 {
-    struct redis_msg_s *msg = (struct redis_msg_s *)malloc(sizeof(struct redis_msg_s));
+    struct redis_msg_s *msg = (struct redis_msg_s *)l7_mem_alloc(sizeof(struct redis_msg_s));
     if (msg == NULL) {
         ERROR("[Redis Parse] redis_msg_s malloc failed.\n");
         return NULL;
@@ -34,7 +35,7 @@ void free_redis_msg(struct redis_msg_s *msg)
         return;
     }
     if (msg->command != NULL) {
-        free(msg->command);
+        l7_mem_free(msg->command);
         msg->command = NULL;
     }
 
@@ -42,17 +43,16 @@ void free_redis_msg(struct redis_msg_s *msg)
         free(msg->payload);
         msg->payload = NULL;
     }
-    free(msg);
+    l7_mem_free(msg);
 }
 
 struct redis_record_s *init_redis_record(void)
 {
-    struct redis_record_s *record = (struct redis_record_s *)malloc(sizeof(struct redis_record_s));
+    struct redis_record_s *record = (struct redis_record_s *)l7_mem_cycle_alloc(sizeof(struct redis_record_s));
     if (record == NULL) {
         ERROR("[Redis Parse] redis_record_s malloc failed.\n");
         return NULL;
     }
-    memset(record, 0, sizeof(struct redis_record_s));
     return record;
 }
 
@@ -67,5 +67,5 @@ void free_redis_record(struct redis_record_s *record)
     if (record->resp_msg != NULL && record->resp_msg->is_fake_msg) {
         free_redis_msg(record->resp_msg);
     }
-    free(record);
+    l7_mem_free(record);
 }
\ No newline at end of file
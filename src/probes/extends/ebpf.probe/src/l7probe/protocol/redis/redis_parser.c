@@ -17,6 +17,7 @@
 #include <utarray.h>
 #include "utils/binary_decoder.h"
 #include "utils/string_utils.h"
+#include "utils/l7_mem.h"
 #include "common/protocol_common.h"
 #include "l7.h"
 #include "redis_msg_format.h"
@@ -290,13 +291,12 @@ parse_state_t redis_parse_frame(enum message_type_t msg_type, struct raw_data_s
     }
     msg->timestamp_ns = raw_data->timestamp_ns;
 
-    *frame_data = (struct frame_data_s *) malloc(sizeof(struct frame_data_s));
+    *frame_data = (struct frame_data_s *) l7_mem_zalloc(sizeof(struct frame_data_s));
     if ((*frame_data) == NULL) {
         free_redis_msg(msg);
         ERROR("[Redis Parse] The frame_data_s malloc failed.\n");
         return STATE_INVALID;
     }
-    memset(*frame_data, 0, sizeof(struct frame_data_s));
 
     // 解析后的msg封装到通用数据结构frame_data中
     (*frame_data)->frame = msg;
@@ -0,0 +1,417 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-28
+ * Description: memory of parsed l7 frames and records
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "l7_mem.h"
+
+#define L7_MEM_ALIGN            16
+#define L7_MEM_MIN_BLOCK        64
+#define L7_MEM_HEAP             L7_MEM_CLASS_NUM        // Block is too large for pool, malloced
+#define L7_MEM_CYCLE            (L7_MEM_CLASS_NUM + 1)  // Block is in cycle arena
+#define L7_MEM_CYCLE_MAX        (L7_MEM_CHUNK_SIZE / 4) // Larger records fall back to pool
+#define L7_MEM_ORPHAN           ((struct l7_mem_free_s *)1) // Remote list of pool whose thread exited
+
+#define L7_MEM_ROUNDUP(size)    (((size) + L7_MEM_ALIGN - 1) & ~((size_t)L7_MEM_ALIGN - 1))
+
+// Put in front of every block, keeps memory returned 16 bytes aligned like malloc().
+struct l7_mem_hdr_s {
+    uint32_t cls;
+    uint32_t reserved;
+    union {
+        struct l7_mem_s *owner;     // Pool the block is given back to, only for pooled blocks
+        uint64_t pad;
+    };
+};
+
+struct l7_mem_free_s {
+    struct l7_mem_hdr_s hdr;        // Kept, so cls of blocks freed by other threads is known
+    struct l7_mem_free_s *next;
+};
+
+struct l7_mem_class_s {
+    struct l7_mem_free_s *free_list;
+    uint32_t cached;
+    uint32_t used;
+    uint32_t peak;          // Max of used since last trim
+};
+
+struct l7_mem_chunk_s {
+    struct l7_mem_chunk_s *next;
+    size_t used;
+    char data[] __attribute__((aligned(L7_MEM_ALIGN)));
+};
+
+struct l7_mem_s {
+    struct l7_mem_class_s classes[L7_MEM_CLASS_NUM];
+    struct l7_mem_chunk_s *chunks;      // Chunk in use is the first one
+    struct l7_mem_chunk_s *spares;
+    uint32_t spare_num;
+    struct l7_mem_free_s *remote;       // Blocks freed by other threads, pushed without lock
+    int64_t orphan_used;                // Blocks left when thread exited, pool is freed with the last
+    uint64_t allocs;
+    uint64_t sys_allocs;
+};
+
+/*
+ * Per thread, so parsers never lock. Blocks freed by another thread(e.g. trackers aged by the
+ * main thread) are handed back to the pool of their owner through its remote list, and cached
+ * there when the owner allocates or trims next, so they are reused and trimmed like local frees.
+ * A pool is kept after its thread exits until the blocks left in use are freed by others.
+ */
+static __thread struct l7_mem_s *g_l7_mem;
+static pthread_key_t g_l7_mem_key;
+static pthread_once_t g_l7_mem_once = PTHREAD_ONCE_INIT;
+
+static void free_mem_block(struct l7_mem_s *mem, struct l7_mem_free_s *blk);
+
+static void orphan_l7_mem(void *arg)
+{
+    struct l7_mem_s *mem = (struct l7_mem_s *)arg;
+    struct l7_mem_free_s *blk, *next;
+    struct l7_mem_chunk_s *chunk, *next_chunk;
+    int64_t used = 0;
+    int cls;
+
+    g_l7_mem = NULL;
+    for (chunk = mem->chunks; chunk != NULL; chunk = next_chunk) {
+        next_chunk = chunk->next;
+        free(chunk);
+    }
+    for (chunk = mem->spares; chunk != NULL; chunk = next_chunk) {
+        next_chunk = chunk->next;
+        free(chunk);
+    }
+
+    // Blocks freed by others from now on go to system directly.
+    blk = __atomic_exchange_n(&mem->remote, L7_MEM_ORPHAN, __ATOMIC_ACQUIRE);
+    for (; blk != NULL; blk = next) {
+        next = blk->next;
+        free_mem_block(mem, blk);
+    }
+    for (cls = 0; cls < L7_MEM_CLASS_NUM; cls++) {
+        for (blk = mem->classes[cls].free_list; blk != NULL; blk = next) {
+            next = blk->next;
+            free(blk);
+        }
+        used += mem->classes[cls].used;
+    }
+
+    // Blocks freed meanwhile have taken orphan_used below zero already.
+    if (__atomic_add_fetch(&mem->orphan_used, used, __ATOMIC_ACQ_REL) == 0) {
+        free(mem);
+    }
+}
+
+static void create_l7_mem_key(void)
+{
+    (void)pthread_key_create(&g_l7_mem_key, orphan_l7_mem);
+}
+
+static struct l7_mem_s *get_l7_mem(void)
+{
+    struct l7_mem_s *mem = g_l7_mem;
+
+    if (mem != NULL) {
+        return mem;
+    }
+    (void)pthread_once(&g_l7_mem_once, create_l7_mem_key);
+    mem = (struct l7_mem_s *)calloc(1, sizeof(struct l7_mem_s));
+    if (mem == NULL) {
+        return NULL;
+    }
+    (void)pthread_setspecific(g_l7_mem_key, mem);
+    g_l7_mem = mem;
+    return mem;
+}
+
+/* Take back blocks freed by other threads. */
+static void collect_remote_blocks(struct l7_mem_s *mem)
+{
+    struct l7_mem_free_s *blk, *next;
+
+    if (__atomic_load_n(&mem->remote, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    blk = __atomic_exchange_n(&mem->remote, NULL, __ATOMIC_ACQUIRE);
+    for (; blk != NULL; blk = next) {
+        next = blk->next;
+        free_mem_block(mem, blk);
+    }
+}
+
+static int get_mem_class(size_t size)
+{
+    size_t block = L7_MEM_MIN_BLOCK;
+    int cls;
+
+    size += sizeof(struct l7_mem_hdr_s);
+    for (cls = 0; cls < L7_MEM_CLASS_NUM; cls++) {
+        if (size <= block) {
+            return cls;
+        }
+        block <<= 1;
+    }
+    return L7_MEM_HEAP;
+}
+
+static void *set_mem_hdr(void *block, uint32_t cls, struct l7_mem_s *owner)
+{
+    struct l7_mem_hdr_s *hdr = (struct l7_mem_hdr_s *)block;
+
+    hdr->cls = cls;
+    hdr->owner = owner;
+    return (void *)(hdr + 1);
+}
+
+void *l7_mem_alloc(size_t size)
+{
+    struct l7_mem_s *mem = get_l7_mem();
+    struct l7_mem_class_s *mem_class;
+    struct l7_mem_free_s *blk;
+    void *block;
+    int cls = get_mem_class(size);
+
+    if (mem == NULL || cls == L7_MEM_HEAP) {
+        block = malloc(sizeof(struct l7_mem_hdr_s) + size);
+        if (mem != NULL) {
+            mem->allocs++;
+            mem->sys_allocs++;
+        }
+        return block == NULL ? NULL : set_mem_hdr(block, L7_MEM_HEAP, NULL);
+    }
+
+    mem->allocs++;
+    mem_class = &mem->classes[cls];
+    if (mem_class->free_list == NULL) {
+        collect_remote_blocks(mem);
+    }
+    blk = mem_class->free_list;
+    if (blk != NULL) {
+        mem_class->free_list = blk->next;
+        mem_class->cached--;
+        block = (void *)blk;
+    } else {
+        block = malloc((size_t)L7_MEM_MIN_BLOCK << cls);
+        if (block == NULL) {
+            return NULL;
+        }
+        mem->sys_allocs++;
+    }
+
+    mem_class->used++;
+    if (mem_class->used > mem_class->peak) {
+        mem_class->peak = mem_class->used;
+    }
+    return set_mem_hdr(block, (uint32_t)cls, mem);
+}
+
+void *l7_mem_zalloc(size_t size)
+{
+    void *p = l7_mem_alloc(size);
+
+    if (p != NULL) {
+        (void)memset(p, 0, size);
+    }
+    return p;
+}
+
+char *l7_mem_strndup(const char *str, size_t len)
+{
+    char *p;
+
+    len = strnlen(str, len);
+    p = (char *)l7_mem_alloc(len + 1);
+    if (p != NULL) {
+        (void)memcpy(p, str, len);
+        p[len] = 0;
+    }
+    return p;
+}
+
+char *l7_mem_strdup(const char *str)
+{
+    return l7_mem_strndup(str, strlen(str));
+}
+
+static struct l7_mem_chunk_s *new_mem_chunk(struct l7_mem_s *mem)
+{
+    struct l7_mem_chunk_s *chunk = mem->spares;
+
+    if (chunk != NULL) {
+        mem->spares = chunk->next;
+        mem->spare_num--;
+    } else {
+        chunk = (struct l7_mem_chunk_s *)malloc(sizeof(struct l7_mem_chunk_s) + L7_MEM_CHUNK_SIZE);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        mem->sys_allocs++;
+    }
+    chunk->used = 0;
+    chunk->next = mem->chunks;
+    mem->chunks = chunk;
+    return chunk;
+}
+
+void *l7_mem_cycle_alloc(size_t size)
+{
+    struct l7_mem_s *mem = get_l7_mem();
+    struct l7_mem_chunk_s *chunk;
+    size_t block_size = sizeof(struct l7_mem_hdr_s) + L7_MEM_ROUNDUP(size);
+    void *block;
+
+    if (mem == NULL || block_size > L7_MEM_CYCLE_MAX) {
+        return l7_mem_zalloc(size);
+    }
+
+    chunk = mem->chunks;
+    if (chunk == NULL || L7_MEM_CHUNK_SIZE - chunk->used < block_size) {
+        chunk = new_mem_chunk(mem);
+        if (chunk == NULL) {
+            return NULL;
+        }
+    }
+
+    block = chunk->data + chunk->used;
+    chunk->used += block_size;
+    mem->allocs++;
+    (void)memset(block, 0, block_size);
+    return set_mem_hdr(block, L7_MEM_CYCLE, mem);
+}
+
+static void free_mem_block(struct l7_mem_s *mem, struct l7_mem_free_s *blk)
+{
+    struct l7_mem_class_s *mem_class = &mem->classes[blk->hdr.cls];
+
+    if (mem_class->used > 0) {
+        mem_class->used--;
+    }
+    if (mem_class->cached >= L7_MEM_CACHE_MAX) {
+        free(blk);
+        return;
+    }
+    blk->next = mem_class->free_list;
+    mem_class->free_list = blk;
+    mem_class->cached++;
+}
+
+static void free_remote_block(struct l7_mem_s *owner, struct l7_mem_free_s *blk)
+{
+    struct l7_mem_free_s *head = __atomic_load_n(&owner->remote, __ATOMIC_RELAXED);
+
+    do {
+        if (head == L7_MEM_ORPHAN) {
+            free(blk);
+            if (__atomic_sub_fetch(&owner->orphan_used, 1, __ATOMIC_ACQ_REL) == 0) {
+                free(owner);
+            }
+            return;
+        }
+        blk->next = head;
+    } while (!__atomic_compare_exchange_n(&owner->remote, &head, blk, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void l7_mem_free(void *ptr)
+{
+    struct l7_mem_hdr_s *hdr;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    hdr = (struct l7_mem_hdr_s *)ptr - 1;
+    if (hdr->cls == L7_MEM_CYCLE) {
+        return;
+    }
+    if (hdr->cls == L7_MEM_HEAP) {
+        free(hdr);
+        return;
+    }
+
+    if (hdr->owner == g_l7_mem) {
+        free_mem_block(hdr->owner, (struct l7_mem_free_s *)hdr);
+    } else {
+        free_remote_block(hdr->owner, (struct l7_mem_free_s *)hdr);
+    }
+}
+
+void l7_mem_cycle_reset(void)
+{
+    struct l7_mem_s *mem = g_l7_mem;
+    struct l7_mem_chunk_s *chunk, *next;
+
+    if (mem == NULL) {
+        return;
+    }
+    for (chunk = mem->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        if (mem->spare_num < L7_MEM_KEEP_CHUNKS) {
+            chunk->next = mem->spares;
+            mem->spares = chunk;
+            mem->spare_num++;
+            continue;
+        }
+        free(chunk);
+    }
+    mem->chunks = NULL;
+}
+
+/* Keep as many free blocks as needed to get back to the peak of last period without malloc. */
+void l7_mem_trim(void)
+{
+    struct l7_mem_s *mem = g_l7_mem;
+    struct l7_mem_class_s *mem_class;
+    struct l7_mem_free_s *blk;
+    uint32_t keep;
+    int cls;
+
+    if (mem == NULL) {
+        return;
+    }
+    collect_remote_blocks(mem);
+    for (cls = 0; cls < L7_MEM_CLASS_NUM; cls++) {
+        mem_class = &mem->classes[cls];
+        keep = mem_class->peak - mem_class->used;
+        while (mem_class->cached > keep) {
+            blk = mem_class->free_list;
+            mem_class->free_list = blk->next;
+            mem_class->cached--;
+            free(blk);
+        }
+        mem_class->peak = mem_class->used;
+    }
+}
+
+void l7_mem_get_stats(struct l7_mem_stats_s *stats)
+{
+    struct l7_mem_s *mem = g_l7_mem;
+    struct l7_mem_chunk_s *chunk;
+    int cls;
+
+    (void)memset(stats, 0, sizeof(struct l7_mem_stats_s));
+    if (mem == NULL) {
+        return;
+    }
+    stats->allocs = mem->allocs;
+    stats->sys_allocs = mem->sys_allocs;
+    for (cls = 0; cls < L7_MEM_CLASS_NUM; cls++) {
+        stats->cached += mem->classes[cls].cached;
+    }
+    for (chunk = mem->chunks; chunk != NULL; chunk = chunk->next) {
+        stats->cycle_bytes += chunk->used;
+    }
+}
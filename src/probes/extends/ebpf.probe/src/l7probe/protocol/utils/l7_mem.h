@@ -0,0 +1,59 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-28
+ * Description: memory of parsed l7 frames and records
+ ******************************************************************************/
+
+#ifndef __L7_MEM_H__
+#define __L7_MEM_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define L7_MEM_CLASS_NUM        5           // Pooled block sizes: 64, 128, 256, 512, 1024 bytes
+#define L7_MEM_CACHE_MAX        4096        // Max free blocks cached per size class
+#define L7_MEM_CHUNK_SIZE       (16 * 1024)
+#define L7_MEM_KEEP_CHUNKS      16          // Chunks of cycle arena kept by reset for reuse
+
+/*
+ * Frames and records of all protocols are small objects allocated and freed at message rate.
+ * Two allocators of the parser thread serve them:
+ *   - Frames stay in frame buffers until they are matched, which may take several parse cycles, so
+ *     they come from a pool of free lists per size class, freeing a frame just links it back.
+ *   - Records never outlive the parse cycle creating them, so they are bump-allocated from the cycle
+ *     arena and released in bulk by l7_mem_cycle_reset(), freeing a record one by one does nothing.
+ * Memory from both of them must be released by l7_mem_free() instead of free(), which knows where the
+ * block comes from, from any thread, a pooled block is given back to the pool of its owner. Cached blocks beyond what the last report period needed are given back to the
+ * system by l7_mem_trim().
+ */
+void *l7_mem_alloc(size_t size);
+void *l7_mem_zalloc(size_t size);
+char *l7_mem_strndup(const char *str, size_t len);
+char *l7_mem_strdup(const char *str);
+/* Zeroed memory valid until next l7_mem_cycle_reset() of the calling thread. */
+void *l7_mem_cycle_alloc(size_t size);
+void l7_mem_free(void *ptr);
+void l7_mem_cycle_reset(void);
+void l7_mem_trim(void);
+
+struct l7_mem_stats_s {
+    uint64_t allocs;            // Allocations served
+    uint64_t sys_allocs;        // Allocations which had to malloc
+    uint64_t cached;            // Free blocks cached in pool
+    uint64_t cycle_bytes;       // Bytes of cycle arena in use
+};
+
+void l7_mem_get_stats(struct l7_mem_stats_s *stats);
+
+#endif
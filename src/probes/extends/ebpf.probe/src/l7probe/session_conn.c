@@ -25,6 +25,7 @@
 #endif
 
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "args.h"
 #include "conn_tracker.h"
 #include "l7_common.h"
@@ -118,7 +119,7 @@ static void submit_sock_conn_stats(void *ctx, struct sock_conn_s* sock_conn,
 }
 
 // TODO: may need to check local IP and port。
-static int cmp_sock_conn(struct conn_info_s *conn_info, struct session_data_args_s *args)
+static int cmp_sock_conn(const struct conn_info_s *conn_info, struct session_data_args_s *args)
 {
     if (conn_info->id.tgid != args->session_conn_id.tgid) {
         return -1;
@@ -148,30 +149,35 @@ static int cmp_sock_conn(struct conn_info_s *conn_info, struct session_data_args
     return 0;
 }
 
-static int find_session_sock(struct l7_mng_s *l7_mng, struct session_data_args_s *args,
-                            struct conn_id_s *matched_conn_id)
-{
-    struct conn_id_s key = {0};
-    struct conn_id_s next_key = {0};
-    struct sock_conn_s sock_conn = {0};
-    int conn_tbl_fd = l7_mng->bpf_progs.conn_tbl_fd;
-
-    while (bpf_map_get_next_key(conn_tbl_fd, &key, &next_key) == 0) {
-        if (bpf_map_lookup_elem(conn_tbl_fd, &next_key, &sock_conn) != 0) {
-            key = next_key;
-            continue;
-        }
+struct session_sock_match_s {
+    struct session_data_args_s *args;
+    struct conn_id_s *matched_conn_id;
+    char found;
+};
 
-        if (cmp_sock_conn(&sock_conn.info, args) == 0){
-            matched_conn_id->tgid = next_key.tgid;
-            matched_conn_id->fd = next_key.fd;
-            return 0;
-        }
+static int match_session_sock(const void *key, const void *value, void *ctx)
+{
+    const struct conn_id_s *conn_id = key;
+    const struct sock_conn_s *sock_conn = value;
+    struct session_sock_match_s *match = ctx;
 
-        key = next_key;
+    if (cmp_sock_conn(&sock_conn->info, match->args) != 0) {
+        return MAP_ITER_CONTINUE;
     }
+    match->matched_conn_id->tgid = conn_id->tgid;
+    match->matched_conn_id->fd = conn_id->fd;
+    match->found = 1;
+    return MAP_ITER_STOP;
+}
 
-    return -1;
+static int find_session_sock(struct l7_mng_s *l7_mng, struct session_data_args_s *args,
+                            struct conn_id_s *matched_conn_id)
+{
+    struct session_sock_match_s match = {.args = args, .matched_conn_id = matched_conn_id};
+
+    (void)bpf_map_iter(l7_mng->bpf_progs.conn_tbl_fd, sizeof(struct conn_id_s), sizeof(struct sock_conn_s),
+                       match_session_sock, &match);
+    return match.found ? 0 : -1;
 }
 
 void clean_pid_session_hash(int tgid)
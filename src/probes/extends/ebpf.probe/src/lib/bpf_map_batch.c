@@ -0,0 +1,302 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-30
+ * Description: batched bpf map iteration
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef BPF_PROG_KERN
+#undef BPF_PROG_KERN
+#endif
+
+#ifdef BPF_PROG_USER
+#undef BPF_PROG_USER
+#endif
+
+#include "bpf.h"
+#include "bpf_map_batch.h"
+
+#define MAP_BATCH_CNT_MAX   (64 * 1024)
+#define MAP_BATCH_UNSUPPORTED   (-2)
+
+struct map_batch_s {
+    int map_fd;
+    u32 key_size;
+    u32 value_size;
+    u32 cnt;                // Capacity of keys and values
+    char *keys;
+    char *values;
+    char *tokens[2];        // in_batch and out_batch, bucket id for hash maps, key for arrays
+    char *del_keys;         // Keys to delete after the callbacks
+    u32 del_num;
+    u32 del_cap;
+};
+
+static void deinit_map_batch(struct map_batch_s *batch)
+{
+    free(batch->keys);
+    free(batch->values);
+    free(batch->tokens[0]);
+    free(batch->tokens[1]);
+    free(batch->del_keys);
+}
+
+static int init_map_batch(struct map_batch_s *batch, int map_fd, u32 key_size, u32 value_size, u32 cnt)
+{
+    size_t token_size = (key_size > sizeof(u64)) ? key_size : sizeof(u64);
+
+    (void)memset(batch, 0, sizeof(struct map_batch_s));
+    batch->map_fd = map_fd;
+    batch->key_size = key_size;
+    batch->value_size = value_size;
+    batch->cnt = cnt;
+    batch->keys = (char *)malloc((size_t)cnt * key_size);
+    batch->values = (char *)malloc((size_t)cnt * (value_size ? value_size : 1));
+    batch->tokens[0] = (char *)calloc(1, token_size);
+    batch->tokens[1] = (char *)calloc(1, token_size);
+    if (!batch->keys || !batch->values || !batch->tokens[0] || !batch->tokens[1]) {
+        deinit_map_batch(batch);
+        return -1;
+    }
+    return 0;
+}
+
+static int queue_del_key(struct map_batch_s *batch, const void *key)
+{
+    u32 cap;
+    char *keys;
+
+    if (batch->del_num >= batch->del_cap) {
+        cap = (batch->del_cap == 0) ? MAP_BATCH_CNT : batch->del_cap * 2;
+        keys = (char *)realloc(batch->del_keys, (size_t)cap * batch->key_size);
+        if (keys == NULL) {
+            return -1;
+        }
+        batch->del_keys = keys;
+        batch->del_cap = cap;
+    }
+    (void)memcpy(batch->del_keys + (size_t)batch->del_num * batch->key_size, key, batch->key_size);
+    batch->del_num++;
+    return 0;
+}
+
+static void flush_del_keys(struct map_batch_s *batch)
+{
+    u32 i = 0;
+
+#if (CURRENT_LIBBPF_VERSION  >= LIBBPF_VERSION(0, 8))
+    u32 count = batch->del_num;
+
+    // Stops at the first key which fails, e.g. deleted by bpf prog meanwhile, the rest go one by one.
+    if (count > 0 && bpf_map_delete_batch(batch->map_fd, batch->del_keys, &count, NULL) < 0) {
+        i = count;
+    } else {
+        i = batch->del_num;
+    }
+#endif
+    for (; i < batch->del_num; i++) {
+        (void)bpf_map_delete_elem(batch->map_fd, batch->del_keys + (size_t)i * batch->key_size);
+    }
+    batch->del_num = 0;
+}
+
+/*
+ * Returns 1 if the walk should stop, -1 if the delete cannot be queued. A drain never stops,
+ * the entries read in batch are deleted already and must all reach the callback.
+ */
+static int call_iter_cb(struct map_batch_s *batch, const void *key, const void *value,
+                        map_iter_cb cb, void *ctx, char drain)
+{
+    int ret;
+
+    if (cb == NULL) {
+        return 0;
+    }
+    ret = cb(key, value, ctx);
+    if (drain) {
+        return 0;
+    }
+    if (ret == MAP_ITER_DELETE) {
+        return queue_del_key(batch, key);
+    }
+    return (ret == MAP_ITER_STOP) ? 1 : 0;
+}
+
+#if (CURRENT_LIBBPF_VERSION  >= LIBBPF_VERSION(0, 8))
+static int grow_map_batch(struct map_batch_s *batch)
+{
+    u32 cnt = batch->cnt * 2;
+    char *keys, *values;
+
+    if (cnt > MAP_BATCH_CNT_MAX) {
+        return -1;
+    }
+    keys = (char *)realloc(batch->keys, (size_t)cnt * batch->key_size);
+    if (keys == NULL) {
+        return -1;
+    }
+    batch->keys = keys;
+    values = (char *)realloc(batch->values, (size_t)cnt * batch->value_size);
+    if (values == NULL) {
+        return -1;
+    }
+    batch->values = values;
+    batch->cnt = cnt;
+    return 0;
+}
+
+/* Returns the number of entries visited, or MAP_BATCH_UNSUPPORTED if nothing is read in batch. */
+static int walk_map_batch(struct map_batch_s *batch, map_iter_cb cb, void *ctx, char drain)
+{
+    void *in_batch = NULL;
+    u32 count, i;
+    int ret, err, stop = 0, visited = 0;
+
+    if (batch->value_size == 0) {
+        return MAP_BATCH_UNSUPPORTED;
+    }
+
+    for (;;) {
+        count = batch->cnt;
+        if (drain) {
+            ret = bpf_map_lookup_and_delete_batch(batch->map_fd, in_batch, batch->tokens[1],
+                                                  batch->keys, batch->values, &count, NULL);
+        } else {
+            ret = bpf_map_lookup_batch(batch->map_fd, in_batch, batch->tokens[1],
+                                       batch->keys, batch->values, &count, NULL);
+        }
+        err = (ret < 0) ? errno : 0;
+        if (ret < 0 && err != ENOENT) {
+            // A hash bucket holds more entries than one batch.
+            if (err == ENOSPC && grow_map_batch(batch) == 0) {
+                continue;
+            }
+            if (in_batch == NULL && visited == 0) {
+                // Old kernel or map type without batch ops.
+                return MAP_BATCH_UNSUPPORTED;
+            }
+            return -1;
+        }
+
+        for (i = 0; i < count && !stop; i++) {
+            visited++;
+            ret = call_iter_cb(batch, batch->keys + (size_t)i * batch->key_size,
+                               batch->values + (size_t)i * batch->value_size, cb, ctx, drain);
+            if (ret < 0) {
+                flush_del_keys(batch);
+                return -1;
+            }
+            stop = ret;
+        }
+        flush_del_keys(batch);
+        if (stop || err == ENOENT) {
+            break;
+        }
+
+        in_batch = batch->tokens[1];
+        batch->tokens[1] = batch->tokens[0];
+        batch->tokens[0] = in_batch;
+    }
+    return visited;
+}
+#else
+static int walk_map_batch(struct map_batch_s *batch, map_iter_cb cb, void *ctx, char drain)
+{
+    return MAP_BATCH_UNSUPPORTED;
+}
+#endif
+
+/*
+ * Deleting the key which get_next_key() continues from restarts a hash map from its first entry,
+ * so the deletes are queued until the walk is done.
+ */
+static int walk_map_keys(struct map_batch_s *batch, map_iter_cb cb, void *ctx)
+{
+    char *key = batch->keys, *next_key = batch->keys + batch->key_size;
+    char has_key = 0;
+    int ret, visited = 0;
+
+    while (bpf_map_get_next_key(batch->map_fd, has_key ? key : NULL, next_key) == 0) {
+        (void)memcpy(key, next_key, batch->key_size);
+        has_key = 1;
+        if (batch->value_size != 0 && bpf_map_lookup_elem(batch->map_fd, key, batch->values) < 0) {
+            continue;
+        }
+        visited++;
+        ret = call_iter_cb(batch, key, batch->values, cb, ctx, 0);
+        if (ret < 0) {
+            visited = -1;
+            break;
+        }
+        if (ret) {
+            break;
+        }
+    }
+    flush_del_keys(batch);
+    return visited;
+}
+
+/* All entries are deleted here, restarting from the first remaining entry is fine then. */
+static int drain_map_keys(struct map_batch_s *batch, map_iter_cb cb, void *ctx)
+{
+    char *key = batch->keys, *next_key = batch->keys + batch->key_size;
+    char has_key = 0;
+    int visited = 0;
+
+    while (bpf_map_get_next_key(batch->map_fd, has_key ? key : NULL, next_key) == 0) {
+        (void)memcpy(key, next_key, batch->key_size);
+        has_key = 1;
+        if (cb != NULL && batch->value_size != 0) {
+            if (bpf_map_lookup_elem(batch->map_fd, key, batch->values) < 0) {
+                continue;
+            }
+            (void)call_iter_cb(batch, key, batch->values, cb, ctx, 1);
+        }
+        (void)bpf_map_delete_elem(batch->map_fd, key);
+        visited++;
+    }
+    return visited;
+}
+
+static int __bpf_map_walk(int map_fd, u32 key_size, u32 value_size, map_iter_cb cb, void *ctx, char drain)
+{
+    struct map_batch_s batch;
+    int ret;
+
+    if (map_fd < 0 || key_size == 0) {
+        return -1;
+    }
+    if (init_map_batch(&batch, map_fd, key_size, value_size, MAP_BATCH_CNT)) {
+        return -1;
+    }
+
+    ret = walk_map_batch(&batch, cb, ctx, drain);
+    if (ret == MAP_BATCH_UNSUPPORTED) {
+        ret = drain ? drain_map_keys(&batch, cb, ctx) : walk_map_keys(&batch, cb, ctx);
+    }
+
+    deinit_map_batch(&batch);
+    return ret;
+}
+
+int bpf_map_iter(int map_fd, u32 key_size, u32 value_size, map_iter_cb cb, void *ctx)
+{
+    return __bpf_map_walk(map_fd, key_size, value_size, cb, ctx, 0);
+}
+
+int bpf_map_drain(int map_fd, u32 key_size, u32 value_size, map_iter_cb cb, void *ctx)
+{
+    return __bpf_map_walk(map_fd, key_size, value_size, cb, ctx, 1);
+}
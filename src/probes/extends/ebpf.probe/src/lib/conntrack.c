@@ -16,11 +16,25 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <uthash.h>
 
 #include "conntrack.h"
 
+#define CONNTRACK_NL_BUF_SIZE       (64 * 1024)
+#define CONNTRACK_NL_RCVBUF         (8 * 1024 * 1024)
+#define CONNTRACK_NL_TMOUT          1       // unit: second
+#define CONNTRACK_CACHE_MAX         (64 * 1024)
+#define CONNTRACK_RESYNC_INTERVAL   60      // unit: second, only if cache is not complete, e.g. events are lost
+
 struct tcp_conntrack_s {
     char *src, *dst;
     char *reply_src, *reply_dst;
@@ -254,7 +268,7 @@ static int __dnat_op(const struct tcp_conntrack_s *conn_track, struct tcp_connec
 }
 
 #define CONNTRACK_DNAT_CMD  "conntrack -L -s %s -d %s -g -p tcp | grep ESTABLISHED"
-int get_cluster_ip_backend(struct tcp_connect_s *connect, int *transform)
+static int get_cluster_ip_backend_by_cmd(struct tcp_connect_s *connect, int *transform)
 {
     int ret = 0;
     FILE *f;
@@ -263,12 +277,6 @@ int get_cluster_ip_backend(struct tcp_connect_s *connect, int *transform)
     char line[LINE_BUF_LEN];
     char command[COMMAND_LEN];
 
-    *transform = ADDR_TRANSFORM_NONE;
-    // Only transform Kubernetes cluster IP backend for the client TCP connection.
-    if (connect->role == 0) {
-        return 0;
-    }
-
     cip[0] = 0;
     if (inet_ntop(connect->family, (const void *)&(connect->cip_addr), cip, IP6_LEN) == NULL) {
         ERROR("[CLUSTERIP] inet_ntop failed for src ip\n");
@@ -318,3 +326,583 @@ int get_cluster_ip_backend(struct tcp_connect_s *connect, int *transform)
     return ret;
 }
 
+/*
+ * DNAT entries of the host conntrack table are mirrored in a hash keyed on the original tuple.
+ * The cache is filled by a NETLINK_NETFILTER dump and kept up to date by NEW/DESTROY events,
+ * which are drained before each lookup, so cluster IP lookups need neither fork nor syscalls
+ * except reading pending events.
+ * Unlike the conntrack command, entries are not filtered by ESTABLISHED state: the command
+ * matches addresses only and needs it to skip closing entries of other ports, while the cache is
+ * keyed on the full original tuple and closed entries are removed by DESTROY events. Entries are
+ * cached from NEW events before they get ESTABLISHED, filtering them would need UPDATE events.
+ */
+struct conntrack_key_s {
+    u16 family;
+    u16 sport;                      // Original direction, host byte order
+    u16 dport;
+    u16 rsvd;
+    unsigned char src[IP6_LEN];
+    unsigned char dst[IP6_LEN];
+};
+
+struct conntrack_dnat_s {
+    struct conntrack_key_s key;
+    unsigned char nat_dst[IP6_LEN]; // Source of reply direction, i.e. the backend
+    u16 nat_dport;
+    UT_hash_handle hh;
+};
+
+struct conntrack_nl_s {
+    int evt_fd;                     // Subscribed to NEW/DESTROY events
+    int req_fd;                     // Used by dump and query
+    u32 seq;
+    char inited;
+    char unavailable;               // Netlink is not usable, fall back to conntrack command
+    char complete;                  // Cache holds all DNAT entries, so a miss means no DNAT
+    time_t sync_ts;
+    u32 cache_num;
+    struct conntrack_dnat_s *cache;
+    pthread_mutex_t lock;
+};
+
+static struct conntrack_nl_s g_conntrack = {
+    .evt_fd = -1,
+    .req_fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+#define CT_NLA_DATA(attr)       ((void *)((char *)(attr) + NLA_HDRLEN))
+#define CT_NLA_LEN(attr)        ((int)(attr)->nla_len - NLA_HDRLEN)
+
+static void ct_parse_attrs(const struct nlattr *tb[], int max, const void *data, int len)
+{
+    const struct nlattr *attr = (const struct nlattr *)data;
+    int type;
+
+    (void)memset(tb, 0, sizeof(struct nlattr *) * (max + 1));
+    while (len >= (int)sizeof(struct nlattr) && attr->nla_len >= sizeof(struct nlattr) && attr->nla_len <= len) {
+        type = attr->nla_type & NLA_TYPE_MASK;
+        if (type <= max) {
+            tb[type] = attr;
+        }
+        len -= NLA_ALIGN(attr->nla_len);
+        attr = (const struct nlattr *)((const char *)attr + NLA_ALIGN(attr->nla_len));
+    }
+}
+
+static int ct_parse_tuple(const struct nlattr *tuple, u16 family, unsigned char src[], unsigned char dst[],
+                          u16 *sport, u16 *dport)
+{
+    const struct nlattr *tb[CTA_TUPLE_MAX + 1];
+    const struct nlattr *ip[CTA_IP_MAX + 1];
+    const struct nlattr *proto[CTA_PROTO_MAX + 1];
+    int ip_src = (family == AF_INET) ? CTA_IP_V4_SRC : CTA_IP_V6_SRC;
+    int ip_dst = (family == AF_INET) ? CTA_IP_V4_DST : CTA_IP_V6_DST;
+    int ip_len = (family == AF_INET) ? IP_LEN : IP6_LEN;
+
+    ct_parse_attrs(tb, CTA_TUPLE_MAX, CT_NLA_DATA(tuple), CT_NLA_LEN(tuple));
+    if (tb[CTA_TUPLE_IP] == NULL || tb[CTA_TUPLE_PROTO] == NULL) {
+        return -1;
+    }
+
+    ct_parse_attrs(proto, CTA_PROTO_MAX, CT_NLA_DATA(tb[CTA_TUPLE_PROTO]), CT_NLA_LEN(tb[CTA_TUPLE_PROTO]));
+    if (proto[CTA_PROTO_NUM] == NULL || *(u8 *)CT_NLA_DATA(proto[CTA_PROTO_NUM]) != IPPROTO_TCP ||
+        proto[CTA_PROTO_SRC_PORT] == NULL || proto[CTA_PROTO_DST_PORT] == NULL) {
+        return -1;
+    }
+    *sport = ntohs(*(u16 *)CT_NLA_DATA(proto[CTA_PROTO_SRC_PORT]));
+    *dport = ntohs(*(u16 *)CT_NLA_DATA(proto[CTA_PROTO_DST_PORT]));
+
+    ct_parse_attrs(ip, CTA_IP_MAX, CT_NLA_DATA(tb[CTA_TUPLE_IP]), CT_NLA_LEN(tb[CTA_TUPLE_IP]));
+    if (ip[ip_src] == NULL || ip[ip_dst] == NULL ||
+        CT_NLA_LEN(ip[ip_src]) < ip_len || CT_NLA_LEN(ip[ip_dst]) < ip_len) {
+        return -1;
+    }
+    (void)memcpy(src, CT_NLA_DATA(ip[ip_src]), ip_len);
+    (void)memcpy(dst, CT_NLA_DATA(ip[ip_dst]), ip_len);
+    return 0;
+}
+
+/* Parse one ctnetlink message, returns 1 if it's a DNAT entry, 0 if not, -1 if it's not a TCP entry. */
+static int ct_parse_msg(const struct nlmsghdr *nlh, struct conntrack_dnat_s *entry)
+{
+    const struct nlattr *tb[CTA_MAX + 1];
+    const struct nfgenmsg *nfg = NLMSG_DATA(nlh);
+    unsigned char reply_dst[IP6_LEN];
+    u16 reply_dport;
+    int attr_off = NLMSG_ALIGN(sizeof(struct nfgenmsg));
+
+    if (nlh->nlmsg_len < NLMSG_LENGTH(attr_off)) {
+        return -1;
+    }
+    if (nfg->nfgen_family != AF_INET && nfg->nfgen_family != AF_INET6) {
+        return -1;
+    }
+
+    (void)memset(entry, 0, sizeof(struct conntrack_dnat_s));
+    entry->key.family = nfg->nfgen_family;
+    ct_parse_attrs(tb, CTA_MAX, (const char *)nfg + attr_off, (int)nlh->nlmsg_len - NLMSG_LENGTH(attr_off));
+    if (tb[CTA_TUPLE_ORIG] == NULL || tb[CTA_TUPLE_REPLY] == NULL) {
+        return -1;
+    }
+
+    if (ct_parse_tuple(tb[CTA_TUPLE_ORIG], entry->key.family, entry->key.src, entry->key.dst,
+                       &entry->key.sport, &entry->key.dport)) {
+        return -1;
+    }
+    if (ct_parse_tuple(tb[CTA_TUPLE_REPLY], entry->key.family, entry->nat_dst, reply_dst,
+                       &entry->nat_dport, &reply_dport)) {
+        return -1;
+    }
+
+    // Reply comes from somewhere else than the original destination: DNAT.
+    if (memcmp(entry->nat_dst, entry->key.dst, IP6_LEN) == 0 && entry->nat_dport == entry->key.dport) {
+        return 0;
+    }
+    return 1;
+}
+
+static void ct_cache_del(struct conntrack_nl_s *ct, const struct conntrack_key_s *key)
+{
+    struct conntrack_dnat_s *item = NULL;
+
+    HASH_FIND(hh, ct->cache, key, sizeof(struct conntrack_key_s), item);
+    if (item != NULL) {
+        HASH_DEL(ct->cache, item);
+        free(item);
+        ct->cache_num--;
+    }
+}
+
+static void ct_cache_add(struct conntrack_nl_s *ct, const struct conntrack_dnat_s *entry)
+{
+    struct conntrack_dnat_s *item = NULL;
+
+    HASH_FIND(hh, ct->cache, &entry->key, sizeof(struct conntrack_key_s), item);
+    if (item != NULL) {
+        (void)memcpy(item->nat_dst, entry->nat_dst, IP6_LEN);
+        item->nat_dport = entry->nat_dport;
+        return;
+    }
+
+    if (ct->cache_num >= CONNTRACK_CACHE_MAX) {
+        // Misses have to be queried from kernel until the next resync.
+        ct->complete = 0;
+        return;
+    }
+
+    item = (struct conntrack_dnat_s *)malloc(sizeof(struct conntrack_dnat_s));
+    if (item == NULL) {
+        ct->complete = 0;
+        return;
+    }
+    (void)memcpy(item, entry, sizeof(struct conntrack_dnat_s));
+    HASH_ADD(hh, ct->cache, key, sizeof(struct conntrack_key_s), item);
+    ct->cache_num++;
+}
+
+static void ct_cache_clear(struct conntrack_nl_s *ct)
+{
+    struct conntrack_dnat_s *item, *tmp;
+
+    HASH_ITER(hh, ct->cache, item, tmp) {
+        HASH_DEL(ct->cache, item);
+        free(item);
+    }
+    ct->cache_num = 0;
+}
+
+static int ct_apply_msg(const struct nlmsghdr *nlh, void *arg)
+{
+    struct conntrack_nl_s *ct = (struct conntrack_nl_s *)arg;
+    struct conntrack_dnat_s entry;
+    int ret = ct_parse_msg(nlh, &entry);
+
+    if (ret < 0) {
+        return 0;
+    }
+
+    if (NFNL_MSG_TYPE(nlh->nlmsg_type) == IPCTNL_MSG_CT_DELETE || ret == 0) {
+        ct_cache_del(ct, &entry.key);
+    } else {
+        ct_cache_add(ct, &entry);
+    }
+    return 0;
+}
+
+/*
+ * Walk through the messages of one netlink datagram, messages of other requests than seq are
+ * skipped(events have no seq). Returns 1 on NLMSG_DONE, -1 on NLMSG_ERROR.
+ */
+static int ct_nl_walk(const char *buf, int len, u32 seq, int (*cb)(const struct nlmsghdr *, void *), void *arg)
+{
+    const struct nlmsghdr *nlh;
+    const struct nlmsgerr *err;
+
+    for (nlh = (const struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+        if (nlh->nlmsg_seq != seq) {
+            continue;
+        }
+        if (nlh->nlmsg_type == NLMSG_DONE) {
+            return 1;
+        }
+        if (nlh->nlmsg_type == NLMSG_ERROR) {
+            err = (const struct nlmsgerr *)NLMSG_DATA(nlh);
+            return (err->error == 0) ? 1 : -1;
+        }
+        if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_CTNETLINK) {
+            continue;
+        }
+        if (cb(nlh, arg)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int ct_nl_open(const unsigned int groups[], int groups_num)
+{
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+    struct timeval tmout = {.tv_sec = CONNTRACK_NL_TMOUT};
+    int rcvbuf = CONNTRACK_NL_RCVBUF;
+    int fd, i;
+
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        goto err;
+    }
+
+    for (i = 0; i < groups_num; i++) {
+        if (setsockopt(fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &groups[i], sizeof(groups[i])) < 0) {
+            goto err;
+        }
+    }
+    if (groups_num > 0) {
+        // Bursts of new connections must not overflow the event socket.
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0) {
+            (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+    } else {
+        (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tmout, sizeof(tmout));
+    }
+    return fd;
+
+err:
+    (void)close(fd);
+    return -1;
+}
+
+static int ct_nl_request(struct conntrack_nl_s *ct, u16 flags, u8 family, const void *attrs, int attrs_len)
+{
+    char buf[NLMSG_SPACE(sizeof(struct nfgenmsg)) + 128];
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+    struct nfgenmsg *nfg;
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+
+    if (attrs_len > 128) {
+        return -1;
+    }
+    (void)memset(buf, 0, sizeof(buf));
+    nlh->nlmsg_len = NLMSG_LENGTH(NLMSG_ALIGN(sizeof(struct nfgenmsg)) + attrs_len);
+    nlh->nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_GET;
+    nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+    nlh->nlmsg_seq = ++ct->seq;
+
+    nfg = (struct nfgenmsg *)NLMSG_DATA(nlh);
+    nfg->nfgen_family = family;
+    nfg->version = NFNETLINK_V0;
+    nfg->res_id = 0;
+    if (attrs_len > 0) {
+        (void)memcpy((char *)nfg + NLMSG_ALIGN(sizeof(struct nfgenmsg)), attrs, attrs_len);
+    }
+
+    if (sendto(ct->req_fd, buf, nlh->nlmsg_len, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Receive replies of the last request until it's done, returns 0 on success. */
+static int ct_nl_recv(struct conntrack_nl_s *ct, int dump, int (*cb)(const struct nlmsghdr *, void *), void *arg)
+{
+    char *buf;
+    ssize_t len;
+    int ret;
+
+    buf = (char *)malloc(CONNTRACK_NL_BUF_SIZE);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    for (;;) {
+        len = recv(ct->req_fd, buf, CONNTRACK_NL_BUF_SIZE, 0);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            ret = -1;
+            break;
+        }
+        ret = ct_nl_walk(buf, (int)len, ct->seq, cb, arg);
+        if (ret != 0) {
+            ret = (ret > 0) ? 0 : -1;
+            break;
+        }
+        // A query is answered by one datagram, a dump ends with NLMSG_DONE.
+        if (!dump) {
+            break;
+        }
+    }
+
+    free(buf);
+    return ret;
+}
+
+static int ct_nl_sync(struct conntrack_nl_s *ct)
+{
+    static const u8 families[] = {AF_INET, AF_INET6};
+    int i;
+
+    ct_cache_clear(ct);
+    ct->complete = 1;
+    ct->sync_ts = time(NULL);
+
+    for (i = 0; i < sizeof(families) / sizeof(families[0]); i++) {
+        if (ct_nl_request(ct, NLM_F_DUMP, families[i], NULL, 0) || ct_nl_recv(ct, 1, ct_apply_msg, ct)) {
+            // Misses are queried from kernel until the next try.
+            ERROR("[CLUSTERIP] Failed to dump conntrack table(family %u).\n", families[i]);
+            ct->complete = 0;
+            return -1;
+        }
+    }
+    DEBUG("[CLUSTERIP] Conntrack table is synced, %u DNAT entries.\n", ct->cache_num);
+    return 0;
+}
+
+static void ct_nl_drain_events(struct conntrack_nl_s *ct)
+{
+    char buf[CONNTRACK_NL_BUF_SIZE];
+    ssize_t len;
+
+    for (;;) {
+        len = recv(ct->evt_fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len > 0) {
+            (void)ct_nl_walk(buf, (int)len, 0, ct_apply_msg, ct);
+            continue;
+        }
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len < 0 && errno == ENOBUFS) {
+            // Events are lost, misses are queried from kernel until the next resync. Resync is
+            // rate limited, since the event socket keeps overflowing under connection storms
+            // and a dump on every lookup would hold the lock far longer than queries do.
+            ct->complete = 0;
+            continue;
+        }
+        break;
+    }
+}
+
+static int ct_nl_init(struct conntrack_nl_s *ct)
+{
+    static const unsigned int groups[] = {NFNLGRP_CONNTRACK_NEW, NFNLGRP_CONNTRACK_DESTROY};
+
+    ct->inited = 1;
+    // Subscribe before dumping, so nothing happens in between is missed.
+    ct->evt_fd = ct_nl_open(groups, sizeof(groups) / sizeof(groups[0]));
+    ct->req_fd = ct_nl_open(NULL, 0);
+    if (ct->evt_fd < 0 || ct->req_fd < 0) {
+        goto err;
+    }
+    if (ct_nl_sync(ct)) {
+        goto err;
+    }
+    INFO("[CLUSTERIP] Conntrack entries are read from netlink.\n");
+    return 0;
+
+err:
+    WARN("[CLUSTERIP] Netlink conntrack is unavailable(%s), use conntrack command instead.\n", strerror(errno));
+    if (ct->evt_fd >= 0) {
+        (void)close(ct->evt_fd);
+        ct->evt_fd = -1;
+    }
+    if (ct->req_fd >= 0) {
+        (void)close(ct->req_fd);
+        ct->req_fd = -1;
+    }
+    ct_cache_clear(ct);
+    ct->unavailable = 1;
+    return -1;
+}
+
+static void ct_nl_put_attr(char *buf, int *off, u16 type, const void *data, int len)
+{
+    struct nlattr *attr = (struct nlattr *)(buf + *off);
+
+    attr->nla_type = type;
+    attr->nla_len = NLA_HDRLEN + len;
+    if (len > 0) {
+        (void)memcpy(CT_NLA_DATA(attr), data, len);
+    }
+    *off += NLA_ALIGN(attr->nla_len);
+}
+
+static int ct_nl_nest_start(char *buf, int *off, u16 type)
+{
+    int start = *off;
+
+    ct_nl_put_attr(buf, off, type | NLA_F_NESTED, NULL, 0);
+    return start;
+}
+
+static void ct_nl_nest_end(char *buf, const int *off, int start)
+{
+    ((struct nlattr *)(buf + start))->nla_len = *off - start;
+}
+
+static int ct_query_msg(const struct nlmsghdr *nlh, void *arg)
+{
+    struct conntrack_dnat_s *entry = (struct conntrack_dnat_s *)arg;
+    struct conntrack_dnat_s parsed;
+
+    if (ct_parse_msg(nlh, &parsed) == 1) {
+        (void)memcpy(entry, &parsed, sizeof(parsed));
+    }
+    return 0;
+}
+
+/* Query kernel for one original tuple, only used when the cache is not complete. */
+static int ct_nl_query(struct conntrack_nl_s *ct, const struct conntrack_key_s *key, struct conntrack_dnat_s *entry)
+{
+    char attrs[128];
+    int off = 0, tuple, ip, proto;
+    int ip_len = (key->family == AF_INET) ? IP_LEN : IP6_LEN;
+    u8 proto_num = IPPROTO_TCP;
+    u16 sport = htons(key->sport), dport = htons(key->dport);
+
+    tuple = ct_nl_nest_start(attrs, &off, CTA_TUPLE_ORIG);
+    ip = ct_nl_nest_start(attrs, &off, CTA_TUPLE_IP);
+    ct_nl_put_attr(attrs, &off, (key->family == AF_INET) ? CTA_IP_V4_SRC : CTA_IP_V6_SRC, key->src, ip_len);
+    ct_nl_put_attr(attrs, &off, (key->family == AF_INET) ? CTA_IP_V4_DST : CTA_IP_V6_DST, key->dst, ip_len);
+    ct_nl_nest_end(attrs, &off, ip);
+    proto = ct_nl_nest_start(attrs, &off, CTA_TUPLE_PROTO);
+    ct_nl_put_attr(attrs, &off, CTA_PROTO_NUM, &proto_num, sizeof(proto_num));
+    ct_nl_put_attr(attrs, &off, CTA_PROTO_SRC_PORT, &sport, sizeof(sport));
+    ct_nl_put_attr(attrs, &off, CTA_PROTO_DST_PORT, &dport, sizeof(dport));
+    ct_nl_nest_end(attrs, &off, proto);
+    ct_nl_nest_end(attrs, &off, tuple);
+
+    (void)memset(entry, 0, sizeof(struct conntrack_dnat_s));
+    if (ct_nl_request(ct, 0, (u8)key->family, attrs, off)) {
+        return -1;
+    }
+    // No such entry is reported as NLMSG_ERROR(ENOENT).
+    (void)ct_nl_recv(ct, 0, ct_query_msg, entry);
+    return (entry->key.family != 0) ? 0 : -1;
+}
+
+static int ct_key_from_connect(const struct tcp_connect_s *connect, struct conntrack_key_s *key)
+{
+    (void)memset(key, 0, sizeof(struct conntrack_key_s));
+    key->sport = connect->c_port;
+    key->dport = connect->s_port;
+
+    if (connect->family == AF_INET) {
+        key->family = AF_INET;
+        (void)memcpy(key->src, &connect->cip_addr.c_ip, IP_LEN);
+        (void)memcpy(key->dst, &connect->sip_addr.s_ip, IP_LEN);
+    } else if (connect->family == AF_INET6 &&
+               NIP6_IS_ADDR_V4MAPPED((unsigned short *)connect->cip_addr.c_ip6) &&
+               NIP6_IS_ADDR_V4MAPPED((unsigned short *)connect->sip_addr.s_ip6)) {
+        // IPv4 traffic on dual-stack sockets is tracked as IPv4
+        key->family = AF_INET;
+        (void)memcpy(key->src, connect->cip_addr.c_ip6 + IP4_BYTE_1_IN_IP6, IP_LEN);
+        (void)memcpy(key->dst, connect->sip_addr.s_ip6 + IP4_BYTE_1_IN_IP6, IP_LEN);
+    } else if (connect->family == AF_INET6) {
+        key->family = AF_INET6;
+        (void)memcpy(key->src, connect->cip_addr.c_ip6, IP6_LEN);
+        (void)memcpy(key->dst, connect->sip_addr.s_ip6, IP6_LEN);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static void ct_dnat_connect(const struct conntrack_dnat_s *entry, struct tcp_connect_s *connect)
+{
+    if (connect->family == AF_INET) {
+        (void)memcpy(&connect->sip_addr.s_ip, entry->nat_dst, IP_LEN);
+    } else if (entry->key.family == AF_INET) {
+        (void)memcpy(connect->sip_addr.s_ip6 + IP4_BYTE_1_IN_IP6, entry->nat_dst, IP_LEN);
+    } else {
+        (void)memcpy(connect->sip_addr.s_ip6, entry->nat_dst, IP6_LEN);
+    }
+    connect->s_port = entry->nat_dport;
+}
+
+static void ct_cache_lookup(struct conntrack_nl_s *ct, struct tcp_connect_s *connect, int *transform)
+{
+    struct conntrack_key_s key;
+    struct conntrack_dnat_s *item = NULL;
+    struct conntrack_dnat_s entry;
+
+    if (ct_key_from_connect(connect, &key)) {
+        return;
+    }
+
+    HASH_FIND(hh, ct->cache, &key, sizeof(key), item);
+    if (item != NULL) {
+        ct_dnat_connect(item, connect);
+        *transform = ADDR_TRANSFORM_SERVER;
+        return;
+    }
+
+    if (!ct->complete && ct->req_fd >= 0 && ct_nl_query(ct, &key, &entry) == 0) {
+        ct_dnat_connect(&entry, connect);
+        *transform = ADDR_TRANSFORM_SERVER;
+    }
+}
+
+/* Returns -1 if netlink is not usable and the caller has to fall back to conntrack command. */
+static int get_cluster_ip_backend_by_nl(struct tcp_connect_s *connect, int *transform)
+{
+    struct conntrack_nl_s *ct = &g_conntrack;
+    time_t now;
+
+    (void)pthread_mutex_lock(&ct->lock);
+    if (!ct->inited) {
+        (void)ct_nl_init(ct);
+    }
+    if (ct->unavailable) {
+        (void)pthread_mutex_unlock(&ct->lock);
+        return -1;
+    }
+
+    ct_nl_drain_events(ct);
+    now = time(NULL);
+    if (!ct->complete && now >= ct->sync_ts + CONNTRACK_RESYNC_INTERVAL) {
+        (void)ct_nl_sync(ct);
+    }
+
+    ct_cache_lookup(ct, connect, transform);
+    (void)pthread_mutex_unlock(&ct->lock);
+    return 0;
+}
+
+int get_cluster_ip_backend(struct tcp_connect_s *connect, int *transform)
+{
+    *transform = ADDR_TRANSFORM_NONE;
+    // Only transform Kubernetes cluster IP backend for the client TCP connection.
+    if (connect->role == 0) {
+        return 0;
+    }
+
+    if (get_cluster_ip_backend_by_nl(connect, transform) == 0) {
+        return 0;
+    }
+    return get_cluster_ip_backend_by_cmd(connect, transform);
+}
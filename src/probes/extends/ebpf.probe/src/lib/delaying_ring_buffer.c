@@ -18,83 +18,132 @@
 #include "common.h"
 #include "delaying_ring_buffer.h"
 
+#define DRB_ROUNDUP(size)   (((size) + DRB_ALIGN - 1) & ~(DRB_ALIGN - 1))
+
+/* capacity is in bytes, records are stored with a header of sizeof(struct drb_item) bytes. */
 struct delaying_ring_buffer *drb_new(int capacity, int delay_ms)
 {
-    struct delaying_ring_buffer *drb = malloc(sizeof(struct delaying_ring_buffer));
+    struct delaying_ring_buffer *drb;
+
+    capacity &= ~(DRB_ALIGN - 1);
+    if (capacity <= (int)sizeof(struct drb_item)) {
+        return NULL;
+    }
+
+    drb = malloc(sizeof(struct delaying_ring_buffer));
     if (!drb) {
         return NULL;
     }
+    drb->storage = malloc(capacity);
+    if (!drb->storage) {
+        free(drb);
+        return NULL;
+    }
     drb->reader_idx = drb->writer_idx = 0;
+    drb->used = 0;
+    drb->data_end = capacity;
     drb->capacity = capacity;
     drb->delay_ms = delay_ms;
-    drb->storage = malloc(sizeof(struct drb_item) * capacity);
-    INFO("[DRB] Allocated a delaying ring buffer with capacity %d and delay %d ms\n", capacity, delay_ms);
+    INFO("[DRB] Allocated a delaying ring buffer with capacity %d bytes and delay %d ms\n", capacity, delay_ms);
     return drb;
 }
 
 void drb_destroy(struct delaying_ring_buffer *drb)
 {
     if (drb) {
-        if (drb->storage) {
-            for (int idx = drb->reader_idx; idx < drb->writer_idx; idx++) {
-                free(drb->storage[idx].data);
-            }
-            free(drb->storage);
-        }
+        // Records live in storage, nothing else to free.
+        free(drb->storage);
         free(drb);
     }
     INFO("[DRB] Delaying ring buffer destroyed\n");
 }
 
-int drb_put(struct delaying_ring_buffer *drb, const char *data, const int size)
+/* Returns offset to write a record of len bytes at, or -1 if there is no room. */
+static int drb_reserve(struct delaying_ring_buffer *drb, int len)
 {
-    int writer_idx = drb->writer_idx;
-    if ((writer_idx + 1) % drb->capacity == drb->reader_idx) {
-        return -1; // storage is full
+    if (drb->used == 0) {
+        // Empty, restart from the beginning to get the most contiguous room.
+        drb->reader_idx = drb->writer_idx = 0;
+        drb->data_end = drb->capacity;
     }
 
-    char *copy = malloc(size);
-    memcpy(copy, data, size);
-    drb->storage[writer_idx].data = copy;
-    drb->storage[writer_idx].size = size;
-    clock_gettime(CLOCK_MONOTONIC, &drb->storage[writer_idx].creation_time);
+    if (drb->used == 0 || drb->writer_idx > drb->reader_idx) {
+        if (drb->capacity - drb->writer_idx >= len) {
+            return drb->writer_idx;
+        }
+        if (drb->reader_idx < len) {
+            return -1;
+        }
+        // Skip the tail which is too small for the record.
+        drb->data_end = drb->writer_idx;
+        drb->used += drb->capacity - drb->writer_idx;
+        drb->writer_idx = 0;
+        return 0;
+    }
 
-    drb->writer_idx = (drb->writer_idx + 1) % drb->capacity;
-    return 0;
+    if (drb->reader_idx - drb->writer_idx >= len) {
+        return drb->writer_idx;
+    }
+    return -1; // storage is full
 }
 
-static void timespec_diff(struct timespec *now, struct timespec *past, struct timespec *diff) {
-    diff->tv_sec = (now)->tv_sec - (past)->tv_sec;
-    diff->tv_nsec = (now)->tv_nsec - (past)->tv_nsec;
-    if (diff->tv_nsec < 0) {
-      --diff->tv_sec;
-      diff->tv_nsec += 1000000000;
+int drb_put(struct delaying_ring_buffer *drb, const char *data, const int size)
+{
+    struct drb_item *item;
+    int len, idx;
+
+    if (size < 0 || size > drb->capacity - (int)sizeof(struct drb_item)) {
+        return -1;
+    }
+    len = DRB_ROUNDUP((int)sizeof(struct drb_item) + size);
+    idx = drb_reserve(drb, len);
+    if (idx < 0) {
+        return -1;
     }
+
+    item = (struct drb_item *)(drb->storage + idx);
+    item->size = size;
+    item->len = len;
+    memcpy(item->data, data, size);
+    clock_gettime(CLOCK_MONOTONIC, &item->creation_time);
+
+    drb->writer_idx = idx + len;
+    if (drb->writer_idx == drb->capacity) {
+        drb->writer_idx = 0;
+    }
+    drb->used += len;
+    return 0;
 }
 
 const struct drb_item *drb_look(struct delaying_ring_buffer *drb)
 {
-    if (drb->reader_idx == drb->writer_idx) {
+    if (drb->used == 0) {
         return NULL;
     }
-    struct timespec now, diff;
+    struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
 
-    struct drb_item *item = &drb->storage[drb->reader_idx];
+    struct drb_item *item = (struct drb_item *)(drb->storage + drb->reader_idx);
 
-    timespec_diff(&now, &item->creation_time, &diff);
-    if (diff.tv_sec == 0 && (diff.tv_nsec / 1000000) < drb->delay_ms) {
+    long diff_ms = (now.tv_sec - item->creation_time.tv_sec) * 1000 +
+                   (now.tv_nsec - item->creation_time.tv_nsec) / 1000000;
+    if (diff_ms < drb->delay_ms) {
         return NULL;
     }
-    return &drb->storage[drb->reader_idx];
+    return item;
 }
 
 int drb_pop(struct delaying_ring_buffer *drb) {
-    if (drb->writer_idx == drb->reader_idx) {
+    if (drb->used == 0) {
         return -1;
     }
-    struct drb_item *item = &drb->storage[drb->reader_idx];
-    free(item->data);
-    drb->reader_idx = (drb->reader_idx + 1) % drb->capacity;
+    struct drb_item *item = (struct drb_item *)(drb->storage + drb->reader_idx);
+    drb->reader_idx += item->len;
+    drb->used -= item->len;
+    if (drb->reader_idx >= drb->data_end) {
+        drb->used -= drb->capacity - drb->data_end;
+        drb->reader_idx = 0;
+        drb->data_end = drb->capacity;
+    }
     return 0;
-}
\ No newline at end of file
+}
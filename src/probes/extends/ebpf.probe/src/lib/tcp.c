@@ -16,7 +16,16 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <uthash.h>
 #include "bpf.h"
+#include "container.h"
 #include "tcp.h"
 
 /*
@@ -43,14 +52,15 @@
 */
 #define SS_ESTAB_COMMAND "ss -anpt | grep ESTAB |  awk '{print $4 \"|\" $5 \"@\" $6}'"
 
-#define LS_SOCK_INODE_CMD \
-    "/usr/bin/ls -l /proc/%u/fd/%u | /usr/bin/awk -F '[' '{print $2}' | /usr/bin/awk -F ']' '{print $1}'"
-
 #define LISTEN_PORTS_LEN  2048
 #define PORT_LEN 11
 #define PID_LEN 32
 #define FID_LEN 32
 
+#define SOCK_DIAG_BUF_SIZE  (32 * 1024)
+#define SOCK_LINK_PREFIX    "socket:["
+#define THREAD_NETNS_PATH   "/proc/thread-self/ns/net"
+
 
 static char __is_digit_str(const char *s)
 {
@@ -360,7 +370,7 @@ err:
 }
 
 
-static int __get_estabs(struct tcp_estabs* tes)
+static int __get_estabs_by_ss(struct tcp_estabs* tes)
 {
     char line[LINE_BUF_LEN];
     FILE *f;
@@ -506,6 +516,7 @@ static struct tcp_listen_port* __new_tlp(const char *s, unsigned int port)
     if (tlp == NULL)
         return NULL;
 
+    (void)memset(tlp, 0, sizeof(struct tcp_listen_port));
     tlp->pid = pid;
     tlp->port = port;
     tlp->fd = fd;
@@ -585,7 +596,7 @@ static int __parse_tlp_line(struct tcp_listen_ports* tlps, const char *s)
     return ret;
 }
 
-static int __get_tlps(struct tcp_listen_ports* tlps)
+static int __get_tlps_by_ss(struct tcp_listen_ports* tlps)
 {
     char line[LISTEN_PORTS_LEN];
     FILE *f;
@@ -608,6 +619,411 @@ static int __get_tlps(struct tcp_listen_ports* tlps)
     return 0;
 }
 
+struct diag_sock_s {
+    unsigned long ino;
+    unsigned char state;
+    unsigned char family;
+    unsigned short sport;       // host byte order
+    unsigned short dport;
+    unsigned int uid;
+    unsigned int src[4];
+    unsigned int dst[4];
+    int owner_num;
+    struct tcp_estab_comm *owners[TCP_ESTAB_COMM_MAX];
+    UT_hash_handle hh;
+};
+
+static void __free_diag_socks(struct diag_sock_s **socks)
+{
+    struct diag_sock_s *sock, *tmp;
+
+    HASH_ITER(hh, *socks, sock, tmp) {
+        HASH_DEL(*socks, sock);
+        for (int i = 0; i < sock->owner_num; i++) {
+            (void)free(sock->owners[i]);
+        }
+        (void)free(sock);
+    }
+}
+
+static int __add_diag_sock(struct diag_sock_s **socks, const struct inet_diag_msg *msg)
+{
+    struct diag_sock_s *sock;
+    unsigned long ino = msg->idiag_inode;
+
+    // Sockets being closed have no inode, nobody owns them.
+    if (ino == 0) {
+        return 0;
+    }
+    HASH_FIND(hh, *socks, &ino, sizeof(ino), sock);
+    if (sock != NULL) {
+        return 0;
+    }
+
+    sock = (struct diag_sock_s *)calloc(1, sizeof(struct diag_sock_s));
+    if (sock == NULL) {
+        return -1;
+    }
+    sock->ino = ino;
+    sock->state = msg->idiag_state;
+    sock->family = msg->idiag_family;
+    sock->sport = ntohs(msg->id.idiag_sport);
+    sock->dport = ntohs(msg->id.idiag_dport);
+    sock->uid = msg->idiag_uid;
+    (void)memcpy(sock->src, msg->id.idiag_src, sizeof(sock->src));
+    (void)memcpy(sock->dst, msg->id.idiag_dst, sizeof(sock->dst));
+    HASH_ADD(hh, *socks, ino, sizeof(sock->ino), sock);
+    return 0;
+}
+
+static int __diag_dump_family(int nl_fd, unsigned char family, unsigned int states, struct diag_sock_s **socks)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } request;
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+    const struct nlmsghdr *nlh;
+    const struct nlmsgerr *err;
+    char *buf;
+    ssize_t len;
+    int ret = -1;
+
+    (void)memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = sizeof(request);
+    request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.nlh.nlmsg_seq = family;
+    request.req.sdiag_family = family;
+    request.req.sdiag_protocol = IPPROTO_TCP;
+    request.req.idiag_states = states;
+
+    if (sendto(nl_fd, &request, sizeof(request), 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return -1;
+    }
+
+    buf = (char *)malloc(SOCK_DIAG_BUF_SIZE);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    for (;;) {
+        len = recv(nl_fd, buf, SOCK_DIAG_BUF_SIZE, 0);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            goto out;
+        }
+
+        for (nlh = (const struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                ret = 0;
+                goto out;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                err = (const struct nlmsgerr *)NLMSG_DATA(nlh);
+                errno = -err->error;
+                goto out;
+            }
+            if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+                continue;
+            }
+            if (__add_diag_sock(socks, (const struct inet_diag_msg *)NLMSG_DATA(nlh))) {
+                goto out;
+            }
+        }
+    }
+
+out:
+    (void)free(buf);
+    return ret;
+}
+
+/* Move calling thread to the net namespace of pid, 0 means staying in the current one. */
+static int __enter_netns(unsigned int pid, int *orig_fd)
+{
+    *orig_fd = -1;
+    if (pid == 0) {
+        return 0;
+    }
+
+    *orig_fd = open(THREAD_NETNS_PATH, O_RDONLY | O_CLOEXEC);
+    if (*orig_fd < 0) {
+        return -1;
+    }
+    if (enter_proc_netns(pid)) {
+        (void)close(*orig_fd);
+        *orig_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void __exit_netns(int orig_fd)
+{
+    if (orig_fd < 0) {
+        return;
+    }
+    if (exit_container_netns(orig_fd)) {
+        ERROR("[TCP] Failed to restore net namespace: %s.\n", strerror(errno));
+    }
+    (void)close(orig_fd);
+}
+
+/* A netlink socket keeps serving the net namespace it is created in, only creating it switches netns. */
+static int __diag_socket(unsigned int pid)
+{
+    int nl_fd, orig_fd;
+
+    if (__enter_netns(pid, &orig_fd)) {
+        return -1;
+    }
+    nl_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    __exit_netns(orig_fd);
+    return nl_fd;
+}
+
+/* Dump TCP sockets in given states of the net namespace of pid(0: current one). */
+static int __diag_dump(unsigned int pid, unsigned int states, struct diag_sock_s **socks)
+{
+    int nl_fd, ret;
+
+    nl_fd = __diag_socket(pid);
+    if (nl_fd < 0) {
+        return -1;
+    }
+
+    ret = __diag_dump_family(nl_fd, AF_INET, states, socks);
+    if (ret == 0) {
+        ret = __diag_dump_family(nl_fd, AF_INET6, states, socks);
+    }
+    (void)close(nl_fd);
+    return ret;
+}
+
+static void __read_proc_comm(const char *pid, char comm[], unsigned int len)
+{
+    char path[PATH_LEN];
+    FILE *f;
+
+    comm[0] = 0;
+    path[0] = 0;
+    (void)snprintf(path, sizeof(path), "/proc/%s/comm", pid);
+    f = fopen(path, "r");
+    if (f == NULL) {
+        return;
+    }
+    if (fgets(comm, (int)len, f) == NULL) {
+        comm[0] = 0;
+    }
+    SPLIT_NEWLINE_SYMBOL(comm);
+    (void)fclose(f);
+}
+
+static void __scan_proc_fds(const char *pid, struct diag_sock_s *socks)
+{
+    char path[PATH_LEN];
+    char link[PATH_LEN];
+    char comm[TASK_COMM_LEN];
+    DIR *dir;
+    struct dirent *entry;
+    struct diag_sock_s *sock;
+    struct tcp_estab_comm *owner;
+    unsigned long ino;
+    ssize_t len;
+
+    path[0] = 0;
+    (void)snprintf(path, sizeof(path), "/proc/%s/fd", pid);
+    dir = opendir(path);
+    if (dir == NULL) {
+        return;
+    }
+
+    comm[0] = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        len = readlinkat(dirfd(dir), entry->d_name, link, sizeof(link) - 1);
+        if (len <= (ssize_t)strlen(SOCK_LINK_PREFIX)) {
+            continue;
+        }
+        link[len] = 0;
+        if (strncmp(link, SOCK_LINK_PREFIX, strlen(SOCK_LINK_PREFIX)) != 0) {
+            continue;
+        }
+
+        ino = strtoul(link + strlen(SOCK_LINK_PREFIX), NULL, 10);
+        HASH_FIND(hh, socks, &ino, sizeof(ino), sock);
+        if (sock == NULL || sock->owner_num >= TCP_ESTAB_COMM_MAX) {
+            continue;
+        }
+
+        owner = (struct tcp_estab_comm *)malloc(sizeof(struct tcp_estab_comm));
+        if (owner == NULL) {
+            break;
+        }
+        if (comm[0] == 0) {
+            __read_proc_comm(pid, comm, sizeof(comm));
+        }
+        (void)snprintf(owner->comm, sizeof(owner->comm), "%s", comm);
+        owner->pid = strtoul(pid, NULL, 10);
+        owner->fd = strtoul(entry->d_name, NULL, 10);
+        sock->owners[sock->owner_num++] = owner;
+    }
+    (void)closedir(dir);
+}
+
+/* Find owners(pid, fd, comm) of dumped sockets by one walk through /proc. */
+static void __scan_sock_owners(struct diag_sock_s *socks)
+{
+    DIR *dir;
+    struct dirent *entry;
+
+    if (socks == NULL) {
+        return;
+    }
+
+    dir = opendir("/proc");
+    if (dir == NULL) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        __scan_proc_fds(entry->d_name, socks);
+    }
+    (void)closedir(dir);
+}
+
+static int __get_tlps_by_diag(struct tcp_listen_ports* tlps, unsigned int pid)
+{
+    struct diag_sock_s *socks = NULL, *sock, *tmp;
+    struct tcp_listen_port* tlp;
+    int i;
+
+    if (__diag_dump(pid, 1 << TCP_LISTEN, &socks)) {
+        __free_diag_socks(&socks);
+        return -1;
+    }
+    __scan_sock_owners(socks);
+
+    HASH_ITER(hh, socks, sock, tmp) {
+        if (sock->sport >= PORT_MAX_NUM) {
+            continue;
+        }
+        for (i = 0; i < sock->owner_num; i++) {
+            tlp = (struct tcp_listen_port *)malloc(sizeof(struct tcp_listen_port));
+            if (tlp == NULL) {
+                goto out;
+            }
+            tlp->pid = sock->owners[i]->pid;
+            tlp->port = sock->sport;
+            tlp->fd = sock->owners[i]->fd;
+            tlp->uid = sock->uid;
+            tlp->ino = sock->ino;
+            (void)memcpy(tlp->comm, sock->owners[i]->comm, TASK_COMM_LEN);
+            if (__add_tlp(tlps, tlp) < 0) {
+                (void)free(tlp);
+                goto out;
+            }
+        }
+    }
+
+out:
+    __free_diag_socks(&socks);
+    return 0;
+}
+
+static void __diag_ip_addr(unsigned char family, const unsigned int addr[], unsigned short port,
+                           struct ip_addr* ip_addr)
+{
+    ip_addr->ip[0] = 0;
+    (void)inet_ntop(family, (const void *)addr, ip_addr->ip, sizeof(ip_addr->ip));
+    ip_addr->port = port;
+    ip_addr->ipv4 = (family == AF_INET) ? 1 : 0;
+}
+
+static int __get_estabs_by_diag(struct tcp_estabs* tes, unsigned int pid)
+{
+    struct diag_sock_s *socks = NULL, *sock, *tmp;
+    struct tcp_estab* te;
+    int i;
+
+    if (__diag_dump(pid, 1 << TCP_ESTABLISHED, &socks)) {
+        __free_diag_socks(&socks);
+        return -1;
+    }
+    __scan_sock_owners(socks);
+
+    HASH_ITER(hh, socks, sock, tmp) {
+        if (sock->owner_num == 0) {
+            continue;
+        }
+
+        te = __new_estab();
+        if (te == NULL) {
+            break;
+        }
+        te->uid = sock->uid;
+        te->ino = sock->ino;
+        __diag_ip_addr(sock->family, sock->src, sock->sport, &te->local);
+        __diag_ip_addr(sock->family, sock->dst, sock->dport, &te->remote);
+
+        // Owners are moved to estab tcp.
+        for (i = 0; i < sock->owner_num; i++) {
+            te->te_comm[i] = sock->owners[i];
+        }
+        te->te_comm_num = sock->owner_num;
+        sock->owner_num = 0;
+
+        if (__add_estab(tes, te) < 0) {
+            __free_estab(&te);
+            break;
+        }
+    }
+
+    __free_diag_socks(&socks);
+    return 0;
+}
+
+static int __get_tlps(struct tcp_listen_ports* tlps, unsigned int pid)
+{
+    int orig_fd, ret;
+
+    if (__get_tlps_by_diag(tlps, pid) == 0) {
+        return 0;
+    }
+    DEBUG("[TCP] sock_diag is unavailable(%s), use ss instead.\n", strerror(errno));
+
+    // ss inherits the net namespace of calling thread.
+    if (__enter_netns(pid, &orig_fd)) {
+        return -1;
+    }
+    ret = __get_tlps_by_ss(tlps);
+    __exit_netns(orig_fd);
+    return ret;
+}
+
+static int __get_estabs(struct tcp_estabs* tes, unsigned int pid)
+{
+    int orig_fd, ret;
+
+    if (__get_estabs_by_diag(tes, pid) == 0) {
+        return 0;
+    }
+    DEBUG("[TCP] sock_diag is unavailable(%s), use ss instead.\n", strerror(errno));
+
+    if (__enter_netns(pid, &orig_fd)) {
+        return -1;
+    }
+    ret = __get_estabs_by_ss(tes);
+    __exit_netns(orig_fd);
+    return ret;
+}
+
 char is_listen_port(unsigned int port, struct tcp_listen_ports* tlps)
 {
     if (port >= PORT_MAX_NUM)
@@ -617,6 +1033,11 @@ char is_listen_port(unsigned int port, struct tcp_listen_ports* tlps)
 }
 
 struct tcp_listen_ports* get_listen_ports(void)
+{
+    return get_netns_listen_ports(0);
+}
+
+struct tcp_listen_ports* get_netns_listen_ports(unsigned int pid)
 {
     struct tcp_listen_ports* tlps;
     int ret;
@@ -625,7 +1046,7 @@ struct tcp_listen_ports* get_listen_ports(void)
     if (tlps == NULL)
         return NULL;
 
-    ret = __get_tlps(tlps);
+    ret = __get_tlps(tlps, pid);
     if (ret < 0) {
         __free_tlps(&tlps);
         return NULL;
@@ -640,29 +1061,36 @@ void free_listen_ports(struct tcp_listen_ports** ptlps)
 
 int get_listen_sock_inode(struct tcp_listen_port *tlp, unsigned long *ino)
 {
-    FILE *f = NULL;
-    char cmd[COMMAND_LEN];
-    char line[LINE_BUF_LEN];
+    char path[PATH_LEN];
+    char link[PATH_LEN];
+    ssize_t len;
 
-    cmd[0] = 0;
-    (void)snprintf(cmd, COMMAND_LEN, LS_SOCK_INODE_CMD, tlp->pid, tlp->fd);
-    f = popen(cmd, "r");
-    if (f == NULL) {
+    // Known already if the port is found by sock_diag
+    if (tlp->ino != 0) {
+        *ino = tlp->ino;
+        return 0;
+    }
+
+    path[0] = 0;
+    (void)snprintf(path, sizeof(path), "/proc/%u/fd/%u", tlp->pid, tlp->fd);
+    len = readlink(path, link, sizeof(link) - 1);
+    if (len <= 0) {
         return -1;
     }
-    line[0] = 0;
-    if (fgets(line, sizeof(line), f) == NULL) {
-        (void)pclose(f);
+    link[len] = 0;
+    if (strncmp(link, SOCK_LINK_PREFIX, strlen(SOCK_LINK_PREFIX)) != 0) {
         return -1;
     }
-    SPLIT_NEWLINE_SYMBOL(line);
-    *ino = strtol(line, NULL, 10);
-
-    (void)pclose(f);
+    *ino = strtoul(link + strlen(SOCK_LINK_PREFIX), NULL, 10);
     return 0;
 }
 
 struct tcp_estabs* get_estab_tcps(struct tcp_listen_ports* tlps)
+{
+    return get_netns_estab_tcps(tlps, 0);
+}
+
+struct tcp_estabs* get_netns_estab_tcps(struct tcp_listen_ports* tlps, unsigned int pid)
 {
     struct tcp_estabs* tes;
     int ret;
@@ -671,7 +1099,7 @@ struct tcp_estabs* get_estab_tcps(struct tcp_listen_ports* tlps)
     if (tes == NULL)
         return NULL;
 
-    ret = __get_estabs(tes);
+    ret = __get_estabs(tes, pid);
     if (ret < 0) {
         __free_estabs(&tes);
         return NULL;
@@ -27,6 +27,7 @@
 #endif
 
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "ipc.h"
 #include "trace_lvs.h"
 
@@ -100,94 +101,90 @@ static void update_ipvs_collect_map(const struct link_key *k, unsigned short pro
     return;
 }
 
-static void pull_probe_data(int fd, int collect_fd)
+static int pull_link(const void *key, const void *val, void *ctx)
 {
-    int ret = 0;
-    struct link_key   key = {0};
-    struct link_key   next_key = {0};
-    struct link_value value;
+    const struct link_key *link_key = key;
+    const struct link_value *value = val;
+    int collect_fd = *(int *)ctx;
     char ip_pro_str[INET6_ADDRSTRLEN];
     unsigned char cli_ip_str[INET6_ADDRSTRLEN];
     unsigned char vir_ip_str[INET6_ADDRSTRLEN];
     unsigned char loc_ip_str[INET6_ADDRSTRLEN];
     unsigned char src_ip_str[INET6_ADDRSTRLEN];
 
-    while (bpf_map_get_next_key(fd, &key, &next_key) == 0) {
-        ret = bpf_map_lookup_elem(fd, &next_key, &value);
-        if (ret == 0) {
-            ippro_to_str(value.protocol, ip_pro_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.c_addr), cli_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.v_addr), vir_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(value.l_addr), loc_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.s_addr), src_ip_str, INET6_ADDRSTRLEN);
-            LVS_DEBUG("LVS new connect protocol[%s] type[%s] c[%s:%d]--v[%s:%d]--l[%s:%d]--s[%s:%d] state[%d]. \n",
-                ip_pro_str,
-                (next_key.family == AF_INET) ? "IPv4" : "IPv6",
-                cli_ip_str,
-                ntohs(next_key.c_port),
-                vir_ip_str,
-                ntohs(next_key.v_port),
-                loc_ip_str,
-                ntohs(value.l_port),
-                src_ip_str,
-                ntohs(next_key.s_port),
-                value.state);
-            /* update collect map */
-            update_ipvs_collect_map(&next_key, value.protocol, &value.l_addr, value.l_port, collect_fd);
-        }
-        if (value.state == IP_VS_TCP_S_CLOSE) {
-            (void)bpf_map_delete_elem(fd, &next_key);
-        } else {
-            key = next_key;
-        }
-    }
+    ippro_to_str(value->protocol, ip_pro_str, INET6_ADDRSTRLEN);
+    ip_str(link_key->family, (unsigned char *)&(link_key->c_addr), cli_ip_str, INET6_ADDRSTRLEN);
+    ip_str(link_key->family, (unsigned char *)&(link_key->v_addr), vir_ip_str, INET6_ADDRSTRLEN);
+    ip_str(link_key->family, (unsigned char *)&(value->l_addr), loc_ip_str, INET6_ADDRSTRLEN);
+    ip_str(link_key->family, (unsigned char *)&(link_key->s_addr), src_ip_str, INET6_ADDRSTRLEN);
+    LVS_DEBUG("LVS new connect protocol[%s] type[%s] c[%s:%d]--v[%s:%d]--l[%s:%d]--s[%s:%d] state[%d]. \n",
+        ip_pro_str,
+        (link_key->family == AF_INET) ? "IPv4" : "IPv6",
+        cli_ip_str,
+        ntohs(link_key->c_port),
+        vir_ip_str,
+        ntohs(link_key->v_port),
+        loc_ip_str,
+        ntohs(value->l_port),
+        src_ip_str,
+        ntohs(link_key->s_port),
+        value->state);
+    /* update collect map */
+    update_ipvs_collect_map(link_key, value->protocol, &value->l_addr, value->l_port, collect_fd);
+
+    return (value->state == IP_VS_TCP_S_CLOSE) ? MAP_ITER_DELETE : MAP_ITER_CONTINUE;
 }
 
-static void print_ipvs_collect(int map_fd)
+static void pull_probe_data(int fd, int collect_fd)
 {
-    int ret = 0;
-    struct collect_key  key = {0};
-    struct collect_key  next_key = {0};
-    struct collect_value    value = {0};
+    (void)bpf_map_iter(fd, sizeof(struct link_key), sizeof(struct link_value), pull_link, &collect_fd);
+}
 
+static int print_ipvs_link(const void *key, const void *val, void *ctx)
+{
+    const struct collect_key *collect_key = key;
+    const struct collect_value *value = val;
     unsigned char cli_ip_str[INET6_ADDRSTRLEN];
     unsigned char vir_ip_str[INET6_ADDRSTRLEN];
     unsigned char loc_ip_str[INET6_ADDRSTRLEN];
     unsigned char src_ip_str[INET6_ADDRSTRLEN];
 
-    while (bpf_map_get_next_key(map_fd, &key, &next_key) == 0) {
-        ret = bpf_map_lookup_elem(map_fd, &next_key, &value);
-        if (ret == 0) {
-            ip_str(next_key.family, (unsigned char *)&(next_key.c_addr), cli_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.v_addr), vir_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.s_addr), src_ip_str, INET6_ADDRSTRLEN);
-            ip_str(next_key.family, (unsigned char *)&(next_key.l_addr), loc_ip_str, INET6_ADDRSTRLEN);
-            fprintf(stdout,
-                "|%s|%s|%s|%s|%s|%s|%u|%u|%u|%u|%u|%llu|\n",
-                METRIC_NAME_LVS_LINK,
-                "ipvs",
-                cli_ip_str,
-                vir_ip_str,
-                loc_ip_str,
-                src_ip_str,
-                ntohs(next_key.c_port),
-                ntohs(next_key.v_port),
-                ntohs(next_key.l_port),
-                ntohs(next_key.s_port),
-                value.protocol,
-                value.link_count);
-
-            LVS_DEBUG("collect c_ip[%s], v_ip[%s:%d] l_ip[%s] s_ip[%s:%d] link_count[%lld]. \n",
-                cli_ip_str,
-                vir_ip_str,
-                ntohs(next_key.v_port),
-                loc_ip_str,
-                src_ip_str,
-                ntohs(next_key.s_port),
-                value.link_count);
-        }
-        (void)bpf_map_delete_elem(map_fd, &next_key);
-    }
+    ip_str(collect_key->family, (unsigned char *)&(collect_key->c_addr), cli_ip_str, INET6_ADDRSTRLEN);
+    ip_str(collect_key->family, (unsigned char *)&(collect_key->v_addr), vir_ip_str, INET6_ADDRSTRLEN);
+    ip_str(collect_key->family, (unsigned char *)&(collect_key->s_addr), src_ip_str, INET6_ADDRSTRLEN);
+    ip_str(collect_key->family, (unsigned char *)&(collect_key->l_addr), loc_ip_str, INET6_ADDRSTRLEN);
+
+    fprintf(stdout,
+        "|%s|%s|%s|%s|%s|%s|%u|%u|%u|%u|%u|%llu|\n",
+        METRIC_NAME_LVS_LINK,
+        "ipvs",
+        cli_ip_str,
+        vir_ip_str,
+        loc_ip_str,
+        src_ip_str,
+        ntohs(collect_key->c_port),
+        ntohs(collect_key->v_port),
+        ntohs(collect_key->l_port),
+        ntohs(collect_key->s_port),
+        value->protocol,
+        value->link_count);
+
+    LVS_DEBUG("collect c_ip[%s], v_ip[%s:%d] l_ip[%s] s_ip[%s:%d] link_count[%lld]. \n",
+        cli_ip_str,
+        vir_ip_str,
+        ntohs(collect_key->v_port),
+        loc_ip_str,
+        src_ip_str,
+        ntohs(collect_key->s_port),
+        value->link_count);
+
+    return MAP_ITER_CONTINUE;
+}
+
+static void print_ipvs_collect(int map_fd)
+{
+    // Links are counted per period, the collect map is emptied once printed.
+    (void)bpf_map_drain(map_fd, sizeof(struct collect_key), sizeof(struct collect_value), print_ipvs_link, NULL);
     (void)fflush(stdout);
     return;
 }
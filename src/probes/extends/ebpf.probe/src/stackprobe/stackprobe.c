@@ -38,6 +38,7 @@
 #endif
 
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "ipc.h"
 #include "hash.h"
 #include "logs.h"
@@ -1879,33 +1880,26 @@ static struct bpf_link_hash_t* find_bpf_link(unsigned int pid)
 /*
 [root@localhost ~]# ps -e -o pid,comm | grep gaussdb | awk '{print $1}'
 */
-static int add_pids(void)
+static int add_pid(const void *key, const void *value, void *ctx)
 {
-    unsigned int pid = 0;
-    int ret = 0;
-    int proc_obj_map_fd = g_st->proc_obj_map_fd;
-    struct proc_s key = {0};
-    struct proc_s next_key = {0};
-    struct obj_ref_s value = {0};
+    unsigned int pid = ((const struct proc_s *)key)->proc_id;
 
-    while (bpf_map_get_next_key(proc_obj_map_fd, &key, &next_key) == 0) {
-        ret = bpf_map_lookup_elem(proc_obj_map_fd, &next_key, &value);
-        key = next_key;
-        if (ret < 0) {
-            continue;
-        }
-        pid = key.proc_id;
-        // find_bpf_link and add_bpf_link will set bpf_link status
-        if (!find_bpf_link(pid)) {
-            if (add_bpf_link(pid) != 0) {
-                ERROR("[STACKPROBE]: add pid %u failed\n", pid);
-            } else {
-                DEBUG("[STACKPROBE]: add of pid %u success\n", pid);
-            }
+    // find_bpf_link and add_bpf_link will set bpf_link status
+    if (!find_bpf_link(pid)) {
+        if (add_bpf_link(pid) != 0) {
+            ERROR("[STACKPROBE]: add pid %u failed\n", pid);
+        } else {
+            DEBUG("[STACKPROBE]: add of pid %u success\n", pid);
         }
     }
+    return MAP_ITER_CONTINUE;
+}
 
-    return ret;
+static int add_pids(void)
+{
+    int ret = bpf_map_iter(g_st->proc_obj_map_fd, sizeof(struct proc_s), sizeof(struct obj_ref_s), add_pid, NULL);
+
+    return (ret < 0) ? -1 : 0;
 }
 
 static void clear_invalid_pids()
@@ -2078,11 +2072,8 @@ static int attach_mem_bpf_prog(struct ipc_body_s *ipc_body, struct svg_stack_tra
 
 static void clear_stackmap(int stackmap_fd)
 {
-    u32 stackid = 0, next_id;
-    while (bpf_map_get_next_key(stackmap_fd, &stackid, &next_id) == 0) {
-        bpf_map_delete_elem(stackmap_fd, &next_id);
-        stackid = next_id;
-    }
+    // Stack trace maps have no batch ops, only keys are walked.
+    (void)bpf_map_drain(stackmap_fd, sizeof(u32), 0, NULL, NULL);
 }
 
 static void clear_running_ctx(struct stack_trace_s *st)
@@ -56,7 +56,7 @@ static __always_inline void report_abn(void *ctx, struct tcp_metrics_s *metrics,
     u32 last_time_sk_drops = metrics->abn_stats.sk_drops;
     u32 last_time_lost_out = metrics->abn_stats.lost_out;
 
-    (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+    report_tcp_metrics(ctx, metrics);
 
     __builtin_memset(&(metrics->abn_stats), 0x0, sizeof(metrics->abn_stats));
     metrics->abn_stats.last_time_sk_drops = last_time_sk_drops;
@@ -153,7 +153,7 @@ static void set_estab_tcps_finished_flag(struct estab_tcp_hash_t **pphead)
 
 #if 1
 
-static void do_lkup_established_tcp_info(void)
+static void do_lkup_established_tcp_info(u32 pid)
 {
     int i, j;
     u8 role;
@@ -162,12 +162,13 @@ static void do_lkup_established_tcp_info(void)
     struct estab_tcp_key k;
     struct estab_tcp_hash_t *item;
 
-    tlps = get_listen_ports();
+    tlps = get_netns_listen_ports(pid);
     if (tlps == NULL) {
+        ERROR("[TCPPROBE]: Get listen ports failed.(%u)\n", pid);
         goto err;
     }
 
-    tes = get_estab_tcps(tlps);
+    tes = get_netns_estab_tcps(tlps, pid);
     if (tes == NULL) {
         goto err;
     }
@@ -208,16 +209,6 @@ err:
     return;
 }
 
-static int get_netns_fd(pid_t pid)
-{
-    const char *fmt = "/proc/%d/ns/net";
-    char path[PATH_LEN];
-
-    path[0] = 0;
-    (void)snprintf(path, PATH_LEN, fmt, pid);
-    return open(path, O_RDONLY);
-}
-
 /*
  * 查询tcp探针启动前系统中已创建的tcp连接信息
  *   1. 全局只获取一次主机netns下的tcp连接信息
@@ -225,11 +216,9 @@ static int get_netns_fd(pid_t pid)
  */
 void lkup_established_tcp(int proc_map_fd, struct ipc_body_s *ipc_body)
 {
-    int netns_fd = 0;
     struct proc_s key = {0};
     struct obj_ref_s val = {0};
     static char host_netns_flag = 0;   // 全局只获取一次主机netns下的tcp连接信息
-    int ret;
     int i;
 
     /* Ensure that newly added TCP connections of the process overwrites the existing TCP connections. */
@@ -237,16 +226,10 @@ void lkup_established_tcp(int proc_map_fd, struct ipc_body_s *ipc_body)
 
     if (!host_netns_flag) {
         INFO("[TCPPROBE]: Lookup established tcp for host netns...\n");
-        do_lkup_established_tcp_info();
+        do_lkup_established_tcp_info(0);
         host_netns_flag = 1;
     }
 
-    netns_fd = get_netns_fd(getpid());
-    if (netns_fd <= 0) {
-        ERROR("[TCPPROBE]: Get netns fd failed.\n");
-        return;
-    }
-
     for (i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
         if (ipc_body->snooper_objs[i].type != SNOOPER_OBJ_PROC) {
             continue;
@@ -258,18 +241,10 @@ void lkup_established_tcp(int proc_map_fd, struct ipc_body_s *ipc_body)
         }
 
         if (is_container_proc(key.proc_id)) {
-            ret = enter_proc_netns(key.proc_id);
-            if (ret) {
-                ERROR("[TCPPROBE]: Enter container netns failed.(%u, ret = %d)\n", key.proc_id, ret);
-                continue;
-            }
             INFO("[TCPPROBE]: Lookup established tcp for container netns of proc:%u ...\n", key.proc_id);
-            do_lkup_established_tcp_info();
-            (void)exit_container_netns(netns_fd);
+            do_lkup_established_tcp_info(key.proc_id);
         }
     }
-
-    (void)close(netns_fd);
 }
 
 #endif
@@ -34,7 +34,7 @@ static __always_inline void report_srtt(void *ctx, struct tcp_metrics_s *metrics
     u32 probe_flags = get_probe_flags();
     if (probe_flags & PROBE_RANGE_TCP_SRTT) {
         metrics->report_flags |= TCP_PROBE_SRTT;
-        (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+        report_tcp_metrics(ctx, metrics);
         metrics->report_flags &= ~TCP_PROBE_SRTT;
     }
 }
@@ -109,7 +109,7 @@ static __always_inline void report_tcp_close(void *ctx, struct sock *sk, struct
     u32 last_time_segs_out = metrics->tx_rx_stats.segs_out;
     u32 last_time_segs_in = metrics->tx_rx_stats.segs_in;
 
-    (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+    report_tcp_metrics(ctx, metrics);
 
     metrics->report_flags &= ~TCP_CLOSE_FLAG;
 
@@ -229,7 +229,7 @@ KPROBE(tcp_recvmsg, pt_regs)
 static __always_inline void report_toa(void *ctx, struct tcp_metrics_s *metrics)
 {
     metrics->report_flags |= TCP_PROBE_TOA;
-    (void) bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+    report_tcp_metrics(ctx, metrics);
     metrics->report_flags &= ~TCP_PROBE_TOA;
 }
 
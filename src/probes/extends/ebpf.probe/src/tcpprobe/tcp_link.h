@@ -68,6 +68,24 @@ struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
     __uint(max_entries, 64);
 } tcp_output SEC(".maps");
+
+#define __TCP_AGGR_MAX (10 * 1024)
+// Used to aggregate metrics of all sockets of a tcp tracker if kernel_aggr is set.
+// Harvested and emptied by user space once per report period.
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(key_size, sizeof(struct tcp_aggr_key_s));
+    __uint(value_size, sizeof(struct tcp_aggr_s));
+    __uint(max_entries, __TCP_AGGR_MAX);
+} tcp_aggr_map SEC(".maps");
+
+// Never updated, initial value of tcp_aggr_map which is too big for the bpf stack.
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(key_size, sizeof(u32));  // const value 0
+    __uint(value_size, sizeof(struct tcp_aggr_s));
+    __uint(max_entries, 1);
+} tcp_aggr_zero SEC(".maps");
 #endif
 
 #define __TCP_FD_MAX (50)
@@ -107,6 +125,13 @@ static __always_inline __maybe_unused u32 get_probe_flags(void)
     return 0;
 }
 
+static __always_inline __maybe_unused struct tcp_args_s *get_tcp_args(void)
+{
+    u32 key = 0;
+
+    return (struct tcp_args_s *)bpf_map_lookup_elem(&args_map, &key);
+}
+
 static __always_inline __maybe_unused char is_valid_tgid(u32 tgid)
 {
     struct proc_s obj = {.proc_id = tgid};
@@ -168,6 +193,265 @@ static __always_inline __maybe_unused void delete_sock_obj(struct sock *sk)
     (void)bpf_map_delete_elem(&sock_map, &sk);
 }
 
+#ifndef TCP_FD_BPF
+/* Bucket ranges are the same as tcp_xxx_histios in tcp_tracker.c, -1 if the value is out of all ranges. */
+static __always_inline int get_wind_bucket(u64 value)
+{
+    u64 max = 1000;
+
+    if (value == 0) {
+        return -1;
+    }
+#pragma unroll
+    for (int i = 0; i < 5; i++) {
+        if (value <= max) {
+            return i;
+        }
+        max *= 10;
+    }
+    return -1;
+}
+
+static __always_inline int get_sockbuf_bucket(u64 value)
+{
+    u64 max = 131072;
+
+    if (value == 0) {
+        return -1;
+    }
+#pragma unroll
+    for (int i = 0; i < 8; i++) {
+        if (value <= max) {
+            return i;
+        }
+        max *= 2;
+    }
+    return -1;
+}
+
+static __always_inline int get_rtt_bucket(u64 value)
+{
+    if (value == 0) {
+        return -1;
+    }
+    if (value <= 50) {
+        return 0;
+    }
+    if (value <= 100) {
+        return 1;
+    }
+    if (value <= 200) {
+        return 2;
+    }
+    if (value <= 500) {
+        return 3;
+    }
+    return (value <= 1000) ? 4 : -1;
+}
+
+static __always_inline int get_rto_bucket(u64 value)
+{
+    if (value == 0) {
+        return -1;
+    }
+    if (value <= 1000) {
+        return 0;
+    }
+    if (value <= 10000) {
+        return 1;
+    }
+    if (value <= 20000) {
+        return 2;
+    }
+    if (value <= 40000) {
+        return 3;
+    }
+    return (value <= 80000) ? 4 : -1;
+}
+
+#define TCP_AGGR_CAS_RETRY  4
+static __always_inline void aggr_histo_add(struct tcp_aggr_s *aggr, int histo, int bucket, u64 value)
+{
+    struct tcp_aggr_histo_s *h;
+    u64 max, old;
+
+    if (histo < 0 || histo >= TCP_AGGR_HISTO_MAX || bucket < 0 || bucket >= TCP_AGGR_BUCKET_MAX) {
+        return;
+    }
+    h = &(aggr->histos[histo]);
+    __sync_fetch_and_add(&(h->counts[bucket]), 1);
+    __sync_fetch_and_add(&(h->sum), value);
+
+    // Sockets of a tracker race on other CPUs, retries are bounded for verifier.
+    max = h->max;
+#pragma clang loop unroll(full)
+    for (int i = 0; i < TCP_AGGR_CAS_RETRY; i++) {
+        if (value <= max) {
+            break;
+        }
+        old = __sync_val_compare_and_swap(&(h->max), max, value);
+        if (old == max) {
+            break;
+        }
+        max = old;
+    }
+}
+
+static __always_inline u32 get_delta(u32 value, u32 last_value)
+{
+    return (value >= last_value) ? (value - last_value) : value;
+}
+
+static __always_inline struct tcp_aggr_s *get_tcp_aggr(const struct tcp_link_s *link, u16 report_cport)
+{
+    u32 zero = 0;
+    struct tcp_aggr_key_s key = {0};
+    struct tcp_aggr_s *aggr, *init;
+
+    key.tgid = link->tgid;
+    key.family = link->family;
+    key.role = link->role;
+    key.s_port = link->s_port;
+    key.c_port = report_cport ? link->c_port : 0;
+    __builtin_memcpy(key.c_ip6, link->c_ip6, IP6_LEN);
+    __builtin_memcpy(key.s_ip6, link->s_ip6, IP6_LEN);
+
+    aggr = (struct tcp_aggr_s *)bpf_map_lookup_elem(&tcp_aggr_map, &key);
+    if (aggr) {
+        return aggr;
+    }
+
+    init = (struct tcp_aggr_s *)bpf_map_lookup_elem(&tcp_aggr_zero, &zero);
+    if (init == NULL) {
+        return NULL;
+    }
+    (void)bpf_map_update_elem(&tcp_aggr_map, &key, init, BPF_NOEXIST);
+    aggr = (struct tcp_aggr_s *)bpf_map_lookup_elem(&tcp_aggr_map, &key);
+    if (aggr) {
+        __builtin_memcpy(aggr->comm, link->comm, TASK_COMM_LEN);
+    }
+    return aggr;
+}
+
+/*
+ * Fold the metrics a socket is about to output into its tracker, the same way as proc_tcp_xxx() in user space.
+ * Returns -1 if the tracker cannot be added, e.g. tcp_aggr_map is full.
+ */
+static __always_inline int aggr_tcp_metrics(const struct tcp_metrics_s *metrics, u16 report_cport)
+{
+    struct tcp_aggr_s *aggr;
+    u32 flags = metrics->report_flags & TCP_AGGR_FLAGS;
+
+    if (flags == 0) {
+        return 0;
+    }
+    aggr = get_tcp_aggr(&(metrics->link), report_cport);
+    if (aggr == NULL) {
+        return -1;
+    }
+
+    if (flags & TCP_PROBE_TXRX) {
+        const struct tcp_tx_rx *data = &(metrics->tx_rx_stats);
+        TCP_TX_XADD(aggr->tx_rx_stats, data->tx);
+        TCP_RX_XADD(aggr->tx_rx_stats, data->rx);
+        __sync_fetch_and_add(&(aggr->tx_rx_stats.segs_out), get_delta(data->segs_out, data->last_time_segs_out));
+        __sync_fetch_and_add(&(aggr->tx_rx_stats.segs_in), get_delta(data->segs_in, data->last_time_segs_in));
+    }
+
+    if (flags & TCP_PROBE_ABN) {
+        const struct tcp_abn *data = &(metrics->abn_stats);
+        TCP_RETRANS_INC(aggr->abn_stats, data->total_retrans);
+        __sync_fetch_and_add(&(aggr->abn_stats.backlog_drops), data->backlog_drops);
+        __sync_fetch_and_add(&(aggr->abn_stats.filter_drops), data->filter_drops);
+        __sync_fetch_and_add(&(aggr->abn_stats.sk_drops), get_delta(data->sk_drops, data->last_time_sk_drops));
+        __sync_fetch_and_add(&(aggr->abn_stats.lost_out), get_delta(data->lost_out, data->last_time_lost_out));
+        __sync_fetch_and_add(&(aggr->abn_stats.tmout), data->tmout);
+        __sync_fetch_and_add(&(aggr->abn_stats.sndbuf_limit), data->sndbuf_limit);
+        __sync_fetch_and_add(&(aggr->abn_stats.rmem_scheduls), data->rmem_scheduls);
+        __sync_fetch_and_add(&(aggr->abn_stats.tcp_oom), data->tcp_oom);
+        __sync_fetch_and_add(&(aggr->abn_stats.send_rsts), data->send_rsts);
+        __sync_fetch_and_add(&(aggr->abn_stats.receive_rsts), data->receive_rsts);
+        if (data->sacked_out > aggr->abn_stats.sacked_out) {
+            aggr->abn_stats.sacked_out = data->sacked_out;
+        }
+    }
+
+    if (flags & TCP_PROBE_WINDOWS) {
+        const struct tcp_windows *data = &(metrics->win_stats);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_SND, get_wind_bucket(data->tcpi_snd_wnd), data->tcpi_snd_wnd);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_RCV, get_wind_bucket(data->tcpi_rcv_wnd), data->tcpi_rcv_wnd);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_AVL_SND, get_wind_bucket(data->tcpi_avl_snd_wnd), data->tcpi_avl_snd_wnd);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_SND_CWND, get_wind_bucket(data->tcpi_snd_cwnd), data->tcpi_snd_cwnd);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_NOT_SENT, get_wind_bucket(data->tcpi_notsent_bytes), data->tcpi_notsent_bytes);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_ACKED, get_wind_bucket(data->tcpi_notack_bytes), data->tcpi_notack_bytes);
+        aggr_histo_add(aggr, TCP_AGGR_WIND_REORDERING, get_wind_bucket(data->tcpi_reordering), data->tcpi_reordering);
+        if (data->tcpi_snd_wnd == 0) {
+            __sync_fetch_and_add(&(aggr->zero_win_tx), 1);
+        }
+        if (data->tcpi_rcv_wnd == 0) {
+            __sync_fetch_and_add(&(aggr->zero_win_rx), 1);
+        }
+    }
+
+    if (flags & TCP_PROBE_RTT) {
+        aggr_histo_add(aggr, TCP_AGGR_RTT_SRTT, get_rtt_bucket(metrics->rtt_stats.tcpi_srtt), metrics->rtt_stats.tcpi_srtt);
+        aggr_histo_add(aggr, TCP_AGGR_RTT_RCV_RTT, get_rtt_bucket(metrics->rtt_stats.tcpi_rcv_rtt),
+                       metrics->rtt_stats.tcpi_rcv_rtt);
+    }
+
+    if (flags & TCP_PROBE_SRTT) {
+        aggr_histo_add(aggr, TCP_AGGR_RTT_SYN_SRTT, get_rtt_bucket(metrics->srtt_stats.syn_srtt),
+                       metrics->srtt_stats.syn_srtt);
+    }
+
+    if (flags & TCP_PROBE_RATE) {
+        aggr_histo_add(aggr, TCP_AGGR_RTO, get_rto_bucket(metrics->rate_stats.tcpi_rto), metrics->rate_stats.tcpi_rto);
+        aggr_histo_add(aggr, TCP_AGGR_ATO, get_rto_bucket(metrics->rate_stats.tcpi_ato), metrics->rate_stats.tcpi_ato);
+    }
+
+    if (flags & TCP_PROBE_SOCKBUF) {
+        aggr_histo_add(aggr, TCP_AGGR_SOCKBUF_SND, get_sockbuf_bucket((u32)metrics->sockbuf_stats.sk_sndbuf),
+                       (u32)metrics->sockbuf_stats.sk_sndbuf);
+        aggr_histo_add(aggr, TCP_AGGR_SOCKBUF_RCV, get_sockbuf_bucket((u32)metrics->sockbuf_stats.sk_rcvbuf),
+                       (u32)metrics->sockbuf_stats.sk_rcvbuf);
+    }
+
+    // Sockets of a tracker are folded on several CPUs at once, a plain |= may lose their flags.
+    if ((aggr->report_flags & flags) != flags) {
+        __sync_fetch_and_or(&(aggr->report_flags), flags);
+    }
+    return 0;
+}
+
+/*
+ * Output the metrics of a socket, or fold them into tcp_aggr_map if kernel_aggr is set.
+ * Flow delays are still output per socket as tcp_flow_tracker_s is keyed by the remote address string,
+ * and so is the whole record if its tracker does not fit in tcp_aggr_map.
+ */
+static __always_inline __maybe_unused void report_tcp_metrics(void *ctx, struct tcp_metrics_s *metrics)
+{
+    u32 report_flags;
+    struct tcp_args_s *args = get_tcp_args();
+
+    if (args == NULL || !args->kernel_aggr) {
+        (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+        return;
+    }
+
+    if (aggr_tcp_metrics(metrics, args->report_cport)) {
+        (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+        return;
+    }
+
+    report_flags = metrics->report_flags;
+    if ((report_flags & TCP_PROBE_DELAY) && (args->probe_flags & PROBE_RANGE_TCP_DELAY)) {
+        metrics->report_flags = TCP_PROBE_DELAY;
+        (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+        metrics->report_flags = report_flags;
+    }
+}
+#endif
+
 #endif
 
 #endif
@@ -34,6 +34,7 @@
 #include "tcpprobe.h"
 #include "tcp_tracker.h"
 #include "tcp_event.h"
+#include "bpf_map_batch.h"
 #include "tcp_tx_rx.skel.h"
 #include "tcp_stats.skel.h"
 #include "tcp_abn.skel.h"
@@ -769,6 +770,99 @@ static int proc_tcp_metrics_evt(void *ctx, void *data, u32 size)
     return 0;
 }
 
+
+static void proc_tcp_aggr_histos(struct tcp_mng_s *tcp_mng, struct tcp_tracker_s *tracker,
+    const struct tcp_aggr_s *aggr, u32 flags)
+{
+    const struct tcp_aggr_histo_s *h = aggr->histos;
+
+    if (flags & TCP_PROBE_WINDOWS) {
+        (void)histo_bucket_add_counts(&tracker->snd_wnd_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_SND].counts, h[TCP_AGGR_WIND_SND].sum, h[TCP_AGGR_WIND_SND].max);
+        (void)histo_bucket_add_counts(&tracker->rcv_wnd_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_RCV].counts, h[TCP_AGGR_WIND_RCV].sum, h[TCP_AGGR_WIND_RCV].max);
+        (void)histo_bucket_add_counts(&tracker->avl_snd_wnd_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_AVL_SND].counts, h[TCP_AGGR_WIND_AVL_SND].sum, h[TCP_AGGR_WIND_AVL_SND].max);
+        (void)histo_bucket_add_counts(&tracker->snd_cwnd_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_SND_CWND].counts, h[TCP_AGGR_WIND_SND_CWND].sum, h[TCP_AGGR_WIND_SND_CWND].max);
+        (void)histo_bucket_add_counts(&tracker->not_sent_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_NOT_SENT].counts, h[TCP_AGGR_WIND_NOT_SENT].sum, h[TCP_AGGR_WIND_NOT_SENT].max);
+        (void)histo_bucket_add_counts(&tracker->not_acked_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_ACKED].counts, h[TCP_AGGR_WIND_ACKED].sum, h[TCP_AGGR_WIND_ACKED].max);
+        (void)histo_bucket_add_counts(&tracker->reordering_buckets, __MAX_WIND_SIZE,
+            h[TCP_AGGR_WIND_REORDERING].counts, h[TCP_AGGR_WIND_REORDERING].sum, h[TCP_AGGR_WIND_REORDERING].max);
+        tracker->stats[ZERO_WIN_TX] += aggr->zero_win_tx;
+        tracker->stats[ZERO_WIN_RX] += aggr->zero_win_rx;
+    }
+
+    if (flags & TCP_PROBE_RTT) {
+        (void)histo_bucket_add_counts(&tracker->srtt_buckets, __MAX_RTT_SIZE,
+            h[TCP_AGGR_RTT_SRTT].counts, h[TCP_AGGR_RTT_SRTT].sum, h[TCP_AGGR_RTT_SRTT].max);
+        (void)histo_bucket_add_counts(&tracker->rcv_rtt_buckets, __MAX_RTT_SIZE,
+            h[TCP_AGGR_RTT_RCV_RTT].counts, h[TCP_AGGR_RTT_RCV_RTT].sum, h[TCP_AGGR_RTT_RCV_RTT].max);
+    }
+
+    if (flags & TCP_PROBE_SRTT) {
+        (void)histo_bucket_add_counts(&tracker->syn_srtt_buckets, __MAX_RTT_SIZE,
+            h[TCP_AGGR_RTT_SYN_SRTT].counts, h[TCP_AGGR_RTT_SYN_SRTT].sum, h[TCP_AGGR_RTT_SYN_SRTT].max);
+        tracker->stats[SYN_SRTT_MAX] = max(tracker->stats[SYN_SRTT_MAX], h[TCP_AGGR_RTT_SYN_SRTT].max);
+    }
+
+    if (flags & TCP_PROBE_RATE) {
+        (void)histo_bucket_add_counts(&tracker->rto_buckets, __MAX_RTO_SIZE,
+            h[TCP_AGGR_RTO].counts, h[TCP_AGGR_RTO].sum, h[TCP_AGGR_RTO].max);
+        (void)histo_bucket_add_counts(&tracker->ato_buckets, __MAX_RTO_SIZE,
+            h[TCP_AGGR_ATO].counts, h[TCP_AGGR_ATO].sum, h[TCP_AGGR_ATO].max);
+    }
+
+    if (flags & TCP_PROBE_SOCKBUF) {
+        (void)histo_bucket_add_counts(&tracker->snd_buf_buckets, __MAX_SOCKBUF_SIZE,
+            h[TCP_AGGR_SOCKBUF_SND].counts, h[TCP_AGGR_SOCKBUF_SND].sum, h[TCP_AGGR_SOCKBUF_SND].max);
+        (void)histo_bucket_add_counts(&tracker->rcv_buf_buckets, __MAX_SOCKBUF_SIZE,
+            h[TCP_AGGR_SOCKBUF_RCV].counts, h[TCP_AGGR_SOCKBUF_RCV].sum, h[TCP_AGGR_SOCKBUF_RCV].max);
+    }
+
+    tracker->report_flags |= flags & (TCP_PROBE_WINDOWS | TCP_PROBE_RTT | TCP_PROBE_SRTT
+        | TCP_PROBE_RATE | TCP_PROBE_SOCKBUF);
+}
+
+static int proc_tcp_aggr(const void *key, const void *value, void *ctx)
+{
+    struct tcp_mng_s *tcp_mng = ctx;
+    const struct tcp_aggr_key_s *aggr_key = key;
+    const struct tcp_aggr_s *aggr = value;
+    struct tcp_link_s link = {0};
+    struct tcp_tracker_s *tracker;
+
+    link.tgid = aggr_key->tgid;
+    link.family = aggr_key->family;
+    link.role = aggr_key->role;
+    link.s_port = aggr_key->s_port;
+    link.c_port = aggr_key->c_port;
+    memcpy(link.c_ip6, aggr_key->c_ip6, IP6_LEN);
+    memcpy(link.s_ip6, aggr_key->s_ip6, IP6_LEN);
+    memcpy(link.comm, aggr->comm, TASK_COMM_LEN);
+
+    // Sockets are folded in kernel without their toa address.
+    tracker = get_tcp_tracker(tcp_mng, (const void *)&link, NULL);
+    if (tracker == NULL) {
+        return MAP_ITER_CONTINUE;
+    }
+
+    tracker->last_rcv_data = (time_t)time(NULL);
+
+    if (aggr->report_flags & TCP_PROBE_ABN) {
+        proc_tcp_abnormal(tcp_mng, tracker, (const struct tcp_abn *)(&(aggr->abn_stats)));
+    }
+
+    if (aggr->report_flags & TCP_PROBE_TXRX) {
+        proc_tcp_txrx(tcp_mng, tracker, (const struct tcp_tx_rx *)(&(aggr->tx_rx_stats)));
+    }
+
+    proc_tcp_aggr_histos(tcp_mng, tracker, aggr, aggr->report_flags);
+    return MAP_ITER_CONTINUE;
+}
+
 #endif
 
 static int tcp_load_probe_stats(struct tcp_mng_s *tcp_mng, struct bpf_prog_s *prog, char is_load)
@@ -1032,6 +1126,27 @@ void aging_tcp_flow_trackers(struct tcp_mng_s *tcp_mng)
     }
 }
 
+/* Move metrics aggregated in kernel into trackers, tcp_aggr_map is emptied for the next round. */
+void harvest_tcp_aggr(struct tcp_mng_s *tcp_mng)
+{
+    // Keep draining once opened, leftovers are harvested after kernel_aggr is turned off.
+    if ((!tcp_mng->ipc_body.probe_param.kernel_aggr && tcp_mng->aggr_map_fd <= 0) || tcp_mng->tcp_progs == NULL) {
+        return;
+    }
+
+    if (tcp_mng->aggr_map_fd <= 0) {
+        tcp_mng->aggr_map_fd = bpf_obj_get(TCP_LINK_AGGR_PATH);
+        if (tcp_mng->aggr_map_fd <= 0) {
+            return;
+        }
+    }
+
+    if (bpf_map_drain(tcp_mng->aggr_map_fd, sizeof(struct tcp_aggr_key_s), sizeof(struct tcp_aggr_s),
+                      proc_tcp_aggr, tcp_mng) < 0) {
+        WARN("[TCPPROBE]: Harvest tcp aggregation map failed.\n");
+    }
+}
+
 #define __STEP (5000)
 void scan_tcp_trackers(struct tcp_mng_s *tcp_mng)
 {
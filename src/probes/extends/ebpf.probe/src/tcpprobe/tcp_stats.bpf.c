@@ -51,7 +51,7 @@ static __always_inline void report_tcp_stats(void *ctx, struct tcp_metrics_s *me
     }
 
     metrics->report_flags |= report_flags;
-    (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+    report_tcp_metrics(ctx, metrics);
     metrics->report_flags &= ~report_flags;
 }
 
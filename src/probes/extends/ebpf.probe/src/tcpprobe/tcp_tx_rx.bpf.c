@@ -56,7 +56,7 @@ static __always_inline void report_tx_rx(void *ctx, struct tcp_metrics_s *metric
     u32 last_time_segs_in = metrics->tx_rx_stats.segs_in;
 
     metrics->report_flags |= TCP_PROBE_TXRX;
-    (void)bpfbuf_output(ctx, &tcp_output, metrics, sizeof(struct tcp_metrics_s));
+    report_tcp_metrics(ctx, metrics);
 
     metrics->report_flags &= ~TCP_PROBE_TXRX;
     __builtin_memset(&(metrics->tx_rx_stats), 0x0, sizeof(metrics->tx_rx_stats));
@@ -35,6 +35,7 @@
 #endif
 
 #include "bpf.h"
+#include "bpf_map_batch.h"
 #include "ipc.h"
 #include "tc_loader.h"
 #include "tcp_tracker.h"
@@ -51,6 +52,7 @@ static struct tcp_mng_s g_tcp_mng;
 
 int load_established_tcps(int proc_obj_map_fd, int map_fd);
 int tcp_load_probe(struct tcp_mng_s *tcp_mng, struct ipc_body_s *ipc_body, struct bpf_prog_s **new_prog);
+void harvest_tcp_aggr(struct tcp_mng_s *tcp_mng);
 void scan_tcp_trackers(struct tcp_mng_s *tcp_mng);
 void scan_tcp_flow_trackers(struct tcp_mng_s *tcp_mng);
 void aging_tcp_trackers(struct tcp_mng_s *tcp_mng);
@@ -92,19 +94,16 @@ static int init_tcp_historm_range(struct tcp_mng_s *tcp_mng)
 }
 
 
+static int is_unref_proc(const void *key, const void *value, void *ctx)
+{
+    const struct obj_ref_s *ref = value;
+
+    return (ref->count == 0) ? MAP_ITER_DELETE : MAP_ITER_CONTINUE;
+}
+
 static void clear_unref_proc_map(int fd)
 {
-    struct proc_s key = {0};
-    struct proc_s next_key = {0};
-    struct obj_ref_s value = {0};
-
-    while (bpf_map_get_next_key(fd, &key, &next_key) == 0) {
-        (void)bpf_map_lookup_elem(fd, &next_key, &value);
-        if (value.count == 0) {
-            (void)bpf_map_delete_elem(fd, &next_key);
-        }
-        key = next_key;
-    }
+    (void)bpf_map_iter(fd, sizeof(struct proc_s), sizeof(struct obj_ref_s), is_unref_proc, NULL);
 }
 
 static void reload_tcp_snoopers(int fd, struct ipc_body_s *ipc_old, struct ipc_body_s *ipc_new)
@@ -222,12 +221,7 @@ static void deinit_tcp_historm(struct tcp_mng_s *tcp_mng)
 
 static void empty_tcp_fd_map(int map_fd)
 {
-    u32 key = 0, next_key = 0;
-
-    while (bpf_map_get_next_key(map_fd, &key, &next_key) == 0) {
-        (void)bpf_map_delete_elem(map_fd, &next_key);
-        key = next_key;
-    }
+    (void)bpf_map_drain(map_fd, sizeof(u32), sizeof(struct tcp_fd_info), NULL, NULL);
 }
 
 static int load_established_tcps_mngt(int proc_obj_map_fd, int tcp_fd_map_fd)
@@ -277,6 +271,8 @@ static void tcp_load_args(int args_fd, struct ipc_body_s *ipc_body)
     struct tcp_args_s args = {0};
 
     args.probe_flags = ipc_body->probe_range_flags;
+    args.kernel_aggr = (u16)ipc_body->probe_param.kernel_aggr;
+    args.report_cport = (u16)ipc_body->probe_param.report_cport;
     args.sample_period = MS2NS(ipc_body->probe_param.sample_period);
 
     (void)bpf_map_update_elem(args_fd, &key, &args, BPF_ANY);
@@ -396,6 +392,7 @@ int main(int argc, char **argv)
         }
 
         if (is_need_scanning(tcp_mng)) {
+            harvest_tcp_aggr(tcp_mng);
             scan_tcp_trackers(tcp_mng);
             scan_tcp_flow_trackers(tcp_mng);
         }
@@ -412,6 +409,9 @@ err:
     if (supports_tstamp) {
         offload_tc_bpf(TC_TYPE_INGRESS);
     }
+    if (tcp_mng->aggr_map_fd > 0) {
+        (void)close(tcp_mng->aggr_map_fd);
+    }
     destroy_ipc_body(&(tcp_mng->ipc_body));
     destroy_tcp_trackers(tcp_mng);
     destroy_toa_sockets(tcp_mng);
@@ -26,6 +26,7 @@
 #define TCP_LINK_SOCKS_PATH     "/sys/fs/bpf/gala-gopher/__tcplink_socks"
 #define TCP_LINK_TCP_PATH       "/sys/fs/bpf/gala-gopher/__tcplink_tcp"
 #define TCP_LINK_FD_PATH        "/sys/fs/bpf/gala-gopher/__tcplink_tcp_fd"
+#define TCP_LINK_AGGR_PATH      "/sys/fs/bpf/gala-gopher/__tcplink_aggr"
 
 #define PROBE_RANGE_TCP_ABNORMAL    0x00000001
 #define PROBE_RANGE_TCP_WINDOWS     0x00000002
@@ -209,9 +210,74 @@ struct sock_stats_s {
 
 struct tcp_args_s {
     __u32 probe_flags;
+    __u16 kernel_aggr;                 // Aggregate metrics into tcp_aggr_map instead of outputting each socket
+    __u16 report_cport;
     __u64 sample_period;               // Sampling period, unit ns
 };
 
+// Same order as enum tcp_historm_e
+enum tcp_aggr_histo_e {
+    TCP_AGGR_WIND_SND = 0,
+    TCP_AGGR_WIND_RCV,
+    TCP_AGGR_WIND_AVL_SND,
+    TCP_AGGR_WIND_SND_CWND,
+    TCP_AGGR_WIND_NOT_SENT,
+    TCP_AGGR_WIND_ACKED,
+    TCP_AGGR_WIND_REORDERING,
+
+    TCP_AGGR_SOCKBUF_SND,
+    TCP_AGGR_SOCKBUF_RCV,
+
+    TCP_AGGR_RTT_SRTT,
+    TCP_AGGR_RTT_RCV_RTT,
+    TCP_AGGR_RTT_SYN_SRTT,
+
+    TCP_AGGR_RTO,
+    TCP_AGGR_ATO,
+
+    TCP_AGGR_HISTO_MAX
+};
+
+#define TCP_AGGR_BUCKET_MAX     8       // Most buckets of tcp histograms, see __MAX_SOCKBUF_SIZE
+#define TCP_AGGR_FLAGS          (TCP_PROBE_ABN | TCP_PROBE_WINDOWS | TCP_PROBE_RTT | TCP_PROBE_TXRX \
+                                | TCP_PROBE_SOCKBUF | TCP_PROBE_RATE | TCP_PROBE_SRTT)
+
+// Identifies a tcp tracker, client port is 0 unless report_cport is set.
+struct tcp_aggr_key_s {
+    __u32 tgid;
+    union {
+        __u32 c_ip;
+        unsigned char c_ip6[IP6_LEN];
+    };
+    union {
+        __u32 s_ip;
+        unsigned char s_ip6[IP6_LEN];
+    };
+    __u16 s_port;
+    __u16 c_port;
+    __u16 family;
+    __u16 role;
+};
+
+// Values are bucketed in kernel, only the sum and max of all values are kept.
+struct tcp_aggr_histo_s {
+    __u32 counts[TCP_AGGR_BUCKET_MAX];
+    __u64 sum;
+    __u64 max;
+};
+
+// Metrics of all sockets of a tcp tracker within a report period.
+struct tcp_aggr_s {
+    u32 report_flags;       // Refer to TCP_AGGR_FLAGS
+    u32 zero_win_tx;
+    u32 zero_win_rx;
+    char comm[TASK_COMM_LEN];
+
+    struct tcp_tx_rx tx_rx_stats;   // Deltas of segs, last_time_xxx is not used
+    struct tcp_abn abn_stats;       // Likewise
+    struct tcp_aggr_histo_s histos[TCP_AGGR_HISTO_MAX];
+};
+
 #if !defined(BPF_PROG_KERN) && !defined(BPF_PROG_USER)
 #include "ipc.h"
 
@@ -239,6 +305,7 @@ int is_tcp_fd_probe_loaded(void);
     MAP_SET_PIN_PATH(probe_name, tcp_link_map, TCP_LINK_TCP_PATH, load); \
     MAP_SET_PIN_PATH(probe_name, sock_map, TCP_LINK_SOCKS_PATH, load); \
     MAP_SET_PIN_PATH(probe_name, tcp_fd_map, TCP_LINK_FD_PATH, load); \
+    MAP_SET_PIN_PATH(probe_name, tcp_aggr_map, TCP_LINK_AGGR_PATH, load); \
     MAP_SET_PIN_PATH(probe_name, tcp_output, TCP_LINK_OUTPUT_PATH, load);
 
 #define __LOAD_PROBE(probe_name, end, load) \
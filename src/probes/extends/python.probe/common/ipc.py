@@ -67,6 +67,9 @@ class ProbeParams(Structure):
         ("profiling_chan", c_uint),
         ("min_exec_dur", c_uint),
         ("min_aggr_dur", c_uint),
+        ("fifo_overflow", c_uint),
+        ("fifo_block_tmout", c_uint),
+        ("kernel_aggr", c_char),
     ]
 
 class Proc(Structure):
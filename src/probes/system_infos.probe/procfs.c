@@ -0,0 +1,297 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-25
+ * Description: procfs reader of system_infos probe
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include "procfs.h"
+
+#define IS_BLANK(c)     ((c) == ' ' || (c) == '\t')
+#define PROCFS_KEPT_FDS_DEFAULT 512
+
+static u32 g_kept_fds;
+static u32 g_kept_fds_max;
+static char g_emfile_warned;
+
+void procfs_file_init(struct procfs_file_s *file, const char *path)
+{
+    (void)memset(file, 0, sizeof(struct procfs_file_s));
+    file->fd = -1;
+    (void)snprintf(file->path, sizeof(file->path), "%s", path);
+}
+
+static u32 procfs_kept_fds_max(void)
+{
+    struct rlimit rlim;
+
+    if (g_kept_fds_max != 0) {
+        return g_kept_fds_max;
+    }
+
+    // The other half is left to the rest of the probe, e.g. fds of /proc/<pid>/fd walks.
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur != RLIM_INFINITY) {
+        g_kept_fds_max = (u32)(rlim.rlim_cur / 2);
+    }
+    if (g_kept_fds_max == 0) {
+        g_kept_fds_max = PROCFS_KEPT_FDS_DEFAULT;
+    }
+    return g_kept_fds_max;
+}
+
+static int procfs_open(struct procfs_file_s *file)
+{
+    file->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) {
+        if ((errno == EMFILE || errno == ENFILE) && !g_emfile_warned) {
+            WARN("[PROCFS] Failed to open %s: %s, %u procfs files kept open.\n",
+                 file->path, strerror(errno), g_kept_fds);
+            g_emfile_warned = 1;
+        }
+        return -1;
+    }
+    g_emfile_warned = 0;
+
+    if (g_kept_fds < procfs_kept_fds_max()) {
+        file->kept = 1;
+        g_kept_fds++;
+    }
+    return 0;
+}
+
+static void procfs_close_fd(struct procfs_file_s *file)
+{
+    if (file->fd < 0) {
+        return;
+    }
+    (void)close(file->fd);
+    file->fd = -1;
+    if (file->kept) {
+        file->kept = 0;
+        g_kept_fds--;
+    }
+}
+
+void procfs_close(struct procfs_file_s *file)
+{
+    procfs_close_fd(file);
+    if (file->buf != NULL) {
+        free(file->buf);
+        file->buf = NULL;
+    }
+    file->size = 0;
+    file->len = 0;
+}
+
+static int procfs_grow(struct procfs_file_s *file)
+{
+    u32 size = (file->size == 0) ? PROCFS_BUF_INIT_SIZE : file->size * 2;
+    char *buf;
+
+    if (size > PROCFS_BUF_MAX_SIZE) {
+        ERROR("[PROCFS] %s is larger than %u bytes.\n", file->path, PROCFS_BUF_MAX_SIZE);
+        return -1;
+    }
+
+    buf = (char *)realloc(file->buf, size);
+    if (buf == NULL) {
+        return -1;
+    }
+    file->buf = buf;
+    file->size = size;
+    return 0;
+}
+
+static int procfs_pread_all(struct procfs_file_s *file)
+{
+    u32 len = 0;
+    ssize_t ret;
+
+    for (;;) {
+        if (len + 1 >= file->size && procfs_grow(file)) {
+            return -1;
+        }
+        ret = pread(file->fd, file->buf + len, file->size - len - 1, (off_t)len);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (ret == 0) {
+            break;
+        }
+        len += (u32)ret;
+    }
+
+    file->buf[len] = 0;
+    file->len = len;
+    return (int)len;
+}
+
+int procfs_read(struct procfs_file_s *file)
+{
+    int ret, retry;
+
+    // A kept fd fails when its owner is gone(e.g. /proc/<pid>/stat of an exited process), reopen
+    // once, so a reused path(e.g. recycled pid) is read from the new owner.
+    for (retry = 0; retry < 2; retry++) {
+        if (file->fd < 0 && procfs_open(file)) {
+            return -1;
+        }
+
+        ret = procfs_pread_all(file);
+        if (ret >= 0) {
+            if (!file->kept) {
+                procfs_close_fd(file);
+            }
+            return ret;
+        }
+        procfs_close_fd(file);
+    }
+    return -1;
+}
+
+int procfs_read_once(const char *path, char buf[], u32 size)
+{
+    u32 len = 0;
+    ssize_t ret = 0;
+    int fd;
+
+    if (size == 0) {
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    while (len < size - 1) {
+        ret = read(fd, buf + len, size - len - 1);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        len += (u32)ret;
+    }
+    (void)close(fd);
+
+    buf[len] = 0;
+    return (len == 0 && ret < 0) ? -1 : (int)len;
+}
+
+char *procfs_next_line(char **pos)
+{
+    char *line = *pos;
+    char *end;
+
+    if (line == NULL || *line == 0) {
+        return NULL;
+    }
+
+    end = strchr(line, '\n');
+    if (end == NULL) {
+        *pos = line + strlen(line);
+    } else {
+        *end = 0;
+        *pos = end + 1;
+    }
+    return line;
+}
+
+char *procfs_next_field(char **pos)
+{
+    char *start = *pos;
+    char *end;
+
+    while (IS_BLANK(*start)) {
+        start++;
+    }
+    if (*start == 0 || *start == '\n') {
+        *pos = start;
+        return NULL;
+    }
+
+    end = start;
+    while (*end != 0 && !IS_BLANK(*end) && *end != '\n') {
+        end++;
+    }
+    if (*end != 0) {
+        *end = 0;
+        end++;
+    }
+    *pos = end;
+    return start;
+}
+
+void procfs_skip_fields(char **pos, u32 num)
+{
+    char *p = *pos;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+        while (IS_BLANK(*p)) {
+            p++;
+        }
+        while (*p != 0 && *p != '\n' && !IS_BLANK(*p)) {
+            p++;
+        }
+    }
+    *pos = p;
+}
+
+int procfs_next_u64(char **pos, int base, u64 *value)
+{
+    char *p = *pos;
+    char *end;
+    u64 v;
+
+    // Never run over the end of current line
+    while (IS_BLANK(*p)) {
+        p++;
+    }
+    if (*p == 0 || *p == '\n') {
+        return -1;
+    }
+
+    v = (u64)strtoull(p, &end, base);
+    if (end == p) {
+        return -1;
+    }
+    *pos = end;
+    *value = v;
+    return 0;
+}
+
+char *procfs_find_key(char *buf, const char *key)
+{
+    size_t key_len = strlen(key);
+    char *line = buf;
+
+    while (line != NULL && *line != 0) {
+        if (strncmp(line, key, key_len) == 0) {
+            return line + key_len;
+        }
+        line = strchr(line, '\n');
+        if (line != NULL) {
+            line++;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-25
+ * Description: procfs reader of system_infos probe
+ ******************************************************************************/
+#ifndef __PROCFS_H__
+#define __PROCFS_H__
+
+#pragma once
+
+#include "common.h"
+
+#define PROCFS_BUF_INIT_SIZE    1024
+#define PROCFS_BUF_MAX_SIZE     (64 * 1024 * 1024)
+
+/*
+ * A procfs(or sysfs) file kept open between probe periods. Every read is pread() from offset 0
+ * into the buffer of the file, which only grows when the content does not fit, so collecting
+ * does not fork, open or allocate in steady state.
+ * At most half of RLIMIT_NOFILE fds are kept, files beyond that are opened and closed per read.
+ */
+struct procfs_file_s {
+    int fd;                     // Opened at first read, -1 if not opened
+    char kept;                  // fd counts in the kept fds and stays open after read
+    u32 len;                    // Length of the content of last read
+    u32 size;                   // Size of buf
+    char *buf;                  // Content of last read, always terminated by '\0'
+    char path[PATH_LEN];
+};
+
+#define PROCFS_FILE(file_path)  {.fd = -1, .path = file_path}
+
+void procfs_file_init(struct procfs_file_s *file, const char *path);
+/* Returns length of content, or -1 if the file can not be read even after reopening it. */
+int procfs_read(struct procfs_file_s *file);
+/* Close fd and free the buffer, path is kept so the file can be read again. */
+void procfs_close(struct procfs_file_s *file);
+/* One-shot read of a small file into buf, returns length of content or -1. */
+int procfs_read_once(const char *path, char buf[], u32 size);
+
+/*
+ * Zero-allocation tokenizers working on the content in place, *pos is moved forward over
+ * what is consumed. Lines and fields are terminated by overwriting the separator with '\0'.
+ */
+char *procfs_next_line(char **pos);
+char *procfs_next_field(char **pos);
+void procfs_skip_fields(char **pos, u32 num);
+/* Returns -1 if there is no number at *pos, negative numbers wrap around like strtoull(). */
+int procfs_next_u64(char **pos, int base, u64 *value);
+/* Find the line starting with key, returns position right after key or NULL. */
+char *procfs_find_key(char *buf, const char *key);
+
+#endif
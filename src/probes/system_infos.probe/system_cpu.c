@@ -20,14 +20,15 @@
 #include "common.h"
 #include "nprobe_fprintf.h"
 #include "event.h"
+#include "procfs.h"
 #include "system_cpu.h"
 
 #define METRICS_CPU_NAME            "system_cpu"
 #define METRICS_CPU_UTIL_NAME       "system_cpu_util"
 #define ENTITY_NAME                 "cpu"
-#define SYSTEM_PROCESSOR_INFO       "cat /proc/softirqs | grep -E '\\sRCU:\\s|\\sTIMER:\\s|\\sSCHED:\\s|\\sNET_RX:\\s'"
+#define SYSTEM_SOFTIRQS_PATH        "/proc/softirqs"
 #define SYSTEM_PROC_STAT_PATH       "/proc/stat"
-#define SYSTEM_CPU_MHZ_INFO         "cat /proc/cpuinfo | grep MHz"
+#define SYSTEM_CPUINFO_PATH         "/proc/cpuinfo"
 #define SOFTNET_STAT_PATH           "/proc/net/softnet_stat"
 #define PROC_STAT_FILEDS_NUM        8
 #define PROC_STAT_COL_NUM           8
@@ -38,7 +39,6 @@
 #define BASE_HEX                    16
 #define MAX_CPU_NUM                 1024
 #define FULL_PER                    100
-#define MAX_COL_NUM                 20
 
 static struct cpu_stat **cur_cpus = NULL;
 static struct cpu_stat **old_cpus = NULL;
@@ -46,32 +46,27 @@ static int cpus_num = 0;
 static bool is_first_get = true;
 static u64 last_time_total, cur_time_total, last_time_used, cur_time_used;
 static float util_per;
-static int softirq_line_num = 0;
-char *softirq_line = NULL;
+static struct procfs_file_s g_stat_file = PROCFS_FILE(SYSTEM_PROC_STAT_PATH);
+static struct procfs_file_s g_softirqs_file = PROCFS_FILE(SYSTEM_SOFTIRQS_PATH);
+static struct procfs_file_s g_softnet_file = PROCFS_FILE(SOFTNET_STAT_PATH);
+static struct procfs_file_s g_cpuinfo_file = PROCFS_FILE(SYSTEM_CPUINFO_PATH);
 
 /*
  * time_total = user + nice + sys + irq + softirq + steal + idle + iowait (前8列)
  * time_idle = idle + iowait
  * time_used = user + nice + sys + irq + softirq + steal
  */
-static void get_cpu_time_in_jiff(char *cpu_total_line, u64 *time_total, u64 *time_used)
+static void get_cpu_time_in_jiff(const u64 times[], u64 *time_total, u64 *time_used)
 {
-    char *retrieved_time = NULL, *save;
-    int i = 0;
+    int i;
     *time_total = 0;
     *time_used = 0;
-    u64 time;
-
-    (void)__strtok_r(cpu_total_line, " ", &save);
-
-    while (i++ < PROC_STAT_COL_NUM) {
-        retrieved_time = __strtok_r(NULL, " ", &save);
-        time = strtoll(retrieved_time, NULL, 10);
 
-        *time_total += time;
+    for (i = 1; i <= PROC_STAT_COL_NUM; i++) {
+        *time_total += times[i - 1];
 
         if (i != PROC_STAT_IDLE_COL && i != PROC_STAT_IOWAIT_COL) {
-            *time_used += time;
+            *time_used += times[i - 1];
         }
     }
 }
@@ -102,176 +97,175 @@ static void report_cpu_status(struct ipc_body_s *ipc_body)
     return;
 }
 
-static float get_cpu_util(char *src, u64 *last_total, u64 *last_used, u64 *cur_total, u64 *cur_used)
+static float get_cpu_util(const u64 times[], u64 *last_total, u64 *last_used, u64 *cur_total, u64 *cur_used)
 {
     float util;
 
-    get_cpu_time_in_jiff(src, cur_total, cur_used);
+    get_cpu_time_in_jiff(times, cur_total, cur_used);
 
     util = (*cur_used - *last_used) * FULL_PER * 1.0 / (*cur_total - *last_total);
 
     return util;
 }
 
+/* Parse the first PROC_STAT_COL_NUM columns of a "cpu" line, returns the number of columns parsed. */
+static int get_cpu_line_times(char *line, u64 times[])
+{
+    char *pos = line;
+    int num = 0;
+
+    procfs_skip_fields(&pos, 1);
+    while (num < PROC_STAT_COL_NUM && procfs_next_u64(&pos, 10, &times[num]) == 0) {
+        num++;
+    }
+    for (int i = num; i < PROC_STAT_COL_NUM; i++) {
+        times[i] = 0;
+    }
+    return num;
+}
+
 static int get_proc_stat_info(void)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
-    char dst_line[LINE_BUF_LEN];
-    int ret;
+    char *pos, *line;
+    u64 times[PROC_STAT_COL_NUM];
+    struct cpu_stat *cpu;
     int index = 0;
     bool is_first_line = true;
 
-    f = fopen(SYSTEM_PROC_STAT_PATH, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_stat_file) < 0) {
         return -1;
     }
-    while (!feof(f)) {
-        dst_line[0] = 0;
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            fclose(f);
-            return 0;
+
+    pos = g_stat_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
+        if (strncmp(line, "cpu", 3) != 0) {
+            continue;
         }
-        snprintf(dst_line, sizeof(dst_line), "%s", line);
         if (is_first_line) {
-            util_per = get_cpu_util(dst_line, &last_time_total, &last_time_used,
+            (void)get_cpu_line_times(line, times);
+            util_per = get_cpu_util(times, &last_time_total, &last_time_used,
                                     &cur_time_total, &cur_time_used);
             last_time_total = cur_time_total;
             last_time_used = cur_time_used;
             is_first_line = false;
             continue;
         }
-        if (strstr(line, "cpu") == NULL) {
-            continue;
-        }
 
         if (index >= cpus_num) {
             break;
         }
-        cur_cpus[index]->cpu_util_per = get_cpu_util(dst_line, &old_cpus[index]->cpu_time_total,
-                                                     &old_cpus[index]->cpu_time_used,
-                                                     &cur_cpus[index]->cpu_time_total,
-                                                     &cur_cpus[index]->cpu_time_used);
-        ret = sscanf(line,
-            "%*s %llu %llu %llu %llu %llu %llu %llu %llu %*llu %*llu",
-            &cur_cpus[index]->cpu_user_total_second,
-            &cur_cpus[index]->cpu_nice_total_second,
-            &cur_cpus[index]->cpu_system_total_second,
-            &cur_cpus[index]->cpu_idle_total_second,
-            &cur_cpus[index]->cpu_iowait_total_second,
-            &cur_cpus[index]->cpu_irq_total_second,
-            &cur_cpus[index]->cpu_softirq_total_second,
-            &cur_cpus[index]->cpu_steal_total_second);
-        if (ret < PROC_STAT_FILEDS_NUM) {
+        cpu = cur_cpus[index];
+        if (get_cpu_line_times(line, times) < PROC_STAT_FILEDS_NUM) {
             ERROR("system_cpu.probe failed to get proc_stat metrics.\n");
         }
+        cpu->cpu_util_per = get_cpu_util(times, &old_cpus[index]->cpu_time_total,
+                                         &old_cpus[index]->cpu_time_used,
+                                         &cpu->cpu_time_total, &cpu->cpu_time_used);
+        cpu->cpu_user_total_second = times[0];
+        cpu->cpu_nice_total_second = times[1];
+        cpu->cpu_system_total_second = times[2];
+        cpu->cpu_idle_total_second = times[3];
+        cpu->cpu_iowait_total_second = times[4];
+        cpu->cpu_irq_total_second = times[5];
+        cpu->cpu_softirq_total_second = times[6];
+        cpu->cpu_steal_total_second = times[7];
         index++;
     }
-    (void)fclose(f);
     return 0;
 }
 
+static u64 *get_softirq_counter(struct cpu_stat *cpu, const char *name)
+{
+    if (strcmp(name, "RCU:") == 0) {
+        return &cpu->rcu;
+    }
+    if (strcmp(name, "TIMER:") == 0) {
+        return &cpu->timer;
+    }
+    if (strcmp(name, "SCHED:") == 0) {
+        return &cpu->sched;
+    }
+    if (strcmp(name, "NET_RX:") == 0) {
+        return &cpu->net_rx;
+    }
+    return NULL;
+}
+
+/*
+ [root@localhost ~]# cat /proc/softirqs
+                    CPU0       CPU1
+          HI:          0          0
+       TIMER:     264725     290125
+ */
 static int get_softirq_info(void)
 {
-    FILE *f = NULL;
-    char *field, *save;
+    char *pos, *line, *field;
+    u64 *counter;
+    u64 value;
 
-    softirq_line[0] = 0;
-    f = popen(SYSTEM_PROCESSOR_INFO, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_softirqs_file) < 0) {
         return -1;
     }
-    while (fgets(softirq_line, softirq_line_num - 1, f) != NULL) {
-        field = __strtok_r(softirq_line, " ", &save);
-        if (!field) {
-            softirq_line[0] = 0;
+
+    pos = g_softirqs_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
+        field = procfs_next_field(&line);
+        if (field == NULL || get_softirq_counter(cur_cpus[0], field) == NULL) {
             continue;
         }
-        if (strcmp(field, "RCU:") == 0) {
-            for (size_t i = 0; i < cpus_num; i++) {
-                cur_cpus[i]->rcu = strtoul(__strtok_r(NULL, " ", &save), NULL, 10);
-            }
-        } else if (strcmp(field, "TIMER:") == 0) {
-            for (size_t i = 0; i < cpus_num; i++) {
-                cur_cpus[i]->timer = strtoul(__strtok_r(NULL, " ", &save), NULL, 10);
-            }
-        } else if (strcmp(field, "SCHED:") == 0) {
-            for (size_t i = 0; i < cpus_num; i++) {
-                cur_cpus[i]->sched = strtoul(__strtok_r(NULL, " ", &save), NULL, 10);
-            }
-        } else if (strcmp(field, "NET_RX:") == 0) {
-            for (size_t i = 0; i < cpus_num; i++) {
-                cur_cpus[i]->net_rx = strtoul(__strtok_r(NULL, " ", &save), NULL, 10);
-            }
+        for (int i = 0; i < cpus_num && procfs_next_u64(&line, 10, &value) == 0; i++) {
+            counter = get_softirq_counter(cur_cpus[i], field);
+            *counter = value;
         }
-        softirq_line[0] = 0;
     }
-
-    pclose(f);
     return 0;
 }
 
 static int get_softnet_stat_info(void)
 {
-    FILE *f = fopen(SOFTNET_STAT_PATH, "r");
-    char line[LINE_BUF_LEN];
-    char *val, *save;
+    char *pos, *line;
+    u64 value;
+    int i = 0;
 
-    if (f == NULL) {
+    if (procfs_read(&g_softnet_file) < 0) {
         return -1;
     }
 
-    int i = 0;
-    line[0] = 0;
-    while (fgets(line, LINE_BUF_LEN, f) != NULL) {
-        int t = 2;
-        val = __strtok_r(line, " ", &save);
-        while (val != NULL) {
-            val = __strtok_r(NULL, " ", &save);
+    pos = g_softnet_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL && i < cpus_num) {
+        for (int t = 1; t <= SOFTNET_RPS_COL && procfs_next_u64(&line, BASE_HEX, &value) == 0; t++) {
             if (t == SOFTNET_DROP_COL) {
-                cur_cpus[i]->backlog_drops = strtoll(val, NULL, BASE_HEX);
+                cur_cpus[i]->backlog_drops = value;
             }
             if (t == SOFTNET_RPS_COL) {
-                cur_cpus[i]->rps_count = strtoll(val, NULL, BASE_HEX);
-                break;
+                cur_cpus[i]->rps_count = value;
             }
-            t++;
         }
-        line[0] = 0;
         i++;
     }
-
-    (void)fclose(f);
     return 0;
 }
 
 static int get_cpu_mhz_info(void)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
-    char *token, *last_token;
+    char *pos, *line, *colon;
+    int index = 0;
 
-    f = popen(SYSTEM_CPU_MHZ_INFO, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_cpuinfo_file) < 0) {
         return -1;
     }
-    int index = 0;
-    line[0] = 0;
-    while (fgets(line, LINE_BUF_LEN, f) != NULL) {
-        last_token = NULL;
-        token = strtok(line, ":");
-        while (token != NULL) {
-            last_token = token;
-            token = strtok(NULL, ":");
+
+    pos = g_cpuinfo_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL && index < cpus_num) {
+        if (strstr(line, "MHz") == NULL) {
+            continue;
         }
-        if (last_token != NULL && index < cpus_num) {
-            cur_cpus[index]->mhz = strtod(last_token, NULL);
+        colon = strrchr(line, ':');
+        if (colon != NULL) {
+            cur_cpus[index]->mhz = strtod(colon + 1, NULL);
             index++;
         }
     }
-
-    pclose(f);
     return 0;
 }
 
@@ -346,12 +340,6 @@ int system_cpu_init(void)
         system_cpu_destroy();
         return -1;
     }
-    softirq_line_num = MAX_COL_NUM * (1 + cpus_num);
-    softirq_line = (char *)malloc(softirq_line_num);
-    if (softirq_line == NULL) {
-        system_cpu_destroy();
-        return -1;
-    }
     return 0;
 }
 
@@ -359,10 +347,10 @@ void system_cpu_destroy(void)
 {
     dealloc_memory(cur_cpus);
     dealloc_memory(old_cpus);
-    if (softirq_line != NULL) {
-        free(softirq_line);
-        softirq_line = NULL;
-    }
+    procfs_close(&g_stat_file);
+    procfs_close(&g_softirqs_file);
+    procfs_close(&g_softnet_file);
+    procfs_close(&g_cpuinfo_file);
     cur_cpus = NULL;
     old_cpus = NULL;
 }
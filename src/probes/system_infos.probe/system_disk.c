@@ -18,6 +18,8 @@
 #include <unistd.h>
 #include "event.h"
 #include "nprobe_fprintf.h"
+#include "nprobe_record.h"
+#include "procfs.h"
 #include "system_disk.h"
 
 #define METRICS_DF_NAME         "system_df"
@@ -26,12 +28,12 @@
 #define ENTITY_DISK_NAME        "disk"
 #define SYSTEM_INODE_COMMAND    "/usr/bin/df -T -i"
 #define SYSTEM_BLOCK_CMD        "/usr/bin/df -T"
-#define SYSTEM_MOUNT_STAT_CMD   "cat /proc/mounts"
+#define SYSTEM_MOUNTS           "/proc/mounts"
 #define SYSTEM_DISKSTATS        "/proc/diskstats"
-#define SYSTEM_DISKSTATS_CMD    "/usr/bin/cat /proc/diskstats"
-#define SYSTEM_DISK_DEV_NUM     "/usr/bin/cat /proc/diskstats | wc -l"
 
 static df_stats *g_df_tbl = NULL;
+static struct procfs_file_s g_mounts_file = PROCFS_FILE(SYSTEM_MOUNTS);
+static struct procfs_file_s g_diskstats_file = PROCFS_FILE(SYSTEM_DISKSTATS);
 
 #define DF_INODE_FIELD_NUM 7
 static int get_df_inode_fields(char *line, df_stats *stats)
@@ -73,7 +75,7 @@ static int get_df_block_fields(char *line, df_stats *stats)
 }
 
 #define MNT_FIELD_NUM 2
-static int get_fs_mount_status(char *line, char *mountOn, size_t mounton_len,
+static int get_fs_mount_status(const char *line, char *mountOn, size_t mounton_len,
                                char *mountStatus, size_t mountstatus_len)
 {
     int ret;
@@ -245,24 +247,17 @@ static int init_fs_block_info(void)
 
 static int init_fs_status(void)
 {
-    FILE *f = NULL;
     df_stats *fsItem;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
     char mountOn[MOUNTON_LEN];
     char mountStatus[MOUNTSTATUS_LEN];
 
-    f = popen(SYSTEM_MOUNT_STAT_CMD, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_mounts_file) < 0) {
         return -1;
     }
 
-    while (!feof(f)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            break;
-        }
-        SPLIT_NEWLINE_SYMBOL(line);
-
+    pos = g_mounts_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
         mountOn[0] = 0;
         mountStatus[0] = 0;
         if (get_fs_mount_status(line, mountOn, sizeof(mountOn), mountStatus, sizeof(mountStatus))) {
@@ -276,8 +271,6 @@ static int init_fs_status(void)
         }
         (void)snprintf(fsItem->mount_status, sizeof(fsItem->mount_status), "%s", mountStatus);
     }
-
-    (void)pclose(f);
     return 0;
 
 }
@@ -308,20 +301,21 @@ int system_disk_probe(struct ipc_body_s *ipc_body)
         }
 
         /* output metric */
-        (void)nprobe_fprintf(stdout, "|%s|%s|%s|%s|%s|%ld|%ld|%ld|%ld|%ld|%ld|%ld|%ld|\n",
-            METRICS_DF_NAME,
-            fsItem->mount_on,
-            fsItem->mount_status,
-            fsItem->fsname,
-            fsItem->fstype,
-            fsItem->inode_sum,
-            fsItem->inode_used,
-            fsItem->inode_free,
-            fsItem->inode_used_per,
-            fsItem->blk_sum,
-            fsItem->blk_used,
-            fsItem->blk_free,
-            fsItem->blk_used_per);
+        struct nprobe_field_s fields[] = {
+            NPROBE_STR(fsItem->mount_on),
+            NPROBE_STR(fsItem->mount_status),
+            NPROBE_STR(fsItem->fsname),
+            NPROBE_STR(fsItem->fstype),
+            NPROBE_S64(fsItem->inode_sum),
+            NPROBE_S64(fsItem->inode_used),
+            NPROBE_S64(fsItem->inode_free),
+            NPROBE_S64(fsItem->inode_used_per),
+            NPROBE_S64(fsItem->blk_sum),
+            NPROBE_S64(fsItem->blk_used),
+            NPROBE_S64(fsItem->blk_free),
+            NPROBE_S64(fsItem->blk_used_per)
+        };
+        (void)nprobe_emit_record(METRICS_DF_NAME, fields, NPROBE_FIELDS_NUM(fields));
         /* output event */
         report_disk_status(fsItem, ipc_body);
         fsItem->valid = 0;
@@ -419,22 +413,20 @@ static int g_first_flag;
 
 int system_iostat_probe(struct ipc_body_s *ipc_body)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
     disk_stats temp;
     disk_io_stats io_datas;
     int index;
 
-    f = popen(SYSTEM_DISKSTATS_CMD, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_diskstats_file) < 0) {
         return -1;
     }
 
     index = 0;
-    while (!feof(f) && index < g_disk_dev_num) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            (void)pclose(f);
+    pos = g_diskstats_file.buf;
+    while (index < g_disk_dev_num) {
+        line = procfs_next_line(&pos);
+        if (line == NULL) {
             return -1;
         }
         (void)memcpy(&temp, &g_disk_stats[index], sizeof(disk_stats));
@@ -448,47 +440,42 @@ int system_iostat_probe(struct ipc_body_s *ipc_body)
             cal_disk_io_stats(&temp, &g_disk_stats[index], &io_datas, ipc_body->probe_param.period);
         }
 
-        (void)nprobe_fprintf(stdout,
-            "|%s|%s|%.2f|%.2f|%.2f|%.2f|%.2f|%.2f|%.2f|%.2f|%.2f|%.2f|\n",
-            METRICS_IOSTAT_NAME,
-            g_disk_stats[index].disk_name,
-            io_datas.rd_speed,
-            io_datas.rdkb_speed,
-            io_datas.rd_await,
-            io_datas.rareq_sz,
-            io_datas.wr_speed,
-            io_datas.wrkb_speed,
-            io_datas.wr_await,
-            io_datas.wareq_sz,
-            io_datas.aqu_sz,
-            io_datas.util);
+        struct nprobe_field_s fields[] = {
+            NPROBE_STR(g_disk_stats[index].disk_name),
+            NPROBE_DBL(io_datas.rd_speed, 2),
+            NPROBE_DBL(io_datas.rdkb_speed, 2),
+            NPROBE_DBL(io_datas.rd_await, 2),
+            NPROBE_DBL(io_datas.rareq_sz, 2),
+            NPROBE_DBL(io_datas.wr_speed, 2),
+            NPROBE_DBL(io_datas.wrkb_speed, 2),
+            NPROBE_DBL(io_datas.wr_await, 2),
+            NPROBE_DBL(io_datas.wareq_sz, 2),
+            NPROBE_DBL(io_datas.aqu_sz, 2),
+            NPROBE_DBL(io_datas.util, 2)
+        };
+        (void)nprobe_emit_record(METRICS_IOSTAT_NAME, fields, NPROBE_FIELDS_NUM(fields));
         /* event_output */
         report_disk_iostat(g_disk_stats[index].disk_name, &io_datas, ipc_body);
 
         index++;
     }
     g_first_flag = 0;
-    (void)pclose(f);
     return 0;
 }
 
 static int get_diskdev_num(int *num)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos;
+    int lines = 0;
 
-    f = popen(SYSTEM_DISK_DEV_NUM, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_diskstats_file) < 0) {
         return -1;
     }
-    line[0] = 0;
-    if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-        (void)pclose(f);
-        return -1;
+    pos = g_diskstats_file.buf;
+    while (procfs_next_line(&pos) != NULL) {
+        lines++;
     }
-    SPLIT_NEWLINE_SYMBOL(line);
-    *num = strtol(line, NULL, 10);
-    (void)pclose(f);
+    *num = lines;
     return 0;
 }
 
@@ -519,8 +506,7 @@ void system_disk_destroy(void)
             free(item);
         }
     }
-
-    return;
+    procfs_close(&g_mounts_file);
 }
 
 void system_iostat_destroy(void)
@@ -529,4 +515,5 @@ void system_iostat_destroy(void)
         (void)free(g_disk_stats);
         g_disk_stats = NULL;
     }
+    procfs_close(&g_diskstats_file);
 }
\ No newline at end of file
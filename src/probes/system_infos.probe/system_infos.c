@@ -144,6 +144,19 @@ int main(struct probe_s *probe)
             is_need_refresh_con = 1;
         }
 
+        // Processes are sampled at their own offsets in the period, see system_proc_probe()
+        if (is_load_proc) {
+            if (is_need_refresh_proc && refresh_proc_filter_map(&g_ipc_body) < 0) {
+                ERROR("[SYSTEM_PROBE] system proc refresh failed.\n");
+                goto err;
+            }
+            is_need_refresh_proc = 0;   // refresh proc_map at first time after recv_ipc_msg
+            if (system_proc_probe(&g_ipc_body) < 0) {
+                ERROR("[SYSTEM_PROBE] system proc probe failed.\n");
+                goto err;
+            }
+        }
+
         if (!is_report_tmout()) {
             sleep(1);
             continue;
@@ -173,17 +186,6 @@ int main(struct probe_s *probe)
             ERROR("[SYSTEM_PROBE] system iostat probe fail.\n");
             goto err;
         }
-        if (is_load_proc) {
-            if (is_need_refresh_proc && refresh_proc_filter_map(&g_ipc_body) < 0) {
-                ERROR("[SYSTEM_PROBE] system proc refresh failed.\n");
-                goto err;
-            }
-            is_need_refresh_proc = 0;   // refresh proc_map at first time after recv_ipc_msg
-            if (system_proc_probe(&g_ipc_body) < 0) {
-                ERROR("[SYSTEM_PROBE] system proc probe failed.\n");
-                goto err;
-            }
-        }
         if (is_load_con) {
             if (is_need_refresh_con && refresh_con_filter_map(&g_ipc_body) < 0) {
                 ERROR("[SYSTEM_PROBE] system con refresh failed.\n");
@@ -19,18 +19,21 @@
 #include "common.h"
 #include "event.h"
 #include "nprobe_fprintf.h"
+#include "procfs.h"
 #include "system_meminfo.h"
 
 #define METRICS_MEMINFO_NAME "system_meminfo"
 #define METRICS_MEMINFO_PATH "/proc/meminfo"
 #define METRTCS_DENTRY_NAME  "system_dentry"
 #define METRICS_DENTRY_ORIGIN  "fs.dentry-state"
-#define SYSTEM_FS_DENTRY_STATE "cat /proc/sys/fs/dentry-state"
+#define SYSTEM_FS_DENTRY_STATE "/proc/sys/fs/dentry-state"
 /* VmallocUsed in /proc/meminfo is inaccurate because it include VM_MALLOC VM_IOREMAP VM_MAP */
 #define METRICS_VMLLLOC_PATH  "/proc/vmallocinfo"
-#define METRICS_VMALLOC_SIZE  "grep vmalloc /proc/vmallocinfo | awk '{total+=$2}; END {print total}'"
 static struct system_meminfo_field* meminfo_fields = NULL;
 static struct dentry_stat dentry_state = {0};
+static struct procfs_file_s g_meminfo_file = PROCFS_FILE(METRICS_MEMINFO_PATH);
+static struct procfs_file_s g_vmalloc_file = PROCFS_FILE(METRICS_VMLLLOC_PATH);
+static struct procfs_file_s g_dentry_file = PROCFS_FILE(SYSTEM_FS_DENTRY_STATE);
 
 int system_meminfo_init(void)
 {
@@ -58,10 +61,13 @@ void system_meminfo_destroy(void)
         (void)free(meminfo_fields);
         meminfo_fields = NULL;
     }
+    procfs_close(&g_meminfo_file);
+    procfs_close(&g_vmalloc_file);
+    procfs_close(&g_dentry_file);
 }
 
 // get key & value from the line text, and assign to the target key.
-static int set_meminfosp_fields(const char* line, const int cur_index)
+static int set_meminfosp_fields(char* line, const int cur_index)
 {
     char* colon = strchr(line, ':');
     if (colon == NULL) {
@@ -79,24 +85,36 @@ static int set_meminfosp_fields(const char* line, const int cur_index)
     return -1;
 }
 
+/*
+ [root@localhost ~]# cat /proc/vmallocinfo
+ 0xffffa4d0c0000000-0xffffa4d0c0005000   20480 irq_init_percpu_irqstack+0x176/0x1c0 vmap
+ 0xffffa4d0c0005000-0xffffa4d0c0007000    8192 acpi_os_map_iomem+0x1ac/0x1d0 phys=0x000000007ffe0000 ioremap
+ 0xffffa4d0c000d000-0xffffa4d0c000f000    8192 bpf_prog_alloc_no_stats+0x3d/0x170 pages=1 vmalloc N0=1
+ */
 static int update_total_vmalloc(unsigned long long *value)
 {
-    char cmd[LINE_BUF_LEN];
-    char line[LINE_BUF_LEN];
-    cmd[0] = 0;
-    line[0] = 0;
+    char *pos, *line;
+    u64 size, total_b = 0;
 
-    if (access(METRICS_VMLLLOC_PATH, R_OK) != 0) {
+    if (g_vmalloc_file.fd < 0 && access(METRICS_VMLLLOC_PATH, R_OK) != 0) {
         return 0;
     }
 
-    (void)snprintf(cmd, LINE_BUF_LEN, METRICS_VMALLOC_SIZE);
-    if (exec_cmd(cmd, line, LINE_BUF_LEN) != 0) {
+    if (procfs_read(&g_vmalloc_file) < 0) {
         ERROR("[SYSTEM_PROBE] get vmallocinfo failed.\n");
         return -1;
     }
 
-    unsigned long long total_b = strtoull(line, NULL, 10);
+    pos = g_vmalloc_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
+        if (strstr(line, "vmalloc") == NULL) {
+            continue;
+        }
+        procfs_skip_fields(&line, 1);
+        if (procfs_next_u64(&line, 10, &size) == 0) {
+            total_b += size;
+        }
+    }
 
     *value = total_b / 1024;    // KB
     return 0;
@@ -189,20 +207,15 @@ static void output_meminfo(struct ipc_body_s *ipc_body)
 // /proc/meminfo
 static int get_meminfo(struct ipc_body_s *ipc_body)
 {
-    FILE* f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
     int ret = 0;
 
-    f = fopen(METRICS_MEMINFO_PATH, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_meminfo_file) < 0) {
         return -1;
     }
     int cur_index = 0;
-    while (!feof(f)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            break;
-        }
+    pos = g_meminfo_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
         ret = set_meminfosp_fields(line, cur_index);
         if (!ret) {
             cur_index++;
@@ -215,12 +228,9 @@ static int get_meminfo(struct ipc_body_s *ipc_body)
     }
     ret = update_total_vmalloc(&meminfo_fields[VMALLOC_USED].value);
     if (ret < 0) {
-        (void)fclose(f);
         return -1;
     }
     output_meminfo(ipc_body);
-
-    (void)fclose(f);
     return 0;
 }
 
@@ -228,26 +238,24 @@ static int get_meminfo(struct ipc_body_s *ipc_body)
 #define DENTRY_STATE_VALID_FIELD_NUM    3
 static int get_dentry_state(void)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos;
+    u64 values[DENTRY_STATE_VALID_FIELD_NUM];
+    int ret = 0;
 
-    f = popen(SYSTEM_FS_DENTRY_STATE, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_dentry_file) < 0) {
         return -1;
     }
-    line[0] = 0;
-    if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-        pclose(f);
-        return -1;
+    pos = g_dentry_file.buf;
+    while (ret < DENTRY_STATE_VALID_FIELD_NUM && procfs_next_u64(&pos, 10, &values[ret]) == 0) {
+        ret++;
     }
-    SPLIT_NEWLINE_SYMBOL(line);
-    int ret = sscanf(line, "%d %d %d %*d %*d %*d",
-        &dentry_state.dentry, &dentry_state.unused, &dentry_state.age_limit);
     if (ret < DENTRY_STATE_VALID_FIELD_NUM) {
         DEBUG("[SYSTEM_PROBE] get dentry_state fields fail.\n");
-        pclose(f);
         return -1;
     }
+    dentry_state.dentry = (int)values[0];
+    dentry_state.unused = (int)values[1];
+    dentry_state.age_limit = (int)values[2];
     // report data
     (void)nprobe_fprintf(stdout, "|%s|%s|%d|%d|%d|\n",
         METRTCS_DENTRY_NAME,
@@ -255,8 +263,6 @@ static int get_dentry_state(void)
         dentry_state.dentry,
         dentry_state.unused,
         dentry_state.age_limit);
-
-    pclose(f);
     return 0;
 }
 
@@ -19,6 +19,8 @@
 #include <dirent.h>
 #include "event.h"
 #include "nprobe_fprintf.h"
+#include "nprobe_record.h"
+#include "procfs.h"
 #include "system_net.h"
 
 #define METRICS_TCP_NAME        "system_tcp"
@@ -30,9 +32,12 @@
 #define SYSTEM_NET_DEV_STATUS   "/sys/class/net/%s/operstate"
 #define SYSTEM_NET_QDISC_SHOW   "tc -s -d qdisc show dev %s"
 
+static struct procfs_file_s g_snmp_file = PROCFS_FILE(SYSTEM_NET_SNMP_PATH);
+static struct procfs_file_s g_netdev_file = PROCFS_FILE(SYSTEM_NET_DEV_PATH);
+
 #define NETSNMP_TCP_FIELD_NUM   5
 #define NETSNMP_UDP_FIELD_NUM   2
-static int get_netsnmp_fields(const char *net_snmp_info, net_snmp_stat *stats)
+static int get_netsnmp_fields(char *net_snmp_info, net_snmp_stat *stats)
 {
     int ret;
     char *colon = strchr(net_snmp_info, ':');
@@ -74,23 +79,18 @@ static net_snmp_stat g_snmp_stats;
 
 int system_tcp_probe(void)
 {
-    FILE* f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
     net_snmp_stat temp = {0};
 
-    f = fopen(SYSTEM_NET_SNMP_PATH, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_snmp_file) < 0) {
         return -1;
     }
-    /* fopen success, copy g_snmp_stats to temp */
+    /* read success, copy g_snmp_stats to temp */
     (void)memcpy(&temp, &g_snmp_stats, sizeof(net_snmp_stat));
 
     /* parse lines */
-    while (!feof(f)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            break;
-        }
+    pos = g_snmp_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
         if (get_netsnmp_fields(line, (net_snmp_stat *)&g_snmp_stats) < 0) {
             continue;
         }
@@ -113,8 +113,6 @@ int system_tcp_probe(void)
             (g_snmp_stats.udp_in_datagrams - temp.udp_in_datagrams) : 0,
         (g_snmp_stats.udp_out_datagrams > temp.udp_out_datagrams) ?
             (g_snmp_stats.udp_out_datagrams - temp.udp_out_datagrams) : 0);
-
-    (void)fclose(f);
     return 0;
 }
 
@@ -160,7 +158,6 @@ static int get_netdev_fields(const char *net_dev_info, net_dev_stat *stats)
 
 static int get_netdev_status(net_dev_stat *stats)
 {
-    FILE *f = NULL;
     char fname[PATH_LEN];
     char line[LINE_BUF_LEN];
     char netdev_path[PATH_MAX];
@@ -175,23 +172,14 @@ static int get_netdev_status(net_dev_stat *stats)
         return -1;
     }
 
-    f = fopen(netdev_path, "r");
-    if (f == NULL) {
-        ERROR("[SYSTEM_NET] failed to open %s\n", netdev_path);
-        return -1;
-    }
-    line[0] = 0;
-    if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-        ERROR("[SYSTEM_NET] failed to get dev(%s) status, line is NULL.\n", stats->dev_name);
-        (void)fclose(f);
+    if (procfs_read_once(netdev_path, line, sizeof(line)) <= 0) {
+        ERROR("[SYSTEM_NET] failed to get dev(%s) status from %s.\n", stats->dev_name, netdev_path);
         return -1;
     }
     SPLIT_NEWLINE_SYMBOL(line);
     if (!strcasecmp(line, "up")) {
         stats->net_status = 1;
     }
-
-    (void)fclose(f);
     return 0;
 }
 
@@ -345,23 +333,17 @@ static int g_netdev_num;
 
 int system_net_probe(struct ipc_body_s *ipc_body)
 {
-    FILE* f = NULL;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
     char dev_name[NET_DEVICE_NAME_SIZE];
     net_dev_stat temp;
     int index = 0;
 
-    f = fopen(SYSTEM_NET_DEV_PATH, "r");
-    if (f == NULL) {
+    if (procfs_read(&g_netdev_file) < 0) {
         ERROR("[SYSTEM_NET] failed to get net device info\n");
         return -1;
     }
-    while (!feof(f)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            fclose(f);
-            return 0;
-        }
+    pos = g_netdev_file.buf;
+    while ((line = procfs_next_line(&pos)) != NULL) {
         if (strchr(line, '|') != NULL) {
             continue;
         }
@@ -382,35 +364,34 @@ int system_net_probe(struct ipc_body_s *ipc_body)
         get_netdev_status(&g_dev_stats[index]);
         get_netdev_qdisc(&g_dev_stats[index]);
 
-        (void)nprobe_fprintf(stdout,
-            "|%s|%s|%s|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%.2f|%.2f|%llu|%llu|%llu|%llu|\n",
-            METRICS_NIC_NAME,
-            g_dev_stats[index].dev_name,
-            g_dev_stats[index].net_status == 1 ? "UP" : "DOWN",
-            (g_dev_stats[index].rx_bytes > temp.rx_bytes) ? (g_dev_stats[index].rx_bytes - temp.rx_bytes) : 0,
-            (g_dev_stats[index].rx_packets > temp.rx_packets) ? (g_dev_stats[index].rx_packets - temp.rx_packets) : 0,
-            (g_dev_stats[index].rx_errs > temp.rx_errs) ? (g_dev_stats[index].rx_errs - temp.rx_errs) : 0,
-            (g_dev_stats[index].rx_dropped > temp.rx_dropped) ? (g_dev_stats[index].rx_dropped - temp.rx_dropped) : 0,
-            (g_dev_stats[index].tx_bytes > temp.tx_bytes) ? (g_dev_stats[index].tx_bytes - temp.tx_bytes) : 0,
-            (g_dev_stats[index].tx_packets > temp.tx_packets) ? (g_dev_stats[index].tx_packets - temp.tx_packets) : 0,
-            (g_dev_stats[index].tx_errs > temp.tx_errs) ? (g_dev_stats[index].tx_errs - temp.tx_errs) : 0,
-            (g_dev_stats[index].tx_dropped > temp.tx_dropped) ? (g_dev_stats[index].tx_dropped - temp.tx_dropped) : 0,
-            (g_dev_stats[index].rx_bytes > temp.rx_bytes) ?
-                SPEED_VALUE(temp.rx_bytes, g_dev_stats[index].rx_bytes, ipc_body->probe_param.period) : 0,
-            (g_dev_stats[index].tx_bytes > temp.tx_bytes) ?
-                SPEED_VALUE(temp.tx_bytes, g_dev_stats[index].tx_bytes, ipc_body->probe_param.period) : 0,
-            (g_dev_stats[index].tc_sent_drop_count > temp.tc_sent_drop_count) ?
-                (g_dev_stats[index].tc_sent_drop_count - temp.tc_sent_drop_count) : 0,
-            (g_dev_stats[index].tc_sent_overlimits_count > temp.tc_sent_overlimits_count) ?
-                (g_dev_stats[index].tc_sent_overlimits_count - temp.tc_sent_overlimits_count) : 0,
-            g_dev_stats[index].tc_backlog_count,
-            g_dev_stats[index].tc_ecn_mark);
+        net_dev_stat *cur = &g_dev_stats[index];
+        struct nprobe_field_s fields[] = {
+            NPROBE_STR(cur->dev_name),
+            NPROBE_STR(cur->net_status == 1 ? "UP" : "DOWN"),
+            NPROBE_U64((cur->rx_bytes > temp.rx_bytes) ? (cur->rx_bytes - temp.rx_bytes) : 0),
+            NPROBE_U64((cur->rx_packets > temp.rx_packets) ? (cur->rx_packets - temp.rx_packets) : 0),
+            NPROBE_U64((cur->rx_errs > temp.rx_errs) ? (cur->rx_errs - temp.rx_errs) : 0),
+            NPROBE_U64((cur->rx_dropped > temp.rx_dropped) ? (cur->rx_dropped - temp.rx_dropped) : 0),
+            NPROBE_U64((cur->tx_bytes > temp.tx_bytes) ? (cur->tx_bytes - temp.tx_bytes) : 0),
+            NPROBE_U64((cur->tx_packets > temp.tx_packets) ? (cur->tx_packets - temp.tx_packets) : 0),
+            NPROBE_U64((cur->tx_errs > temp.tx_errs) ? (cur->tx_errs - temp.tx_errs) : 0),
+            NPROBE_U64((cur->tx_dropped > temp.tx_dropped) ? (cur->tx_dropped - temp.tx_dropped) : 0),
+            NPROBE_DBL((cur->rx_bytes > temp.rx_bytes) ?
+                SPEED_VALUE(temp.rx_bytes, cur->rx_bytes, ipc_body->probe_param.period) : 0, 2),
+            NPROBE_DBL((cur->tx_bytes > temp.tx_bytes) ?
+                SPEED_VALUE(temp.tx_bytes, cur->tx_bytes, ipc_body->probe_param.period) : 0, 2),
+            NPROBE_U64((cur->tc_sent_drop_count > temp.tc_sent_drop_count) ?
+                (cur->tc_sent_drop_count - temp.tc_sent_drop_count) : 0),
+            NPROBE_U64((cur->tc_sent_overlimits_count > temp.tc_sent_overlimits_count) ?
+                (cur->tc_sent_overlimits_count - temp.tc_sent_overlimits_count) : 0),
+            NPROBE_U64(cur->tc_backlog_count),
+            NPROBE_U64(cur->tc_ecn_mark)
+        };
+        (void)nprobe_emit_record(METRICS_NIC_NAME, fields, NPROBE_FIELDS_NUM(fields));
         /* output event */
         report_netdev(&g_dev_stats[index], &temp, ipc_body);
         index++;
     }
-
-    (void)fclose(f);
     return 0;
 }
 
@@ -460,4 +441,6 @@ void system_net_destroy(void)
         (void)free(g_dev_stats);
         g_dev_stats = NULL;
     }
+    procfs_close(&g_snmp_file);
+    procfs_close(&g_netdev_file);
 }
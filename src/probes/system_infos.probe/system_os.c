@@ -20,8 +20,10 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netdb.h>
+#include <sys/utsname.h>
 
 #include "nprobe_fprintf.h"
+#include "procfs.h"
 #include "system_os.h"
 
 #define METRICS_OS_NAME         "system_os"
@@ -32,8 +34,6 @@
 #define OS_RELEASE_PRETTY_NAME  "/usr/bin/cat %s | grep -w PRETTY_NAME | awk -F'\"' \'{print $2}\'"
 #define OS_LATEST_VERSION       "/usr/bin/cat %s | grep -e %s.*version | awk -F'=' \'{print $2}\'"
 #define SYS_STAT                "/proc/stat"
-#define OS_BTIME_CMD            "/usr/bin/cat /proc/stat | awk '{if($1==\"btime\")print $2}'"
-#define OS_KVERSION             "/usr/bin/uname -r"
 #define OS_DETECT_VIRT_ENV      "systemd-detect-virt -v"
 #define LEN_1MB                 (1024 * 1024)     // 1 MB
 
@@ -84,6 +84,7 @@ static int get_os_release_info(struct node_infos *infos)
     char os_latest_path[COMMAND_LEN];
     char cmd[COMMAND_LEN];
     char line[LINE_BUF_LEN];
+    struct utsname uts;
 
     if (do_get_os_release_path(os_release_path, COMMAND_LEN) < 0) {
         ERROR("[SYSTEM_OS] get os-release file failed.\n");
@@ -106,11 +107,11 @@ static int get_os_release_info(struct node_infos *infos)
     }
     (void)snprintf(infos->os_pretty_name, sizeof(infos->os_pretty_name), "%s", line);
 
-    if (do_read_line(OS_KVERSION, line) < 0) {
+    if (uname(&uts) < 0) {
         ERROR("[SYSTEM_OS] get os kernelversion failed.\n");
         return -1;
     }
-    (void)snprintf(infos->kernel_version, sizeof(infos->kernel_version), "%s", line);
+    (void)snprintf(infos->kernel_version, sizeof(infos->kernel_version), "%s", uts.release);
 
     os_latest_path[0] = 0;
     if (strcasecmp(infos->os_id, "openEuler") == 0) {
@@ -210,29 +211,26 @@ static int get_ip_addr(struct node_infos *infos, struct ipc_body_s * ipc_body)
 
 static int get_system_btime(char *buf)
 {
-    FILE *f = NULL;
-    char line[LINE_BUF_LEN];
+    struct procfs_file_s stat_file = PROCFS_FILE(SYS_STAT);
+    char *pos, *btime;
+    int ret = -1;
 
-    if (access((const char *)SYS_STAT, 0) != 0) {
-        return -1;
+    if (procfs_read(&stat_file) < 0) {
+        ERROR("[SYSTEM_PROBE] get OS btime failed, read %s error.\n", SYS_STAT);
+        goto out;
     }
 
-    line[0] = 0;
-    f = popen(OS_BTIME_CMD, "r");
-    if (f == NULL) {
-        ERROR("[SYSTEM_PROBE] get OS btime failed, popen error.\n");
-        return -1;
-    }
-    if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-        (void)pclose(f);
-        ERROR("[SYSTEM_PROBE] OS get_info failed, line is null.\n");
-        return -1;
+    pos = procfs_find_key(stat_file.buf, "btime ");
+    btime = (pos != NULL) ? procfs_next_field(&pos) : NULL;
+    if (btime == NULL) {
+        ERROR("[SYSTEM_PROBE] OS get_info failed, btime is null.\n");
+        goto out;
     }
-
-    SPLIT_NEWLINE_SYMBOL(line);
-    (void)snprintf(buf, MAX_FIELD_LEN, "%s", line);
-    (void)pclose(f);
-    return 0;
+    (void)snprintf(buf, MAX_FIELD_LEN, "%s", btime);
+    ret = 0;
+out:
+    procfs_close(&stat_file);
+    return ret;
 }
 
 static int get_resource_info(struct node_infos *infos)
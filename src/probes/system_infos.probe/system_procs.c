@@ -22,6 +22,7 @@
 #include <time.h>
 #include "common.h"
 #include "nprobe_fprintf.h"
+#include "nprobe_record.h"
 #include "system_procs.h"
 
 #define METRICS_PROC_NAME   "system_proc"
@@ -29,11 +30,13 @@
 #define FULL_PER            100
 #define PROC_FD             "/proc/%u/fd"
 #define PROC_IO             "/proc/%u/io"
-#define PROC_SMAPS          "/proc/%u/smaps_rollup"
-#define PROC_ID_CMD         "ps -eo pid,ppid,pgid,comm | /usr/bin/awk '{if($1==\"%u\"){print $2 \"|\" $3}}'"
+#define PROC_SMAPS          "/proc/%u/smaps"
+#define PROC_SMAPS_ROLLUP   "/proc/%u/smaps_rollup"
+#define PROC_SMAPS_BUF_LEN  2048
 #define PROC_CPUSET         "/proc/%u/cpuset"
 #define PROC_CPUSET_CMD     "/usr/bin/cat /proc/%u/cpuset 2>/dev/null | awk -F '/' '{print $NF}'"
 #define PROC_LIMIT          "/proc/%u/limits"
+#define PROC_LIMIT_BUF_LEN  2048
 
 static proc_hash_t *g_procmap = NULL;
 static proc_info_t g_pre_proc_info;
@@ -56,6 +59,13 @@ static proc_hash_t *hash_find_proc(u32 pid, const char *stime)
     return p;
 }
 
+static void free_one_proc(proc_hash_t *one_proc)
+{
+    procfs_close(&one_proc->stat_file);
+    procfs_close(&one_proc->io_file);
+    (void)free(one_proc);
+}
+
 static void hash_clear_all_proc(void)
 {
     if (g_procmap == NULL) {
@@ -65,7 +75,7 @@ static void hash_clear_all_proc(void)
     HASH_ITER(hh, g_procmap, r, tmp) {
         HASH_DEL(g_procmap, r);
         if (r != NULL) {
-            (void)free(r);
+            free_one_proc(r);
         }
     }
 }
@@ -78,40 +88,6 @@ static inline int is_proc_subdir(const char *d_name)
     return -1;
 }
 
-static void get_proc_id(u32 pid, proc_info_t *proc_info)
-{
-    FILE *f = NULL;
-    char cmd[LINE_BUF_LEN];
-    char line[LINE_BUF_LEN];
-
-    if (strlen(proc_info->comm) == 0) {
-        /* comm is NULL, return */
-        return;
-    }
-
-    cmd[0] = 0;
-    (void)snprintf(cmd, LINE_BUF_LEN, PROC_ID_CMD, pid);
-    f = popen(cmd, "r");
-    if (f == NULL) {
-        goto out;
-    }
-    while (!feof(f)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            goto out;
-        }
-        SPLIT_NEWLINE_SYMBOL(line);
-
-        (void)sscanf(line, "%d %*c %d", &proc_info->ppid, &proc_info->pgid);
-    }
-
-out:
-    if (f != NULL) {
-        pclose(f);
-    }
-    return;
-}
-
 static FILE *get_proc_file(u32 pid, const char *file_fmt)
 {
     FILE *f = NULL;
@@ -125,35 +101,22 @@ static FILE *get_proc_file(u32 pid, const char *file_fmt)
 
 static int get_proc_max_fdnum(u32 pid, proc_info_t *proc_info)
 {
-    FILE *f = NULL;
-    char buffer[LINE_BUF_LEN];
-    const char *prefix = "Max open files";
-    size_t prefixLen = strlen(prefix);
-    int ret;
+    char fname[PATH_LEN];
+    char buffer[PROC_LIMIT_BUF_LEN];
+    char *pos;
+    u64 value;
 
-    f = get_proc_file(pid, PROC_LIMIT);
-    if (f == NULL) {
+    fname[0] = 0;
+    (void)snprintf(fname, sizeof(fname), PROC_LIMIT, pid);
+    if (procfs_read_once(fname, buffer, sizeof(buffer)) < 0) {
         return -1;
     }
 
-    while (!feof(f)) {
-        buffer[0] = 0;
-        if (fgets(buffer, sizeof(buffer), f) == NULL) {
-            (void)fclose(f);
-            return -1;
-        }
-        if (strncmp(prefix, buffer, prefixLen) != 0) {
-            continue;
-        }
-        ret = sscanf(buffer + prefixLen, "%u", &proc_info->max_fd_limit);
-        if (ret <= 0) {
-            (void)fclose(f);
-            return -1;
-        }
-        break;
+    pos = procfs_find_key(buffer, "Max open files");
+    if (pos == NULL || procfs_next_u64(&pos, 10, &value) < 0) {
+        return -1;
     }
-
-    (void)fclose(f);
+    proc_info->max_fd_limit = (u32)value;
     return 0;
 }
 
@@ -183,11 +146,16 @@ static int get_proc_fdcnt(u32 pid, proc_info_t *proc_info)
     return 0;
 }
 
-static void do_set_proc_stat(proc_info_t *proc_info, char *buf, int index)
+static void do_set_proc_stat(proc_info_t *proc_info, u64 value, int index)
 {
-    u64 value = strtoull(buf, NULL, 10);
     switch (index)
     {
+        case PROC_STAT_PPID:
+            proc_info->ppid = (int)value;
+            break;
+        case PROC_STAT_PGRP:
+            proc_info->pgid = (int)value;
+            break;
         case PROC_STAT_MIN_FLT:
             proc_info->proc_stat_min_flt = value;
             break;
@@ -235,36 +203,33 @@ static void do_set_proc_stat(proc_info_t *proc_info, char *buf, int index)
     }
 }
 
-static int get_proc_stat(u32 pid, proc_info_t *proc_info)
+static int get_proc_stat(proc_hash_t *proc)
 {
-    FILE *f = NULL;
-    char buffer[LINE_BUF_LEN];
-    char *p = NULL;
-    int index = 1;
+    char *pos;
+    u64 value;
+    int index;
 
-    f = get_proc_file(pid, PROC_STAT);
-    if (f == NULL) {
+    if (procfs_read(&proc->stat_file) < 0) {
         return -1;
     }
 
-    buffer[0] = 0;
-    if (fgets(buffer, sizeof(buffer), f) == NULL) {
-        (void)fclose(f);
+    // comm(field 2) may contain blanks and ')', fields are counted from the last ')'.
+    pos = strrchr(proc->stat_file.buf, ')');
+    if (pos == NULL) {
         return -1;
     }
-    SPLIT_NEWLINE_SYMBOL(buffer);
+    pos++;
+    procfs_skip_fields(&pos, 1);    // state(field 3)
 
-    p = strtok(buffer, " \t");
-    while (p != NULL && index < PROC_STAT_MAX) {
-        do_set_proc_stat(proc_info, p, index);
-        p = strtok(NULL, " \t");
-        index++;
+    for (index = PROC_STAT_PPID; index < PROC_STAT_MAX; index++) {
+        if (procfs_next_u64(&pos, 10, &value) < 0) {
+            break;
+        }
+        do_set_proc_stat(&proc->info, value, index);
     }
     if (index != PROC_STAT_MAX) {
         DEBUG("[SYSTEM_PROC] get proc stats incompletely, last position is:%d\n", index);
     }
-
-    (void)fclose(f);
     return 0;
 }
 
@@ -298,32 +263,25 @@ static void do_set_proc_io(proc_info_t *proc_info, u64 value, int index)
     }
 }
 
-static int get_proc_io(u32 pid, proc_info_t *proc_info)
+static int get_proc_io(proc_hash_t *proc)
 {
-    FILE *f = NULL;
     int index = 0;
     u64 value = 0;
-    char line[LINE_BUF_LEN];
+    char *pos, *line;
 
-    f = get_proc_file(pid, PROC_IO);
-    if (f == NULL) {
+    if (procfs_read(&proc->io_file) < 0) {
         return -1;
     }
 
-    while (!feof(f) && (index < PROC_IO_MAX)) {
-        line[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            goto out;
-        }
-        value = 0;
-        if (sscanf(line, "%*s %llu", &value) < 1) {
-            goto out;
+    pos = proc->io_file.buf;
+    while (index < PROC_IO_MAX && (line = procfs_next_line(&pos)) != NULL) {
+        procfs_skip_fields(&line, 1);
+        if (procfs_next_u64(&line, 10, &value) < 0) {
+            break;
         }
-        do_set_proc_io(proc_info, value, index);
+        do_set_proc_io(&proc->info, value, index);
         index++;
     }
-out:
-    (void)fclose(f);
     return 0;
 }
 
@@ -360,87 +318,158 @@ static void do_set_proc_mss(proc_info_t *proc_info, u32 value, int index)
     }
 }
 
-static int get_proc_mss(u32 pid, proc_info_t *proc_info)
+static const char *g_mss_keys[PROC_MSS_MAX] = {"Shared_Clean:", "Shared_Dirty:", "Private_Clean:",
+    "Private_Dirty:", "Referenced:", "LazyFree:", "Swap:", "SwapPss:"};
+static char g_smaps_rollup_checked = 0;
+static char g_smaps_rollup_supported = 0;
+
+static char is_smaps_rollup_supported(void)
+{
+    // smaps_rollup is provided since kernel 4.14
+    if (!g_smaps_rollup_checked) {
+        g_smaps_rollup_supported = (access("/proc/self/smaps_rollup", R_OK) == 0) ? 1 : 0;
+        g_smaps_rollup_checked = 1;
+    }
+    return g_smaps_rollup_supported;
+}
+
+/* Sums up the line to the field of its key, so both rollup and per-mapping smaps are accepted. */
+static void add_proc_mss_line(char *line, u32 mss[])
+{
+    char *key;
+    u64 value;
+    int i;
+
+    key = procfs_next_field(&line);
+    if (key == NULL || procfs_next_u64(&line, 10, &value) < 0) {
+        return;
+    }
+    for (i = 0; i < PROC_MSS_MAX; i++) {
+        if (strcmp(key, g_mss_keys[i]) == 0) {
+            mss[i] += (u32)value;
+            return;
+        }
+    }
+}
+
+static int read_proc_smaps_rollup(u32 pid, u32 mss[])
+{
+    char fname[PATH_LEN];
+    char buffer[PROC_SMAPS_BUF_LEN];
+    char *pos, *line;
+
+    fname[0] = 0;
+    (void)snprintf(fname, sizeof(fname), PROC_SMAPS_ROLLUP, pid);
+    if (procfs_read_once(fname, buffer, sizeof(buffer)) < 0) {
+        return -1;
+    }
+
+    pos = buffer;
+    (void)procfs_next_line(&pos);   // filter out the first line
+    while ((line = procfs_next_line(&pos)) != NULL) {
+        add_proc_mss_line(line, mss);
+    }
+    return 0;
+}
+
+static int read_proc_smaps(u32 pid, u32 mss[])
 {
     FILE *f = NULL;
-    int index = 0;
-    u32 value = 0;
     char line[LINE_BUF_LEN];
-    char key[LINE_BUF_LEN];
-    char format[SSCANF_FORMAT_LEN];
-    char smap_key_list[PROC_MSS_MAX][LINE_BUF_LEN] = {"Shared_Clean:", "Shared_Dirty:", "Private_Clean:",
-        "Private_Dirty:", "Referenced:", "LazyFree:", "Swap:", "SwapPss:"};
-    int smap_index = 0;
 
+    // smaps may be tens of megabytes for processes with many mappings, it is streamed line by line.
     f = get_proc_file(pid, PROC_SMAPS);
     if (f == NULL) {
         return -1;
     }
-
-    (void)snprintf(format, sizeof(format), "%%%lus %%u %%*s", sizeof(key) - 1);
-    while (!feof(f)) {
-        line[0] = 0;
-        key[0] = 0;
-        if (fgets(line, LINE_BUF_LEN, f) == NULL) {
-            goto out;
-        }
-        if (index == 0) {   // filter out the first line
-            index++;
-            continue;
-        }
-        value = 0;
-        int ret = sscanf(line, format, key, &value);
-        if (ret < 2) {
-            goto out;
-        }
-        if (strcmp(smap_key_list[smap_index], key) != 0) {
-            continue;
-        }
-        do_set_proc_mss(proc_info, value, smap_index);
-        smap_index++;
-        if (smap_index >= PROC_MSS_MAX) {
-            break;
-        }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        add_proc_mss_line(line, mss);
     }
-out:
     (void)fclose(f);
     return 0;
 }
 
-static int update_proc_infos(u32 pid, proc_info_t *proc_info)
+static int get_proc_mss(u32 pid, proc_info_t *proc_info)
 {
-    int ret = 0;
-
-    (void)memcpy(&g_pre_proc_info, proc_info, sizeof(proc_info_t));
+    u32 mss[PROC_MSS_MAX] = {0};
+    int ret, i;
 
-    ret = get_proc_stat(pid, proc_info);
+    if (is_smaps_rollup_supported()) {
+        ret = read_proc_smaps_rollup(pid, mss);
+    } else {
+        ret = read_proc_smaps(pid, mss);
+    }
     if (ret < 0) {
-        DEBUG("[SYSTEM_PROC] failed to get process stat\n");
         return -1;
     }
 
-    ret = get_proc_fdcnt(pid, proc_info);
-    if (ret < 0) {
+    for (i = 0; i < PROC_MSS_MAX; i++) {
+        do_set_proc_mss(proc_info, mss[i], i);
+    }
+    return 0;
+}
+
+static u64 get_elapsed_us(const struct timespec *start, const struct timespec *end)
+{
+    return (u64)((end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000);
+}
+
+static int update_proc_slow_infos(proc_hash_t *proc)
+{
+    struct timespec start, end;
+    u64 cost_us;
+    int ret = 0;
+
+    if (proc->slow_countdown > 0) {
+        proc->slow_countdown--;
+        return 0;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    if (get_proc_fdcnt(proc->key.pid, &proc->info) < 0) {
         DEBUG("[SYSTEM_PROC] failed to get process fd info\n");
-        return -1;
+        ret = -1;
+    } else if (get_proc_mss(proc->key.pid, &proc->info) < 0) {
+        DEBUG("[SYSTEM_PROC] failed to get process mss info\n");
+        ret = -1;
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Huge fd tables and mapping lists are walked less often, the last values are reported meanwhile.
+    cost_us = get_elapsed_us(&start, &end);
+    if (cost_us > PROC_SLOW_COST_US) {
+        if (proc->slow_interval < PROC_SLOW_MAX_INTERVAL) {
+            proc->slow_interval *= 2;
+        }
+    } else if (cost_us < PROC_SLOW_COST_US / 4 && proc->slow_interval > 1) {
+        proc->slow_interval /= 2;
     }
+    proc->slow_countdown = proc->slow_interval - 1;
+    return ret;
+}
+
+static int update_proc_infos(proc_hash_t *proc)
+{
+    int ret = 0;
+
+    (void)memcpy(&g_pre_proc_info, &proc->info, sizeof(proc_info_t));
 
-    ret = get_proc_io(pid, proc_info);
+    ret = get_proc_stat(proc);
     if (ret < 0) {
-        DEBUG("[SYSTEM_PROC] failed to get process io info\n");
+        DEBUG("[SYSTEM_PROC] failed to get process stat\n");
         return -1;
     }
 
-    ret = get_proc_mss(pid, proc_info);
+    ret = get_proc_io(proc);
     if (ret < 0) {
-        DEBUG("[SYSTEM_PROC] failed to get process mss info\n");
+        DEBUG("[SYSTEM_PROC] failed to get process io info\n");
         return -1;
     }
 
-    return 0;
+    return update_proc_slow_infos(proc);
 }
 
-static void output_proc_infos(proc_hash_t *one_proc, unsigned int period)
+static void output_proc_infos(proc_hash_t *one_proc, time_t elapsed)
 {
     u32 fd_free = one_proc->info.max_fd_limit - one_proc->info.fd_count;
     float fd_free_per = fd_free / (float)one_proc->info.max_fd_limit * 100;
@@ -448,63 +477,65 @@ static void output_proc_infos(proc_hash_t *one_proc, unsigned int period)
     u64 sys_clock_ticks = (u64)sysconf(_SC_CLK_TCK);
 
     float proc_cpu_util = (float)((one_proc->info.proc_stat_utime + one_proc->info.proc_stat_stime) -
-        (g_pre_proc_info.proc_stat_utime + g_pre_proc_info.proc_stat_stime)) / (period * sys_clock_ticks) * FULL_PER;
+        (g_pre_proc_info.proc_stat_utime + g_pre_proc_info.proc_stat_stime)) / (elapsed * sys_clock_ticks) * FULL_PER;
 
     float proc_cpu_user_util = 0.0;
     float cur_proc_user_ticks = (one_proc->info.proc_stat_utime - one_proc->info.proc_stat_guest_time);
     float prev_proc_user_ticks = (g_pre_proc_info.proc_stat_utime - g_pre_proc_info.proc_stat_guest_time);
     if (cur_proc_user_ticks > prev_proc_user_ticks) {
-        proc_cpu_user_util = (float)(cur_proc_user_ticks - prev_proc_user_ticks) / (period * sys_clock_ticks) * FULL_PER;
+        proc_cpu_user_util = (float)(cur_proc_user_ticks - prev_proc_user_ticks) / (elapsed * sys_clock_ticks) * FULL_PER;
     }
 
     float proc_cpu_system_util = (float)(one_proc->info.proc_stat_stime - g_pre_proc_info.proc_stat_stime) /
-        (period * sys_clock_ticks) * FULL_PER;
-
-    nprobe_fprintf(stdout,
-        "|%s|%lu|%d|%d|%u|%.2f|%llu|%llu|%u|%u|%llu|%llu|%llu|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%llu|%.2f|%llu|%.2f|%.2f|%.2f|\n",
-        METRICS_PROC_NAME,
-        one_proc->key.pid,
-        one_proc->info.pgid,
-        one_proc->info.ppid,
-        one_proc->info.fd_count,
-        fd_free_per,
-        one_proc->info.proc_rchar_bytes - g_pre_proc_info.proc_rchar_bytes,
-        one_proc->info.proc_wchar_bytes - g_pre_proc_info.proc_wchar_bytes,
-        one_proc->info.proc_syscr_count - g_pre_proc_info.proc_syscr_count,
-        one_proc->info.proc_syscw_count - g_pre_proc_info.proc_syscw_count,
-        one_proc->info.proc_read_bytes - g_pre_proc_info.proc_read_bytes,
-        one_proc->info.proc_write_bytes - g_pre_proc_info.proc_write_bytes,
-        one_proc->info.proc_cancelled_write_bytes - g_pre_proc_info.proc_cancelled_write_bytes,
-        one_proc->info.proc_shared_clean,
-        one_proc->info.proc_shared_dirty,
-        one_proc->info.proc_private_clean,
-        one_proc->info.proc_private_dirty,
-        one_proc->info.proc_referenced,
-        one_proc->info.proc_lazyfree,
-        one_proc->info.proc_swap,
-        one_proc->info.proc_swappss,
-        one_proc->info.proc_stat_min_flt - g_pre_proc_info.proc_stat_min_flt,
-        one_proc->info.proc_stat_maj_flt - g_pre_proc_info.proc_stat_maj_flt,
-        one_proc->info.proc_stat_utime - g_pre_proc_info.proc_stat_utime,
-        one_proc->info.proc_stat_stime - g_pre_proc_info.proc_stat_stime,
-        one_proc->info.proc_stat_cutime - g_pre_proc_info.proc_stat_cutime,
-        one_proc->info.proc_stat_cstime - g_pre_proc_info.proc_stat_cstime,
-        one_proc->info.proc_stat_priority,
-        one_proc->info.proc_stat_nice,
-        one_proc->info.proc_stat_num_threads,
-        one_proc->info.proc_stat_vsize,
-        one_proc->info.proc_stat_rss * (u64)sysconf(_SC_PAGESIZE),
-        one_proc->info.proc_stat_rss * 1.0 * FULL_PER / (u64)sysconf(_SC_PHYS_PAGES),
-        one_proc->info.proc_stat_cpu,
-        proc_cpu_util,
-        proc_cpu_user_util,
-        proc_cpu_system_util);
+        (elapsed * sys_clock_ticks) * FULL_PER;
+
+    struct nprobe_field_s fields[] = {
+        NPROBE_U64(one_proc->key.pid),
+        NPROBE_S64(one_proc->info.pgid),
+        NPROBE_S64(one_proc->info.ppid),
+        NPROBE_U64(one_proc->info.fd_count),
+        NPROBE_DBL(fd_free_per, 2),
+        NPROBE_U64(one_proc->info.proc_rchar_bytes - g_pre_proc_info.proc_rchar_bytes),
+        NPROBE_U64(one_proc->info.proc_wchar_bytes - g_pre_proc_info.proc_wchar_bytes),
+        NPROBE_U64(one_proc->info.proc_syscr_count - g_pre_proc_info.proc_syscr_count),
+        NPROBE_U64(one_proc->info.proc_syscw_count - g_pre_proc_info.proc_syscw_count),
+        NPROBE_U64(one_proc->info.proc_read_bytes - g_pre_proc_info.proc_read_bytes),
+        NPROBE_U64(one_proc->info.proc_write_bytes - g_pre_proc_info.proc_write_bytes),
+        NPROBE_U64(one_proc->info.proc_cancelled_write_bytes - g_pre_proc_info.proc_cancelled_write_bytes),
+        NPROBE_U64(one_proc->info.proc_shared_clean),
+        NPROBE_U64(one_proc->info.proc_shared_dirty),
+        NPROBE_U64(one_proc->info.proc_private_clean),
+        NPROBE_U64(one_proc->info.proc_private_dirty),
+        NPROBE_U64(one_proc->info.proc_referenced),
+        NPROBE_U64(one_proc->info.proc_lazyfree),
+        NPROBE_U64(one_proc->info.proc_swap),
+        NPROBE_U64(one_proc->info.proc_swappss),
+        NPROBE_U64(one_proc->info.proc_stat_min_flt - g_pre_proc_info.proc_stat_min_flt),
+        NPROBE_U64(one_proc->info.proc_stat_maj_flt - g_pre_proc_info.proc_stat_maj_flt),
+        NPROBE_U64(one_proc->info.proc_stat_utime - g_pre_proc_info.proc_stat_utime),
+        NPROBE_U64(one_proc->info.proc_stat_stime - g_pre_proc_info.proc_stat_stime),
+        NPROBE_U64(one_proc->info.proc_stat_cutime - g_pre_proc_info.proc_stat_cutime),
+        NPROBE_U64(one_proc->info.proc_stat_cstime - g_pre_proc_info.proc_stat_cstime),
+        NPROBE_U64(one_proc->info.proc_stat_priority),
+        NPROBE_U64(one_proc->info.proc_stat_nice),
+        NPROBE_U64(one_proc->info.proc_stat_num_threads),
+        NPROBE_U64(one_proc->info.proc_stat_vsize),
+        NPROBE_U64(one_proc->info.proc_stat_rss * (u64)sysconf(_SC_PAGESIZE)),
+        NPROBE_DBL(one_proc->info.proc_stat_rss * 1.0 * FULL_PER / (u64)sysconf(_SC_PHYS_PAGES), 2),
+        NPROBE_U64(one_proc->info.proc_stat_cpu),
+        NPROBE_DBL(proc_cpu_util, 2),
+        NPROBE_DBL(proc_cpu_user_util, 2),
+        NPROBE_DBL(proc_cpu_system_util, 2)
+    };
+
+    (void)nprobe_emit_record(METRICS_PROC_NAME, fields, NPROBE_FIELDS_NUM(fields));
     return;
 }
 
 static proc_hash_t* init_one_proc(u32 pid, char *stime, char *comm)
 {
     proc_hash_t *item;
+    char fname[PATH_LEN];
 
     item = (proc_hash_t *)malloc(sizeof(proc_hash_t));
     if (item == NULL) {
@@ -518,34 +549,56 @@ static proc_hash_t* init_one_proc(u32 pid, char *stime, char *comm)
     (void)snprintf(item->info.comm, sizeof(item->info.comm), "%s", comm);
     item->flag = PROC_IN_PROBE_RANGE;
 
-    (void)get_proc_max_fdnum(pid, &item->info);
+    fname[0] = 0;
+    (void)snprintf(fname, sizeof(fname), PROC_STAT, pid);
+    procfs_file_init(&item->stat_file, fname);
+    fname[0] = 0;
+    (void)snprintf(fname, sizeof(fname), PROC_IO, pid);
+    procfs_file_init(&item->io_file, fname);
 
-    get_proc_id(pid, &item->info);
+    (void)get_proc_max_fdnum(pid, &item->info);
 
-    (void)update_proc_infos(pid, &item->info);
+    item->slow_interval = 1;
+    (void)update_proc_infos(item);
+    item->last_sample = time(NULL);
 
     return item;
 }
 
+/*
+ * Called every second, samples the processes whose time has come. Each process is sampled once per
+ * period, at the offset assigned when the proc map is refreshed, so collection is spread over the period.
+ */
 int system_proc_probe(struct ipc_body_s *ipc_body)
 {
     proc_hash_t *proc, *tmp;
+    time_t now = time(NULL);
+    time_t period = (time_t)ipc_body->probe_param.period;
 
     HASH_ITER(hh, g_procmap, proc, tmp) {
+        if (now < proc->next_sample) {
+            continue;
+        }
         if (!is_valid_proc(proc->key.pid)) {
             HASH_DEL(g_procmap, proc);
-            free(proc);
+            free_one_proc(proc);
             continue;
         }
         if (proc->flag == PROC_IN_PROBE_RANGE) {
-            (void)update_proc_infos(proc->key.pid, &proc->info);
+            (void)update_proc_infos(proc);
             if (proc->key.start_time != proc->info.proc_start_time) {
                 HASH_DEL(g_procmap, proc);
-                free(proc);
+                free_one_proc(proc);
                 continue;
             }
 
-            output_proc_infos(proc, ipc_body->probe_param.period);
+            output_proc_infos(proc, (now > proc->last_sample) ? (now - proc->last_sample) : 1);
+        }
+        proc->last_sample = now;
+        // Keep the offset in period, unless the probe fell behind by more than one period.
+        proc->next_sample += period;
+        if (proc->next_sample <= now) {
+            proc->next_sample = now + period;
         }
     }
 
@@ -558,10 +611,19 @@ int refresh_proc_filter_map(struct ipc_body_s *ipc_body)
     char comm[PROC_NAME_MAX];
     char stime[PROC_NAME_MAX];
     proc_hash_t *item, *p;
+    time_t now = time(NULL);
+    time_t period = (time_t)ipc_body->probe_param.period;
+    int proc_num = 0, i;
 
     hash_clear_all_proc();
 
-    for (int i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
+    for (i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
+        if (ipc_body->snooper_objs[i].type == SNOOPER_OBJ_PROC) {
+            proc_num++;
+        }
+    }
+
+    for (i = 0; i < ipc_body->snooper_obj_num && i < SNOOPER_MAX; i++) {
         if (ipc_body->snooper_objs[i].type != SNOOPER_OBJ_PROC) {
             continue;
         }
@@ -574,6 +636,11 @@ int refresh_proc_filter_map(struct ipc_body_s *ipc_body)
         p = hash_find_proc(pid, stime);
         if (p == NULL) {
             item = init_one_proc(pid, stime, comm);
+            if (item == NULL) {
+                continue;
+            }
+            // The n-th process is first sampled at (n * period / proc_num) seconds into the period.
+            item->next_sample = now + 1 + (time_t)HASH_COUNT(g_procmap) * period / proc_num;
             hash_add_proc(item);
         }
     }
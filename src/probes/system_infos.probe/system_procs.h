@@ -20,11 +20,15 @@
 #include <uthash.h>
 #include "common.h"
 #include "ipc.h"
+#include "procfs.h"
 
 #define PROC_NAME_MAX       64
 #define PROC_MAX_RANGE      64
 #define PROC_IN_PROBE_RANGE 1
 
+#define PROC_SLOW_COST_US       2000    // smaps and fd count costing more than this are sampled less often
+#define PROC_SLOW_MAX_INTERVAL  8       // unit: sample, smaps and fd count are sampled at least this often
+
 #define CONTAINER_ID_BUF_LEN (CONTAINER_ABBR_ID_LEN + 4)
 
 enum proc_io_e {
@@ -40,6 +44,8 @@ enum proc_io_e {
 };
 
 enum proc_stat_e {
+    PROC_STAT_PPID = 4,
+    PROC_STAT_PGRP,
     PROC_STAT_MIN_FLT = 10,
     PROC_STAT_MAJ_FLT = 12,
     PROC_STAT_UTIME = 14,
@@ -77,10 +83,10 @@ typedef struct {
 
 typedef struct {
     char comm[PROC_NAME_MAX];
-    int pgid;
-    int ppid;
+    int pgid;                           // FROM same as proc_stat_min_flt
+    int ppid;                           // FROM same as proc_stat_min_flt
     u64 proc_start_time;                // FROM same as proc_stat_min_flt
-    u32 fd_count;                       // FROM '/usr/bin/ls -l /proc/[PID]/fd | wc -l'
+    u32 fd_count;                       // FROM '/proc/[PID]/fd' directory walk
     u32 max_fd_limit;                   // FROM 'cat /proc/[PID]/limits | grep -w "MAX open files"'
     u32 proc_syscr_count;               // FROM same as 'task_rchar_bytes'
     u32 proc_syscw_count;               // FROM same as 'task_rchar_bytes'
@@ -90,7 +96,7 @@ typedef struct {
     u64 proc_write_bytes;               // FROM same as 'task_rchar_bytes'
     u64 proc_cancelled_write_bytes;     // FROM same as 'task_rchar_bytes'
     u32 proc_oom_score_adj;             // FROM tracepoint 'oom_score_adj_update'
-    u32 proc_shared_dirty;              // FROM '/usr/bin/cat /proc/%s/smaps_rollup'
+    u32 proc_shared_dirty;              // FROM '/proc/[PID]/smaps_rollup', or summed from '/proc/[PID]/smaps'
     u32 proc_shared_clean;              // FROM same as proc_shared_dirty
     u32 proc_private_dirty;             // FROM same as proc_shared_dirty
     u32 proc_private_clean;             // FROM same as proc_shared_dirty
@@ -98,7 +104,7 @@ typedef struct {
     u32 proc_lazyfree;                  // FROM same as proc_shared_dirty
     u32 proc_swap;                      // FROM same as proc_shared_dirty
     u32 proc_swappss;                   // FROM same as proc_shared_dirty
-    u64 proc_stat_min_flt;              // FROM '/usr/bin/cat /proc/%s/stat'
+    u64 proc_stat_min_flt;              // FROM '/proc/[PID]/stat'
     u64 proc_stat_maj_flt;              // FROM same as proc_stat_min_flt
     u64 proc_stat_utime;                // FROM same as proc_stat_min_flt
     u64 proc_stat_stime;                // FROM same as proc_stat_min_flt
@@ -117,6 +123,17 @@ typedef struct {
     proc_key_t key;     // key
     char flag;          // whether in proc_range list, 1:yes/0:no
     proc_info_t info;
+    struct procfs_file_s stat_file;     // '/proc/[PID]/stat' kept open if the fd budget allows
+    struct procfs_file_s io_file;       // '/proc/[PID]/io' kept open if the fd budget allows
+    /*
+     * Processes are spread over the period, each one is sampled once per period at its own offset.
+     * smaps and fd count are sampled every slow_interval samples, which doubles while collecting
+     * them is expensive and halves when it is cheap again.
+     */
+    time_t next_sample;
+    time_t last_sample;
+    u32 slow_interval;
+    u32 slow_countdown;
     UT_hash_handle hh;
 } proc_hash_t;
 
@@ -479,7 +479,7 @@ static int WebServerInit(ResourceMgr *resourceMgr)
     }
 
     resourceMgr->web_server_mgr = web_server_mgr;
-    ret = init_web_server_mgr(web_server_mgr, configMgr->webServerConfig);
+    ret = init_web_server_mgr(web_server_mgr, configMgr->webServerConfig, resourceMgr->imdbMgr);
     if (ret) {
         return -1;
     }
@@ -493,7 +493,7 @@ static int WebServerInit(ResourceMgr *resourceMgr)
 
 static void WebServerDeinit(ResourceMgr *resourceMgr)
 {
-    destroy_http_server_mgr(resourceMgr->web_server_mgr);
+    destroy_web_server_mgr(resourceMgr->web_server_mgr);
     resourceMgr->web_server_mgr = NULL;
     return;
 }
@@ -23,11 +23,38 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <errno.h>
+#include <time.h>
+#include <zlib.h>
 
 #include "imdb.h"
 #include "http_server.h"
 #include "web_server.h"
 
+#define WEB_SERVER_CHUNK_SIZE       (1024 * 1024)   // Same as the serializing buffer of metrics logs
+#define WEB_SERVER_GZIP_WBITS       (MAX_WBITS + 16)
+
+/*
+ * One rendering of IMDB, shared by all scrapers within snapshot_ttl. Replies hold
+ * references on it, so it is only freed after the last reply has been sent.
+ */
+struct metrics_snapshot_s {
+    int ref;
+    time_t ts;
+    char *buf;
+    size_t len;
+    size_t size;
+    char *gz_buf;                   // Compressed on the first scrape accepting gzip
+    size_t gz_len;
+};
+
+struct web_server_metrics_s {
+    IMDB_DataBaseMgr *imdb_mgr;
+    char metrics_file;
+    uint32_t snapshot_ttl;
+    char *chunk;
+    struct metrics_snapshot_s *snapshot;
+};
+
 
 static int is_request_uri_invalid(struct evhttp_request *req)
 {
@@ -62,22 +89,200 @@ static int evbuffer_add_file_content(struct evbuffer *buf, int fd, ev_off_t offs
     return r;
 }
 
-static void web_server_request_handler(struct evhttp_request *req, void *arg)
+static void metrics_snapshot_put(struct metrics_snapshot_s *snapshot)
 {
-    char log_file_name[256];
-    struct evbuffer *evbuffer = NULL;
-    struct stat buf;
-    int fd, ret;
+    if (snapshot == NULL || --snapshot->ref > 0) {
+        return;
+    }
+    free(snapshot->buf);
+    free(snapshot->gz_buf);
+    free(snapshot);
+}
 
-    // Disallow any input data and any method except GET
-    if (evhttp_request_get_command(req) != EVHTTP_REQ_GET) {
-        return http_server_reply_code(req, HTTP_BADMETHOD);
+static void metrics_snapshot_cleanup(const void *data, size_t datalen, void *extra)
+{
+    metrics_snapshot_put((struct metrics_snapshot_s *)extra);
+}
+
+static int metrics_snapshot_append(void *ctx, const char *buf, uint32_t len)
+{
+    struct metrics_snapshot_s *snapshot = (struct metrics_snapshot_s *)ctx;
+    size_t size;
+    char *new_buf;
+
+    if (snapshot->len + len > snapshot->size) {
+        size = (snapshot->size == 0) ? WEB_SERVER_CHUNK_SIZE : snapshot->size;
+        while (size < snapshot->len + len) {
+            size *= 2;
+        }
+        new_buf = (char *)realloc(snapshot->buf, size);
+        if (new_buf == NULL) {
+            return -1;
+        }
+        snapshot->buf = new_buf;
+        snapshot->size = size;
     }
 
-    if (is_request_uri_invalid(req)) {
-        return http_server_reply_code(req, HTTP_NOTFOUND);
+    (void)memcpy(snapshot->buf + snapshot->len, buf, len);
+    snapshot->len += len;
+    return 0;
+}
+
+static struct metrics_snapshot_s *metrics_snapshot_render(struct web_server_metrics_s *metrics)
+{
+    struct metrics_snapshot_s *snapshot;
+
+    snapshot = (struct metrics_snapshot_s *)calloc(1, sizeof(struct metrics_snapshot_s));
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    snapshot->ref = 1;
+    snapshot->ts = time(NULL);
+
+    metrics->chunk[0] = 0;
+    if (IMDB_DataBase2MetricsSnapshot(metrics->imdb_mgr, metrics->chunk, WEB_SERVER_CHUNK_SIZE,
+                                      metrics_snapshot_append, snapshot) < 0) {
+        ERROR("[WEBSERVER] Failed to render metrics snapshot\n");
+        metrics_snapshot_put(snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+/* Returns a referenced snapshot, it is rendered again only when the current one expires. */
+static struct metrics_snapshot_s *metrics_snapshot_get(struct web_server_metrics_s *metrics)
+{
+    struct metrics_snapshot_s *snapshot = metrics->snapshot;
+
+    if (snapshot == NULL || time(NULL) >= snapshot->ts + (time_t)metrics->snapshot_ttl) {
+        snapshot = metrics_snapshot_render(metrics);
+        if (snapshot == NULL) {
+            return NULL;
+        }
+        metrics_snapshot_put(metrics->snapshot);
+        metrics->snapshot = snapshot;
+    }
+
+    snapshot->ref++;
+    return snapshot;
+}
+
+static int metrics_snapshot_gzip(struct metrics_snapshot_s *snapshot)
+{
+    z_stream strm = {0};
+    uLong bound;
+    int ret;
+
+    if (snapshot->gz_buf != NULL) {
+        return 0;
+    }
+
+    if (deflateInit2(&strm, Z_BEST_SPEED, Z_DEFLATED, WEB_SERVER_GZIP_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+    bound = deflateBound(&strm, (uLong)snapshot->len);
+    snapshot->gz_buf = (char *)malloc(bound);
+    if (snapshot->gz_buf == NULL) {
+        (void)deflateEnd(&strm);
+        return -1;
+    }
+
+    strm.next_in = (Bytef *)snapshot->buf;
+    strm.avail_in = (uInt)snapshot->len;
+    strm.next_out = (Bytef *)snapshot->gz_buf;
+    strm.avail_out = (uInt)bound;
+    ret = deflate(&strm, Z_FINISH);
+    snapshot->gz_len = strm.total_out;
+    (void)deflateEnd(&strm);
+
+    if (ret != Z_STREAM_END) {
+        free(snapshot->gz_buf);
+        snapshot->gz_buf = NULL;
+        snapshot->gz_len = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static int is_gzip_accepted(struct evhttp_request *req)
+{
+    const char *encoding;
+    const char *gzip;
+
+    encoding = evhttp_find_header(evhttp_request_get_input_headers(req), "Accept-Encoding");
+    if (encoding == NULL) {
+        return 0;
+    }
+    gzip = strstr(encoding, "gzip");
+    if (gzip == NULL) {
+        return 0;
+    }
+
+    // "gzip;q=0" means gzip is not acceptable
+    gzip += strlen("gzip");
+    while (*gzip == ' ') {
+        gzip++;
+    }
+    if (strncmp(gzip, ";q=", strlen(";q=")) == 0) {
+        return strtod(gzip + strlen(";q="), NULL) > 0;
+    }
+    return 1;
+}
+
+static void web_server_reply_snapshot(struct evhttp_request *req, struct web_server_metrics_s *metrics)
+{
+    struct metrics_snapshot_s *snapshot;
+    struct evbuffer *evbuffer;
+    struct evkeyvalq *headers;
+    const char *data;
+    size_t len;
+    int gzip;
+
+    snapshot = metrics_snapshot_get(metrics);
+    if (snapshot == NULL) {
+        return http_server_reply_code(req, HTTP_INTERNAL);
     }
 
+    if (snapshot->len == 0) {
+        metrics_snapshot_put(snapshot);
+        return http_server_reply_code(req, HTTP_NOCONTENT);
+    }
+
+    gzip = is_gzip_accepted(req) && metrics_snapshot_gzip(snapshot) == 0;
+    data = gzip ? snapshot->gz_buf : snapshot->buf;
+    len = gzip ? snapshot->gz_len : snapshot->len;
+
+    evbuffer = evbuffer_new();
+    if (evbuffer == NULL) {
+        metrics_snapshot_put(snapshot);
+        ERROR("[WEBSERVER] Failed to allocate reply buffer\n");
+        return http_server_reply_code(req, HTTP_INTERNAL);
+    }
+
+    // Reply refers to the snapshot without copying, the reference is dropped by cleanup callback.
+    if (evbuffer_add_reference(evbuffer, data, len, metrics_snapshot_cleanup, snapshot) != 0) {
+        metrics_snapshot_put(snapshot);
+        evbuffer_free(evbuffer);
+        return http_server_reply_code(req, HTTP_INTERNAL);
+    }
+
+    headers = evhttp_request_get_output_headers(req);
+    (void)evhttp_add_header(headers, "Content-Type", "text/plain; version=0.0.4");
+    (void)evhttp_add_header(headers, "Vary", "Accept-Encoding");
+    if (gzip) {
+        (void)evhttp_add_header(headers, "Content-Encoding", "gzip");
+    }
+    evhttp_send_reply(req, HTTP_OK, NULL, evbuffer);
+    evbuffer_free(evbuffer);
+}
+
+static void web_server_reply_file(struct evhttp_request *req)
+{
+    char log_file_name[256];
+    struct evbuffer *evbuffer = NULL;
+    struct stat buf;
+    int fd, ret;
+
     // The log file may has not been created if we get here between que_get_next_file() and LOG4CPLUS_DEBUG_FMT()
     if (ReadMetricsLogs(log_file_name) < 0 || access(log_file_name, F_OK) == -1) {
         return http_server_reply_code(req, HTTP_NOCONTENT);
@@ -118,11 +323,84 @@ static void web_server_request_handler(struct evhttp_request *req, void *arg)
     evbuffer_free(evbuffer);
 }
 
+static void web_server_request_handler(struct evhttp_request *req, void *arg)
+{
+    struct web_server_metrics_s *metrics = (struct web_server_metrics_s *)arg;
 
-int init_web_server_mgr(http_server_mgr_s *web_server, HttpServerConfig *config)
+    // Disallow any input data and any method except GET
+    if (evhttp_request_get_command(req) != EVHTTP_REQ_GET) {
+        return http_server_reply_code(req, HTTP_BADMETHOD);
+    }
+
+    if (is_request_uri_invalid(req)) {
+        return http_server_reply_code(req, HTTP_NOTFOUND);
+    }
+
+    if (metrics == NULL || metrics->metrics_file) {
+        return web_server_reply_file(req);
+    }
+    return web_server_reply_snapshot(req, metrics);
+}
+
+static void destroy_web_server_metrics(struct web_server_metrics_s *metrics)
 {
+    if (metrics == NULL) {
+        return;
+    }
+    metrics_snapshot_put(metrics->snapshot);
+    free(metrics->chunk);
+    free(metrics);
+}
+
+static struct web_server_metrics_s *create_web_server_metrics(HttpServerConfig *config, IMDB_DataBaseMgr *imdb_mgr)
+{
+    struct web_server_metrics_s *metrics;
+
+    metrics = (struct web_server_metrics_s *)calloc(1, sizeof(struct web_server_metrics_s));
+    if (metrics == NULL) {
+        return NULL;
+    }
+    metrics->imdb_mgr = imdb_mgr;
+    metrics->metrics_file = config->metricsFile;
+    metrics->snapshot_ttl = config->snapshotTtl;
+    if (metrics->metrics_file) {
+        return metrics;
+    }
+
+    metrics->chunk = (char *)malloc(WEB_SERVER_CHUNK_SIZE);
+    if (metrics->chunk == NULL) {
+        free(metrics);
+        return NULL;
+    }
+    return metrics;
+}
+
+int init_web_server_mgr(http_server_mgr_s *web_server, HttpServerConfig *config, IMDB_DataBaseMgr *imdb_mgr)
+{
+    struct web_server_metrics_s *metrics;
+
+    metrics = create_web_server_metrics(config, imdb_mgr);
+    if (metrics == NULL) {
+        ERROR("[WEBSERVER] Failed to create metrics context\n");
+        return -1;
+    }
+
     (void)snprintf(web_server->name, HTTP_THREAD_NAME_LEN, "%s", "WEBSERVER");
     web_server->req_handler = web_server_request_handler;
+    web_server->req_arg = metrics;
     web_server->allow_methods = EVHTTP_REQ_GET;
+    if (imdb_mgr != NULL && !metrics->metrics_file) {
+        imdb_mgr->renderOnScrape = 1;
+    }
     return init_http_server_mgr(web_server, config);
 }
+
+void destroy_web_server_mgr(http_server_mgr_s *web_server)
+{
+    if (web_server == NULL) {
+        return;
+    }
+    destroy_web_server_metrics((struct web_server_metrics_s *)web_server->req_arg);
+    web_server->req_arg = NULL;
+    destroy_http_server_mgr(web_server);
+}
@@ -21,7 +21,14 @@
 #include "config.h"
 #include "base.h"
 #include "http_server.h"
+#include "imdb.h"
 
-int init_web_server_mgr(http_server_mgr_s *web_server, HttpServerConfig *config);
+/*
+ * By default scrapes are served from an in-memory snapshot of IMDB, which is rendered on
+ * demand and shared by all scrapers within snapshot_ttl. metrics_mode = "file" keeps the
+ * old behavior: serve and remove the files written by metrics logs thread.
+ */
+int init_web_server_mgr(http_server_mgr_s *web_server, HttpServerConfig *config, IMDB_DataBaseMgr *imdb_mgr);
+void destroy_web_server_mgr(http_server_mgr_s *web_server);
 #endif
 
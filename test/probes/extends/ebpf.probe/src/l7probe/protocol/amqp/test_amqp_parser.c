@@ -18,6 +18,7 @@
 #include <assert.h>
 #include "common/protocol_common.h"
 #include "amqp_parser.h"
+#include "utils/l7_mem.h"
 
 /* Test Data */
 static const char AMQP_PROTOCOL_HEADER[] = "AMQP\x00\x00\x09\x01";
@@ -46,7 +47,7 @@ static void test_protocol_header(void)
     
     /* Cleanup */
     if (frame_data) {
-        free(frame_data);
+        l7_mem_free(frame_data);
     }
 }
 
@@ -75,7 +76,7 @@ static void test_method_frame(void)
     
     /* Cleanup */
     if (frame_data) {
-        free(frame_data);
+        l7_mem_free(frame_data);
     }
 }
 
@@ -103,7 +104,7 @@ static void test_content_header(void)
     
     /* Cleanup */
     if (frame_data) {
-        free(frame_data);
+        l7_mem_free(frame_data);
     }
 }
 
@@ -132,7 +133,7 @@ static void test_content_body(void)
     
     /* Cleanup */
     if (frame_data) {
-        free(frame_data);
+        l7_mem_free(frame_data);
     }
 }
 
@@ -159,7 +160,7 @@ static void test_heartbeat(void)
     
     /* Cleanup */
     if (frame_data) {
-        free(frame_data);
+        l7_mem_free(frame_data);
     }
 }
 
@@ -0,0 +1,287 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-28
+ * Description: l7 frame and record memory test cases and per-protocol parser benchmark
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include "data_stream.h"
+#include "expose/protocol_parser.h"
+
+// Pool internals are checked directly.
+#include "l7_mem.c"
+
+#define BENCH_ROUNDS    2000
+#define BENCH_BATCH     64      // Request/response pairs per parse cycle
+
+static void test_pool(void)
+{
+    struct l7_mem_stats_s stats;
+    char *p, *q, *large;
+
+    p = (char *)l7_mem_zalloc(40);
+    assert(p != NULL && p[0] == 0 && p[39] == 0);
+    assert(((uintptr_t)p % L7_MEM_ALIGN) == 0);
+    l7_mem_free(p);
+    assert(g_l7_mem->classes[0].cached == 1);
+
+    // Freed block is reused by the next allocation of the same class
+    q = (char *)l7_mem_alloc(48);
+    assert(q == p && g_l7_mem->classes[0].cached == 0);
+    l7_mem_free(q);
+
+    p = l7_mem_strndup("GET /index.html", 3);
+    assert(strcmp(p, "GET") == 0);
+    l7_mem_free(p);
+    p = l7_mem_strdup("SET");
+    assert(strcmp(p, "SET") == 0);
+    l7_mem_free(p);
+
+    // Blocks too large for pool are never cached
+    large = (char *)l7_mem_alloc(64 * 1024);
+    assert(large != NULL);
+    (void)memset(large, 1, 64 * 1024);
+    l7_mem_free(large);
+    l7_mem_get_stats(&stats);
+    assert(stats.cached == 1);
+    l7_mem_free(NULL);
+}
+
+static void test_cycle(void)
+{
+    struct l7_mem_stats_s stats;
+    struct l7_mem_chunk_s *chunk;
+    char *p, *big;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        p = (char *)l7_mem_cycle_alloc(100);
+        assert(p != NULL && p[0] == 0 && p[99] == 0);
+        (void)memset(p, 0xff, 100);
+        // Freeing a record one by one does nothing
+        l7_mem_free(p);
+    }
+    l7_mem_get_stats(&stats);
+    assert(stats.cycle_bytes >= 1000 * 100 && g_l7_mem->chunks->next != NULL);
+
+    // Oversized records come from pool, and are freed one by one
+    big = (char *)l7_mem_cycle_alloc(L7_MEM_CHUNK_SIZE);
+    assert(big != NULL && big[L7_MEM_CHUNK_SIZE - 1] == 0);
+    l7_mem_free(big);
+
+    l7_mem_cycle_reset();
+    l7_mem_get_stats(&stats);
+    assert(stats.cycle_bytes == 0 && g_l7_mem->chunks == NULL && g_l7_mem->spare_num > 0);
+
+    // Memory of last cycle is reused and zeroed again
+    chunk = g_l7_mem->spares;
+    p = (char *)l7_mem_cycle_alloc(100);
+    assert(g_l7_mem->chunks == chunk && p[0] == 0);
+    l7_mem_cycle_reset();
+}
+
+static void test_trim(void)
+{
+    void *blocks[100];
+    int i;
+
+    l7_mem_trim();
+    for (i = 0; i < 100; i++) {
+        blocks[i] = l7_mem_alloc(100);
+    }
+    for (i = 0; i < 100; i++) {
+        l7_mem_free(blocks[i]);
+    }
+    assert(g_l7_mem->classes[1].cached == 100);
+
+    // Free blocks are kept to reach peak of last period again, then released if not needed
+    l7_mem_trim();
+    assert(g_l7_mem->classes[1].cached == 100);
+    blocks[0] = l7_mem_alloc(100);
+    l7_mem_trim();
+    assert(g_l7_mem->classes[1].cached == 0 && g_l7_mem->classes[1].used == 1);
+    l7_mem_free(blocks[0]);
+}
+
+static void *free_blocks_thread(void *arg)
+{
+    void **blocks = (void **)arg;
+
+    for (int i = 0; i < 10; i++) {
+        l7_mem_free(blocks[i]);
+    }
+    // Nothing is cached by the freeing thread
+    assert(g_l7_mem == NULL);
+    return NULL;
+}
+
+static void *alloc_blocks_thread(void *arg)
+{
+    void **blocks = (void **)arg;
+
+    for (int i = 0; i < 10; i++) {
+        blocks[i] = l7_mem_alloc(100);
+    }
+    return NULL;
+}
+
+static void test_remote_free(void)
+{
+    void *blocks[10];
+    pthread_t thd;
+    uint64_t sys_allocs;
+    int i;
+
+    l7_mem_trim();
+    for (i = 0; i < 10; i++) {
+        blocks[i] = l7_mem_alloc(100);
+    }
+    assert(g_l7_mem->classes[1].used == 10);
+    sys_allocs = g_l7_mem->sys_allocs;
+
+    // Blocks freed by another thread are given back to the pool of their owner
+    assert(pthread_create(&thd, NULL, free_blocks_thread, blocks) == 0);
+    (void)pthread_join(thd, NULL);
+    assert(g_l7_mem->classes[1].cached == 0 && g_l7_mem->remote != NULL);
+    for (i = 0; i < 10; i++) {
+        blocks[i] = l7_mem_alloc(100);
+    }
+    assert(g_l7_mem->sys_allocs == sys_allocs && g_l7_mem->classes[1].used == 10);
+    for (i = 0; i < 10; i++) {
+        l7_mem_free(blocks[i]);
+    }
+    l7_mem_trim();
+    l7_mem_trim();
+    assert(g_l7_mem->classes[1].cached == 0);
+
+    // Blocks of an exited thread are released to system
+    assert(pthread_create(&thd, NULL, alloc_blocks_thread, blocks) == 0);
+    (void)pthread_join(thd, NULL);
+    for (i = 0; i < 10; i++) {
+        l7_mem_free(blocks[i]);
+    }
+    assert(g_l7_mem->classes[1].cached == 0);
+}
+
+struct bench_proto_s {
+    const char *name;
+    enum proto_type_t type;
+    const char *req;
+    size_t req_len;
+    const char *resp;
+    size_t resp_len;
+};
+
+#define BENCH_MSG(str)  (str), (sizeof(str) - 1)
+
+static const struct bench_proto_s g_bench_protos[] = {
+    {"http", PROTO_HTTP,
+        BENCH_MSG("GET /api/v1/items?id=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"),
+        BENCH_MSG("HTTP/1.1 204 No Content\r\nServer: bench\r\n\r\n")},
+    {"redis", PROTO_REDIS,
+        BENCH_MSG("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"),
+        BENCH_MSG("+OK\r\n")},
+    {"pgsql", PROTO_PGSQL,
+        BENCH_MSG("Q\x00\x00\x00\x0eSELECT 1;\x00"),
+        BENCH_MSG("C\x00\x00\x00\x0dSELECT 1\x00Z\x00\x00\x00\x05I")},
+    {"mysql", PROTO_MYSQL,
+        BENCH_MSG("\x09\x00\x00\x00\x03SELECT 1"),
+        BENCH_MSG("\x07\x00\x00\x01\x00\x00\x00\x02\x00\x00\x00")},
+};
+
+static void destroy_bench_records(enum proto_type_t type, struct record_buf_s *record_buf)
+{
+    if (record_buf->api_stats != NULL) {
+        destroy_api_stats(record_buf->api_stats);
+        record_buf->api_stats = NULL;
+    }
+    for (size_t i = 0; i < record_buf->record_buf_size; i++) {
+        free_record_data(type, record_buf->records[i]);
+    }
+    record_buf_reset_records(record_buf);
+    record_buf->err_count = 0;
+    record_buf->req_count = 0;
+    record_buf->resp_count = 0;
+    record_buf->msg_error_count = 0;
+    record_buf->msg_total_count = 0;
+}
+
+static void bench_proto(const struct bench_proto_s *proto)
+{
+    struct data_stream_s req_stream, resp_stream;
+    struct record_buf_s record_buf = {0};
+    struct l7_mem_stats_s start_stats, end_stats;
+    struct timespec start, end;
+    u64 ts = 1, records = 0;
+    u32 index = 0;
+    double cost;
+    int i, j;
+
+    (void)init_data_stream(&req_stream);
+    (void)init_data_stream(&resp_stream);
+    req_stream.type = proto->type;
+    resp_stream.type = proto->type;
+
+    l7_mem_get_stats(&start_stats);
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        for (j = 0; j < BENCH_BATCH; j++) {
+            (void)data_stream_add_raw_data(&req_stream, proto->req, proto->req_len, ts, index);
+            (void)data_stream_add_raw_data(&resp_stream, proto->resp, proto->resp_len, ts + 1, index);
+            ts += 2;
+            index++;
+        }
+
+        // Same steps as a tracker in one parse cycle
+        (void)data_stream_parse_frames(MESSAGE_REQUEST, &req_stream);
+        (void)data_stream_parse_frames(MESSAGE_RESPONSE, &resp_stream);
+        proto_match_frames(proto->type, &req_stream.frame_bufs, &resp_stream.frame_bufs, &record_buf);
+        records += record_buf.record_buf_size;
+        destroy_bench_records(proto->type, &record_buf);
+        data_stream_pop_frames(&req_stream);
+        data_stream_pop_frames(&resp_stream);
+        l7_mem_cycle_reset();
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    l7_mem_get_stats(&end_stats);
+
+    cost = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+    printf("%-6s %7.0f ns per request/response, %lu records, l7 allocs %lu (malloc %lu)\n",
+           proto->name, cost / (BENCH_ROUNDS * BENCH_BATCH), records,
+           end_stats.allocs - start_stats.allocs, end_stats.sys_allocs - start_stats.sys_allocs);
+    assert(records > 0);
+
+    record_buf_release(&record_buf);
+    deinit_data_stream(&req_stream);
+    deinit_data_stream(&resp_stream);
+    l7_mem_trim();
+}
+
+int main(void)
+{
+    printf("Running l7 memory tests...\n");
+
+    test_pool();
+    test_cycle();
+    test_trim();
+    test_remote_free();
+    for (size_t i = 0; i < sizeof(g_bench_protos) / sizeof(g_bench_protos[0]); i++) {
+        bench_proto(&g_bench_protos[i]);
+    }
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,275 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-27
+ * Description: data stream buffer test cases, reassembly and per-tracker memory benchmark
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+// Static buffer helpers of data stream are tested directly.
+#include "data_stream.c"
+
+#define BENCH_TRACKERS      50000
+#define BENCH_INFLIGHT      8
+#define BENCH_FRAGMENTS     2048
+#define BENCH_FRAGMENT_LEN  1024
+
+/* Pointer arrays embedded in every tracker before buffers were allocated on demand */
+#define FIXED_TRACKER_BUF_BYTES \
+    ((2 * (__RAW_BUF_SIZE + __FRAME_BUF_SIZE) + RECORD_BUF_SIZE) * sizeof(void *))
+
+static struct frame_data_s *new_frame(u64 ts)
+{
+    struct frame_data_s *frame = (struct frame_data_s *)l7_mem_zalloc(sizeof(struct frame_data_s));
+
+    assert(frame != NULL);
+    frame->timestamp_ns = ts;
+    return frame;
+}
+
+static void test_raw_buf(void)
+{
+    struct data_stream_s stream;
+    struct raw_data_s *raw_data;
+    char payload[] = "payload";
+    u32 i;
+
+    (void)init_data_stream(&stream);
+    assert(stream.raw_bufs.slots == NULL && data_stream_mem_size(&stream) == 0);
+
+    // Interleaved push and pop keeps order, and never needs more slots than pending raw data
+    for (i = 0; i < __RAW_BUF_SIZE * 2 - 1; i++) {
+        assert(data_stream_add_raw_data(&stream, payload, sizeof(payload), i, i) == 0);
+        if (i % 2 == 1) {
+            raw_data = pop_raw_data(&stream);
+            assert(raw_data != NULL && raw_data->index == i / 2);
+            destroy_raw_data(raw_data);
+        }
+    }
+    assert(stream.raw_bufs.raw_buf_size == __RAW_BUF_SIZE);
+    assert(stream.raw_bufs.slots_size == __RAW_BUF_SIZE);
+
+    // Full buffer rejects more data
+    assert(data_stream_add_raw_data(&stream, payload, sizeof(payload), 0, 0) != 0);
+    assert(peek_raw_data(&stream)->index == __RAW_BUF_SIZE - 1);
+
+    // Overlaying the first two raw data keeps the rest in place
+    assert(overlay_raw_data(&stream) == 0);
+    assert(stream.raw_bufs.raw_buf_size == __RAW_BUF_SIZE - 1);
+    raw_data = peek_raw_data(&stream);
+    assert(raw_data->data_len == sizeof(payload) * 2 && raw_data->index == __RAW_BUF_SIZE);
+
+    // Draining releases grown slots
+    while ((raw_data = pop_raw_data(&stream)) != NULL) {
+        destroy_raw_data(raw_data);
+    }
+    assert(stream.raw_bufs.slots == NULL && stream.raw_bufs.raw_datas == NULL);
+    deinit_data_stream(&stream);
+}
+
+static void test_overlay(void)
+{
+    struct data_stream_s stream;
+    struct raw_data_s *raw_data;
+    char chunk[4];
+
+    (void)init_data_stream(&stream);
+
+    // Fragments are appended in order into the first raw data
+    for (u32 i = 0; i < 10; i++) {
+        (void)snprintf(chunk, sizeof(chunk), "%03u", i);
+        assert(data_stream_add_raw_data(&stream, chunk, 3, 100 + i, i) == 0);
+    }
+    peek_raw_data(&stream)->current_pos = 2;
+    for (u32 i = 1; i < 8; i++) {
+        assert(overlay_raw_data(&stream) == 0);
+    }
+    raw_data = peek_raw_data(&stream);
+    assert(stream.raw_bufs.raw_buf_size == 3);
+    assert(raw_data->data_len == 24 && memcmp(raw_data->data, "000001002003004005006007", 24) == 0);
+    assert(raw_data->data_cap >= raw_data->data_len && raw_data->data_cap <= 2 * raw_data->data_len);
+    assert(raw_data->timestamp_ns == 100 && raw_data->current_pos == 2 && raw_data->index == 7);
+    assert(stream.raw_bufs.raw_datas[1]->index == 8);
+
+    // Out of order fragment is not appended
+    stream.raw_bufs.raw_datas[1]->index = 1;
+    assert(overlay_raw_data(&stream) == 0);
+    assert(peek_raw_data(&stream)->isBrokeData == 1 && stream.raw_bufs.raw_buf_size == 3);
+
+    deinit_data_stream(&stream);
+}
+
+static void test_frame_buf(void)
+{
+    struct data_stream_s stream;
+    struct frame_buf_s *frame_buf = &stream.frame_bufs;
+    u64 ts = 0, expect = 0;
+    int round;
+    size_t i;
+
+    (void)init_data_stream(&stream);
+    stream.type = PROTO_MAX;
+
+    // Matchers index frames[current_pos..frame_buf_size) and consume a part of them each round
+    for (round = 0; round < 100; round++) {
+        for (i = 0; i < 10; i++) {
+            assert(push_frame_data(&stream, new_frame(ts++)) == 0);
+        }
+        for (i = 0; i < frame_buf->frame_buf_size; i++) {
+            assert(frame_buf->frames[i]->timestamp_ns == expect + i);
+        }
+        frame_buf->current_pos = 7;
+        data_stream_pop_frames(&stream);
+        expect += 7;
+        assert(frame_buf->current_pos == 0);
+        assert(frame_buf->frames[0]->timestamp_ns == expect);
+    }
+    // 300 frames pending after 1000 pushes, slots follow the pending frames instead of the total
+    assert(frame_buf->frame_buf_size == 300 && frame_buf->slots_size == 512);
+
+    // current_pos beyond the pending frames pops all of them
+    frame_buf->current_pos = frame_buf->frame_buf_size + 1;
+    data_stream_pop_frames(&stream);
+    assert(frame_buf->frame_buf_size == 0 && frame_buf->slots == NULL);
+
+    for (i = 0; i < __FRAME_BUF_SIZE; i++) {
+        assert(push_frame_data(&stream, new_frame(i)) == 0);
+    }
+    assert(push_frame_data(&stream, frame_buf->frames[0]) != 0);
+    deinit_data_stream(&stream);
+    assert(data_stream_mem_size(&stream) == 0);
+}
+
+static void test_record_buf(void)
+{
+    struct record_buf_s record_buf = {0};
+    struct record_data_s record_data = {0};
+    struct api_stats *api_stats;
+    int i;
+
+    for (i = 0; i < RECORD_BUF_SIZE; i++) {
+        assert(record_buf_add_record(&record_buf, &record_data) == 0);
+    }
+    assert(record_buf_add_record(&record_buf, &record_data) != 0);
+    assert(record_buf.record_buf_size == RECORD_BUF_SIZE);
+
+    record_buf_reset_records(&record_buf);
+    assert(record_buf.record_buf_size == 0 && record_buf.records == NULL);
+    assert(record_buf_add_record(&record_buf, &record_data) == 0);
+    record_buf_reset_records(&record_buf);
+    assert(record_buf.records != NULL && record_buf.records_slots_size == __BUF_SLOTS_INIT_SIZE);
+    record_buf_release(&record_buf);
+
+    api_stats = create_api_stats("GET /api");
+    assert(api_stats != NULL && api_stats->records == NULL);
+    for (i = 0; i < RECORD_BUF_SIZE + 1; i++) {
+        (void)api_stats_add_record(api_stats, &record_data);
+        (void)api_stats_add_err_record(api_stats, &record_data);
+    }
+    assert(api_stats->record_buf_size == RECORD_BUF_SIZE && api_stats->err_count == RECORD_BUF_SIZE);
+    destroy_api_stats(api_stats);
+}
+
+static double elapsed_sec(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench_overlay(void)
+{
+    struct data_stream_s stream;
+    struct timespec start, end;
+    char *chunk;
+    u32 i;
+
+    chunk = (char *)calloc(1, BENCH_FRAGMENT_LEN);
+    assert(chunk != NULL);
+    (void)init_data_stream(&stream);
+
+    // A message arriving in many fragments, reassembled as parser asks for more data on each one
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(data_stream_add_raw_data(&stream, chunk, BENCH_FRAGMENT_LEN, 0, 0) == 0);
+    for (i = 1; i < BENCH_FRAGMENTS; i++) {
+        assert(data_stream_add_raw_data(&stream, chunk, BENCH_FRAGMENT_LEN, 0, i) == 0);
+        assert(overlay_raw_data(&stream) == 0);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(peek_raw_data(&stream)->data_len == (size_t)BENCH_FRAGMENTS * BENCH_FRAGMENT_LEN);
+
+    // Copying accumulated data on every fragment would copy sum(1..n) fragments
+    printf("%d fragments of %d bytes reassembled in %.2f ms, copy-all reassembly copies %.1f MB\n",
+           BENCH_FRAGMENTS, BENCH_FRAGMENT_LEN, elapsed_sec(&start, &end) * 1000,
+           (double)BENCH_FRAGMENTS * (BENCH_FRAGMENTS + 1) / 2 * BENCH_FRAGMENT_LEN / (1024 * 1024));
+
+    deinit_data_stream(&stream);
+    free(chunk);
+}
+
+static void bench_tracker_mem(void)
+{
+    struct data_stream_s *streams;
+    struct record_buf_s record_buf = {0};
+    struct record_data_s record_data = {0};
+    struct timespec start, end;
+    char payload[64] = {0};
+    size_t idle_mem, busy_mem = 0;
+    int i, j;
+
+    streams = (struct data_stream_s *)calloc(BENCH_TRACKERS * 2, sizeof(struct data_stream_s));
+    assert(streams != NULL);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_TRACKERS * 2; i++) {
+        (void)init_data_stream(&streams[i]);
+        streams[i].type = PROTO_MAX;
+        for (j = 0; j < BENCH_INFLIGHT; j++) {
+            assert(data_stream_add_raw_data(&streams[i], payload, sizeof(payload), 0, j) == 0);
+            assert(push_frame_data(&streams[i], new_frame(j)) == 0);
+        }
+        busy_mem += data_stream_mem_size(&streams[i]);
+    }
+    for (j = 0; j < BENCH_INFLIGHT; j++) {
+        assert(record_buf_add_record(&record_buf, &record_data) == 0);
+    }
+    busy_mem = busy_mem / BENCH_TRACKERS + record_buf.records_slots_size * sizeof(struct record_data_s *);
+    for (i = 0; i < BENCH_TRACKERS * 2; i++) {
+        deinit_data_stream(&streams[i]);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    record_buf_release(&record_buf);
+
+    idle_mem = 2 * sizeof(struct data_stream_s) + sizeof(struct record_buf_s);
+    printf("buffers per tracker: fixed arrays %zu bytes, idle %zu bytes, %d in-flight %zu bytes\n",
+           FIXED_TRACKER_BUF_BYTES, idle_mem, BENCH_INFLIGHT, idle_mem + busy_mem);
+    printf("%d trackers: fixed arrays %.1f MB, in-flight %.1f MB, setup and teardown %.1f ms\n", BENCH_TRACKERS,
+           (double)FIXED_TRACKER_BUF_BYTES * BENCH_TRACKERS / (1024 * 1024),
+           (double)(idle_mem + busy_mem) * BENCH_TRACKERS / (1024 * 1024), elapsed_sec(&start, &end) * 1000);
+    free(streams);
+}
+
+int main(void)
+{
+    printf("Running data stream tests...\n");
+
+    test_raw_buf();
+    test_overlay();
+    test_frame_buf();
+    test_record_buf();
+    bench_overlay();
+    bench_tracker_mem();
+
+    printf("All tests passed!\n");
+    return 0;
+}
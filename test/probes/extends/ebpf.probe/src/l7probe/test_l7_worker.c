@@ -0,0 +1,395 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-29
+ * Description: sharded l7 worker test cases and tracker event throughput benchmarks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <time.h>
+
+// Static dispatch and merge functions are tested directly.
+#include "conn_tracker.c"
+#include "l7_worker.c"
+
+#define TEST_TGIDS          16
+#define TEST_FDS_PER_TGID   8       // Connections of one process are sharded apart
+#define TEST_PAIRS          64      // Request/response pairs per connection in one tick
+#define TEST_TICKS          50
+#define TEST_SERVER_PORT    6379
+
+#define REDIS_REQ   "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"
+#define REDIS_RESP  "+OK\r\n"
+
+struct trace_s {
+    char *data;
+    size_t len;
+    size_t size;
+    u64 events;
+    size_t *tick_ends;      // Offset where each tick ends, l7_parser() is called there
+    u32 ticks;
+};
+
+static void trace_append(struct trace_s *trace, const void *msg, size_t size)
+{
+    if (trace->len + size > trace->size) {
+        trace->size = (trace->size == 0) ? (1024 * 1024) : trace->size * 2;
+        trace->data = (char *)realloc(trace->data, trace->size);
+        assert(trace->data != NULL);
+    }
+    (void)memcpy(trace->data + trace->len, msg, size);
+    trace->len += size;
+    trace->events++;
+}
+
+static void trace_add_open(struct trace_s *trace, int tgid, int fd)
+{
+    struct conn_ctl_s ctl = {0};
+
+    ctl.evt = TRACKER_EVT_CTRL;
+    ctl.conn_id.tgid = tgid;
+    ctl.conn_id.fd = fd;
+    ctl.type = CONN_EVT_OPEN;
+    ctl.open.l4_role = L4_CLIENT;
+    ctl.open.server_addr.family = AF_INET;
+    ctl.open.server_addr.port = TEST_SERVER_PORT;
+    ctl.open.server_addr.ip = 0x0100007f;
+    ctl.open.client_addr.family = AF_INET;
+    ctl.open.client_addr.ip = 0x0100007f;
+    trace_append(trace, &ctl, sizeof(ctl));
+}
+
+static void trace_add_data(struct trace_s *trace, int tgid, int fd, enum l7_direction_t direction,
+                           const char *buf, u32 len, u64 ts, u32 index)
+{
+    char msg[sizeof(struct conn_data_msg_s) + 64];
+    struct conn_data_msg_s *data_msg = (struct conn_data_msg_s *)msg;
+
+    (void)memset(data_msg, 0, sizeof(struct conn_data_msg_s));
+    data_msg->evt = TRACKER_EVT_DATA;
+    data_msg->proto = PROTO_REDIS;
+    data_msg->l7_role = L7_CLIENT;
+    data_msg->direction = direction;
+    data_msg->conn_id.tgid = tgid;
+    data_msg->conn_id.fd = fd;
+    data_msg->timestamp_ns = ts;
+    data_msg->data_size = len;
+    data_msg->payload_size = len;
+    data_msg->index = index;
+    (void)memcpy(msg + sizeof(struct conn_data_msg_s), buf, len);
+    trace_append(trace, msg, sizeof(struct conn_data_msg_s) + len);
+}
+
+/* Redis clients of several processes, requests of all connections interleaved as they come from kernel. */
+static void build_trace(struct trace_s *trace)
+{
+    int tgid, fd;
+    u64 ts = 1;
+    u32 index = 0;
+
+    (void)memset(trace, 0, sizeof(struct trace_s));
+    trace->tick_ends = (size_t *)calloc(TEST_TICKS, sizeof(size_t));
+    assert(trace->tick_ends != NULL);
+
+    for (tgid = 1; tgid <= TEST_TGIDS; tgid++) {
+        for (fd = 3; fd < 3 + TEST_FDS_PER_TGID; fd++) {
+            trace_add_open(trace, tgid, fd);
+        }
+    }
+
+    for (u32 tick = 0; tick < TEST_TICKS; tick++) {
+        for (int i = 0; i < TEST_PAIRS; i++) {
+            for (tgid = 1; tgid <= TEST_TGIDS; tgid++) {
+                for (fd = 3; fd < 3 + TEST_FDS_PER_TGID; fd++) {
+                    trace_add_data(trace, tgid, fd, L7_EGRESS, REDIS_REQ, sizeof(REDIS_REQ) - 1, ts, index);
+                    trace_add_data(trace, tgid, fd, L7_INGRESS, REDIS_RESP, sizeof(REDIS_RESP) - 1, ts + 1, index);
+                }
+            }
+            ts += 2;
+            index++;
+        }
+        trace->tick_ends[tick] = trace->len;
+    }
+    trace->ticks = TEST_TICKS;
+}
+
+/*
+ * A trace recorded from the drb of a live l7probe: tracker msgs dumped back to back. It is
+ * replayed in 1MB ticks since the timing of the recording is not kept.
+ */
+static int load_trace(struct trace_s *trace, const char *path)
+{
+    FILE *f;
+    long len;
+    size_t offset = 0;
+    struct conn_id_s *conn_id;
+    size_t walk_size;
+
+    (void)memset(trace, 0, sizeof(struct trace_s));
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    (void)fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    (void)fseek(f, 0, SEEK_SET);
+    if (len <= 0) {
+        (void)fclose(f);
+        return -1;
+    }
+    trace->data = (char *)malloc((size_t)len);
+    assert(trace->data != NULL);
+    trace->len = fread(trace->data, 1, (size_t)len, f);
+    (void)fclose(f);
+
+    trace->tick_ends = (size_t *)calloc(trace->len / (1024 * 1024) + 1, sizeof(size_t));
+    assert(trace->tick_ends != NULL);
+    while (offset + TRACKER_MSG_MIN_SIZE <= trace->len) {
+        walk_size = get_tracker_msg(trace->data + offset, (int)(trace->len - offset), &conn_id);
+        if (walk_size == 0) {
+            break;
+        }
+        offset += walk_size;
+        trace->events++;
+        if (offset / (1024 * 1024) > trace->ticks) {
+            trace->tick_ends[trace->ticks++] = offset;
+        }
+    }
+    trace->tick_ends[trace->ticks++] = offset;
+    return 0;
+}
+
+static void free_trace(struct trace_s *trace)
+{
+    free(trace->data);
+    free(trace->tick_ends);
+}
+
+static void init_test_mng(struct l7_mng_s *l7_mng, u32 worker_num)
+{
+    (void)memset(l7_mng, 0, sizeof(struct l7_mng_s));
+    for (int i = 0; i < __MAX_LT_RANGE; i++) {
+        (void)init_bucket_range(&(l7_mng->latency_buckets[i]), (u64)i * 1000, (u64)(i + 1) * 1000);
+    }
+    assert(l7_workers_create(l7_mng, worker_num) == 0);
+    assert(l7_mng->worker_num == worker_num);
+}
+
+/* Wait until every worker has processed all handed over batches and parse requests. */
+static void wait_workers_idle(struct l7_mng_s *l7_mng)
+{
+    struct l7_worker_s *worker;
+    char idle;
+
+    for (u32 i = 0; i < l7_mng->worker_num; i++) {
+        worker = &(l7_mng->workers[i]);
+        do {
+            (void)pthread_mutex_lock(&worker->q_lock);
+            idle = (worker->head == NULL && !worker->parse);
+            (void)pthread_mutex_unlock(&worker->q_lock);
+            if (!idle) {
+                (void)sched_yield();
+            }
+        } while (!idle);
+        // Worker holds lock until the batches it has taken are processed.
+        (void)pthread_mutex_lock(&worker->lock);
+        (void)pthread_mutex_unlock(&worker->lock);
+    }
+}
+
+/*
+ * Returns the cost in ns of dispatching and parsing the whole trace. Ticks are 100ms apart in
+ * l7probe, workers catch up in between, so each tick is waited for here as well.
+ */
+static double replay_trace(struct l7_mng_s *l7_mng, const struct trace_s *trace)
+{
+    struct timespec start, end;
+    size_t offset = 0;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (u32 tick = 0; tick < trace->ticks; tick++) {
+        (void)tracker_msg_continue(l7_mng, trace->data + offset, (u32)(trace->tick_ends[tick] - offset));
+        l7_parser(l7_mng);
+        wait_workers_idle(l7_mng);
+        offset = trace->tick_ends[tick];
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+}
+
+static u64 sum_links(struct l7_mng_s *l7_mng, enum l7_stats_t type, u32 *link_num)
+{
+    struct l7_link_s *link, *tmp;
+    u64 sum = 0;
+
+    *link_num = 0;
+    H_ITER(l7_mng->l7_links, link, tmp) {
+        sum += link->stats[type];
+        (*link_num)++;
+    }
+    return sum;
+}
+
+static void fini_test_mng(struct l7_mng_s *l7_mng)
+{
+    l7_workers_stop(l7_mng);
+    destroy_trackers(l7_mng);
+    destroy_links(l7_mng);
+    l7_workers_destroy(l7_mng);
+}
+
+static void test_sharding(void)
+{
+    struct l7_mng_s l7_mng;
+    struct l7_worker_s *worker;
+    u32 used = 0;
+
+    init_test_mng(&l7_mng, 4);
+
+    // Same tracker always goes to the same worker, trackers of one process are spread.
+    for (int fd = 0; fd < 64; fd++) {
+        worker = l7_worker_of(&l7_mng, 100, fd);
+        assert(worker == l7_worker_of(&l7_mng, 100, fd));
+        used |= 1U << worker->id;
+    }
+    assert(used == 0xf);
+
+    fini_test_mng(&l7_mng);
+}
+
+static void test_merge_equals_single(const struct trace_s *trace)
+{
+    struct l7_mng_s l7_mng;
+    u64 req_single, rsp_single, evt_single, req, rsp, evt;
+    u32 links_single, links;
+
+    init_test_mng(&l7_mng, 1);
+    (void)replay_trace(&l7_mng, trace);
+    merge_l7_workers(&l7_mng);
+    req_single = sum_links(&l7_mng, REQ_COUNT, &links_single);
+    rsp_single = sum_links(&l7_mng, RSP_COUNT, &links_single);
+    evt_single = sum_links(&l7_mng, DATA_EVT_SENT, &links_single);
+    fini_test_mng(&l7_mng);
+
+    assert(links_single == TEST_TGIDS);
+    assert(req_single == (u64)TEST_TGIDS * TEST_FDS_PER_TGID * TEST_PAIRS * TEST_TICKS);
+    assert(evt_single == req_single);
+
+    // Each process has connections in several workers, merged links count the same
+    init_test_mng(&l7_mng, 4);
+    (void)replay_trace(&l7_mng, trace);
+    merge_l7_workers(&l7_mng);
+    req = sum_links(&l7_mng, REQ_COUNT, &links);
+    rsp = sum_links(&l7_mng, RSP_COUNT, &links);
+    evt = sum_links(&l7_mng, DATA_EVT_SENT, &links);
+    assert(links == links_single && req == req_single && rsp == rsp_single && evt == evt_single);
+
+    // Stats of worker links are reset once merged
+    reset_l7_stats(&l7_mng);
+    merge_l7_workers(&l7_mng);
+    assert(sum_links(&l7_mng, REQ_COUNT, &links) == 0 && links == links_single);
+    fini_test_mng(&l7_mng);
+}
+
+static void bench_workers(const struct trace_s *trace)
+{
+    struct l7_mng_s l7_mng;
+    u32 nums[] = {1, 2, 4};
+    double cost;
+
+    for (size_t i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+        init_test_mng(&l7_mng, nums[i]);
+        cost = replay_trace(&l7_mng, trace);
+        fini_test_mng(&l7_mng);
+        printf("%u workers: %lu events, %.0f ns per event, %.0f events/s\n",
+               nums[i], trace->events, cost / trace->events, trace->events * 1e9 / cost);
+    }
+}
+
+/* Same as poll_drb() of l7probe. */
+static void poll_test_drb(struct l7_mng_s *l7_mng)
+{
+    const struct drb_item *item;
+
+    while ((item = drb_look(l7_mng->drb))) {
+        (void)tracker_msg_continue(l7_mng, (void *)item->data, item->size);
+        (void)drb_pop(l7_mng->drb);
+    }
+}
+
+/* Events come one by one through tracker_msg() and the delaying ring buffer, as from kernel. */
+static void bench_drb(const struct trace_s *trace)
+{
+    struct l7_mng_s l7_mng;
+    struct timespec start, end;
+    struct conn_id_s *conn_id;
+    size_t offset = 0, walk_size;
+    double cost = 0;
+
+    init_test_mng(&l7_mng, 1);
+    l7_mng.drb = drb_new(32 * 1024 * 1024, 0);
+    assert(l7_mng.drb != NULL);
+
+    for (u32 tick = 0; tick < trace->ticks; tick++) {
+        (void)clock_gettime(CLOCK_MONOTONIC, &start);
+        while (offset < trace->tick_ends[tick]) {
+            walk_size = get_tracker_msg(trace->data + offset, (int)(trace->tick_ends[tick] - offset), &conn_id);
+            assert(walk_size > 0);
+            (void)tracker_msg(&l7_mng, trace->data + offset, (u32)walk_size);
+            offset += walk_size;
+        }
+        poll_test_drb(&l7_mng);
+        (void)clock_gettime(CLOCK_MONOTONIC, &end);
+        cost += (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+
+        l7_parser(&l7_mng);
+        wait_workers_idle(&l7_mng);
+    }
+    assert(l7_mng.drb_dropped == 0 && l7_mng.drb->used == 0);
+
+    drb_destroy(l7_mng.drb);
+    fini_test_mng(&l7_mng);
+    printf("tracker_msg/poll_drb: %lu events, %.0f ns per event, %.0f events/s\n",
+           trace->events, cost / trace->events, trace->events * 1e9 / cost);
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_s trace, recorded;
+
+    printf("Running l7 worker tests...\n");
+
+    build_trace(&trace);
+    test_sharding();
+    test_merge_equals_single(&trace);
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        bench_workers(&trace);
+        bench_drb(&trace);
+    }
+    free_trace(&trace);
+
+    if (argc > 1) {
+        assert(load_trace(&recorded, argv[1]) == 0);
+        printf("Replaying %s:\n", argv[1]);
+        bench_workers(&recorded);
+        bench_drb(&recorded);
+        free_trace(&recorded);
+    }
+
+    printf("All tests passed!\n");
+    return 0;
+}
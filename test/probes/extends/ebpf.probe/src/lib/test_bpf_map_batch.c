@@ -0,0 +1,324 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-30
+ * Description: batched bpf map iteration test cases and syscall count benchmark
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+// Batch and fallback paths are tested directly against a hash map emulated below.
+#include "bpf_map_batch.c"
+
+#define TEST_MAP_FD     100
+#define TEST_BUCKETS    1024
+#define TEST_MAX        (512 * 1024)
+#define BENCH_ENTRIES   100000
+
+/*
+ * Same iteration semantic as a kernel hash map: entries are walked bucket by bucket, batch
+ * tokens are bucket ids, and get_next_key() of a missing key restarts from the first entry.
+ */
+static u64 g_values[TEST_MAX];
+static char g_present[TEST_MAX];
+static u32 g_bucket_cnt[TEST_BUCKETS];
+static u32 g_entries;
+static char g_batch_supported = 1;
+static u64 g_syscalls;
+
+static void map_add(u32 key)
+{
+    assert(key < TEST_MAX && !g_present[key]);
+    g_present[key] = 1;
+    g_values[key] = (u64)key * 10;
+    g_bucket_cnt[key % TEST_BUCKETS]++;
+    g_entries++;
+}
+
+static int map_del(u32 key)
+{
+    if (key >= TEST_MAX || !g_present[key]) {
+        return -1;
+    }
+    g_present[key] = 0;
+    g_bucket_cnt[key % TEST_BUCKETS]--;
+    g_entries--;
+    return 0;
+}
+
+static void map_reset(void)
+{
+    (void)memset(g_present, 0, sizeof(g_present));
+    (void)memset(g_bucket_cnt, 0, sizeof(g_bucket_cnt));
+    g_entries = 0;
+}
+
+/* Returns the first present key at or after position (bucket, key) in iteration order. */
+static int map_first_from(u32 bucket, u32 key, u32 *found)
+{
+    for (; bucket < TEST_BUCKETS; bucket++, key = bucket) {
+        if (g_bucket_cnt[bucket] == 0) {
+            continue;
+        }
+        for (; key < TEST_MAX; key += TEST_BUCKETS) {
+            if (g_present[key]) {
+                *found = key;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+int bpf_map_get_next_key(int fd, const void *key, void *next_key)
+{
+    u32 k;
+
+    g_syscalls++;
+    if (key == NULL || *(const u32 *)key >= TEST_MAX || !g_present[*(const u32 *)key]) {
+        k = 0;
+    } else {
+        k = *(const u32 *)key + TEST_BUCKETS;
+        if (k >= TEST_MAX) {
+            k = (*(const u32 *)key % TEST_BUCKETS) + 1;
+        }
+    }
+    if (map_first_from(k % TEST_BUCKETS, k, (u32 *)next_key)) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+int bpf_map_lookup_elem(int fd, const void *key, void *value)
+{
+    u32 k = *(const u32 *)key;
+
+    g_syscalls++;
+    if (k >= TEST_MAX || !g_present[k]) {
+        errno = ENOENT;
+        return -1;
+    }
+    *(u64 *)value = g_values[k];
+    return 0;
+}
+
+int bpf_map_delete_elem(int fd, const void *key)
+{
+    g_syscalls++;
+    if (map_del(*(const u32 *)key)) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+static int mock_lookup_batch(void *in_batch, void *out_batch, void *keys, void *values, __u32 *count, char del)
+{
+    u32 bucket = (in_batch == NULL) ? 0 : *(u32 *)in_batch;
+    u32 num = 0, key;
+
+    g_syscalls++;
+    if (!g_batch_supported) {
+        *count = 0;
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (; bucket < TEST_BUCKETS; bucket++) {
+        if (g_bucket_cnt[bucket] == 0) {
+            continue;
+        }
+        if (num + g_bucket_cnt[bucket] > *count) {
+            if (num == 0) {
+                errno = ENOSPC;
+                return -1;
+            }
+            break;
+        }
+        for (key = bucket; key < TEST_MAX; key += TEST_BUCKETS) {
+            if (g_present[key]) {
+                ((u32 *)keys)[num] = key;
+                ((u64 *)values)[num] = g_values[key];
+                num++;
+            }
+        }
+        if (del) {
+            for (u32 i = num - g_bucket_cnt[bucket], n = num; i < n; i++) {
+                (void)map_del(((u32 *)keys)[i]);
+            }
+        }
+    }
+    *count = num;
+    *(u32 *)out_batch = bucket;
+    if (bucket >= TEST_BUCKETS) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+int bpf_map_lookup_batch(int fd, void *in_batch, void *out_batch, void *keys, void *values, __u32 *count,
+                         const struct bpf_map_batch_opts *opts)
+{
+    return mock_lookup_batch(in_batch, out_batch, keys, values, count, 0);
+}
+
+int bpf_map_lookup_and_delete_batch(int fd, void *in_batch, void *out_batch, void *keys, void *values,
+                                    __u32 *count, const struct bpf_map_batch_opts *opts)
+{
+    return mock_lookup_batch(in_batch, out_batch, keys, values, count, 1);
+}
+
+int bpf_map_delete_batch(int fd, const void *keys, __u32 *count, const struct bpf_map_batch_opts *opts)
+{
+    g_syscalls++;
+    for (u32 i = 0; i < *count; i++) {
+        if (map_del(((const u32 *)keys)[i])) {
+            *count = i;
+            errno = ENOENT;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+struct test_walk_s {
+    u32 visited;
+    u64 key_sum;
+    u32 stop_after;
+};
+
+static int check_entry(const void *key, const void *value, void *ctx)
+{
+    struct test_walk_s *walk = ctx;
+    u32 k = *(const u32 *)key;
+
+    assert(*(const u64 *)value == (u64)k * 10);
+    walk->visited++;
+    walk->key_sum += k;
+    if (walk->stop_after != 0 && walk->visited == walk->stop_after) {
+        return MAP_ITER_STOP;
+    }
+    return (k % 2) ? MAP_ITER_DELETE : MAP_ITER_CONTINUE;
+}
+
+static void fill_map(u32 num)
+{
+    map_reset();
+    for (u32 i = 0; i < num; i++) {
+        map_add(i);
+    }
+}
+
+static void test_iter(char batch_supported)
+{
+    struct test_walk_s walk = {0};
+
+    g_batch_supported = batch_supported;
+    fill_map(10000);
+    assert(bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == 10000);
+    assert(walk.visited == 10000 && walk.key_sum == (u64)9999 * 10000 / 2);
+    // Odd keys are deleted, every entry is still visited once
+    assert(g_entries == 5000);
+    for (u32 i = 0; i < 10000; i++) {
+        assert(g_present[i] == !(i % 2));
+    }
+
+    (void)memset(&walk, 0, sizeof(walk));
+    walk.stop_after = 100;
+    assert(bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == 100);
+    assert(walk.visited == 100);
+
+    map_reset();
+    assert(bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == 0);
+}
+
+static void test_drain(char batch_supported)
+{
+    struct test_walk_s walk = {0};
+
+    g_batch_supported = batch_supported;
+    fill_map(10000);
+    assert(bpf_map_drain(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == 10000);
+    assert(walk.visited == 10000 && walk.key_sum == (u64)9999 * 10000 / 2 && g_entries == 0);
+
+    // Stop is ignored, every deleted entry still reaches the callback
+    (void)memset(&walk, 0, sizeof(walk));
+    walk.stop_after = 100;
+    fill_map(10000);
+    assert(bpf_map_drain(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == 10000);
+    assert(walk.visited == 10000 && g_entries == 0);
+
+    // Keys only, e.g. stack trace maps
+    fill_map(1000);
+    assert(bpf_map_drain(TEST_MAP_FD, sizeof(u32), 0, NULL, NULL) == 1000);
+    assert(g_entries == 0);
+}
+
+static void test_large_bucket(void)
+{
+    struct test_walk_s walk = {0};
+
+    // A bucket holding more entries than one batch, the batch grows instead of failing
+    g_batch_supported = 1;
+    map_reset();
+    for (u32 i = 0; i < MAP_BATCH_CNT + 10; i++) {
+        map_add(7 + i * TEST_BUCKETS);
+    }
+    map_add(8);
+    assert(bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), check_entry, &walk) == MAP_BATCH_CNT + 11);
+}
+
+static void bench_syscalls(void)
+{
+    u64 iter_batch, iter_keys, drain_batch, drain_keys;
+
+    g_batch_supported = 1;
+    fill_map(BENCH_ENTRIES);
+    g_syscalls = 0;
+    (void)bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), NULL, NULL);
+    iter_batch = g_syscalls;
+    g_syscalls = 0;
+    (void)bpf_map_drain(TEST_MAP_FD, sizeof(u32), sizeof(u64), NULL, NULL);
+    drain_batch = g_syscalls;
+
+    g_batch_supported = 0;
+    fill_map(BENCH_ENTRIES);
+    g_syscalls = 0;
+    (void)bpf_map_iter(TEST_MAP_FD, sizeof(u32), sizeof(u64), NULL, NULL);
+    iter_keys = g_syscalls;
+    g_syscalls = 0;
+    (void)bpf_map_drain(TEST_MAP_FD, sizeof(u32), sizeof(u64), NULL, NULL);
+    drain_keys = g_syscalls;
+
+    printf("%d entries, syscalls: iter batch %llu / per key %llu, drain batch %llu / per key %llu\n",
+           BENCH_ENTRIES, iter_batch, iter_keys, drain_batch, drain_keys);
+    assert(iter_batch * 100 < iter_keys && drain_batch * 100 < drain_keys);
+}
+
+int main(void)
+{
+    printf("Running bpf map batch tests...\n");
+
+    test_iter(1);
+    test_iter(0);
+    test_drain(1);
+    test_drain(0);
+    test_large_bucket();
+    bench_syscalls();
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-22
+ * Description: netlink conntrack cache test cases and lookup benchmark
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+// Static parser and cache of conntrack module are tested directly.
+#include "conntrack.c"
+
+#define BENCH_ENTRIES   10000
+#define BENCH_LOOKUPS   1000000
+#define BENCH_CMD_LOOKUPS 20
+
+static int put_tuple(char *buf, int *off, u16 type, u32 src, u32 dst, u16 sport, u16 dport)
+{
+    u8 proto_num = IPPROTO_TCP;
+    u16 nsport = htons(sport), ndport = htons(dport);
+    int tuple, ip, proto;
+
+    tuple = ct_nl_nest_start(buf, off, type);
+    ip = ct_nl_nest_start(buf, off, CTA_TUPLE_IP);
+    ct_nl_put_attr(buf, off, CTA_IP_V4_SRC, &src, sizeof(src));
+    ct_nl_put_attr(buf, off, CTA_IP_V4_DST, &dst, sizeof(dst));
+    ct_nl_nest_end(buf, off, ip);
+    proto = ct_nl_nest_start(buf, off, CTA_TUPLE_PROTO);
+    ct_nl_put_attr(buf, off, CTA_PROTO_NUM, &proto_num, sizeof(proto_num));
+    ct_nl_put_attr(buf, off, CTA_PROTO_SRC_PORT, &nsport, sizeof(nsport));
+    ct_nl_put_attr(buf, off, CTA_PROTO_DST_PORT, &ndport, sizeof(ndport));
+    ct_nl_nest_end(buf, off, proto);
+    ct_nl_nest_end(buf, off, tuple);
+    return 0;
+}
+
+/* Build one ctnetlink event: client -> cluster ip, replied by backend. */
+static int build_ct_msg(char *buf, u16 msg_type, u32 cip, u16 cport, u32 vip, u16 vport, u32 bip, u16 bport)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+    struct nfgenmsg *nfg = (struct nfgenmsg *)NLMSG_DATA(nlh);
+    char *attrs = (char *)nfg + NLMSG_ALIGN(sizeof(struct nfgenmsg));
+    int off = 0;
+
+    (void)memset(buf, 0, NLMSG_SPACE(sizeof(struct nfgenmsg)) + 256);
+    nfg->nfgen_family = AF_INET;
+    nfg->version = NFNETLINK_V0;
+    (void)put_tuple(attrs, &off, CTA_TUPLE_ORIG, cip, vip, cport, vport);
+    (void)put_tuple(attrs, &off, CTA_TUPLE_REPLY, bip, cip, bport, cport);
+
+    nlh->nlmsg_len = NLMSG_LENGTH(NLMSG_ALIGN(sizeof(struct nfgenmsg)) + off);
+    nlh->nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | msg_type;
+    return (int)nlh->nlmsg_len;
+}
+
+static void init_connect(struct tcp_connect_s *connect, u32 cip, u16 cport, u32 vip, u16 vport)
+{
+    (void)memset(connect, 0, sizeof(struct tcp_connect_s));
+    connect->family = AF_INET;
+    connect->role = 1;
+    connect->cip_addr.c_ip = cip;
+    connect->sip_addr.s_ip = vip;
+    connect->c_port = cport;
+    connect->s_port = vport;
+}
+
+static void test_dnat_event(void)
+{
+    struct conntrack_nl_s *ct = &g_conntrack;
+    struct tcp_connect_s connect;
+    char buf[512];
+    int len, transform;
+    u32 cip = inet_addr("10.0.0.1"), vip = inet_addr("10.96.0.10"), bip = inet_addr("10.244.1.5");
+
+    len = build_ct_msg(buf, IPCTNL_MSG_CT_NEW, cip, 40000, vip, 80, bip, 8080);
+    assert(ct_nl_walk(buf, len, 0, ct_apply_msg, ct) == 0);
+    assert(ct->cache_num == 1);
+
+    transform = ADDR_TRANSFORM_NONE;
+    init_connect(&connect, cip, 40000, vip, 80);
+    ct_cache_lookup(ct, &connect, &transform);
+    assert(transform == ADDR_TRANSFORM_SERVER);
+    assert(connect.sip_addr.s_ip == bip);
+    assert(connect.s_port == 8080);
+
+    // Not DNAT: reply comes from the original destination
+    len = build_ct_msg(buf, IPCTNL_MSG_CT_NEW, cip, 40001, vip, 80, vip, 80);
+    assert(ct_nl_walk(buf, len, 0, ct_apply_msg, ct) == 0);
+    assert(ct->cache_num == 1);
+
+    len = build_ct_msg(buf, IPCTNL_MSG_CT_DELETE, cip, 40000, vip, 80, bip, 8080);
+    assert(ct_nl_walk(buf, len, 0, ct_apply_msg, ct) == 0);
+    assert(ct->cache_num == 0);
+
+    transform = ADDR_TRANSFORM_NONE;
+    init_connect(&connect, cip, 40000, vip, 80);
+    ct_cache_lookup(ct, &connect, &transform);
+    assert(transform == ADDR_TRANSFORM_NONE);
+    assert(connect.sip_addr.s_ip == vip);
+}
+
+static double elapsed_sec(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench_lookup(void)
+{
+    struct conntrack_nl_s *ct = &g_conntrack;
+    struct tcp_connect_s connect;
+    struct timespec start, end;
+    char buf[512];
+    int len, transform, hits = 0;
+    u32 vip = inet_addr("10.96.0.10"), bip = inet_addr("10.244.1.5");
+    u32 i;
+
+    for (i = 0; i < BENCH_ENTRIES; i++) {
+        len = build_ct_msg(buf, IPCTNL_MSG_CT_NEW, htonl(0x0a000000 + i), 40000, vip, 80, bip, 8080);
+        (void)ct_nl_walk(buf, len, 0, ct_apply_msg, ct);
+    }
+    assert(ct->cache_num == BENCH_ENTRIES);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LOOKUPS; i++) {
+        transform = ADDR_TRANSFORM_NONE;
+        // Half of lookups miss
+        init_connect(&connect, htonl(0x0a000000 + (i % (BENCH_ENTRIES * 2))), 40000, vip, 80);
+        ct_cache_lookup(ct, &connect, &transform);
+        hits += (transform == ADDR_TRANSFORM_SERVER);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(hits == BENCH_LOOKUPS / 2);
+    printf("netlink cache: %.0f lookups/s\n", BENCH_LOOKUPS / elapsed_sec(&start, &end));
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_CMD_LOOKUPS; i++) {
+        transform = ADDR_TRANSFORM_NONE;
+        init_connect(&connect, htonl(0x0a000000 + i), 40000, vip, 80);
+        (void)get_cluster_ip_backend_by_cmd(&connect, &transform);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("conntrack command: %.0f lookups/s\n", BENCH_CMD_LOOKUPS / elapsed_sec(&start, &end));
+
+    ct_cache_clear(ct);
+}
+
+int main(void)
+{
+    printf("Running conntrack tests...\n");
+
+    // Never touch the host conntrack table: the cache is complete and has no netlink socket.
+    g_conntrack.inited = 1;
+    g_conntrack.complete = 1;
+
+    test_dnat_event();
+    bench_lookup();
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,165 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-30
+ * Description: delaying ring buffer test cases
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+// Ring offsets are checked directly.
+#include "delaying_ring_buffer.c"
+
+#define TEST_CAPACITY   1024
+#define TEST_ROUNDS     100000
+
+static void fill_data(char *buf, int size, unsigned int seq)
+{
+    for (int i = 0; i < size; i++) {
+        buf[i] = (char)(seq + i);
+    }
+}
+
+static void check_item(const struct drb_item *item, int size, unsigned int seq)
+{
+    assert(item != NULL && item->size == size);
+    assert(((uintptr_t)item->data % DRB_ALIGN) == 0);
+    for (int i = 0; i < size; i++) {
+        assert(item->data[i] == (char)(seq + i));
+    }
+}
+
+static void test_fifo(void)
+{
+    struct delaying_ring_buffer *drb;
+    char buf[64];
+
+    drb = drb_new(TEST_CAPACITY, 0);
+    assert(drb != NULL);
+    assert(drb_look(drb) == NULL && drb_pop(drb) == -1);
+
+    for (unsigned int i = 0; i < 3; i++) {
+        fill_data(buf, 10 + i, i);
+        assert(drb_put(drb, buf, 10 + i) == 0);
+    }
+    for (unsigned int i = 0; i < 3; i++) {
+        check_item(drb_look(drb), 10 + i, i);
+        assert(drb_pop(drb) == 0);
+    }
+    assert(drb_look(drb) == NULL && drb->used == 0);
+
+    // Records larger than the ring are refused
+    assert(drb_put(drb, buf, TEST_CAPACITY) == -1);
+    drb_destroy(drb);
+
+    assert(drb_new((int)sizeof(struct drb_item), 0) == NULL);
+}
+
+static void test_delay(void)
+{
+    struct delaying_ring_buffer *drb;
+    char buf[16] = {0};
+
+    drb = drb_new(TEST_CAPACITY, 50);
+    assert(drb != NULL);
+    assert(drb_put(drb, buf, sizeof(buf)) == 0);
+    assert(drb_look(drb) == NULL);
+    (void)usleep(60 * 1000);
+    assert(drb_look(drb) != NULL);
+    assert(drb_pop(drb) == 0);
+    drb_destroy(drb);
+}
+
+static void test_wrap(void)
+{
+    struct delaying_ring_buffer *drb;
+    int len = DRB_ROUNDUP((int)sizeof(struct drb_item) + 100);
+    int num = TEST_CAPACITY / len;
+    char buf[400];
+    int i;
+
+    drb = drb_new(TEST_CAPACITY, 0);
+    assert(drb != NULL);
+
+    for (i = 0; i < num; i++) {
+        fill_data(buf, 100, (unsigned int)i);
+        assert(drb_put(drb, buf, 100) == 0);
+    }
+    assert(drb_put(drb, buf, 100) == -1);
+
+    // Room freed at the start, the record does not fit in the tail so the tail is skipped
+    assert(drb_pop(drb) == 0 && drb_pop(drb) == 0);
+    fill_data(buf, 200, 1000);
+    assert(drb_put(drb, buf, 200) == 0);
+    assert(drb->writer_idx == DRB_ROUNDUP((int)sizeof(struct drb_item) + 200));
+    assert(drb->data_end == num * len && drb->used == TEST_CAPACITY - 2 * len + drb->writer_idx);
+
+    for (i = 2; i < num; i++) {
+        check_item(drb_look(drb), 100, (unsigned int)i);
+        assert(drb_pop(drb) == 0);
+    }
+    // Reader skips the tail as well
+    check_item(drb_look(drb), 200, 1000);
+    assert(drb_pop(drb) == 0);
+    assert(drb->used == 0 && drb->data_end == TEST_CAPACITY);
+    drb_destroy(drb);
+}
+
+/* Random sizes put and popped out of step, every record comes back intact and in order. */
+static void test_random(void)
+{
+    struct delaying_ring_buffer *drb;
+    unsigned int put_seq = 0, pop_seq = 0;
+    int sizes[TEST_CAPACITY];
+    char buf[300];
+    int size;
+
+    drb = drb_new(TEST_CAPACITY, 0);
+    assert(drb != NULL);
+    srand(1);
+    for (int i = 0; i < TEST_ROUNDS; i++) {
+        if (rand() % 2) {
+            size = rand() % (int)sizeof(buf);
+            fill_data(buf, size, put_seq);
+            if (drb_put(drb, buf, size) == 0) {
+                sizes[put_seq % TEST_CAPACITY] = size;
+                put_seq++;
+            } else {
+                // Free room is split in two at most, the record does not fit in either
+                assert(drb->used + 2 * DRB_ROUNDUP((int)sizeof(struct drb_item) + size) > drb->capacity);
+            }
+        } else if (pop_seq < put_seq) {
+            check_item(drb_look(drb), sizes[pop_seq % TEST_CAPACITY], pop_seq);
+            assert(drb_pop(drb) == 0);
+            pop_seq++;
+        } else {
+            assert(drb_look(drb) == NULL);
+        }
+        assert(drb->used >= 0 && drb->used <= drb->capacity);
+    }
+    drb_destroy(drb);
+}
+
+int main(void)
+{
+    printf("Running delaying ring buffer tests...\n");
+
+    test_fifo();
+    test_delay();
+    test_wrap();
+    test_random();
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,230 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-25
+ * Description: sock_diag endpoint discovery test cases and benchmark
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+// Static sock_diag and ss parsers of tcp module are tested directly.
+#include "tcp.c"
+
+#define TEST_PORT       34567
+#define TEST_NETNS_PORT 34568
+#define BENCH_LOOPS     20
+
+static int test_listen_fd = -1;
+static int test_cli_fd = -1;
+static int test_srv_fd = -1;
+
+static void setup_sockets(void)
+{
+    struct sockaddr_in6 laddr = {.sin6_family = AF_INET6, .sin6_port = htons(TEST_PORT)};
+    struct sockaddr_in caddr = {.sin_family = AF_INET, .sin_port = htons(TEST_PORT)};
+    int one = 1;
+
+    laddr.sin6_addr = in6addr_any;
+    caddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    test_listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
+    assert(test_listen_fd >= 0);
+    (void)setsockopt(test_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    assert(bind(test_listen_fd, (struct sockaddr *)&laddr, sizeof(laddr)) == 0);
+    assert(listen(test_listen_fd, 1) == 0);
+
+    test_cli_fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(test_cli_fd >= 0);
+    assert(connect(test_cli_fd, (struct sockaddr *)&caddr, sizeof(caddr)) == 0);
+    test_srv_fd = accept(test_listen_fd, NULL, NULL);
+    assert(test_srv_fd >= 0);
+}
+
+static void test_listen_ports(void)
+{
+    struct tcp_listen_ports *tlps;
+    struct tcp_listen_port *tlp;
+    unsigned long ino, fd_ino;
+    int i, found = 0;
+
+    tlps = get_listen_ports();
+    assert(tlps != NULL);
+    assert(is_listen_port(TEST_PORT, tlps));
+
+    for (i = 0; i < tlps->tlp_num; i++) {
+        tlp = tlps->tlp[i];
+        if (tlp->port != TEST_PORT) {
+            continue;
+        }
+        assert(tlp->pid == (unsigned int)getpid());
+        assert(tlp->fd == (unsigned int)test_listen_fd);
+        assert(tlp->uid == getuid());
+        assert(tlp->ino != 0);
+
+        // Inode from sock_diag equals the one read from /proc/<pid>/fd
+        assert(get_listen_sock_inode(tlp, &ino) == 0);
+        tlp->ino = 0;
+        assert(get_listen_sock_inode(tlp, &fd_ino) == 0);
+        assert(ino == fd_ino);
+        found++;
+    }
+    assert(found == 1);
+    free_listen_ports(&tlps);
+}
+
+static void test_estab_tcps(void)
+{
+    struct tcp_listen_ports *tlps;
+    struct tcp_estabs *tes;
+    struct tcp_estab *te;
+    int i, clients = 0, servers = 0;
+
+    tlps = get_listen_ports();
+    assert(tlps != NULL);
+    tes = get_estab_tcps(tlps);
+    assert(tes != NULL);
+
+    for (i = 0; i < tes->te_num; i++) {
+        te = tes->te[i];
+        if (te->te_comm_num != 1 || te->te_comm[0]->pid != (unsigned int)getpid()) {
+            continue;
+        }
+        if (te->te_comm[0]->fd == (unsigned int)test_cli_fd) {
+            assert(te->is_client);
+            assert(te->local.ipv4 && te->remote.port == TEST_PORT);
+            assert(strcmp(te->remote.ip, "127.0.0.1") == 0);
+            clients++;
+        } else if (te->te_comm[0]->fd == (unsigned int)test_srv_fd) {
+            assert(!te->is_client);
+            // Accepted by an IPv6 listener, address is v4-mapped just like ss prints it.
+            assert(!te->local.ipv4 && te->local.port == TEST_PORT);
+            assert(strcmp(te->local.ip, "::ffff:127.0.0.1") == 0);
+            servers++;
+        }
+    }
+    assert(clients == 1 && servers == 1);
+
+    free_estab_tcps(&tes);
+    free_listen_ports(&tlps);
+}
+
+/* A port listened in another net namespace is only found by looking into that namespace. */
+static void test_netns_listen_ports(void)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(TEST_NETNS_PORT)};
+    struct tcp_listen_ports *tlps;
+    int pipefd[2], fd, status;
+    char ready;
+    pid_t pid;
+
+    assert(pipe(pipefd) == 0);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        (void)close(pipefd[0]);
+        if (unshare(CLONE_NEWNET) != 0) {
+            _exit(1);
+        }
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+            _exit(1);
+        }
+        (void)write(pipefd[1], "1", 1);
+        (void)pause();
+        _exit(0);
+    }
+
+    (void)close(pipefd[1]);
+    if (read(pipefd[0], &ready, 1) != 1) {
+        // Creating a net namespace needs CAP_SYS_ADMIN.
+        printf("netns listen ports: skipped\n");
+        (void)waitpid(pid, &status, 0);
+        (void)close(pipefd[0]);
+        return;
+    }
+
+    tlps = get_listen_ports();
+    assert(tlps != NULL);
+    assert(!is_listen_port(TEST_NETNS_PORT, tlps));
+    free_listen_ports(&tlps);
+
+    tlps = get_netns_listen_ports((unsigned int)pid);
+    assert(tlps != NULL);
+    assert(is_listen_port(TEST_NETNS_PORT, tlps));
+    assert(!is_listen_port(TEST_PORT, tlps));
+    free_listen_ports(&tlps);
+
+    // Calling thread is back in its own net namespace.
+    tlps = get_listen_ports();
+    assert(tlps != NULL);
+    assert(is_listen_port(TEST_PORT, tlps));
+    free_listen_ports(&tlps);
+
+    (void)kill(pid, SIGKILL);
+    (void)waitpid(pid, &status, 0);
+    (void)close(pipefd[0]);
+}
+
+static double elapsed_sec(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench_listen_ports(void)
+{
+    struct tcp_listen_ports *tlps;
+    struct timespec start, end;
+    int i;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        tlps = __new_tlps();
+        assert(tlps != NULL);
+        assert(__get_tlps_by_diag(tlps, 0) == 0);
+        __free_tlps(&tlps);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("sock_diag: %.1f listen scans/s\n", BENCH_LOOPS / elapsed_sec(&start, &end));
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        tlps = __new_tlps();
+        assert(tlps != NULL);
+        (void)__get_tlps_by_ss(tlps);
+        __free_tlps(&tlps);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("ss command: %.1f listen scans/s\n", BENCH_LOOPS / elapsed_sec(&start, &end));
+}
+
+int main(void)
+{
+    printf("Running tcp endpoint tests...\n");
+
+    setup_sockets();
+    test_listen_ports();
+    test_estab_tcps();
+    test_netns_listen_ports();
+    bench_listen_ports();
+
+    (void)close(test_srv_fd);
+    (void)close(test_cli_fd);
+    (void)close(test_listen_fd);
+    printf("All tests passed!\n");
+    return 0;
+}
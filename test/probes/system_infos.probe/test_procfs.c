@@ -0,0 +1,269 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-25
+ * Description: procfs reader test cases and per-cycle cost benchmark against popen collectors
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "procfs.c"
+
+#define BENCH_CYCLES    10
+#define BENCH_PROCS     100
+
+/* Commands run every period by the popen based collectors. */
+static const char *g_popen_cmds[] = {
+    "cat /proc/softirqs | grep -E '\\sRCU:\\s|\\sTIMER:\\s|\\sSCHED:\\s|\\sNET_RX:\\s'",
+    "cat /proc/cpuinfo | grep MHz",
+    "cat /proc/sys/fs/dentry-state",
+    "grep vmalloc /proc/vmallocinfo | awk '{total+=$2}; END {print total}'",
+    "/usr/bin/cat /proc/diskstats",
+    "cat /proc/mounts",
+};
+#define PROC_ID_CMD "ps -eo pid,ppid,pgid,comm | /usr/bin/awk '{if($1==\"%d\"){print $2 \"|\" $3}}'"
+
+static struct procfs_file_s g_files[] = {
+    PROCFS_FILE("/proc/softirqs"),
+    PROCFS_FILE("/proc/cpuinfo"),
+    PROCFS_FILE("/proc/sys/fs/dentry-state"),
+    PROCFS_FILE("/proc/vmallocinfo"),
+    PROCFS_FILE("/proc/diskstats"),
+    PROCFS_FILE("/proc/mounts"),
+};
+
+static void test_tokenizers(void)
+{
+    char buf[] = "          RCU:   12  34\n       TIMER: 5 6\nbtime 1700000000\n";
+    char *pos = buf, *line, *field;
+    u64 value;
+
+    line = procfs_next_line(&pos);
+    field = procfs_next_field(&line);
+    assert(strcmp(field, "RCU:") == 0);
+    assert(procfs_next_u64(&line, 10, &value) == 0 && value == 12);
+    assert(procfs_next_u64(&line, 10, &value) == 0 && value == 34);
+    // Never runs into next line
+    assert(procfs_next_u64(&line, 10, &value) < 0);
+    assert(procfs_next_field(&line) == NULL);
+
+    line = procfs_next_line(&pos);
+    procfs_skip_fields(&line, 2);
+    assert(procfs_next_u64(&line, 16, &value) == 0 && value == 6);
+
+    line = procfs_find_key(pos, "btime ");
+    assert(line != NULL && procfs_next_u64(&line, 10, &value) == 0 && value == 1700000000);
+    assert(procfs_find_key(pos, "intr ") == NULL);
+
+    (void)procfs_next_line(&pos);
+    assert(procfs_next_line(&pos) == NULL);
+}
+
+static void test_kept_file(void)
+{
+    struct procfs_file_s file;
+    char path[PATH_LEN];
+    char *pos;
+    u64 value;
+    pid_t pid;
+    int len;
+
+    // Content larger than initial buffer is read completely
+    procfs_file_init(&file, "/proc/self/maps");
+    len = procfs_read(&file);
+    assert(len > 0 && (u32)len == strlen(file.buf));
+    assert(procfs_read(&file) > 0 && file.fd >= 0);
+    procfs_close(&file);
+    assert(file.fd < 0 && file.buf == NULL);
+
+    // Kept fd of an exited process fails, and is not reopened because the path is gone too
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        pause();
+        _exit(0);
+    }
+    (void)snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    procfs_file_init(&file, path);
+    assert(procfs_read(&file) > 0);
+    pos = strrchr(file.buf, ')') + 1;
+    procfs_skip_fields(&pos, 1);
+    assert(procfs_next_u64(&pos, 10, &value) == 0 && value == (u64)getpid());
+
+    (void)kill(pid, SIGKILL);
+    (void)waitpid(pid, NULL, 0);
+    assert(procfs_read(&file) < 0);
+    assert(file.fd < 0);
+    procfs_close(&file);
+}
+
+static void test_kept_fds_cap(void)
+{
+    struct procfs_file_s kept, over;
+    u32 kept_fds_max = procfs_kept_fds_max();
+
+    procfs_file_init(&kept, "/proc/self/stat");
+    assert(procfs_read(&kept) > 0 && kept.fd >= 0 && kept.kept);
+    assert(g_kept_fds == 1);
+
+    // Beyond the cap the file is opened and closed per read
+    g_kept_fds_max = g_kept_fds;
+    procfs_file_init(&over, "/proc/self/io");
+    assert(procfs_read(&over) > 0 && over.fd < 0 && !over.kept);
+    assert(procfs_read(&over) > 0 && over.fd < 0);
+    assert(g_kept_fds == 1);
+
+    procfs_close(&over);
+    procfs_close(&kept);
+    assert(g_kept_fds == 0);
+    g_kept_fds_max = kept_fds_max;
+}
+
+static double cpu_sec(void)
+{
+    struct rusage self, child;
+
+    (void)getrusage(RUSAGE_SELF, &self);
+    (void)getrusage(RUSAGE_CHILDREN, &child);
+    return (double)(self.ru_utime.tv_sec + self.ru_stime.tv_sec + child.ru_utime.tv_sec + child.ru_stime.tv_sec) +
+        (double)(self.ru_utime.tv_usec + self.ru_stime.tv_usec + child.ru_utime.tv_usec + child.ru_stime.tv_usec) / 1e6;
+}
+
+static int load_pids(int pids[], int max)
+{
+    DIR *dir = opendir("/proc");
+    struct dirent *entry;
+    int num = 0;
+
+    assert(dir != NULL);
+    while (num < max && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] >= '1' && entry->d_name[0] <= '9') {
+            pids[num++] = atoi(entry->d_name);
+        }
+    }
+    (void)closedir(dir);
+    return num;
+}
+
+static void popen_cycle(const int pids[], int pid_num)
+{
+    char cmd[COMMAND_LEN];
+    char line[LINE_BUF_LEN];
+    FILE *f;
+    size_t i;
+
+    for (i = 0; i < sizeof(g_popen_cmds) / sizeof(g_popen_cmds[0]); i++) {
+        f = popen(g_popen_cmds[i], "r");
+        assert(f != NULL);
+        while (fgets(line, sizeof(line), f) != NULL) {
+        }
+        (void)pclose(f);
+    }
+    for (int j = 0; j < pid_num; j++) {
+        (void)snprintf(cmd, sizeof(cmd), PROC_ID_CMD, pids[j]);
+        f = popen(cmd, "r");
+        assert(f != NULL);
+        while (fgets(line, sizeof(line), f) != NULL) {
+        }
+        (void)pclose(f);
+    }
+}
+
+static void procfs_cycle(struct procfs_file_s stat_files[], int pid_num)
+{
+    char *pos, *line;
+    u64 value, sum = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(g_files) / sizeof(g_files[0]); i++) {
+        if (procfs_read(&g_files[i]) < 0) {
+            continue;
+        }
+        pos = g_files[i].buf;
+        while ((line = procfs_next_line(&pos)) != NULL) {
+            procfs_skip_fields(&line, 1);
+            if (procfs_next_u64(&line, 10, &value) == 0) {
+                sum += value;
+            }
+        }
+    }
+    for (int j = 0; j < pid_num; j++) {
+        if (procfs_read(&stat_files[j]) < 0) {
+            continue;
+        }
+        pos = strrchr(stat_files[j].buf, ')');
+        if (pos != NULL) {
+            pos++;
+            procfs_skip_fields(&pos, 1);
+            (void)procfs_next_u64(&pos, 10, &value);
+        }
+    }
+    (void)sum;
+}
+
+static void bench_cycle(void)
+{
+    struct procfs_file_s stat_files[BENCH_PROCS];
+    char path[PATH_LEN];
+    int pids[BENCH_PROCS];
+    int pid_num, i;
+    double start, popen_cost, procfs_cost;
+
+    pid_num = load_pids(pids, BENCH_PROCS);
+    for (i = 0; i < pid_num; i++) {
+        (void)snprintf(path, sizeof(path), "/proc/%d/stat", pids[i]);
+        procfs_file_init(&stat_files[i], path);
+    }
+
+    start = cpu_sec();
+    for (i = 0; i < BENCH_CYCLES; i++) {
+        popen_cycle(pids, pid_num);
+    }
+    popen_cost = (cpu_sec() - start) / BENCH_CYCLES;
+
+    start = cpu_sec();
+    for (i = 0; i < BENCH_CYCLES; i++) {
+        procfs_cycle(stat_files, pid_num);
+    }
+    procfs_cost = (cpu_sec() - start) / BENCH_CYCLES;
+
+    printf("%d processes, cpu time per cycle: popen %.2f ms, procfs %.2f ms\n",
+           pid_num, popen_cost * 1000, procfs_cost * 1000);
+
+    for (i = 0; i < pid_num; i++) {
+        procfs_close(&stat_files[i]);
+    }
+    for (i = 0; i < (int)(sizeof(g_files) / sizeof(g_files[0])); i++) {
+        procfs_close(&g_files[i]);
+    }
+}
+
+int main(void)
+{
+    printf("Running procfs tests...\n");
+
+    test_tokenizers();
+    test_kept_file();
+    test_kept_fds_cap();
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        bench_cycle();
+    }
+
+    printf("All tests passed!\n");
+    return 0;
+}
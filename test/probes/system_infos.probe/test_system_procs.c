@@ -0,0 +1,185 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-26
+ * Description: system_procs sampling test cases and smaps cost benchmark
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+// Static collectors of system_procs are tested directly.
+#include "system_procs.c"
+
+#define TEST_MAPPINGS   10000
+#define TEST_PERIOD     5
+#define BENCH_LOOPS     20
+
+static void *g_maps[TEST_MAPPINGS];
+
+static void setup_mappings(void)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    int i;
+
+    // Alternate protections so neighbouring mappings are not merged into one vma.
+    for (i = 0; i < TEST_MAPPINGS; i++) {
+        g_maps[i] = mmap(NULL, (size_t)page, (i % 2) ? PROT_READ : (PROT_READ | PROT_WRITE),
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(g_maps[i] != MAP_FAILED);
+    }
+}
+
+static void test_mss_rollup_equals_smaps(void)
+{
+    u32 rollup[PROC_MSS_MAX] = {0};
+    u32 smaps[PROC_MSS_MAX] = {0};
+    u32 pid = (u32)getpid();
+
+    if (!is_smaps_rollup_supported()) {
+        printf("smaps_rollup is not supported, skipped\n");
+        return;
+    }
+    assert(read_proc_smaps_rollup(pid, rollup) == 0);
+    assert(read_proc_smaps(pid, smaps) == 0);
+    // Nothing is touched between the two reads, so the fields of the mappings stay the same.
+    assert(rollup[PROC_MSS_SHARED_CLEAN] == smaps[PROC_MSS_SHARED_CLEAN]);
+    assert(rollup[PROC_MSS_SWAP] == smaps[PROC_MSS_SWAP]);
+    assert(rollup[PROC_MSS_PRIVATE_CLEAN] + rollup[PROC_MSS_PROVATE_DIRTY] > 0);
+}
+
+static void test_slow_interval(void)
+{
+    proc_hash_t *proc;
+    u32 interval;
+    int i;
+
+    proc = init_one_proc((u32)getpid(), "0", "test");
+    assert(proc != NULL);
+    assert(proc->info.fd_count > 0);
+
+    proc->slow_interval = 1;
+    proc->slow_countdown = 0;
+    for (i = 0; i < PROC_SLOW_MAX_INTERVAL * 2; i++) {
+        (void)update_proc_slow_infos(proc);
+    }
+    interval = proc->slow_interval;
+    assert(interval >= 1 && interval <= PROC_SLOW_MAX_INTERVAL);
+    assert(proc->slow_countdown < interval);
+    printf("slow fields interval with %d mappings: %u samples\n", TEST_MAPPINGS, interval);
+
+    // Reading full smaps of 10000 mappings is expensive, it backs off to the max interval.
+    g_smaps_rollup_checked = 1;
+    g_smaps_rollup_supported = 0;
+    for (i = 0; i < PROC_SLOW_MAX_INTERVAL * 4; i++) {
+        (void)update_proc_slow_infos(proc);
+    }
+    assert(proc->slow_interval == PROC_SLOW_MAX_INTERVAL);
+    g_smaps_rollup_checked = 0;
+
+    // Skipped samples keep the last values
+    proc->info.fd_count = 0;
+    proc->slow_countdown = 1;
+    assert(update_proc_slow_infos(proc) == 0);
+    assert(proc->info.fd_count == 0 && proc->slow_countdown == 0);
+    assert(update_proc_slow_infos(proc) == 0);
+    assert(proc->info.fd_count > 0);
+
+    free_one_proc(proc);
+}
+
+static void test_spread_over_period(void)
+{
+    struct ipc_body_s ipc_body;
+    int slots[TEST_PERIOD + 1] = {0};
+    proc_hash_t *proc, *tmp;
+    time_t now = time(NULL);
+    int i;
+
+    (void)memset(&ipc_body, 0, sizeof(ipc_body));
+    ipc_body.probe_param.period = TEST_PERIOD;
+    for (i = 0; i < TEST_PERIOD * 2; i++) {
+        ipc_body.snooper_objs[i].type = SNOOPER_OBJ_PROC;
+        ipc_body.snooper_objs[i].obj.proc.proc_id = (u32)getpid();
+    }
+    ipc_body.snooper_obj_num = TEST_PERIOD * 2;
+
+    // Same pid is added once only, so spread a few copies by hand after the refresh
+    assert(refresh_proc_filter_map(&ipc_body) == 0);
+    assert(HASH_COUNT(g_procmap) == 1);
+    HASH_ITER(hh, g_procmap, proc, tmp) {
+        assert(proc->next_sample >= now + 1 && proc->next_sample <= now + 1 + TEST_PERIOD);
+    }
+    hash_clear_all_proc();
+
+    for (i = 0; i < TEST_PERIOD * 2; i++) {
+        proc = init_one_proc((u32)getpid(), "0", "test");
+        assert(proc != NULL);
+        proc->key.start_time = (u64)i;
+        proc->next_sample = now + 1 + (time_t)HASH_COUNT(g_procmap) * TEST_PERIOD / (TEST_PERIOD * 2);
+        hash_add_proc(proc);
+    }
+    HASH_ITER(hh, g_procmap, proc, tmp) {
+        slots[proc->next_sample - now - 1]++;
+    }
+    // Two processes are due at each second of the period
+    for (i = 0; i < TEST_PERIOD; i++) {
+        assert(slots[i] == 2);
+    }
+    hash_clear_all_proc();
+}
+
+static void bench_mss(void)
+{
+    u32 mss[PROC_MSS_MAX];
+    struct timespec start, mid, end;
+    u32 pid = (u32)getpid();
+    int i;
+
+    if (!is_smaps_rollup_supported()) {
+        return;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        (void)memset(mss, 0, sizeof(mss));
+        (void)read_proc_smaps_rollup(pid, mss);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &mid);
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        (void)memset(mss, 0, sizeof(mss));
+        (void)read_proc_smaps(pid, mss);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%d mappings, cost per read: smaps_rollup %.3f ms, smaps %.3f ms\n", TEST_MAPPINGS,
+           (double)get_elapsed_us(&start, &mid) / BENCH_LOOPS / 1000,
+           (double)get_elapsed_us(&mid, &end) / BENCH_LOOPS / 1000);
+}
+
+int main(void)
+{
+    printf("Running system_procs tests...\n");
+
+    setup_mappings();
+    test_mss_rollup_equals_smaps();
+    test_slow_interval();
+    test_spread_over_period();
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        bench_mss();
+    }
+
+    printf("All tests passed!\n");
+    return 0;
+}
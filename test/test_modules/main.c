@@ -23,7 +23,10 @@
 #include "test_meta.h"
 #include "test_probe.h"
 #include "test_imdb.h"
+#include "test_arena.h"
+#include "test_container.h"
 #include "test_logs.h"
+#include "test_histogram.h"
 
 typedef struct {
     char *suiteName;
@@ -40,7 +43,10 @@ TestSuite gTestSuites[] = {
     TEST_SUITE_META,
     //TEST_SUITE_PROBE,
     TEST_SUITE_IMDB,
-    TEST_SUITE_LOGS
+    TEST_SUITE_ARENA,
+    TEST_SUITE_CONTAINER,
+    TEST_SUITE_LOGS,
+    TEST_SUITE_HISTOGRAM
 };
 
 int main(int argc, char *argv[])
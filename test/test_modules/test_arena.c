@@ -0,0 +1,207 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-14
+ * Description: provide gala-gopher test
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CUnit/Basic.h>
+
+#include "imdb.h"
+#include "imdb_arena.h"
+#include "test_arena.h"
+
+#define BENCH_METRICS_NUM   30
+#define BENCH_RECORDS_NUM   20000
+#define BENCH_ROUNDS        10
+
+static void TestArenaAlloc(void)
+{
+    IMDB_Arena arena;
+    char *p1, *p2, *s;
+
+    IMDB_ArenaInit(&arena, IMDB_ARENA_MAX_SIZE);
+
+    p1 = (char *)IMDB_ArenaAlloc(&arena, 3);
+    p2 = (char *)IMDB_ArenaAlloc(&arena, 5);
+    CU_ASSERT(p1 != NULL && p2 != NULL);
+    CU_ASSERT(((uintptr_t)p1 % IMDB_ARENA_ALIGN) == 0);
+    CU_ASSERT(((uintptr_t)p2 % IMDB_ARENA_ALIGN) == 0);
+    CU_ASSERT(p2 - p1 == IMDB_ARENA_ALIGN);
+
+    s = IMDB_ArenaStrdup(&arena, "gala-gopher");
+    CU_ASSERT(s != NULL && strcmp(s, "gala-gopher") == 0);
+
+    // Larger than one chunk
+    p1 = (char *)IMDB_ArenaAlloc(&arena, IMDB_ARENA_CHUNK_SIZE * 2);
+    CU_ASSERT(p1 != NULL);
+    CU_ASSERT(arena.chunkAllocs == 2);
+
+    IMDB_ArenaDestroy(&arena);
+}
+
+static void TestArenaReset(void)
+{
+    IMDB_Arena arena;
+    uint64_t chunkAllocs;
+    int i;
+
+    IMDB_ArenaInit(&arena, IMDB_ARENA_MAX_SIZE);
+    for (i = 0; i < 1000; i++) {
+        CU_ASSERT(IMDB_ArenaAlloc(&arena, 256) != NULL);
+    }
+    chunkAllocs = arena.chunkAllocs;
+    CU_ASSERT(arena.total > 0);
+
+    // Chunks are kept as spares and reused after reset
+    IMDB_ArenaReset(&arena);
+    CU_ASSERT(arena.total == 0);
+    for (i = 0; i < 1000; i++) {
+        CU_ASSERT(IMDB_ArenaAlloc(&arena, 256) != NULL);
+    }
+    CU_ASSERT(arena.chunkAllocs == chunkAllocs);
+
+    IMDB_ArenaDestroy(&arena);
+}
+
+static void TestArenaFull(void)
+{
+    IMDB_Arena arena;
+
+    IMDB_ArenaInit(&arena, IMDB_ARENA_CHUNK_SIZE);
+    CU_ASSERT(IMDB_ArenaFull(&arena) == 0);
+    CU_ASSERT(IMDB_ArenaAlloc(&arena, 8) != NULL);
+    CU_ASSERT(IMDB_ArenaFull(&arena) == 1);
+    // No chunk is added beyond the limit
+    CU_ASSERT(IMDB_ArenaAlloc(&arena, IMDB_ARENA_CHUNK_SIZE) == NULL);
+    CU_ASSERT(arena.total == IMDB_ARENA_CHUNK_SIZE);
+    IMDB_ArenaDestroy(&arena);
+
+    // limit 0 means arena is disabled
+    IMDB_ArenaInit(&arena, 0);
+    CU_ASSERT(IMDB_ArenaFull(&arena) == 1);
+    CU_ASSERT(IMDB_ArenaAlloc(&arena, 8) == NULL);
+    IMDB_ArenaDestroy(&arena);
+}
+
+static IMDB_Table *BenchTableCreate(IMDB_DataBaseMgr *mgr, const char *name)
+{
+    char metricName[MAX_IMDB_METRIC_NAME_LEN];
+    IMDB_Table *table;
+    IMDB_Meta *meta;
+    int i;
+
+    table = IMDB_TableCreate((char *)name, BENCH_RECORDS_NUM);
+    meta = IMDB_MetaCreate(BENCH_METRICS_NUM);
+    if (table == NULL || meta == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < BENCH_METRICS_NUM; i++) {
+        (void)snprintf(metricName, sizeof(metricName), "metric_%d", i);
+        meta->metrics[i] = IMDB_MetricCreate(metricName, "bench", (i == 0) ? "key" : ((i < 5) ? "label" : "gauge"));
+    }
+    IMDB_TableSetMeta(table, meta);
+    if (IMDB_DataBaseMgrAddTable(mgr, table) != 0) {
+        IMDB_TableDestroy(table);
+        return NULL;
+    }
+    return table;
+}
+
+static long BenchVmRSS(void)
+{
+    char line[LINE_BUF_LEN];
+    long rss = 0;
+    FILE *f = fopen("/proc/self/status", "r");
+
+    if (f == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "VmRSS: %ld", &rss) == 1) {
+            break;
+        }
+    }
+    (void)fclose(f);
+    return rss;
+}
+
+static void BenchRun(IMDB_DataBaseMgr *mgr, IMDB_Table *table, const char *mode)
+{
+    char content[LINE_BUF_LEN];
+    struct timespec start, end;
+    long rssBefore, rssPeak = 0, rss;
+    double ns;
+    int i, round;
+
+    rssBefore = BenchVmRSS();
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (i = 0; i < BENCH_RECORDS_NUM; i++) {
+            (void)snprintf(content, sizeof(content),
+                "|%d|container_%d|pod_%d|ns_%d|node|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d"
+                "|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|\n",
+                i, i, i, i, i + round, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, round);
+            CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, content) != NULL);
+        }
+        rss = BenchVmRSS();
+        rssPeak = (rss > rssPeak) ? rss : rssPeak;
+        // Same as serializing all records of the table
+        DeleteAndFreeRecords(table);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+    printf("\n    [%s] %d records x %d rounds: %.1f ns/record, VmRSS before %ld KB, peak %ld KB, after %ld KB",
+           mode, BENCH_RECORDS_NUM, BENCH_ROUNDS, ns / (BENCH_RECORDS_NUM * BENCH_ROUNDS),
+           rssBefore, rssPeak, BenchVmRSS());
+    // Chunks are only counted when the arena is in use, in malloc mode every record and value is malloced.
+    if (table->arena.limit != 0) {
+        printf(", chunk mallocs/record %.4f", (double)table->arena.chunkAllocs / (BENCH_RECORDS_NUM * BENCH_ROUNDS));
+    }
+}
+
+/* Allocation rate and RSS of IMDB records: arena of table vs malloc per record/value. */
+static void TestArenaBenchmark(void)
+{
+    IMDB_DataBaseMgr *mgr;
+    IMDB_Table *table;
+
+    mgr = IMDB_DataBaseMgrCreate(2);
+    CU_ASSERT_FATAL(mgr != NULL);
+
+    table = BenchTableCreate(mgr, "bench_malloc");
+    CU_ASSERT_FATAL(table != NULL);
+    IMDB_ArenaInit(&table->arena, 0);
+    BenchRun(mgr, table, "malloc");
+
+    table = BenchTableCreate(mgr, "bench_arena");
+    CU_ASSERT_FATAL(table != NULL);
+    BenchRun(mgr, table, "arena");
+
+    IMDB_DataBaseMgrDestroy(mgr);
+}
+
+void TestArenaMain(CU_pSuite suite)
+{
+    CU_ADD_TEST(suite, TestArenaAlloc);
+    CU_ADD_TEST(suite, TestArenaReset);
+    CU_ADD_TEST(suite, TestArenaFull);
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        CU_ADD_TEST(suite, TestArenaBenchmark);
+    }
+}
@@ -0,0 +1,26 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-14
+ * Description: provide gala-gopher test
+ ******************************************************************************/
+#ifndef __TEST_ARENA_H__
+#define __TEST_ARENA_H__
+
+#define TEST_SUITE_ARENA \
+    {   \
+        .suiteName = "TEST_ARENA",   \
+        .suiteMain = TestArenaMain   \
+    }
+
+extern void TestArenaMain(CU_pSuite suite);
+
+#endif
@@ -0,0 +1,205 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-18
+ * Description: provide gala-gopher test
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <CUnit/Basic.h>
+
+#include "container.h"
+#include "container_runtime.h"
+#include "test_container.h"
+
+#define TEST_DOCKER_ID      "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+#define TEST_CONTAINERD_ID  "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210"
+#define TEST_BENCH_LOOPS    10000
+
+/* Stand-in of runtime state dirs, same layout as on host */
+static char g_root[PATH_LEN];
+
+static const char *g_docker_config =
+    "{\"ID\":\"" TEST_DOCKER_ID "\",\"Image\":\"sha256:feedbeef\","
+    "\"State\":{\"Running\":true,\"Paused\":false,\"Pid\":%d,\"ExitCode\":0},"
+    "\"Config\":{\"Hostname\":\"nginx\",\"Env\":[\"PATH=/usr/bin\",\"A={}[]\"],"
+    "\"Image\":\"nginx@sha256:feedbeef\","
+    "\"Labels\":{\"io.kubernetes.pod.name\":\"nginx-pod\",\"io.kubernetes.pod.namespace\":\"default\","
+    "\"io.kubernetes.pod.uid\":\"11111111-2222-3333-4444-555555555555\",\"app\":\"web \\\"x\\\"\"}},"
+    "\"Name\":\"/k8s_nginx_nginx-pod\"}";
+
+static const char *g_containerd_config =
+    "{\"ociVersion\":\"1.1.0\",\"process\":{\"args\":[\"/pause\"]},"
+    "\"annotations\":{\"io.kubernetes.cri.container-type\":\"container\","
+    "\"io.kubernetes.cri.container-name\":\"redis\",\"io.kubernetes.cri.image-name\":\"docker.io/library/redis:7\","
+    "\"io.kubernetes.cri.sandbox-name\":\"redis-pod\","
+    "\"io.kubernetes.cri.sandbox-uid\":\"66666666-7777-8888-9999-000000000000\"}}";
+
+static void WriteFile(const char *dir, const char *name, const char *content)
+{
+    char path[PATH_LEN];
+    FILE *f;
+
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "w");
+    CU_ASSERT_FATAL(f != NULL);
+    (void)fputs(content, f);
+    (void)fclose(f);
+}
+
+static void MakeDirs(const char *path)
+{
+    char cmd[COMMAND_LEN];
+
+    (void)snprintf(cmd, sizeof(cmd), "mkdir -p %s", path);
+    CU_ASSERT_FATAL(system(cmd) == 0);
+}
+
+static void SetupRuntimeRoot(void)
+{
+    char dir[PATH_LEN];
+    char buf[LINE_BUF_LEN * 4];
+
+    (void)snprintf(g_root, sizeof(g_root), "/tmp/gopher_test_runtime.XXXXXX");
+    CU_ASSERT_FATAL(mkdtemp(g_root) != NULL);
+
+    (void)snprintf(dir, sizeof(dir), "%s%s/%s", g_root, DOCKER_STATE_DIR, TEST_DOCKER_ID);
+    MakeDirs(dir);
+    (void)snprintf(buf, sizeof(buf), g_docker_config, (int)getpid());
+    WriteFile(dir, "config.v2.json", buf);
+
+    (void)snprintf(dir, sizeof(dir), "%s%s/k8s.io/%s", g_root, CONTAINERD_STATE_DIR, TEST_CONTAINERD_ID);
+    MakeDirs(dir);
+    WriteFile(dir, "config.json", g_containerd_config);
+    (void)snprintf(buf, sizeof(buf), "%d", (int)getpid());
+    WriteFile(dir, "init.pid", buf);
+
+    container_runtime_set_root(g_root);
+}
+
+static void CleanupRuntimeRoot(void)
+{
+    char cmd[COMMAND_LEN];
+
+    container_runtime_set_root(NULL);
+    (void)snprintf(cmd, sizeof(cmd), "rm -rf %s", g_root);
+    (void)system(cmd);
+}
+
+static void TestContainerRuntimeDocker(void)
+{
+    char buf[POD_LABELS_BUF_SIZE];
+    unsigned int pid = 0;
+
+    SetupRuntimeRoot();
+
+    // Abbreviated id matches the state dir named by full id
+    CU_ASSERT(container_runtime_get_name("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "/k8s_nginx_nginx-pod") == 0);
+    CU_ASSERT(container_runtime_get_pid("0123456789ab", &pid) == CONTAINER_OK);
+    CU_ASSERT(pid == (unsigned int)getpid());
+    CU_ASSERT(container_runtime_get_image("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "nginx@sha256:feedbeef") == 0);
+    CU_ASSERT(container_runtime_get_pod("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "nginx-pod") == 0);
+    CU_ASSERT(container_runtime_get_pod_id("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "11111111-2222-3333-4444-555555555555") == 0);
+    CU_ASSERT(container_runtime_get_pod_labels("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(buf[0] == '{' && strstr(buf, "\"app\":\"web \\\"x\\\"\"}") != NULL);
+
+    // Public lookups take the native path and post-process as before
+    CU_ASSERT(get_container_image("0123456789ab", buf, sizeof(buf)) == 0);
+    CU_ASSERT(strcmp(buf, "nginx") == 0);
+
+    CleanupRuntimeRoot();
+}
+
+static void TestContainerRuntimeContainerd(void)
+{
+    char buf[POD_LABELS_BUF_SIZE];
+    unsigned int pid = 0;
+
+    SetupRuntimeRoot();
+
+    CU_ASSERT(container_runtime_get_name("fedcba987654", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "redis") == 0);
+    CU_ASSERT(container_runtime_get_pid("fedcba987654", &pid) == CONTAINER_OK);
+    CU_ASSERT(pid == (unsigned int)getpid());
+    CU_ASSERT(container_runtime_get_image("fedcba987654", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "docker.io/library/redis:7") == 0);
+    CU_ASSERT(container_runtime_get_pod("fedcba987654", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "redis-pod") == 0);
+    CU_ASSERT(container_runtime_get_pod_id("fedcba987654", buf, sizeof(buf)) == CONTAINER_OK);
+    CU_ASSERT(strcmp(buf, "66666666-7777-8888-9999-000000000000") == 0);
+    // Pod labels are only known by CLI
+    CU_ASSERT(container_runtime_get_pod_labels("fedcba987654", buf, sizeof(buf)) == CONTAINER_NOTOK);
+
+    CleanupRuntimeRoot();
+}
+
+static void TestContainerRuntimeUnknown(void)
+{
+    char buf[CONTAINER_NAME_LEN];
+    unsigned int pid = 0;
+
+    SetupRuntimeRoot();
+
+    CU_ASSERT(container_runtime_get_name("aaaaaaaaaaaa", buf, sizeof(buf)) == CONTAINER_NOTOK);
+    CU_ASSERT(container_runtime_get_pid("aaaaaaaaaaaa", &pid) == CONTAINER_NOTOK);
+    CU_ASSERT(container_runtime_get_name("", buf, sizeof(buf)) == CONTAINER_NOTOK);
+
+    CleanupRuntimeRoot();
+}
+
+/* Cost of one lookup: parse state file on every call vs served from cache. */
+static void TestContainerRuntimeBenchmark(void)
+{
+    char buf[CONTAINER_NAME_LEN];
+    struct timespec start, end;
+    double cold_ns, warm_ns;
+    int i;
+
+    SetupRuntimeRoot();
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < TEST_BENCH_LOOPS / 10; i++) {
+        container_runtime_cache_clear();
+        CU_ASSERT(container_runtime_get_name("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    cold_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (TEST_BENCH_LOOPS / 10);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < TEST_BENCH_LOOPS; i++) {
+        CU_ASSERT(container_runtime_get_name("0123456789ab", buf, sizeof(buf)) == CONTAINER_OK);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    warm_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / TEST_BENCH_LOOPS;
+
+    printf("\n[container runtime] state file lookup %.0f ns, cached lookup %.0f ns\n", cold_ns, warm_ns);
+
+    CleanupRuntimeRoot();
+}
+
+void TestContainerMain(CU_pSuite suite)
+{
+    CU_ADD_TEST(suite, TestContainerRuntimeDocker);
+    CU_ADD_TEST(suite, TestContainerRuntimeContainerd);
+    CU_ADD_TEST(suite, TestContainerRuntimeUnknown);
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        CU_ADD_TEST(suite, TestContainerRuntimeBenchmark);
+    }
+}
@@ -13,12 +13,19 @@
  * Description: provide gala-gopher test
  ******************************************************************************/
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <CUnit/Basic.h>
 
 #include "fifo.h"
 #include "test_fifo.h"
 
 #define FIFO_SIZE  8
+#define BENCH_FIFO_SIZE     1024
+#define BENCH_RECORDS_NUM   (1024 * 1024)
 
 static void TestFifoCreate(void)
 {
@@ -44,11 +51,13 @@ static void TestFifoPut(void)
 
     CU_ASSERT(fifo != NULL);
     for (int i = 0; i < FIFO_SIZE; i++) {
+        CU_ASSERT(FifoFull(fifo) == 0);
         ret = FifoPut(fifo, &elem);
         CU_ASSERT(ret == 0);
         CU_ASSERT(fifo->in == (i + 1));
     }
 
+    CU_ASSERT(FifoFull(fifo) == 1);
     ret = FifoPut(fifo, &elem);
     CU_ASSERT(ret == -1);
     CU_ASSERT(fifo->in == FIFO_SIZE);
@@ -72,10 +81,190 @@ static void TestFifoGet(void)
 }
 
 
+static void TestFifoPutNGetN(void)
+{
+    uint32_t ret = 0;
+    uintptr_t in[FIFO_SIZE + 2];
+    uintptr_t out[FIFO_SIZE + 2];
+    Fifo *fifo = FifoCreate(FIFO_SIZE);
+
+    CU_ASSERT(fifo != NULL);
+    for (int i = 0; i < FIFO_SIZE + 2; i++) {
+        in[i] = i + 1;
+    }
+
+    // move the indexes so that the next batch wraps around the buffer end
+    ret = FifoPutN(fifo, (void **)in, 5);
+    CU_ASSERT(ret == 5);
+    ret = FifoGetN(fifo, (void **)out, 5);
+    CU_ASSERT(ret == 5);
+
+    ret = FifoPutN(fifo, (void **)in, FIFO_SIZE + 2);
+    CU_ASSERT(ret == FIFO_SIZE);
+    CU_ASSERT(fifo->in == fifo->in_head);
+
+    ret = FifoGetN(fifo, (void **)out, FIFO_SIZE + 2);
+    CU_ASSERT(ret == FIFO_SIZE);
+    for (int i = 0; i < FIFO_SIZE; i++) {
+        CU_ASSERT(out[i] == in[i]);
+    }
+
+    ret = FifoGetN(fifo, (void **)out, 1);
+    CU_ASSERT(ret == 0);
+    FifoDestroy(fifo);
+}
+
+static void TestFifoNotify(void)
+{
+    int ret = 0;
+    uint32_t elem = 1;
+    uint64_t val = 0;
+    Fifo *fifo = FifoCreate(FIFO_SIZE);
+
+    CU_ASSERT(fifo != NULL);
+
+    // only the first put after consumer armed the fifo writes eventfd
+    for (int i = 0; i < 4; i++) {
+        CU_ASSERT(FifoPut(fifo, &elem) == 0);
+        CU_ASSERT(FifoNotify(fifo) == 0);
+    }
+    CU_ASSERT(fifo->notify_cnt == 1);
+    CU_ASSERT(read(fifo->triggerFd, &val, sizeof(val)) == sizeof(val));
+    CU_ASSERT(val == 1);
+
+    // fifo is not empty, consumer must keep draining instead of waiting
+    ret = FifoArm(fifo);
+    CU_ASSERT(ret == 1);
+    CU_ASSERT(FifoGetN(fifo, (void **)&val, 1) == 1);
+    while (FifoGet(fifo, (void **)&val) == 0) {
+        ;
+    }
+    ret = FifoArm(fifo);
+    CU_ASSERT(ret == 0);
+
+    CU_ASSERT(FifoPut(fifo, &elem) == 0);
+    CU_ASSERT(FifoNotify(fifo) == 0);
+    CU_ASSERT(fifo->notify_cnt == 2);
+    FifoDestroy(fifo);
+}
+
+static void TestFifoStats(void)
+{
+    uint32_t elems[FIFO_SIZE];
+    void *elemP = NULL;
+    Fifo *fifo = FifoCreate(FIFO_SIZE);
+
+    CU_ASSERT(fifo != NULL);
+    for (int i = 0; i < FIFO_SIZE; i++) {
+        CU_ASSERT(FifoPut(fifo, &elems[i]) == 0);
+    }
+    CU_ASSERT(FifoPut(fifo, &elems[0]) == -1);
+    CU_ASSERT(fifo->enqueued == FIFO_SIZE);
+    CU_ASSERT(fifo->high_watermark == FIFO_SIZE);
+    CU_ASSERT(FifoDepth(fifo) == FIFO_SIZE);
+
+    // drop-oldest: the producer takes the oldest element away to make room
+    CU_ASSERT(FifoGet(fifo, &elemP) == 0);
+    CU_ASSERT(elemP == &elems[0]);
+    CU_ASSERT(FifoPut(fifo, &elems[0]) == 0);
+    CU_ASSERT(FifoGet(fifo, &elemP) == 0);
+    CU_ASSERT(elemP == &elems[1]);
+
+    CU_ASSERT(fifo->enqueued == FIFO_SIZE + 1);
+    CU_ASSERT(fifo->high_watermark == FIFO_SIZE);
+    CU_ASSERT(FifoDepth(fifo) == FIFO_SIZE - 1);
+    FifoDestroy(fifo);
+}
+
+struct fifo_bench_s {
+    Fifo *fifo;
+    int coalesce;               // 0: per-element put and eventfd write; 1: FifoNotify and batch get
+    uint64_t syscalls;
+};
+
+static void *FifoBenchProducer(void *arg)
+{
+    struct fifo_bench_s *bench = (struct fifo_bench_s *)arg;
+    uint64_t msg = 1;
+    uintptr_t elem;
+
+    for (elem = 1; elem <= BENCH_RECORDS_NUM; elem++) {
+        while (FifoPut(bench->fifo, (void *)elem) != 0) {
+            (void)FifoNotify(bench->fifo);
+            sched_yield();
+        }
+        if (bench->coalesce) {
+            (void)FifoNotify(bench->fifo);
+        } else {
+            (void)write(bench->fifo->triggerFd, &msg, sizeof(msg));
+            __atomic_add_fetch(&bench->syscalls, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static void FifoBenchRun(int coalesce)
+{
+    struct fifo_bench_s bench = {0};
+    void *elems[FIFO_BATCH_SIZE];
+    struct timespec start, end;
+    uint64_t val, got = 0;
+    uint32_t num;
+    pthread_t tid;
+    double secs;
+
+    bench.fifo = FifoCreate(BENCH_FIFO_SIZE);
+    bench.coalesce = coalesce;
+    CU_ASSERT_FATAL(bench.fifo != NULL);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    CU_ASSERT_FATAL(pthread_create(&tid, NULL, FifoBenchProducer, &bench) == 0);
+
+    while (got < BENCH_RECORDS_NUM) {
+        (void)read(bench.fifo->triggerFd, &val, sizeof(val));
+        bench.syscalls++;
+        if (coalesce) {
+            do {
+                while ((num = FifoGetN(bench.fifo, elems, FIFO_BATCH_SIZE)) > 0) {
+                    got += num;
+                }
+            } while (FifoArm(bench.fifo));
+        } else {
+            while (FifoGet(bench.fifo, elems) == 0) {
+                got++;
+            }
+        }
+    }
+    (void)pthread_join(tid, NULL);
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+    bench.syscalls += bench.fifo->notify_cnt;
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("\n    [%s] %u records, %.0f records/s, %.4f syscalls/record\n",
+           coalesce ? "batch+coalesced" : "per-element", BENCH_RECORDS_NUM,
+           BENCH_RECORDS_NUM / secs, (double)bench.syscalls / BENCH_RECORDS_NUM);
+
+    CU_ASSERT(got == BENCH_RECORDS_NUM);
+    FifoDestroy(bench.fifo);
+}
+
+static void TestFifoBenchmark(void)
+{
+    FifoBenchRun(0);
+    FifoBenchRun(1);
+}
+
 void TestFifoMain(CU_pSuite suite)
 {
     CU_ADD_TEST(suite, TestFifoCreate);
     CU_ADD_TEST(suite, TestFifoPut);
     CU_ADD_TEST(suite, TestFifoGet);
+    CU_ADD_TEST(suite, TestFifoPutNGetN);
+    CU_ADD_TEST(suite, TestFifoNotify);
+    CU_ADD_TEST(suite, TestFifoStats);
+    // Timing runs are kept out of the unit run, set GALA_TEST_BENCH to run them.
+    if (getenv("GALA_TEST_BENCH") != NULL) {
+        CU_ADD_TEST(suite, TestFifoBenchmark);
+    }
 }
 
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024. All rights reserved.
+ * gala-gopher licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: gala-gopher
+ * Create: 2024-11-30
+ * Description: provide gala-gopher test for histogram
+ ******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+
+#include "histogram.h"
+#include "test_histogram.h"
+
+#define TEST_BUCKET_SIZE    3
+#define TEST_HISTO_BUF_LEN  256
+
+static struct bucket_range_s g_test_ranges[TEST_BUCKET_SIZE] = {{0, 10}, {10, 20}, {20, 30}};
+
+static void TestHistoBucketAddCounts(void)
+{
+    struct histo_bucket_array_s buckets = {0};
+    u32 counts[TEST_BUCKET_SIZE] = {2, 0, 1};
+    u32 zeros[TEST_BUCKET_SIZE] = {0};
+    char buf[TEST_HISTO_BUF_LEN];
+
+    // Counts bucketed in kernel, sum and max of the values are kept in the highest bucket
+    CU_ASSERT(histo_bucket_add_counts(&buckets, TEST_BUCKET_SIZE, counts, 40, 25) == 0);
+    CU_ASSERT(buckets.histo_buckets != NULL);
+    CU_ASSERT(buckets.histo_buckets[1] == NULL);
+    CU_ASSERT(buckets.histo_buckets[2]->count == 1 && buckets.histo_buckets[2]->sum == 40);
+
+    // Mixes with values added in user space
+    CU_ASSERT(histo_bucket_add_value(g_test_ranges, &buckets, TEST_BUCKET_SIZE, 5) == 0);
+    CU_ASSERT(serialize_histo(g_test_ranges, &buckets, TEST_BUCKET_SIZE, buf, sizeof(buf)) == 0);
+    CU_ASSERT_STRING_EQUAL(buf, "3 10 3 20 3 30 4 45 25");
+
+    // No counts, the sum and max are dropped
+    CU_ASSERT(histo_bucket_add_counts(&buckets, TEST_BUCKET_SIZE, zeros, 100, 100) == 0);
+    CU_ASSERT(serialize_histo(g_test_ranges, &buckets, TEST_BUCKET_SIZE, buf, sizeof(buf)) == 0);
+    CU_ASSERT_STRING_EQUAL(buf, "3 10 3 20 3 30 4 45 25");
+
+    free_histo_buckets(&buckets, TEST_BUCKET_SIZE);
+}
+
+void TestHistogramMain(CU_pSuite suite)
+{
+    CU_ADD_TEST(suite, TestHistoBucketAddCounts);
+}
@@ -13,6 +13,7 @@
  * Description: provide gala-gopher test
  ******************************************************************************/
 #include <stdint.h>
+#include <string.h>
 #include <CUnit/Basic.h>
 
 #include "imdb.h"
@@ -35,6 +36,8 @@ static void TestIMDB_RecordAppendKey(void);
 static void TestHASH_addRecord(void);
 static void TestHASH_deleteRecord(void);
 static void TestIMDB_TableSetRecordKeySize(void);
+static void TestIMDB_DataBase2MetricsSnapshot(void);
+static void TestIMDB_TableUpsertRecord(void);
 #endif
 
 static void TestIMDB_MetricCreate(void)
@@ -349,6 +352,93 @@ static void TestIMDB_TableSetRecordKeySize(void)
     IMDB_TableDestroy(table);
 }
 
+#define SNAPSHOT_BUF_LEN    (1024 * 1024)
+
+static int SnapshotSink(void *ctx, const char *buf, uint32_t len)
+{
+    *(uint32_t *)ctx += len;
+    return 0;
+}
+
+static void TestIMDB_DataBase2MetricsSnapshot(void)
+{
+    static char buffer[SNAPSHOT_BUF_LEN];
+    char content[LINE_BUF_LEN];
+    uint32_t first = 0, second = 0, stream = 0, left = 0;
+    IMDB_DataBaseMgr *mgr = IMDB_DataBaseMgrCreate(1);
+    IMDB_Table *table = IMDB_TableCreate("snapshot", 1024);
+    IMDB_Meta *meta = IMDB_MetaCreate(2);
+    CU_ASSERT_FATAL(mgr != NULL && table != NULL && meta != NULL);
+
+    meta->metrics[0] = IMDB_MetricCreate("id", "id", "key");
+    meta->metrics[1] = IMDB_MetricCreate("value", "value", "gauge");
+    IMDB_TableSetMeta(table, meta);
+    IMDB_TableSetEntityName(table, "snapshot");
+    CU_ASSERT_FATAL(IMDB_DataBaseMgrAddTable(mgr, table) == 0);
+
+    for (int i = 0; i < 100; i++) {
+        (void)snprintf(content, sizeof(content), "|%d|%d|\n", i, i);
+        CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, content) != NULL);
+    }
+
+    // Records are kept for the next scraper, draining them afterwards gives the same metrics.
+    CU_ASSERT(IMDB_DataBase2MetricsSnapshot(mgr, buffer, SNAPSHOT_BUF_LEN, SnapshotSink, &first) == 0);
+    CU_ASSERT(IMDB_DataBase2MetricsSnapshot(mgr, buffer, SNAPSHOT_BUF_LEN, SnapshotSink, &second) == 0);
+    CU_ASSERT(first > 0 && first == second);
+    CU_ASSERT(table->recordNum == 100);
+
+    CU_ASSERT(IMDB_DataBase2MetricsStream(mgr, buffer, SNAPSHOT_BUF_LEN, SnapshotSink, &stream) == 0);
+    CU_ASSERT(stream == first);
+    CU_ASSERT(IMDB_DataBase2MetricsSnapshot(mgr, buffer, SNAPSHOT_BUF_LEN, SnapshotSink, &left) == 0);
+    CU_ASSERT(left == 0);
+
+    IMDB_DataBaseMgrDestroy(mgr);
+}
+
+static void TestIMDB_TableUpsertRecord(void)
+{
+    IMDB_DataBaseMgr *mgr = IMDB_DataBaseMgrCreate(1);
+    IMDB_Table *table = IMDB_TableCreate("upsert", 1024);
+    IMDB_Meta *meta = IMDB_MetaCreate(3);
+    IMDB_Record *eth0, *eth1;
+    uint64_t allocs;
+    char *value;
+    CU_ASSERT_FATAL(mgr != NULL && table != NULL && meta != NULL);
+
+    // Series sharing the key column differ by labels, e.g. nic_failure
+    meta->metrics[0] = IMDB_MetricCreate("name", "name", "key");
+    meta->metrics[1] = IMDB_MetricCreate("dev", "dev", "label");
+    meta->metrics[2] = IMDB_MetricCreate("value", "value", "gauge");
+    IMDB_TableSetMeta(table, meta);
+    IMDB_TableSetEntityName(table, "upsert");
+    CU_ASSERT_FATAL(IMDB_DataBaseMgrAddTable(mgr, table) == 0);
+
+    eth0 = IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|1|\n");
+    eth1 = IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth1|2|\n");
+    CU_ASSERT_FATAL(eth0 != NULL && eth1 != NULL);
+    CU_ASSERT(eth0 != eth1);
+
+    CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|3|\n") == eth0);
+    CU_ASSERT(table->recordNum == 2);
+    CU_ASSERT(strcmp(eth0->value[2], "3") == 0);
+    CU_ASSERT(strcmp(eth1->value[2], "2") == 0);
+
+    // Storage of a value is kept after a shorter value, the longer one fits in again
+    CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|1234567|\n") == eth0);
+    value = eth0->value[2];
+    CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|7|\n") == eth0);
+    CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|1234567|\n") == eth0);
+    CU_ASSERT(eth0->value[2] == value && strcmp(value, "1234567") == 0);
+
+    // A growing value of a record is moved out of arena, so arena does not grow with updates
+    allocs = table->arena.allocs;
+    CU_ASSERT(IMDB_DataBaseMgrCreateRec(mgr, table, "|nic|eth0|123456789012345|\n") == eth0);
+    CU_ASSERT(strcmp(eth0->value[2], "123456789012345") == 0);
+    CU_ASSERT(table->arena.allocs == allocs);
+
+    IMDB_DataBaseMgrDestroy(mgr);
+}
+
 void TestIMDBMain(CU_pSuite suite)
 {
     CU_ADD_TEST(suite, TestIMDB_MetricCreate);
@@ -367,5 +457,7 @@ void TestIMDBMain(CU_pSuite suite)
     CU_ADD_TEST(suite, TestHASH_addRecord);
     CU_ADD_TEST(suite, TestHASH_deleteRecord);
     CU_ADD_TEST(suite, TestIMDB_TableSetRecordKeySize);
+    CU_ADD_TEST(suite, TestIMDB_DataBase2MetricsSnapshot);
+    CU_ADD_TEST(suite, TestIMDB_TableUpsertRecord);
 }
 
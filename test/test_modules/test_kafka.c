@@ -14,6 +14,7 @@
  ******************************************************************************/
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <CUnit/Basic.h>
 
 #include "kafka.h"
@@ -66,9 +67,107 @@ static void TestKafkaMsgProduce(void)
     ConfigMgrDestroy(configMgr);
 }
 
+#define TEST_BATCH_MSG_NUM 3
+static void TestKafkaMsgProduceBatch(void)
+{
+    int ret;
+    char *msgs[TEST_BATCH_MSG_NUM];
+    KafkaStats stats;
+
+    for (int i = 0; i < TEST_BATCH_MSG_NUM; i++) {
+        msgs[i] = (char *)malloc(10);
+        CU_ASSERT_FATAL(msgs[i] != NULL);
+        (void)snprintf(msgs[i], 10, "record_%d", i);
+    }
+
+    ConfigMgr *configMgr = init_kafka_config();
+    CU_ASSERT(configMgr != NULL);
+    configMgr->kafkaConfig->msgPack = KAFKA_MSG_PACK_NEWLINE;
+
+    KafkaMgr *mgr = KafkaMgrCreate(configMgr, "kafka_topic");
+    CU_ASSERT(mgr != NULL);
+
+    ret = KafkaMsgProduceBatch(mgr, msgs, TEST_BATCH_MSG_NUM);
+    CU_ASSERT(ret == 0);
+
+    // All records are packed into one kafka message
+    KafkaPoll(mgr);
+    KafkaMgrGetStats(mgr, &stats);
+    CU_ASSERT(stats.records == TEST_BATCH_MSG_NUM);
+    CU_ASSERT(stats.produced == 1);
+    CU_ASSERT(stats.failed == 0);
+
+    KafkaMgrDestroy(mgr);
+    ConfigMgrDestroy(configMgr);
+}
+
+static void TestKafkaPackMsgs(void)
+{
+    char rec0[] = "ab";
+    char rec1[] = "cde";
+    char *msgs[] = {rec0, rec1};
+    uint32_t lens[] = {2, 3};
+    const char newline[] = "ab\ncde\n";
+    const char length[] = {0, 0, 0, 2, 'a', 'b', 0, 0, 0, 3, 'c', 'd', 'e'};
+    uint32_t size;
+    char *buf;
+
+    size = KafkaPackSize(KAFKA_MSG_PACK_NEWLINE, lens[0]) + KafkaPackSize(KAFKA_MSG_PACK_NEWLINE, lens[1]);
+    CU_ASSERT_FATAL(size == sizeof(newline) - 1);
+    buf = KafkaPackMsgs(KAFKA_MSG_PACK_NEWLINE, msgs, lens, 2, size);
+    CU_ASSERT_FATAL(buf != NULL);
+    CU_ASSERT(memcmp(buf, newline, size) == 0);
+    free(buf);
+
+    // Each record follows its length in big-endian
+    size = KafkaPackSize(KAFKA_MSG_PACK_LENGTH, lens[0]) + KafkaPackSize(KAFKA_MSG_PACK_LENGTH, lens[1]);
+    CU_ASSERT_FATAL(size == sizeof(length));
+    buf = KafkaPackMsgs(KAFKA_MSG_PACK_LENGTH, msgs, lens, 2, size);
+    CU_ASSERT_FATAL(buf != NULL);
+    CU_ASSERT(memcmp(buf, length, size) == 0);
+    free(buf);
+}
+
+static void TestKafkaMsgProducePending(void)
+{
+    char *msgs[TEST_BATCH_MSG_NUM];
+    KafkaStats stats;
+
+    ConfigMgr *configMgr = init_kafka_config();
+    CU_ASSERT_FATAL(configMgr != NULL);
+    configMgr->kafkaConfig->msgPack = KAFKA_MSG_PACK_NONE;
+    configMgr->kafkaConfig->queueBufferingMaxMessages = 1;
+
+    KafkaMgr *mgr = KafkaMgrCreate(configMgr, "kafka_topic");
+    CU_ASSERT_FATAL(mgr != NULL);
+
+    // Local queue of librdkafka takes only the first one, the others wait in pending.
+    for (int i = 0; i < TEST_BATCH_MSG_NUM; i++) {
+        msgs[i] = strdup("record");
+        CU_ASSERT_FATAL(msgs[i] != NULL);
+    }
+    CU_ASSERT(KafkaMsgProduceBatch(mgr, msgs, TEST_BATCH_MSG_NUM) == 0);
+    CU_ASSERT(mgr->pendingNum == TEST_BATCH_MSG_NUM - 1);
+
+    // New records queue up behind the pending ones.
+    msgs[0] = strdup("record");
+    CU_ASSERT_FATAL(msgs[0] != NULL);
+    CU_ASSERT(KafkaMsgProduceBatch(mgr, msgs, 1) == 0);
+    CU_ASSERT(mgr->pendingNum == TEST_BATCH_MSG_NUM);
+
+    KafkaMgrGetStats(mgr, &stats);
+    CU_ASSERT(stats.produced == 1);
+    CU_ASSERT(stats.failed == 0);
+
+    KafkaMgrDestroy(mgr);
+    ConfigMgrDestroy(configMgr);
+}
 
 void TestKafkaMain(CU_pSuite suite)
 {
     CU_ADD_TEST(suite, TestKafkaMsgProduce);
+    CU_ADD_TEST(suite, TestKafkaMsgProduceBatch);
+    CU_ADD_TEST(suite, TestKafkaPackMsgs);
+    CU_ADD_TEST(suite, TestKafkaMsgProducePending);
 }
 